@@ -0,0 +1,340 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+
+#include "MAVLinkUdpConnection.h"
+#include "Vehicle.h"
+#include "TelemetryLog.h"
+#include "Logger.h"
+#include "FactValueFormatter.h"
+
+/// Cost of every stage a telemetry frame goes through, per message type: parsing a datagram,
+/// Vehicle::handleMessage dispatch into the fact groups, Fact::setRawValue fanning out to published
+/// listeners, FactGroup::_updateAllValues over the whole fact tree and the text formatting of the
+/// snapshot and data log. Frames are synthetic, packed with the c_library_v2 pack functions, and every
+/// stage runs in isolation on one thread so the numbers are comparable between builds.
+///
+/// Each result is the median of several runs. -format csv or json gives machine readable output,
+/// one record per stage and message type, to diff in review. -fact_arena places the vehicle's facts in
+/// a FactArena, to compare both layouts.
+///
+///     HotPathBenchmark [-iterations <n>] [-repeats <n>] [-format table|csv|json] [-fact_arena]
+
+namespace {
+
+constexpr uint8_t kSystemId = 1;
+constexpr uint8_t kComponentId = MAV_COMP_ID_AUTOPILOT1;
+constexpr size_t kFramesPerDatagram = 256;     ///< Keeps sequence numbers contiguous across datagrams
+
+struct Sample {
+    const char *name;
+    mavlink_message_t message;
+};
+
+/// One frame of each message type the built-in fact groups decode
+std::vector<Sample> samples()
+{
+    std::vector<Sample> samples;
+    mavlink_message_t message;
+    const int32_t latitude = 473977420;
+    const int32_t longitude = 85455940;
+
+    mavlink_msg_heartbeat_pack(kSystemId, kComponentId, &message, MAV_TYPE_QUADROTOR, MAV_AUTOPILOT_PX4,
+                               MAV_MODE_FLAG_CUSTOM_MODE_ENABLED, 0, MAV_STATE_ACTIVE);
+    samples.push_back({"HEARTBEAT", message});
+    mavlink_msg_attitude_pack(kSystemId, kComponentId, &message, 123456, 0.1f, -0.05f, 1.5f, 0.01f, 0.02f, 0.03f);
+    samples.push_back({"ATTITUDE", message});
+    mavlink_msg_global_position_int_pack(kSystemId, kComponentId, &message, 123456, latitude, longitude,
+                                         500000, 20000, 100, 50, -10, 9000);
+    samples.push_back({"GLOBAL_POSITION_INT", message});
+    mavlink_msg_vfr_hud_pack(kSystemId, kComponentId, &message, 12.0f, 11.5f, 90, 55, 20.0f, 0.5f);
+    samples.push_back({"VFR_HUD", message});
+    mavlink_msg_gps_raw_int_pack(kSystemId, kComponentId, &message, 123456000, GPS_FIX_TYPE_3D_FIX, latitude, longitude,
+                                 500000, 80, 120, 1150, 9000, 14, 0, 0, 0, 0, 0, 0);
+    samples.push_back({"GPS_RAW_INT", message});
+    mavlink_msg_sys_status_pack(kSystemId, kComponentId, &message, 0x3fffff, 0x3fffff, 0x3fffff, 500, 15800, 1200, 80,
+                                0, 0, 0, 0, 0, 0, 0, 0, 0);
+    samples.push_back({"SYS_STATUS", message});
+    uint16_t voltages[10] = {3950, 3950, 3950, 3950, UINT16_MAX, UINT16_MAX, UINT16_MAX, UINT16_MAX, UINT16_MAX, UINT16_MAX};
+    uint16_t voltagesExt[4] = {0, 0, 0, 0};
+    mavlink_msg_battery_status_pack(kSystemId, kComponentId, &message, 0, MAV_BATTERY_FUNCTION_ALL, MAV_BATTERY_TYPE_LIPO,
+                                    2500, voltages, 1200, 850, 40, 80, 1800, MAV_BATTERY_CHARGE_STATE_OK, voltagesExt,
+                                    MAV_BATTERY_MODE_UNKNOWN, 0);
+    samples.push_back({"BATTERY_STATUS", message});
+    mavlink_msg_rc_channels_pack(kSystemId, kComponentId, &message, 123456, 8, 1500, 1500, 1100, 1500, 1900, 1000, 1500, 1500,
+                                 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 200);
+    samples.push_back({"RC_CHANNELS", message});
+    mavlink_msg_vibration_pack(kSystemId, kComponentId, &message, 123456000, 4.5f, 5.0f, 12.0f, 0, 0, 2);
+    samples.push_back({"VIBRATION", message});
+    mavlink_msg_wind_cov_pack(kSystemId, kComponentId, &message, 123456000, 3.0f, -1.5f, 0.2f, 0.5f, 0.3f, 100.0f, 0.0f, 0.0f);
+    samples.push_back({"WIND_COV", message});
+    return samples;
+}
+
+/// Vehicle whose fact tree refresh can be called directly
+class BenchmarkVehicle : public Vehicle
+{
+public:
+    using Vehicle::Vehicle;
+    using Vehicle::_updateAllValues;
+};
+
+/// Sink for the vehicle's console output while the benchmark runs
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+};
+
+struct Result {
+    std::string stage;
+    std::string message;            ///< "-" for stages which don't depend on the message type
+    uint64_t operations = 0;        ///< Per run
+    double nsPerOperation = 0.0;
+};
+
+/// Median time per operation over several runs of operationsPerRun operations. operation(i) does
+/// operations number i, which lets stages alternate values so nothing is skipped as unchanged.
+template <typename Operation>
+double measure(Operation &&operation, uint64_t operationsPerRun, int repeats)
+{
+    std::vector<double> runs;
+    for (int repeat = 0; repeat < repeats; repeat++) {
+        const auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < operationsPerRun; i++) {
+            operation(i);
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        runs.push_back(std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(operationsPerRun));
+    }
+    std::sort(runs.begin(), runs.end());
+    return runs[runs.size() / 2];
+}
+
+void printResults(const std::vector<Result> &results, const std::string &format, uint64_t iterations, int repeats)
+{
+    if (format == "json") {
+        printf("{\n  \"benchmark\": \"HotPathBenchmark\",\n  \"iterations\": %llu,\n  \"repeats\": %d,\n  \"results\": [\n",
+               static_cast<unsigned long long>(iterations), repeats);
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result &result = results[i];
+            printf("    {\"stage\": \"%s\", \"message\": \"%s\", \"operations\": %llu, \"ns_per_op\": %.2f}%s\n",
+                   result.stage.c_str(), result.message.c_str(), static_cast<unsigned long long>(result.operations),
+                   result.nsPerOperation, i + 1 < results.size() ? "," : "");
+        }
+        printf("  ]\n}\n");
+    } else if (format == "csv") {
+        printf("stage,message,operations,ns_per_op\n");
+        for (const Result &result : results) {
+            printf("%s,%s,%llu,%.2f\n", result.stage.c_str(), result.message.c_str(),
+                   static_cast<unsigned long long>(result.operations), result.nsPerOperation);
+        }
+    } else {
+        printf("Hot path stages, median of %d runs of %llu operations\n", repeats, static_cast<unsigned long long>(iterations));
+        printf("%-20s %-20s %12s %14s\n", "stage", "message", "ns/op", "ops/s");
+        for (const Result &result : results) {
+            printf("%-20s %-20s %12.1f %14.0f\n", result.stage.c_str(), result.message.c_str(), result.nsPerOperation,
+                   result.nsPerOperation > 0.0 ? 1e9 / result.nsPerOperation : 0.0);
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    uint64_t iterations = 200000;
+    int repeats = 5;
+    std::string format = "table";
+    bool factArena = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-iterations" && i + 1 < argc) {
+            iterations = static_cast<uint64_t>(std::max(1LL, atoll(argv[++i])));
+        } else if (arg == "-repeats" && i + 1 < argc) {
+            repeats = std::max(1, atoi(argv[++i]));
+        } else if (arg == "-format" && i + 1 < argc) {
+            format = argv[++i];
+        } else if (arg == "-fact_arena") {
+            factArena = true;
+        } else {
+            std::cout << "Usage: " << argv[0] << " [-iterations <n>] [-repeats <n>] [-format table|csv|json] [-fact_arena]\n";
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+    if (format != "table" && format != "csv" && format != "json") {
+        std::cerr << "Unknown format " << format << "\n";
+        return 1;
+    }
+
+    Logger::instance().setLevel(Logger::Warning);
+    NullBuffer nullBuffer;
+    std::streambuf *coutBuffer = std::cout.rdbuf(&nullBuffer);
+
+    const std::vector<Sample> messages = samples();
+    std::vector<Result> results;
+    auto record = [&](const std::string &stage, const std::string &message, uint64_t operations, double nsPerOperation) {
+        results.push_back(Result{stage, message, operations, nsPerOperation});
+    };
+
+    // Parser: datagrams of back to back frames of one type with contiguous sequence numbers, nothing
+    // attached to the connection so dispatch isn't included
+    {
+        MAVLinkUdpConnection connection;
+        const uint64_t datagrams = std::max<uint64_t>(1, iterations / kFramesPerDatagram);
+        for (const Sample &sample : messages) {
+            std::vector<uint8_t> datagram;
+            mavlink_message_t message = sample.message;
+            uint8_t frame[MAVLINK_MAX_PACKET_LEN];
+            for (size_t i = 0; i < kFramesPerDatagram; i++) {
+                mavlink_status_t status{};
+                status.current_tx_seq = static_cast<uint8_t>(i);
+                mavlink_finalize_message_buffer(&message, message.sysid, message.compid, &status, message.len, message.len,
+                                                mavlink_get_crc_extra(&message));
+                uint16_t length = mavlink_msg_to_send_buffer(frame, &message);
+                datagram.insert(datagram.end(), frame, frame + length);
+            }
+            const double nsPerDatagram = measure([&](uint64_t) {
+                connection.processDatagram(datagram.data(), datagram.size());
+            }, datagrams, repeats);
+            record("parse", sample.name, datagrams * kFramesPerDatagram, nsPerDatagram / kFramesPerDatagram);
+        }
+    }
+
+    // Creating a vehicle with all its fact groups and managers, as a VehicleManager does on discovery
+    {
+        const uint64_t vehicles = std::max<uint64_t>(1, iterations / 1000);
+        const double ns = measure([&](uint64_t) {
+            BenchmarkVehicle discovered(nullptr, kSystemId, kComponentId, {}, factArena);
+        }, vehicles, repeats);
+        record("create_vehicle", "-", vehicles, ns);
+    }
+
+    BenchmarkVehicle vehicle(nullptr, kSystemId, kComponentId, {}, factArena);
+    for (const Sample &sample : messages) {
+        vehicle.handleMessage(sample.message);
+    }
+
+    // Dispatch through the vehicle into its fact groups and managers
+    for (const Sample &sample : messages) {
+        const double ns = measure([&](uint64_t) { vehicle.handleMessage(sample.message); }, iterations, repeats);
+        record("dispatch", sample.name, iterations, ns);
+    }
+
+    // A fact publishing to a growing number of listeners on its group
+    {
+        std::shared_ptr<FactGroup> group = vehicle.getFactGroup("vehicle");
+        std::shared_ptr<Fact> fact = group ? group->getFact("roll") : nullptr;
+        uint64_t notified = 0;
+        std::vector<int> listenerIds;
+        for (size_t listeners : {0, 1, 4, 16}) {
+            while (fact && listenerIds.size() < listeners) {
+                listenerIds.push_back(group->addFactPublishedListener([&notified](const FactGroup*, const Fact*) { notified++; }));
+            }
+            if (fact) {
+                const double ns = measure([&](uint64_t i) {
+                    fact->setRawValue(static_cast<double>(i & 1) * 0.5);
+                }, iterations, repeats);
+                record("set_raw_value", std::to_string(listeners) + "_listeners", iterations, ns);
+            }
+        }
+        for (int listenerId : listenerIds) {
+            group->removeFactPublishedListener(listenerId);
+        }
+    }
+
+    // Reading a cooked value through a built-in translator, against the same conversion as a custom one
+    {
+        auto metaData = std::make_shared<FactMetaData>(FactMetaData::valueTypeDouble);
+        Fact fact(0, "yaw", FactMetaData::valueTypeDouble);
+        fact.setMetaData(metaData);
+        fact.setRawValue(1.5);
+        const std::pair<const char*, FactMetaData::TranslatorKind> translators[] = {
+            {"identity", FactMetaData::TranslatorIdentity},
+            {"radians_to_degrees", FactMetaData::TranslatorRadiansToDegrees},
+            {"custom", FactMetaData::TranslatorCustom},
+        };
+        double sum = 0.0;
+        for (const auto &[name, kind] : translators) {
+            if (kind == FactMetaData::TranslatorCustom) {
+                metaData->setTranslators(
+                    [](const Fact::ValueVariant_t &degrees) -> Fact::ValueVariant_t { return std::get<double>(degrees) * M_PI / 180.0; },
+                    [](const Fact::ValueVariant_t &radians) -> Fact::ValueVariant_t { return std::get<double>(radians) * 180.0 / M_PI; });
+            } else {
+                metaData->setTranslator(kind);
+            }
+            const double ns = measure([&](uint64_t) { sum += std::get<double>(fact.cookedValue()); }, iterations, repeats);
+            record("cooked_value", name, iterations, ns);
+        }
+        // Keeps the reads from being optimized away
+        volatile double result = sum;
+        (void)result;
+    }
+
+    // Refresh of the whole fact tree, which dispatch does once per message
+    {
+        const double ns = measure([&](uint64_t) { vehicle._updateAllValues(); }, iterations, repeats);
+        record("update_all_values", "-", iterations, ns);
+    }
+
+    // Text of single values and of a whole group, as the query server and parameter output write them
+    {
+        std::shared_ptr<FactGroup> group = vehicle.getFactGroup("vehicle");
+        std::shared_ptr<Fact> fact = group ? group->getFact("roll") : nullptr;
+        if (fact) {
+            size_t bytes = 0;
+            const double stringNs = measure([&](uint64_t) { bytes += fact->cookedValueString().size(); }, iterations, repeats);
+            record("value_string", "string", iterations, stringNs);
+
+            char buffer[FactValueFormatter::kBufferSize];
+            const double bufferNs = measure([&](uint64_t) {
+                bytes += fact->cookedValueString(buffer, buffer + sizeof(buffer)) - buffer;
+            }, iterations, repeats);
+            record("value_string", "buffer", iterations, bufferNs);
+
+            std::string text;
+            const uint64_t groups = std::max<uint64_t>(1, iterations / 100);
+            const double groupNs = measure([&](uint64_t) {
+                text.clear();
+                group->formatValues(text);
+            }, groups, repeats);
+            record("format_group", "vehicle", groups, groupNs);
+            bytes += text.size();
+
+            volatile size_t result = bytes;
+            (void)result;
+        }
+    }
+
+    // Console snapshot and one data log line per message
+    {
+        const uint64_t snapshots = std::max<uint64_t>(1, iterations / 100);
+        size_t bytes = 0;
+        const double ns = measure([&](uint64_t i) {
+            bytes += TelemetryLog::telemetrySnapshot(&vehicle, static_cast<int64_t>(i)).size();
+        }, snapshots, repeats);
+        record("snapshot", "-", snapshots, ns);
+
+        std::ostringstream line;
+        for (const Sample &sample : messages) {
+            const double lineNs = measure([&](uint64_t i) {
+                line.str(std::string());
+                TelemetryLog::writeMessageLine(line, static_cast<int64_t>(i), sample.message, &vehicle);
+            }, iterations, repeats);
+            record("log_line", sample.name, iterations, lineNs);
+        }
+    }
+
+    std::cout.rdbuf(coutBuffer);
+    Logger::instance().shutdown();
+
+    printResults(results, format, iterations, repeats);
+    return 0;
+}
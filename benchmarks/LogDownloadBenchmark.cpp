@@ -0,0 +1,316 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "MAVLinkUdpConnection.h"
+#include "VehicleManager.h"
+#include "Vehicle.h"
+#include "LogDownloader.h"
+#include "Logger.h"
+
+/// Sustained throughput of LogDownloader against a simulated vehicle on UDP loopback. The vehicle
+/// serves one LOG_REQUEST_DATA at a time like the autopilots do and drops the given share of LOG_DATA
+/// chunks, every run downloads the same log and checks the file contents afterwards.
+///
+///     LogDownloadBenchmark [-port <n>] [-size <bytes>] [-loss <percent>,...] [-file <path>]
+
+namespace {
+
+constexpr uint8_t kSystemId = 1;
+constexpr uint8_t kComponentId = MAV_COMP_ID_AUTOPILOT1;
+constexpr uint16_t kLogId = 1;
+constexpr mavlink_channel_t kChannel = MAVLINK_COMM_3;     // The collector parses on channel 0
+
+uint8_t logByte(uint32_t offset)
+{
+    return static_cast<uint8_t>((offset * 2654435761u) >> 13);
+}
+
+/// Autopilot side of the log protocol
+class SimulatedVehicle
+{
+public:
+    SimulatedVehicle(uint16_t collectorPort, uint32_t logSize)
+        : _logSize(logSize)
+    {
+        _socket = socket(AF_INET, SOCK_DGRAM, 0);
+        int bufferSize = 4 * 1024 * 1024;
+        setsockopt(_socket, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+
+        sockaddr_in local{};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(_socket, reinterpret_cast<sockaddr*>(&local), sizeof(local));
+
+        timeval timeout{0, 1000};
+        setsockopt(_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        _collector.sin_family = AF_INET;
+        _collector.sin_port = htons(collectorPort);
+        _collector.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        _running = true;
+        _thread = std::thread(&SimulatedVehicle::_threadFunc, this);
+    }
+
+    ~SimulatedVehicle()
+    {
+        _running = false;
+        _thread.join();
+        close(_socket);
+    }
+
+    void setLossPercent(double percent) { _lossPercent = percent; }
+    uint64_t chunksSent() const { return _chunksSent; }
+    uint64_t chunksDropped() const { return _chunksDropped; }
+
+private:
+    void _send(const mavlink_message_t &message)
+    {
+        uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
+        uint16_t length = mavlink_msg_to_send_buffer(buffer, &message);
+        sendto(_socket, buffer, length, 0, reinterpret_cast<const sockaddr*>(&_collector), sizeof(_collector));
+    }
+
+    void _handle(const mavlink_message_t &message)
+    {
+        mavlink_message_t reply;
+        switch (message.msgid) {
+        case MAVLINK_MSG_ID_LOG_REQUEST_LIST:
+            mavlink_msg_log_entry_pack_chan(kSystemId, kComponentId, kChannel, &reply, kLogId, 1, kLogId, 0, _logSize);
+            _send(reply);
+            break;
+        case MAVLINK_MSG_ID_LOG_REQUEST_DATA: {
+            mavlink_log_request_data_t request;
+            mavlink_msg_log_request_data_decode(&message, &request);
+            // A new request replaces the one being served
+            _serveOffset = std::min(request.ofs, _logSize);
+            _serveEnd = std::min<uint64_t>(static_cast<uint64_t>(request.ofs) + request.count, _logSize);
+            break;
+        }
+        case MAVLINK_MSG_ID_COMMAND_LONG: {
+            // Accept whatever the collector asks for so it doesn't keep retrying
+            mavlink_command_long_t command;
+            mavlink_msg_command_long_decode(&message, &command);
+            mavlink_msg_command_ack_pack_chan(kSystemId, kComponentId, kChannel, &reply, command.command, MAV_RESULT_ACCEPTED,
+                                              0, 0, message.sysid, message.compid);
+            _send(reply);
+            break;
+        }
+        case MAVLINK_MSG_ID_LOG_REQUEST_END:
+            _serveOffset = _serveEnd = 0;
+            break;
+        default:
+            break;
+        }
+    }
+
+    void _threadFunc()
+    {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<double> percent(0.0, 100.0);
+        mavlink_message_t message;
+        mavlink_status_t status{};
+        auto lastHeartbeat = std::chrono::steady_clock::time_point();
+
+        while (_running) {
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastHeartbeat >= std::chrono::seconds(1)) {
+                mavlink_msg_heartbeat_pack_chan(kSystemId, kComponentId, kChannel, &message, MAV_TYPE_QUADROTOR,
+                                                MAV_AUTOPILOT_ARDUPILOTMEGA, MAV_MODE_FLAG_CUSTOM_MODE_ENABLED, 0, MAV_STATE_STANDBY);
+                _send(message);
+                lastHeartbeat = now;
+            }
+
+            // Only block for requests when there is nothing to serve
+            uint8_t buffer[2048];
+            ssize_t received = recv(_socket, buffer, sizeof(buffer), _serveOffset < _serveEnd ? MSG_DONTWAIT : 0);
+            for (ssize_t i = 0; i < received; i++) {
+                if (mavlink_parse_char(kChannel, buffer[i], &message, &status) == MAVLINK_FRAMING_OK) {
+                    _handle(message);
+                }
+            }
+
+            // A burst of chunks per loop keeps the receive side responsive to new requests
+            for (int burst = 0; burst < 16 && _serveOffset < _serveEnd; burst++) {
+                uint8_t data[LogDownloader::kChunkSize] = {};
+                const uint32_t count = std::min<uint32_t>(LogDownloader::kChunkSize, _logSize - _serveOffset);
+                for (uint32_t i = 0; i < count; i++) {
+                    data[i] = logByte(_serveOffset + i);
+                }
+                _chunksSent++;
+                if (percent(random) >= _lossPercent) {
+                    mavlink_msg_log_data_pack_chan(kSystemId, kComponentId, kChannel, &message, kLogId, _serveOffset,
+                                                   static_cast<uint8_t>(count), data);
+                    _send(message);
+                } else {
+                    _chunksDropped++;
+                }
+                _serveOffset += count;
+            }
+        }
+    }
+
+    int _socket = -1;
+    sockaddr_in _collector{};
+    uint32_t _logSize = 0;
+    uint32_t _serveOffset = 0;
+    uint32_t _serveEnd = 0;
+    std::atomic<double> _lossPercent{0.0};
+    std::atomic<uint64_t> _chunksSent{0};
+    std::atomic<uint64_t> _chunksDropped{0};
+    std::atomic<bool> _running{false};
+    std::thread _thread;
+};
+
+/// Sink for the vehicles' console output while the benchmark runs
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+};
+
+struct Run {
+    double lossPercent = 0.0;
+    LogDownloader::Result result;
+    bool verified = false;
+    uint64_t chunksSent = 0;
+};
+
+bool verify(const std::string &path, uint32_t size)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    std::vector<uint8_t> contents(size + 1);
+    ssize_t length = read(fd, contents.data(), contents.size());
+    close(fd);
+    if (length != static_cast<ssize_t>(size)) {
+        return false;
+    }
+    for (uint32_t offset = 0; offset < size; offset++) {
+        if (contents[offset] != logByte(offset)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    uint16_t port = 14650;
+    uint32_t logSize = 4 * 1024 * 1024;
+    std::vector<double> losses = {0.0, 1.0, 10.0};
+    std::string path = "/tmp/LogDownloadBenchmark.bin";
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-port" && i + 1 < argc) {
+            port = static_cast<uint16_t>(atoi(argv[++i]));
+        } else if (arg == "-size" && i + 1 < argc) {
+            logSize = static_cast<uint32_t>(std::max(1LL, atoll(argv[++i])));
+        } else if (arg == "-loss" && i + 1 < argc) {
+            losses.clear();
+            for (char *token = strtok(argv[++i], ","); token; token = strtok(nullptr, ",")) {
+                losses.push_back(std::clamp(atof(token), 0.0, 99.0));
+            }
+        } else if (arg == "-file" && i + 1 < argc) {
+            path = argv[++i];
+        } else {
+            std::cout << "Usage: " << argv[0] << " [-port <n>] [-size <bytes>] [-loss <percent>,...] [-file <path>]\n";
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+
+    Logger::instance().setLevel(Logger::Warning);
+    NullBuffer nullBuffer;
+    std::streambuf *coutBuffer = std::cout.rdbuf(&nullBuffer);
+
+    MAVLinkUdpConnection connection;
+    if (!connection.connect("127.0.0.1", port)) {
+        std::cout.rdbuf(coutBuffer);
+        fprintf(stderr, "Can't listen on port %u\n", port);
+        return 1;
+    }
+    VehicleManager manager(&connection);
+    manager.start();
+    SimulatedVehicle simulatedVehicle(port, logSize);
+
+    std::shared_ptr<Vehicle> vehicle;
+    for (int i = 0; i < 500 && !(vehicle = manager.vehicle(kSystemId)); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (!vehicle) {
+        std::cout.rdbuf(coutBuffer);
+        fprintf(stderr, "Simulated vehicle was not discovered\n");
+        return 1;
+    }
+    std::shared_ptr<LogDownloader> downloader = vehicle->logDownloader();
+
+    std::promise<std::vector<LogDownloader::LogEntry>> listPromise;
+    downloader->requestLogList([&listPromise](bool, const std::vector<LogDownloader::LogEntry> &entries) {
+        listPromise.set_value(entries);
+    });
+    std::vector<LogDownloader::LogEntry> entries = listPromise.get_future().get();
+    if (entries.empty()) {
+        std::cout.rdbuf(coutBuffer);
+        fprintf(stderr, "No log listed\n");
+        return 1;
+    }
+
+    std::vector<Run> runs;
+    for (double loss : losses) {
+        simulatedVehicle.setLossPercent(loss);
+        const uint64_t sentBefore = simulatedVehicle.chunksSent();
+
+        Run run;
+        run.lossPercent = loss;
+        std::promise<LogDownloader::Result> resultPromise;
+        if (!downloader->downloadLog(entries.front(), path, [&resultPromise](const LogDownloader::Result &result) {
+                resultPromise.set_value(result);
+            })) {
+            run.result.error = "Download not started";
+        } else {
+            run.result = resultPromise.get_future().get();
+            run.verified = run.result.success && verify(path, logSize);
+        }
+        run.chunksSent = simulatedVehicle.chunksSent() - sentBefore;
+        runs.push_back(run);
+    }
+    unlink(path.c_str());
+
+    connection.disconnect();
+    std::cout.rdbuf(coutBuffer);
+    Logger::instance().shutdown();
+
+    const uint64_t chunks = (logSize + LogDownloader::kChunkSize - 1) / LogDownloader::kChunkSize;
+    printf("Log download over UDP loopback, %u bytes in %llu chunks\n", logSize, static_cast<unsigned long long>(chunks));
+    printf("%8s %10s %10s %10s %10s %10s\n", "loss %", "KB/s", "seconds", "requests", "resent %", "verified");
+    bool allVerified = true;
+    for (const auto& run : runs) {
+        double resent = chunks > 0 ? 100.0 * (static_cast<double>(run.chunksSent) - chunks) / chunks : 0.0;
+        printf("%8.1f %10.0f %10.2f %10u %10.1f %10s\n", run.lossPercent, run.result.kilobytesPerSecond(),
+               run.result.seconds, run.result.requests, resent,
+               run.verified ? "yes" : (run.result.success ? "MISMATCH" : run.result.error.c_str()));
+        allVerified = allVerified && run.verified;
+    }
+    return allVerified ? 0 : 1;
+}
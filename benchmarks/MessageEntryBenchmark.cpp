@@ -0,0 +1,180 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "MAVLinkMessageEntries.h"
+#include "../thirdparty/c_library_v2/common/mavlink.h"
+
+/// Cost of finding a message's CRC extra and lengths, which the parser does once per frame: the
+/// library's binary search over MAVLINK_MESSAGE_CRCS against the direct indexed table the
+/// collector's parse path uses. Message ids come in four orders, the few streams of a telemetry
+/// link, every message of the dialect in turn, the dialect in random order, which defeats the
+/// search's branch prediction, and ids the dialect doesn't define.
+///
+/// Before measuring, both lookups are compared over the whole 24 bit message id space, any
+/// difference fails the run with exit code 1.
+///
+///     MessageEntryBenchmark [-iterations <n>] [-repeats <n>] [-format table|csv|json]
+
+namespace {
+
+struct Result {
+    std::string lookup;
+    std::string workload;
+    uint64_t operations = 0;        ///< Per run
+    double nsPerOperation = 0.0;
+};
+
+/// Median time per lookup over several runs, cycling through messageIds
+template <typename Lookup>
+double measure(Lookup &&lookup, const std::vector<uint32_t> &messageIds, uint64_t lookupsPerRun, int repeats)
+{
+    std::vector<double> runs;
+    uint32_t sink = 0;
+    const size_t mask = messageIds.size() - 1;      // Power of two
+    for (int repeat = 0; repeat < repeats; repeat++) {
+        const auto start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < lookupsPerRun; i++) {
+            const mavlink_msg_entry_t *entry = lookup(messageIds[i & mask]);
+            sink += entry ? entry->crc_extra : 1;
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        runs.push_back(std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(lookupsPerRun));
+    }
+    // Keeps the lookups from being optimized away
+    volatile uint32_t result = sink;
+    (void)result;
+    std::sort(runs.begin(), runs.end());
+    return runs[runs.size() / 2];
+}
+
+/// Fill to a power of two length by repeating the ids
+std::vector<uint32_t> repeated(const std::vector<uint32_t> &messageIds, size_t length)
+{
+    std::vector<uint32_t> result(length);
+    for (size_t i = 0; i < length; i++) {
+        result[i] = messageIds[i % messageIds.size()];
+    }
+    return result;
+}
+
+void printResults(const std::vector<Result> &results, const std::string &format, uint64_t iterations, int repeats)
+{
+    if (format == "json") {
+        printf("{\n  \"benchmark\": \"MessageEntryBenchmark\",\n  \"iterations\": %llu,\n  \"repeats\": %d,\n  \"results\": [\n",
+               static_cast<unsigned long long>(iterations), repeats);
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result &result = results[i];
+            printf("    {\"lookup\": \"%s\", \"workload\": \"%s\", \"operations\": %llu, \"ns_per_op\": %.2f}%s\n",
+                   result.lookup.c_str(), result.workload.c_str(), static_cast<unsigned long long>(result.operations),
+                   result.nsPerOperation, i + 1 < results.size() ? "," : "");
+        }
+        printf("  ]\n}\n");
+    } else if (format == "csv") {
+        printf("lookup,workload,operations,ns_per_op\n");
+        for (const Result &result : results) {
+            printf("%s,%s,%llu,%.2f\n", result.lookup.c_str(), result.workload.c_str(),
+                   static_cast<unsigned long long>(result.operations), result.nsPerOperation);
+        }
+    } else {
+        printf("Message entry lookup, median of %d runs of %llu lookups, %zu messages in the dialect\n", repeats,
+               static_cast<unsigned long long>(iterations), MAVLinkMessageEntries::entryCount);
+        printf("%-10s %-12s %12s %14s\n", "lookup", "workload", "ns/op", "ops/s");
+        for (const Result &result : results) {
+            printf("%-10s %-12s %12.2f %14.0f\n", result.lookup.c_str(), result.workload.c_str(), result.nsPerOperation,
+                   result.nsPerOperation > 0.0 ? 1e9 / result.nsPerOperation : 0.0);
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    uint64_t iterations = 10000000;
+    int repeats = 5;
+    std::string format = "table";
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-iterations" && i + 1 < argc) {
+            iterations = static_cast<uint64_t>(std::max(1LL, atoll(argv[++i])));
+        } else if (arg == "-repeats" && i + 1 < argc) {
+            repeats = std::max(1, atoi(argv[++i]));
+        } else if (arg == "-format" && i + 1 < argc) {
+            format = argv[++i];
+        } else {
+            std::cout << "Usage: " << argv[0] << " [-iterations <n>] [-repeats <n>] [-format table|csv|json]\n";
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+    if (format != "table" && format != "csv" && format != "json") {
+        std::cerr << "Unknown format " << format << "\n";
+        return 1;
+    }
+
+    // Both lookups must agree on every id
+    uint64_t mismatches = 0;
+    for (uint32_t messageId = 0; messageId < (1u << 24); messageId++) {
+        // The library searches its own copy of the entries, compare contents
+        const mavlink_msg_entry_t *entry = MAVLinkMessageEntries::find(messageId);
+        const mavlink_msg_entry_t *expected = MAVLinkMessageEntries::findBySearch(messageId);
+        if ((entry == nullptr) != (expected == nullptr) || (entry && memcmp(entry, expected, sizeof(*entry)) != 0)) {
+            if (mismatches++ < 10) {
+                std::cerr << "Lookups differ for message id " << messageId << "\n";
+            }
+        }
+    }
+    if (mismatches) {
+        std::cerr << mismatches << " message ids differ\n";
+        return 1;
+    }
+
+    constexpr size_t kIdCount = 4096;
+    std::mt19937 random(42);
+
+    std::vector<uint32_t> dialect;
+    for (size_t i = 0; i < MAVLinkMessageEntries::entryCount; i++) {
+        dialect.push_back(MAVLinkMessageEntries::entries[i].msgid);
+    }
+
+    std::vector<uint32_t> unknown;
+    std::uniform_int_distribution<uint32_t> anyId(0, (1u << 24) - 1);
+    while (unknown.size() < kIdCount) {
+        const uint32_t messageId = anyId(random);
+        if (!MAVLinkMessageEntries::find(messageId)) {
+            unknown.push_back(messageId);
+        }
+    }
+
+    std::vector<uint32_t> shuffled = repeated(dialect, kIdCount);
+    std::shuffle(shuffled.begin(), shuffled.end(), random);
+
+    const std::vector<std::pair<const char*, std::vector<uint32_t>>> workloads = {
+        {"telemetry", repeated({MAVLINK_MSG_ID_ATTITUDE, MAVLINK_MSG_ID_GLOBAL_POSITION_INT, MAVLINK_MSG_ID_VFR_HUD,
+                                MAVLINK_MSG_ID_ATTITUDE, MAVLINK_MSG_ID_GPS_RAW_INT, MAVLINK_MSG_ID_SYS_STATUS,
+                                MAVLINK_MSG_ID_ATTITUDE, MAVLINK_MSG_ID_RC_CHANNELS, MAVLINK_MSG_ID_HEARTBEAT,
+                                MAVLINK_MSG_ID_BATTERY_STATUS, MAVLINK_MSG_ID_VIBRATION, MAVLINK_MSG_ID_ESTIMATOR_STATUS},
+                               kIdCount)},
+        {"dialect", repeated(dialect, kIdCount)},
+        {"random", shuffled},
+        {"unknown", unknown},
+    };
+
+    std::vector<Result> results;
+    for (const auto &[workload, messageIds] : workloads) {
+        results.push_back(Result{"search", workload, iterations,
+                                 measure(MAVLinkMessageEntries::findBySearch, messageIds, iterations, repeats)});
+        results.push_back(Result{"table", workload, iterations,
+                                 measure(MAVLinkMessageEntries::find, messageIds, iterations, repeats)});
+    }
+
+    printResults(results, format, iterations, repeats);
+    return 0;
+}
@@ -0,0 +1,434 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <functional>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "MAVLinkUdpConnection.h"
+#include "VehicleManager.h"
+#include "Vehicle.h"
+#include "MissionManager.h"
+#include "Logger.h"
+
+/// Time to download and upload the mission of a simulated ArduPilot vehicle, one MISSION_REQUEST_INT
+/// at a time and with the pipelined requests. The vehicle's transmissions are delayed by the link's
+/// round trip, paced to its rate and lose the given share of frames, every run checks the items.
+///
+///     MissionTransferBenchmark [-port <n>] [-items <n>] [-rate <bytes/s>] [-rtt <ms>] [-loss <percent>,...]
+
+namespace {
+
+constexpr uint8_t kSystemId = 1;
+constexpr uint8_t kComponentId = MAV_COMP_ID_AUTOPILOT1;
+constexpr mavlink_channel_t kChannel = MAVLINK_COMM_3;     // The collector parses on channel 0
+constexpr int kRequestRetryMsecs = 500;                    // Vehicle side, while receiving a mission
+constexpr uint16_t kCurrentSeq = 3;
+
+std::vector<MissionManager::Item> makeMission(size_t count, int variant)
+{
+    std::vector<MissionManager::Item> items(count);
+    for (size_t i = 0; i < count; i++) {
+        MissionManager::Item &item = items[i];
+        item.command = i == 0 ? MAV_CMD_NAV_TAKEOFF : MAV_CMD_NAV_WAYPOINT;
+        item.x = 473977420 + static_cast<int32_t>(i * 100) * variant;
+        item.y = 85455940 + static_cast<int32_t>(i * 37);
+        item.z = 20.0f + static_cast<float>(i % 50);
+        item.param1 = static_cast<float>(variant);
+    }
+    return items;
+}
+
+bool sameItem(const MissionManager::Item &a, const MissionManager::Item &b)
+{
+    return a.command == b.command && a.frame == b.frame && a.autocontinue == b.autocontinue &&
+           a.x == b.x && a.y == b.y && a.z == b.z &&
+           a.param1 == b.param1 && a.param2 == b.param2 && a.param3 == b.param3 && a.param4 == b.param4;
+}
+
+bool sameMission(const std::vector<MissionManager::Item> &a, const std::vector<MissionManager::Item> &b)
+{
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), sameItem);
+}
+
+/// ArduPilot side of the mission protocol behind a paced, delayed and lossy link. Like ArduPilot it
+/// answers item requests in any order.
+class SimulatedVehicle
+{
+public:
+    SimulatedVehicle(uint16_t collectorPort, const std::vector<MissionManager::Item> &mission,
+                     double bytesPerSecond, int roundTripMsecs, double lossPercent)
+        : _mission(mission)
+        , _bytesPerSecond(bytesPerSecond)
+        , _roundTrip(std::chrono::milliseconds(roundTripMsecs))
+        , _lossPercent(lossPercent)
+    {
+        _socket = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in local{};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(_socket, reinterpret_cast<sockaddr*>(&local), sizeof(local));
+
+        timeval timeout{0, 1000};
+        setsockopt(_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        _collector.sin_family = AF_INET;
+        _collector.sin_port = htons(collectorPort);
+        _collector.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        _running = true;
+        _thread = std::thread(&SimulatedVehicle::_threadFunc, this);
+    }
+
+    ~SimulatedVehicle()
+    {
+        _running = false;
+        _thread.join();
+        close(_socket);
+    }
+
+    std::vector<MissionManager::Item> mission() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _mission;
+    }
+
+    uint64_t bytesSent() const { return _bytesSent; }
+
+private:
+    struct Frame {
+        std::chrono::steady_clock::time_point sendTime;
+        std::vector<uint8_t> data;
+    };
+
+    void _queue(const mavlink_message_t &message)
+    {
+        Frame frame;
+        frame.sendTime = std::chrono::steady_clock::now() + _roundTrip;
+        frame.data.resize(MAVLINK_MAX_PACKET_LEN);
+        frame.data.resize(mavlink_msg_to_send_buffer(frame.data.data(), &message));
+        _outgoing.push_back(std::move(frame));
+    }
+
+    void _queueItem(uint16_t seq, uint8_t targetSystem, uint8_t targetComponent)
+    {
+        const MissionManager::Item &item = _mission[seq];
+        mavlink_message_t message;
+        mavlink_msg_mission_item_int_pack_chan(kSystemId, kComponentId, kChannel, &message, targetSystem, targetComponent, seq,
+                                               item.frame, item.command, seq == 0, item.autocontinue,
+                                               item.param1, item.param2, item.param3, item.param4,
+                                               item.x, item.y, item.z, MAV_MISSION_TYPE_MISSION);
+        _queue(message);
+    }
+
+    void _requestUploadItem()
+    {
+        mavlink_message_t message;
+        mavlink_msg_mission_request_int_pack_chan(kSystemId, kComponentId, kChannel, &message, 255, MAV_COMP_ID_MISSIONPLANNER,
+                                                  _uploadSeq, MAV_MISSION_TYPE_MISSION);
+        _queue(message);
+        _lastUploadRequest = std::chrono::steady_clock::now();
+    }
+
+    void _queueAck(uint8_t targetSystem, uint8_t targetComponent)
+    {
+        mavlink_message_t message;
+        mavlink_msg_mission_ack_pack_chan(kSystemId, kComponentId, kChannel, &message, targetSystem, targetComponent,
+                                          MAV_MISSION_ACCEPTED, MAV_MISSION_TYPE_MISSION, 0);
+        _queue(message);
+    }
+
+    void _handle(const mavlink_message_t &message)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        switch (message.msgid) {
+            case MAVLINK_MSG_ID_MISSION_REQUEST_LIST: {
+                mavlink_message_t reply;
+                mavlink_msg_mission_count_pack_chan(kSystemId, kComponentId, kChannel, &reply, message.sysid, message.compid,
+                                                    static_cast<uint16_t>(_mission.size()), MAV_MISSION_TYPE_MISSION, 0);
+                _queue(reply);
+                break;
+            }
+            case MAVLINK_MSG_ID_MISSION_REQUEST_INT: {
+                mavlink_mission_request_int_t request;
+                mavlink_msg_mission_request_int_decode(&message, &request);
+                if (request.seq < _mission.size()) {
+                    _queueItem(request.seq, message.sysid, message.compid);
+                }
+                break;
+            }
+            case MAVLINK_MSG_ID_MISSION_COUNT: {
+                mavlink_mission_count_t count;
+                mavlink_msg_mission_count_decode(&message, &count);
+                _upload.assign(count.count, MissionManager::Item());
+                _uploadSeq = 0;
+                _uploading = count.count > 0;
+                if (_uploading) {
+                    _requestUploadItem();
+                } else {
+                    _mission.clear();
+                    _queueAck(message.sysid, message.compid);
+                }
+                break;
+            }
+            case MAVLINK_MSG_ID_MISSION_ITEM_INT: {
+                mavlink_mission_item_int_t missionItem;
+                mavlink_msg_mission_item_int_decode(&message, &missionItem);
+                if (!_uploading || missionItem.seq != _uploadSeq) {
+                    if (!_uploading && missionItem.seq + 1u == _mission.size()) {
+                        // Our ack was lost
+                        _queueAck(message.sysid, message.compid);
+                    }
+                    break;
+                }
+                MissionManager::Item &item = _upload[_uploadSeq];
+                item.param1 = missionItem.param1;
+                item.param2 = missionItem.param2;
+                item.param3 = missionItem.param3;
+                item.param4 = missionItem.param4;
+                item.x = missionItem.x;
+                item.y = missionItem.y;
+                item.z = missionItem.z;
+                item.command = missionItem.command;
+                item.frame = missionItem.frame;
+                item.autocontinue = missionItem.autocontinue;
+                if (++_uploadSeq == _upload.size()) {
+                    _mission = _upload;
+                    _uploading = false;
+                    _queueAck(message.sysid, message.compid);
+                } else {
+                    _requestUploadItem();
+                }
+                break;
+            }
+            case MAVLINK_MSG_ID_COMMAND_LONG: {
+                mavlink_command_long_t command;
+                mavlink_msg_command_long_decode(&message, &command);
+                mavlink_message_t reply;
+                mavlink_msg_command_ack_pack_chan(kSystemId, kComponentId, kChannel, &reply, command.command, MAV_RESULT_ACCEPTED,
+                                                  0, 0, message.sysid, message.compid);
+                _queue(reply);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void _threadFunc()
+    {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<double> percent(0.0, 100.0);
+        mavlink_message_t message;
+        mavlink_status_t status{};
+        auto lastHeartbeat = std::chrono::steady_clock::time_point();
+        auto lastPacing = std::chrono::steady_clock::now();
+        double budget = 0.0;
+
+        while (_running) {
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastHeartbeat >= std::chrono::seconds(1)) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                mavlink_msg_heartbeat_pack_chan(kSystemId, kComponentId, kChannel, &message, MAV_TYPE_QUADROTOR,
+                                                MAV_AUTOPILOT_ARDUPILOTMEGA, MAV_MODE_FLAG_CUSTOM_MODE_ENABLED, 0, MAV_STATE_STANDBY);
+                _queue(message);
+                mavlink_msg_mission_current_pack_chan(kSystemId, kComponentId, kChannel, &message, kCurrentSeq,
+                                                      static_cast<uint16_t>(_mission.size()), 0, 0, 0, 0, 0);
+                _queue(message);
+                lastHeartbeat = now;
+            }
+
+            uint8_t buffer[2048];
+            ssize_t received = recv(_socket, buffer, sizeof(buffer), 0);
+            for (ssize_t i = 0; i < received; i++) {
+                if (mavlink_parse_char(kChannel, buffer[i], &message, &status) == MAVLINK_FRAMING_OK) {
+                    _handle(message);
+                }
+            }
+
+            now = std::chrono::steady_clock::now();
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_uploading && now - _lastUploadRequest >= std::chrono::milliseconds(kRequestRetryMsecs)) {
+                _requestUploadItem();
+            }
+
+            // The radio sends at its rate once the link delay has passed, queued frames wait
+            budget = std::min(budget + std::chrono::duration<double>(now - lastPacing).count() * _bytesPerSecond, _bytesPerSecond * 0.05);
+            lastPacing = now;
+            while (!_outgoing.empty() && _outgoing.front().sendTime <= now && budget >= _outgoing.front().data.size()) {
+                const std::vector<uint8_t> &frame = _outgoing.front().data;
+                budget -= frame.size();
+                _bytesSent += frame.size();
+                if (percent(random) >= _lossPercent) {
+                    sendto(_socket, frame.data(), frame.size(), 0, reinterpret_cast<const sockaddr*>(&_collector), sizeof(_collector));
+                }
+                _outgoing.pop_front();
+            }
+        }
+    }
+
+    mutable std::mutex _mutex;
+    std::vector<MissionManager::Item> _mission;
+    std::vector<MissionManager::Item> _upload;
+    uint16_t _uploadSeq = 0;
+    bool _uploading = false;
+    std::chrono::steady_clock::time_point _lastUploadRequest;
+    double _bytesPerSecond = 0.0;
+    std::chrono::steady_clock::duration _roundTrip;
+    double _lossPercent = 0.0;
+    std::deque<Frame> _outgoing;
+    int _socket = -1;
+    sockaddr_in _collector{};
+    std::atomic<uint64_t> _bytesSent{0};
+    std::atomic<bool> _running{false};
+    std::thread _thread;
+};
+
+/// Sink for the vehicles' console output while the benchmark runs
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+};
+
+struct Run {
+    int pipeline = 0;
+    double lossPercent = 0.0;
+    MissionManager::Result download;
+    MissionManager::Result upload;
+    bool downloadMatches = false;
+    bool uploadMatches = false;
+    bool currentMatches = false;
+};
+
+bool transfer(const std::function<bool(MissionManager::CompletionCallback)> &start, MissionManager::Result &result)
+{
+    auto promise = std::make_shared<std::promise<MissionManager::Result>>();
+    auto future = promise->get_future();
+    if (!start([promise](const MissionManager::Result &result) { promise->set_value(result); })) {
+        return false;
+    }
+    if (future.wait_for(std::chrono::minutes(5)) != std::future_status::ready) {
+        return false;
+    }
+    result = future.get();
+    return result.success;
+}
+
+Run run(uint16_t port, size_t itemCount, double bytesPerSecond, int roundTripMsecs, double lossPercent, int pipeline)
+{
+    Run result;
+    result.pipeline = pipeline;
+    result.lossPercent = lossPercent;
+
+    MAVLinkUdpConnection connection;
+    if (!connection.connect("127.0.0.1", port)) {
+        return result;
+    }
+    VehicleManager manager(&connection);
+    manager.start();
+
+    const std::vector<MissionManager::Item> onboard = makeMission(itemCount, 1);
+    const std::vector<MissionManager::Item> planned = makeMission(itemCount, 2);
+    SimulatedVehicle simulatedVehicle(port, onboard, bytesPerSecond, roundTripMsecs, lossPercent);
+
+    std::shared_ptr<Vehicle> vehicle;
+    for (int i = 0; i < 500 && !vehicle; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        vehicle = manager.vehicle(kSystemId);
+    }
+    if (!vehicle) {
+        return result;
+    }
+    std::shared_ptr<MissionManager> missionManager = vehicle->missionManager();
+    missionManager->setMaxOutstandingRequests(pipeline);
+
+    if (transfer([&](MissionManager::CompletionCallback done) { return missionManager->loadFromVehicle(done); }, result.download)) {
+        result.downloadMatches = sameMission(missionManager->items(), onboard);
+    }
+    if (transfer([&](MissionManager::CompletionCallback done) { return missionManager->writeToVehicle(planned, done); }, result.upload)) {
+        result.uploadMatches = sameMission(simulatedVehicle.mission(), planned);
+    }
+
+    MissionManager::Item current;
+    result.currentMatches = missionManager->currentItem(current) && missionManager->currentIndex() == kCurrentSeq &&
+                            sameItem(current, planned[kCurrentSeq]);
+
+    vehicle.reset();
+    connection.disconnect();
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    uint16_t port = 14652;
+    size_t itemCount = 500;
+    double bytesPerSecond = 5760.0;         // 57600 baud telemetry radio
+    int roundTripMsecs = 100;
+    std::vector<double> losses = {0.0, 5.0};
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-port" && i + 1 < argc) {
+            port = static_cast<uint16_t>(atoi(argv[++i]));
+        } else if (arg == "-items" && i + 1 < argc) {
+            itemCount = static_cast<size_t>(std::clamp(atoi(argv[++i]), kCurrentSeq + 1, 65535));
+        } else if (arg == "-rate" && i + 1 < argc) {
+            bytesPerSecond = std::max(100.0, atof(argv[++i]));
+        } else if (arg == "-rtt" && i + 1 < argc) {
+            roundTripMsecs = std::clamp(atoi(argv[++i]), 0, 5000);
+        } else if (arg == "-loss" && i + 1 < argc) {
+            losses.clear();
+            for (char *token = strtok(argv[++i], ","); token; token = strtok(nullptr, ",")) {
+                losses.push_back(std::clamp(atof(token), 0.0, 50.0));
+            }
+        } else {
+            std::cout << "Usage: " << argv[0] << " [-port <n>] [-items <n>] [-rate <bytes/s>] [-rtt <ms>] [-loss <percent>,...]\n";
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+
+    Logger::instance().setLevel(Logger::Error);
+    NullBuffer nullBuffer;
+    std::streambuf *coutBuffer = std::cout.rdbuf(&nullBuffer);
+
+    std::vector<Run> runs;
+    for (double loss : losses) {
+        for (int pipeline : {1, MissionManager::kArduPilotMaxOutstandingRequests}) {
+            runs.push_back(run(port, itemCount, bytesPerSecond, roundTripMsecs, loss, pipeline));
+        }
+    }
+
+    std::cout.rdbuf(coutBuffer);
+    Logger::instance().shutdown();
+
+    printf("Mission transfer of %zu items over a %.0f bytes/s link with %d ms round trip\n", itemCount, bytesPerSecond, roundTripMsecs);
+    printf("%9s %7s %10s %10s %10s %10s %8s\n", "pipeline", "loss %", "download s", "requests", "upload s", "messages", "checked");
+    bool allMatched = true;
+    for (const auto& result : runs) {
+        const bool matched = result.downloadMatches && result.uploadMatches && result.currentMatches;
+        printf("%9d %7.1f %10s %10u %10s %10u %8s\n", result.pipeline, result.lossPercent,
+               result.download.success ? std::to_string(result.download.seconds).substr(0, 6).c_str() : "failed",
+               result.download.messagesSent,
+               result.upload.success ? std::to_string(result.upload.seconds).substr(0, 6).c_str() : "failed",
+               result.upload.messagesSent, matched ? "ok" : "FAILED");
+        allMatched = allMatched && matched;
+    }
+    return allMatched ? 0 : 1;
+}
@@ -0,0 +1,466 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "MAVLinkUdpConnection.h"
+#include "VehicleManager.h"
+#include "Vehicle.h"
+#include "ParameterManager.h"
+#include "FTPManager.h"
+#include "Logger.h"
+
+/// Time to load all parameters of a simulated ArduPilot vehicle with MAVLink FTP (@PARAM/param.pck)
+/// and with the PARAM_REQUEST_LIST index protocol. The vehicle's transmissions are paced to a radio
+/// link rate and lose the given share of frames, every run checks the loaded values.
+///
+///     ParamLoadBenchmark [-port <n>] [-params <n>] [-rate <bytes/s>] [-loss <percent>,...]
+
+namespace {
+
+constexpr uint8_t kSystemId = 1;
+constexpr uint8_t kComponentId = MAV_COMP_ID_AUTOPILOT1;
+constexpr mavlink_channel_t kChannel = MAVLINK_COMM_3;     // The collector parses on channel 0
+constexpr int kBurstPackets = 30;
+
+struct Param {
+    std::string name;
+    uint8_t type;       ///< AP_Param type, 1 int8, 2 int16, 3 int32, 4 float
+    Fact::ValueVariant_t value;
+    uint8_t mavType;
+};
+
+std::vector<Param> makeParams(size_t count)
+{
+    static const char *prefixes[] = { "ATC_RAT_PIT_", "ATC_RAT_RLL_", "BATT_", "COMPASS_", "EK3_SRC1_", "GPS_",
+                                      "INS_ACC_", "INS_GYR_", "MOT_", "PSC_POSXY_", "RC1_", "SERVO1_" };
+    std::vector<Param> params;
+    for (size_t i = 0; i < count; i++) {
+        Param param;
+        param.name = std::string(prefixes[i % 12]) + "P" + std::to_string(i / 12);
+        param.type = static_cast<uint8_t>(1 + i % 4);
+        switch (param.type) {
+            case 1: param.value = static_cast<int8_t>(i % 100); param.mavType = MAV_PARAM_TYPE_INT8; break;
+            case 2: param.value = static_cast<int16_t>(i * 7); param.mavType = MAV_PARAM_TYPE_INT16; break;
+            case 3: param.value = static_cast<int32_t>(i * 100003); param.mavType = MAV_PARAM_TYPE_INT32; break;
+            default: param.value = static_cast<float>(i) * 0.25f; param.mavType = MAV_PARAM_TYPE_REAL32; break;
+        }
+        params.push_back(param);
+    }
+    std::sort(params.begin(), params.end(), [](const Param &a, const Param &b) { return a.name < b.name; });
+    return params;
+}
+
+/// ArduPilot's packed format, with defaults for every other parameter and padding so no entry
+/// spans two FTP packets
+std::vector<uint8_t> packParams(const std::vector<Param> &params)
+{
+    const uint16_t header[3] = { ParameterManager::kParamPackMagicWithDefaults,
+                                 static_cast<uint16_t>(params.size()), static_cast<uint16_t>(params.size()) };
+    std::vector<uint8_t> file(sizeof(header));
+    memcpy(file.data(), header, sizeof(header));
+
+    std::string previous;
+    for (size_t i = 0; i < params.size(); i++) {
+        const Param &param = params[i];
+        size_t common = 0;
+        while (common < 15 && common < previous.size() && common + 1 < param.name.size() && previous[common] == param.name[common]) {
+            common++;
+        }
+        const std::string suffix = param.name.substr(common);
+        const bool withDefault = i % 2 == 0;
+
+        std::vector<uint8_t> entry;
+        entry.push_back(static_cast<uint8_t>(param.type | (withDefault ? 0x10 : 0)));
+        entry.push_back(static_cast<uint8_t>(common | ((suffix.size() - 1) << 4)));
+        entry.insert(entry.end(), suffix.begin(), suffix.end());
+        uint8_t value[4];
+        size_t size = 0;
+        std::visit([&](auto v) {
+            if constexpr (sizeof(v) <= 4) {
+                memcpy(value, &v, sizeof(v));
+                size = sizeof(v);
+            }
+        }, param.value);
+        for (int copies = withDefault ? 2 : 1; copies > 0; copies--) {
+            entry.insert(entry.end(), value, value + size);
+        }
+
+        const size_t packetSpace = FTPManager::kDataSize - (file.size() % FTPManager::kDataSize);
+        if (entry.size() > packetSpace) {
+            file.insert(file.end(), packetSpace, 0);
+        }
+        file.insert(file.end(), entry.begin(), entry.end());
+        previous = param.name;
+    }
+    return file;
+}
+
+/// ArduPilot side of the FTP and parameter protocols behind a paced, lossy link
+class SimulatedVehicle
+{
+public:
+    SimulatedVehicle(uint16_t collectorPort, const std::vector<Param> &params, double bytesPerSecond, double lossPercent)
+        : _params(params)
+        , _paramFile(packParams(params))
+        , _bytesPerSecond(bytesPerSecond)
+        , _lossPercent(lossPercent)
+    {
+        _socket = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in local{};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        bind(_socket, reinterpret_cast<sockaddr*>(&local), sizeof(local));
+
+        timeval timeout{0, 1000};
+        setsockopt(_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        _collector.sin_family = AF_INET;
+        _collector.sin_port = htons(collectorPort);
+        _collector.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        _running = true;
+        _thread = std::thread(&SimulatedVehicle::_threadFunc, this);
+    }
+
+    ~SimulatedVehicle()
+    {
+        _running = false;
+        _thread.join();
+        close(_socket);
+    }
+
+    size_t paramFileSize() const { return _paramFile.size(); }
+    uint64_t bytesSent() const { return _bytesSent; }
+
+private:
+    void _queue(const mavlink_message_t &message)
+    {
+        std::vector<uint8_t> frame(MAVLINK_MAX_PACKET_LEN);
+        frame.resize(mavlink_msg_to_send_buffer(frame.data(), &message));
+        _outgoing.push_back(std::move(frame));
+    }
+
+    void _queueParam(size_t index)
+    {
+        const Param &param = _params[index];
+        mavlink_param_union_t paramUnion{};
+        std::visit([&](auto v) {
+            if constexpr (sizeof(v) <= 4) {
+                memcpy(&paramUnion.param_float, &v, sizeof(v));
+            }
+        }, param.value);
+
+        mavlink_message_t message;
+        char name[MAVLINK_MSG_PARAM_VALUE_FIELD_PARAM_ID_LEN] = {};
+        memcpy(name, param.name.data(), std::min(param.name.size(), sizeof(name)));
+        mavlink_msg_param_value_pack_chan(kSystemId, kComponentId, kChannel, &message, name, paramUnion.param_float,
+                                          param.mavType, static_cast<uint16_t>(_params.size()), static_cast<uint16_t>(index));
+        _queue(message);
+    }
+
+    void _queueFtp(const FTPManager::Request &request, uint8_t targetSystem, uint8_t targetComponent)
+    {
+        mavlink_message_t message;
+        mavlink_msg_file_transfer_protocol_pack_chan(kSystemId, kComponentId, kChannel, &message, 0, targetSystem, targetComponent,
+                                                     reinterpret_cast<const uint8_t*>(&request));
+        _queue(message);
+    }
+
+    void _handleFtp(const mavlink_message_t &message)
+    {
+        mavlink_file_transfer_protocol_t transfer;
+        mavlink_msg_file_transfer_protocol_decode(&message, &transfer);
+        FTPManager::Request request;
+        memcpy(&request, transfer.payload, sizeof(request));
+
+        FTPManager::Request response{};
+        response.seqNumber = static_cast<uint16_t>(request.seqNumber + 1);
+        response.session = request.session;
+        response.reqOpcode = request.opcode;
+        response.opcode = FTPManager::kRspAck;
+
+        auto nak = [&response](uint8_t error) {
+            response.opcode = FTPManager::kRspNak;
+            response.size = 1;
+            response.data[0] = error;
+        };
+
+        switch (request.opcode) {
+            case FTPManager::kCmdResetSessions:
+                _sessionOpen = false;
+                break;
+            case FTPManager::kCmdTerminateSession:
+                _sessionOpen = false;
+                break;
+            case FTPManager::kCmdOpenFileRO:
+                if (_sessionOpen) {
+                    nak(FTPManager::kErrNoSessionsAvailable);
+                } else if (std::string(reinterpret_cast<char*>(request.data), request.size).rfind("@PARAM/param.pck", 0) != 0) {
+                    nak(FTPManager::kErrFileNotFound);
+                } else {
+                    _sessionOpen = true;
+                    response.session = ++_session;
+                    response.size = sizeof(uint32_t);
+                    const uint32_t size = static_cast<uint32_t>(_paramFile.size());
+                    memcpy(response.data, &size, sizeof(size));
+                }
+                break;
+            case FTPManager::kCmdReadFile:
+            case FTPManager::kCmdBurstReadFile: {
+                if (!_sessionOpen || request.session != _session) {
+                    nak(FTPManager::kErrInvalidSession);
+                    break;
+                }
+                if (request.offset >= _paramFile.size()) {
+                    nak(FTPManager::kErrEOF);
+                    break;
+                }
+                const int packets = request.opcode == FTPManager::kCmdBurstReadFile ? kBurstPackets : 1;
+                uint32_t offset = request.offset;
+                for (int i = 0; i < packets && offset < _paramFile.size(); i++) {
+                    response.offset = offset;
+                    response.size = static_cast<uint8_t>(std::min<size_t>(FTPManager::kDataSize, _paramFile.size() - offset));
+                    memcpy(response.data, _paramFile.data() + offset, response.size);
+                    offset += response.size;
+                    response.burstComplete = (i + 1 == packets || offset >= _paramFile.size()) ? 1 : 0;
+                    _queueFtp(response, message.sysid, message.compid);
+                    response.seqNumber++;
+                }
+                return;
+            }
+            default:
+                nak(FTPManager::kErrUnknownCommand);
+                break;
+        }
+        _queueFtp(response, message.sysid, message.compid);
+    }
+
+    void _handle(const mavlink_message_t &message)
+    {
+        switch (message.msgid) {
+            case MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL:
+                _handleFtp(message);
+                break;
+            case MAVLINK_MSG_ID_PARAM_REQUEST_LIST:
+                for (size_t i = 0; i < _params.size(); i++) {
+                    _queueParam(i);
+                }
+                break;
+            case MAVLINK_MSG_ID_PARAM_REQUEST_READ: {
+                mavlink_param_request_read_t request;
+                mavlink_msg_param_request_read_decode(&message, &request);
+                if (request.param_index >= 0 && static_cast<size_t>(request.param_index) < _params.size()) {
+                    _queueParam(static_cast<size_t>(request.param_index));
+                }
+                break;
+            }
+            case MAVLINK_MSG_ID_COMMAND_LONG: {
+                mavlink_command_long_t command;
+                mavlink_msg_command_long_decode(&message, &command);
+                mavlink_message_t reply;
+                mavlink_msg_command_ack_pack_chan(kSystemId, kComponentId, kChannel, &reply, command.command, MAV_RESULT_ACCEPTED,
+                                                  0, 0, message.sysid, message.compid);
+                _queue(reply);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    void _threadFunc()
+    {
+        std::mt19937 random(1);
+        std::uniform_real_distribution<double> percent(0.0, 100.0);
+        mavlink_message_t message;
+        mavlink_status_t status{};
+        auto lastHeartbeat = std::chrono::steady_clock::time_point();
+        auto lastPacing = std::chrono::steady_clock::now();
+        double budget = 0.0;
+
+        // A session left open by an earlier ground station
+        _sessionOpen = true;
+
+        while (_running) {
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastHeartbeat >= std::chrono::seconds(1)) {
+                mavlink_msg_heartbeat_pack_chan(kSystemId, kComponentId, kChannel, &message, MAV_TYPE_QUADROTOR,
+                                                MAV_AUTOPILOT_ARDUPILOTMEGA, MAV_MODE_FLAG_CUSTOM_MODE_ENABLED, 0, MAV_STATE_STANDBY);
+                _queue(message);
+                lastHeartbeat = now;
+            }
+
+            uint8_t buffer[2048];
+            ssize_t received = recv(_socket, buffer, sizeof(buffer), 0);
+            for (ssize_t i = 0; i < received; i++) {
+                if (mavlink_parse_char(kChannel, buffer[i], &message, &status) == MAVLINK_FRAMING_OK) {
+                    _handle(message);
+                }
+            }
+
+            // The radio sends at its rate, queued frames wait
+            now = std::chrono::steady_clock::now();
+            budget = std::min(budget + std::chrono::duration<double>(now - lastPacing).count() * _bytesPerSecond, _bytesPerSecond * 0.05);
+            lastPacing = now;
+            while (!_outgoing.empty() && budget >= _outgoing.front().size()) {
+                const std::vector<uint8_t> &frame = _outgoing.front();
+                budget -= frame.size();
+                _bytesSent += frame.size();
+                if (percent(random) >= _lossPercent) {
+                    sendto(_socket, frame.data(), frame.size(), 0, reinterpret_cast<const sockaddr*>(&_collector), sizeof(_collector));
+                }
+                _outgoing.pop_front();
+            }
+        }
+    }
+
+    std::vector<Param> _params;
+    std::vector<uint8_t> _paramFile;
+    double _bytesPerSecond = 0.0;
+    double _lossPercent = 0.0;
+    bool _sessionOpen = false;
+    uint8_t _session = 0;
+    std::deque<std::vector<uint8_t>> _outgoing;
+    int _socket = -1;
+    sockaddr_in _collector{};
+    std::atomic<uint64_t> _bytesSent{0};
+    std::atomic<bool> _running{false};
+    std::thread _thread;
+};
+
+/// Sink for the vehicles' console output while the benchmark runs
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+};
+
+struct Run {
+    bool ftp = false;
+    double lossPercent = 0.0;
+    bool ready = false;
+    double seconds = 0.0;
+    size_t loaded = 0;
+    size_t mismatched = 0;
+    uint64_t bytesSent = 0;
+};
+
+Run run(uint16_t port, const std::vector<Param> &params, double bytesPerSecond, double lossPercent, bool ftp, size_t &fileSize)
+{
+    Run result;
+    result.ftp = ftp;
+    result.lossPercent = lossPercent;
+
+    MAVLinkUdpConnection connection;
+    if (!connection.connect("127.0.0.1", port)) {
+        return result;
+    }
+    VehicleManager manager(&connection);
+
+    auto readyPromise = std::make_shared<std::promise<void>>();
+    auto readySignalled = std::make_shared<std::atomic<bool>>(false);
+    std::chrono::steady_clock::time_point start;
+    manager.setVehicleAddedCallback([&start, ftp, readyPromise, readySignalled](const std::shared_ptr<Vehicle>& vehicle) {
+        start = std::chrono::steady_clock::now();
+        vehicle->parameterManager()->setFtpEnabled(ftp);
+        vehicle->parameterManager()->setParametersReadyCallback([readyPromise, readySignalled](bool) {
+            if (!readySignalled->exchange(true)) {
+                readyPromise->set_value();
+            }
+        });
+    });
+    manager.start();
+
+    SimulatedVehicle simulatedVehicle(port, params, bytesPerSecond, lossPercent);
+    fileSize = simulatedVehicle.paramFileSize();
+    if (readyPromise->get_future().wait_for(std::chrono::minutes(5)) == std::future_status::ready) {
+        result.ready = true;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    result.bytesSent = simulatedVehicle.bytesSent();
+
+    std::shared_ptr<Vehicle> vehicle = manager.vehicle(kSystemId);
+    std::shared_ptr<ParameterManager> parameterManager = vehicle ? vehicle->parameterManager() : nullptr;
+    for (const Param &param : params) {
+        if (parameterManager && parameterManager->parameterExists(kComponentId, param.name)) {
+            result.loaded++;
+            if (parameterManager->getParameter(kComponentId, param.name)->rawValue() != param.value) {
+                result.mismatched++;
+            }
+        }
+    }
+
+    connection.disconnect();
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    uint16_t port = 14651;
+    size_t paramCount = 1000;
+    double bytesPerSecond = 5760.0;         // 57600 baud telemetry radio
+    std::vector<double> losses = {0.0, 5.0};
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-port" && i + 1 < argc) {
+            port = static_cast<uint16_t>(atoi(argv[++i]));
+        } else if (arg == "-params" && i + 1 < argc) {
+            paramCount = static_cast<size_t>(std::clamp(atoi(argv[++i]), 1, 65535));
+        } else if (arg == "-rate" && i + 1 < argc) {
+            bytesPerSecond = std::max(100.0, atof(argv[++i]));
+        } else if (arg == "-loss" && i + 1 < argc) {
+            losses.clear();
+            for (char *token = strtok(argv[++i], ","); token; token = strtok(nullptr, ",")) {
+                losses.push_back(std::clamp(atof(token), 0.0, 50.0));
+            }
+        } else {
+            std::cout << "Usage: " << argv[0] << " [-port <n>] [-params <n>] [-rate <bytes/s>] [-loss <percent>,...]\n";
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+
+    Logger::instance().setLevel(Logger::Error);
+    NullBuffer nullBuffer;
+    std::streambuf *coutBuffer = std::cout.rdbuf(&nullBuffer);
+
+    const std::vector<Param> params = makeParams(paramCount);
+    size_t fileSize = 0;
+    std::vector<Run> runs;
+    for (double loss : losses) {
+        for (bool ftp : {true, false}) {
+            runs.push_back(run(port, params, bytesPerSecond, loss, ftp, fileSize));
+        }
+    }
+
+    std::cout.rdbuf(coutBuffer);
+    Logger::instance().shutdown();
+
+    printf("Parameter load of %zu parameters (param.pck %zu bytes) over a %.0f bytes/s link\n", paramCount, fileSize, bytesPerSecond);
+    printf("%8s %8s %10s %12s %10s %10s\n", "method", "loss %", "seconds", "bytes sent", "loaded", "mismatch");
+    bool allLoaded = true;
+    for (const auto& result : runs) {
+        printf("%8s %8.1f %10s %12llu %10zu %10zu\n", result.ftp ? "ftp" : "index", result.lossPercent,
+               result.ready ? std::to_string(result.seconds).substr(0, 6).c_str() : "timeout",
+               static_cast<unsigned long long>(result.bytesSent), result.loaded, result.mismatched);
+        allLoaded = allLoaded && result.ready && result.loaded == paramCount && result.mismatched == 0;
+    }
+    return allLoaded ? 0 : 1;
+}
@@ -0,0 +1,396 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <csignal>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "MAVLinkUdpConnection.h"
+#include "VehicleManager.h"
+#include "Vehicle.h"
+#include "ParameterManager.h"
+#include "TimeSync.h"
+#include "Logger.h"
+#include "AllocationCounter.h"
+
+/// Runs the collector's receive path, a connection and a VehicleManager, against VehicleSimulator for
+/// as long as asked, hours for a real soak, and samples resident memory, heap allocations, thread
+/// count and the per-stage latencies into a report. Growth is measured from the end of the warm up,
+/// once every vehicle has its parameters, so start up allocations don't count. Any threshold which is
+/// exceeded fails the run with exit code 1.
+///
+/// Heap allocations are counted by replacing the global operator new and delete in this executable,
+/// or by the core library's counting allocator when built with MAVCOLLECTOR_COUNT_ALLOCATIONS.
+///
+///     SoakTest [-duration <seconds>] [-warmup <seconds>] [-interval <seconds>] [-port <n>]
+///              [-vehicles <n>] [-simulator <path>] [-sim-args "<args>"] [-report <file>]
+///              [-max-rss-growth <MB>] [-max-thread-growth <n>] [-max-live-alloc-growth <n>]
+///              [-max-handle-us <mean>] [-max-drop-percent <percent>]
+
+namespace {
+
+std::atomic<bool> g_running(true);
+
+void signalHandler(int)
+{
+    g_running = false;
+}
+
+} // namespace
+
+#if !MAVCOLLECTOR_COUNT_ALLOCATIONS
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_deallocations{0};
+std::atomic<uint64_t> g_allocatedBytes{0};
+
+void *countedAllocate(size_t size)
+{
+    void *pointer = malloc(size ? size : 1);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    return pointer;
+}
+
+void countedFree(void *pointer)
+{
+    if (pointer) {
+        g_deallocations.fetch_add(1, std::memory_order_relaxed);
+        free(pointer);
+    }
+}
+
+} // namespace
+
+void *operator new(size_t size) { return countedAllocate(size); }
+void *operator new[](size_t size) { return countedAllocate(size); }
+void operator delete(void *pointer) noexcept { countedFree(pointer); }
+void operator delete[](void *pointer) noexcept { countedFree(pointer); }
+void operator delete(void *pointer, size_t) noexcept { countedFree(pointer); }
+void operator delete[](void *pointer, size_t) noexcept { countedFree(pointer); }
+
+#endif
+
+namespace {
+
+struct Options {
+    double durationSeconds = 3600.0;
+    double warmupSeconds = 60.0;
+    double intervalSeconds = 10.0;
+    uint16_t port = 44090;
+    int vehicles = 10;
+    std::string simulator;
+    std::string simulatorArgs;
+    std::string reportPath = "soak_report.csv";
+    double maxRssGrowthMB = 32.0;
+    long maxThreadGrowth = 0;
+    long long maxLiveAllocationGrowth = 100000;
+    double maxHandleMicros = 500.0;
+    double maxDropPercent = 1.0;
+};
+
+struct Sample {
+    double seconds = 0.0;
+    long rssKB = 0;
+    long threads = 0;
+    uint64_t allocations = 0;
+    uint64_t deallocations = 0;
+    uint64_t allocatedBytes = 0;
+    VehicleManager::Stats stats;
+    size_t vehicles = 0;
+    size_t vehiclesWithParameters = 0;
+    double linkLatencyMsecs = 0.0;      ///< Mean over synchronized vehicles
+
+    int64_t liveAllocations() const { return static_cast<int64_t>(allocations - deallocations); }
+};
+
+/// Field of /proc/self/status, e.g. VmRSS in kB or Threads
+long procStatus(const char *field)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    const size_t length = strlen(field);
+    while (std::getline(status, line)) {
+        if (line.compare(0, length, field) == 0 && line.size() > length && line[length] == ':') {
+            return atol(line.c_str() + length + 1);
+        }
+    }
+    return -1;
+}
+
+Sample takeSample(double seconds, const VehicleManager &manager)
+{
+    Sample sample;
+    sample.seconds = seconds;
+    sample.rssKB = procStatus("VmRSS");
+    sample.threads = procStatus("Threads");
+#if MAVCOLLECTOR_COUNT_ALLOCATIONS
+    const AllocationCounter::Counts allocations = AllocationCounter::report().total();
+    sample.allocations = allocations.allocations;
+    sample.deallocations = allocations.frees;
+    sample.allocatedBytes = allocations.bytes;
+#else
+    sample.allocations = g_allocations.load(std::memory_order_relaxed);
+    sample.deallocations = g_deallocations.load(std::memory_order_relaxed);
+    sample.allocatedBytes = g_allocatedBytes.load(std::memory_order_relaxed);
+#endif
+    sample.stats = manager.stats();
+
+    int synchronized = 0;
+    for (const auto &vehicle : manager.vehicles()) {
+        sample.vehicles++;
+        if (vehicle->parameterManager() && vehicle->parameterManager()->parametersReady()) {
+            sample.vehiclesWithParameters++;
+        }
+        TimeSync::Estimate clock = vehicle->timeSync()->estimate();
+        if (clock.synchronized) {
+            sample.linkLatencyMsecs += clock.latencyMsecs;
+            synchronized++;
+        }
+    }
+    if (synchronized > 0) {
+        sample.linkLatencyMsecs /= synchronized;
+    }
+    return sample;
+}
+
+std::string csvHeader()
+{
+    return "seconds,rss_kb,threads,allocations,live_allocations,allocated_bytes,vehicles,vehicles_with_params,"
+           "frames,frames_per_sec,dropped,unrouted,queue_wait_us,handle_us,max_handle_us,link_latency_ms,"
+           "allocations_per_frame";
+}
+
+/// Rates and means over the interval since previous
+std::string csvLine(const Sample &sample, const Sample &previous)
+{
+    const uint64_t frames = sample.stats.processed - previous.stats.processed;
+    const double interval = std::max(1e-9, sample.seconds - previous.seconds);
+    const double queueWaitMicros = frames ? (sample.stats.queueWaitNs - previous.stats.queueWaitNs) / 1e3 / frames : 0.0;
+    const double handleMicros = frames ? (sample.stats.handleNs - previous.stats.handleNs) / 1e3 / frames : 0.0;
+    const double allocationsPerFrame = frames ? static_cast<double>(sample.allocations - previous.allocations) / frames : 0.0;
+
+    char line[512];
+    snprintf(line, sizeof(line), "%.1f,%ld,%ld,%llu,%lld,%llu,%zu,%zu,%llu,%.0f,%llu,%llu,%.2f,%.2f,%.1f,%.2f,%.2f",
+             sample.seconds, sample.rssKB, sample.threads, static_cast<unsigned long long>(sample.allocations),
+             static_cast<long long>(sample.liveAllocations()), static_cast<unsigned long long>(sample.allocatedBytes),
+             sample.vehicles, sample.vehiclesWithParameters, static_cast<unsigned long long>(sample.stats.processed),
+             frames / interval, static_cast<unsigned long long>(sample.stats.dropped),
+             static_cast<unsigned long long>(sample.stats.unrouted), queueWaitMicros, handleMicros,
+             sample.stats.maxHandleNs / 1e3, sample.linkLatencyMsecs, allocationsPerFrame);
+    return line;
+}
+
+pid_t startSimulator(const Options &options)
+{
+    std::vector<std::string> args = { options.simulator, "-port", std::to_string(options.port),
+                                      "-vehicles", std::to_string(options.vehicles), "-stats", "60" };
+    std::istringstream extra(options.simulatorArgs);
+    std::string arg;
+    while (extra >> arg) {
+        args.push_back(arg);
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Its statistics would interleave with the samples
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDOUT_FILENO);
+        std::vector<char*> argv;
+        for (std::string &value : args) {
+            argv.push_back(value.data());
+        }
+        argv.push_back(nullptr);
+        execv(argv[0], argv.data());
+        perror("execv");
+        _exit(127);
+    }
+    return pid;
+}
+
+/// Sink for the vehicles' console output while the test runs
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+};
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    std::string self = argv[0];
+    options.simulator = (self.find('/') != std::string::npos ? self.substr(0, self.rfind('/') + 1) : std::string("./")) + "VehicleSimulator";
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "-duration" && hasValue) {
+            options.durationSeconds = std::max(1.0, atof(argv[++i]));
+        } else if (arg == "-warmup" && hasValue) {
+            options.warmupSeconds = std::max(0.0, atof(argv[++i]));
+        } else if (arg == "-interval" && hasValue) {
+            options.intervalSeconds = std::max(0.1, atof(argv[++i]));
+        } else if (arg == "-port" && hasValue) {
+            options.port = static_cast<uint16_t>(atoi(argv[++i]));
+        } else if (arg == "-vehicles" && hasValue) {
+            options.vehicles = std::clamp(atoi(argv[++i]), 1, 254);
+        } else if (arg == "-simulator" && hasValue) {
+            options.simulator = argv[++i];
+        } else if (arg == "-sim-args" && hasValue) {
+            options.simulatorArgs = argv[++i];
+        } else if (arg == "-report" && hasValue) {
+            options.reportPath = argv[++i];
+        } else if (arg == "-max-rss-growth" && hasValue) {
+            options.maxRssGrowthMB = atof(argv[++i]);
+        } else if (arg == "-max-thread-growth" && hasValue) {
+            options.maxThreadGrowth = atol(argv[++i]);
+        } else if (arg == "-max-live-alloc-growth" && hasValue) {
+            options.maxLiveAllocationGrowth = atoll(argv[++i]);
+        } else if (arg == "-max-handle-us" && hasValue) {
+            options.maxHandleMicros = atof(argv[++i]);
+        } else if (arg == "-max-drop-percent" && hasValue) {
+            options.maxDropPercent = atof(argv[++i]);
+        } else {
+            std::cout << "Usage: " << argv[0] << " [-duration <seconds>] [-warmup <seconds>] [-interval <seconds>] [-port <n>]\n"
+                      << "       [-vehicles <n>] [-simulator <path>] [-sim-args \"<args>\"] [-report <file>]\n"
+                      << "       [-max-rss-growth <MB>] [-max-thread-growth <n>] [-max-live-alloc-growth <n>]\n"
+                      << "       [-max-handle-us <mean>] [-max-drop-percent <percent>]\n";
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+    if (access(options.simulator.c_str(), X_OK) != 0) {
+        std::cerr << "Simulator " << options.simulator << " not found, see -simulator\n";
+        return 1;
+    }
+    std::ofstream report(options.reportPath);
+    if (!report) {
+        std::cerr << "Can't write " << options.reportPath << "\n";
+        return 1;
+    }
+
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+    Logger::instance().setLevel(Logger::Warning);
+    NullBuffer nullBuffer;
+    std::streambuf *coutBuffer = std::cout.rdbuf(&nullBuffer);
+
+    MAVLinkUdpConnection connection;
+    if (!connection.connect("127.0.0.1", options.port)) {
+        std::cout.rdbuf(coutBuffer);
+        std::cerr << "Can't listen on port " << options.port << "\n";
+        return 1;
+    }
+    VehicleManager manager(&connection);
+    manager.start();
+    const pid_t simulator = startSimulator(options);
+
+    printf("Soak test: %d vehicle(s) for %.0f s, warm up %.0f s, report in %s\n", options.vehicles, options.durationSeconds,
+           options.warmupSeconds, options.reportPath.c_str());
+    printf("%s\n", csvHeader().c_str());
+    report << csvHeader() << "\n";
+    fflush(stdout);
+
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start]() { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+    std::vector<Sample> samples = { takeSample(0.0, manager) };
+    Sample baseline;
+    bool warmedUp = false;
+
+    while (g_running && elapsed() < options.durationSeconds) {
+        const double next = samples.back().seconds + options.intervalSeconds;
+        while (g_running && elapsed() < std::min(next, options.durationSeconds)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        samples.push_back(takeSample(elapsed(), manager));
+        const Sample &sample = samples.back();
+        const std::string line = csvLine(sample, samples[samples.size() - 2]);
+        printf("%s\n", line.c_str());
+        fflush(stdout);
+        report << line << "\n";
+        report.flush();
+
+        if (!warmedUp && sample.seconds >= options.warmupSeconds && sample.vehicles == static_cast<size_t>(options.vehicles) &&
+            sample.vehiclesWithParameters == sample.vehicles) {
+            warmedUp = true;
+            baseline = sample;
+        }
+    }
+
+    kill(simulator, SIGINT);
+    waitpid(simulator, nullptr, 0);
+    connection.disconnect();
+    std::cout.rdbuf(coutBuffer);
+
+    // Verdict, growth from the end of the warm up to the last sample
+    const Sample &last = samples.back();
+    std::vector<std::string> results;
+    bool passed = true;
+    auto check = [&](const std::string &name, bool ok, const std::string &detail) {
+        results.push_back(std::string(ok ? "PASS " : "FAIL ") + name + ": " + detail);
+        passed = passed && ok;
+    };
+    char detail[256];
+
+    check("warm up", warmedUp, warmedUp ? "all vehicles loaded their parameters"
+                                        : "not every vehicle appeared and loaded its parameters");
+    if (warmedUp) {
+        const double hours = std::max(1e-9, (last.seconds - baseline.seconds) / 3600.0);
+        const double rssGrowthMB = (last.rssKB - baseline.rssKB) / 1024.0;
+        snprintf(detail, sizeof(detail), "%.1f MB (%.1f MB/h), limit %.1f MB", rssGrowthMB, rssGrowthMB / hours, options.maxRssGrowthMB);
+        check("rss growth", rssGrowthMB <= options.maxRssGrowthMB, detail);
+
+        const long threadGrowth = last.threads - baseline.threads;
+        snprintf(detail, sizeof(detail), "%ld (%ld -> %ld), limit %ld", threadGrowth, baseline.threads, last.threads, options.maxThreadGrowth);
+        check("thread growth", threadGrowth <= options.maxThreadGrowth, detail);
+
+        const long long liveGrowth = last.liveAllocations() - baseline.liveAllocations();
+        snprintf(detail, sizeof(detail), "%lld (%.0f/h), limit %lld", liveGrowth, liveGrowth / hours, options.maxLiveAllocationGrowth);
+        check("live allocation growth", liveGrowth <= options.maxLiveAllocationGrowth, detail);
+
+        const uint64_t frames = last.stats.processed - baseline.stats.processed;
+        const double handleMicros = frames ? (last.stats.handleNs - baseline.stats.handleNs) / 1e3 / frames : 0.0;
+        snprintf(detail, sizeof(detail), "%.2f us mean, %.1f us max, limit %.1f us mean", handleMicros,
+                 last.stats.maxHandleNs / 1e3, options.maxHandleMicros);
+        check("handle latency", handleMicros <= options.maxHandleMicros, detail);
+
+        const uint64_t dropped = last.stats.dropped - baseline.stats.dropped;
+        const double dropPercent = frames + dropped ? 100.0 * dropped / (frames + dropped) : 0.0;
+        snprintf(detail, sizeof(detail), "%.3f%% of %llu frames, limit %.3f%%", dropPercent,
+                 static_cast<unsigned long long>(frames + dropped), options.maxDropPercent);
+        check("queue drops", dropPercent <= options.maxDropPercent, detail);
+
+        snprintf(detail, sizeof(detail), "%.2f per frame", frames ? static_cast<double>(last.allocations - baseline.allocations) / frames : 0.0);
+        results.push_back(std::string("INFO allocations: ") + detail);
+    }
+
+    report << "\n";
+    printf("\n");
+    for (const std::string &result : results) {
+        report << "# " << result << "\n";
+        printf("%s\n", result.c_str());
+    }
+    report << "# " << (passed ? "PASSED" : "FAILED") << "\n";
+    printf("%s\n", passed ? "PASSED" : "FAILED");
+
+    Logger::instance().shutdown();
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include "VehicleManager.h"
+#include "Vehicle.h"
+#include "Logger.h"
+
+/// Throughput of VehicleManager routing and Vehicle message handling with 1, 10 and 100 simulated
+/// vehicles. Frames are handed to the manager directly as the receive thread would, without a
+/// connection, so the numbers exclude socket and parser cost.
+///
+///     VehicleManagerBenchmark [-shards <n>] [-messages <n>]
+
+namespace {
+
+constexpr uint8_t kComponentId = MAV_COMP_ID_AUTOPILOT1;
+
+mavlink_message_t heartbeat(uint8_t systemId)
+{
+    mavlink_message_t message;
+    mavlink_msg_heartbeat_pack(systemId, kComponentId, &message, MAV_TYPE_QUADROTOR, MAV_AUTOPILOT_PX4,
+                               MAV_MODE_FLAG_CUSTOM_MODE_ENABLED, 0, MAV_STATE_ACTIVE);
+    return message;
+}
+
+/// Telemetry mix resembling a vehicle streaming at its default rates
+void telemetry(uint8_t systemId, uint32_t sequence, std::vector<mavlink_message_t> &messages)
+{
+    mavlink_message_t message;
+    float t = static_cast<float>(sequence) * 0.02f;
+    int32_t latitude = 473977420 + static_cast<int32_t>(sequence);
+    int32_t longitude = 85455940 + static_cast<int32_t>(systemId) * 100;
+
+    mavlink_msg_attitude_pack(systemId, kComponentId, &message, sequence * 20, 0.1f * t, -0.05f * t, 1.5f, 0.01f, 0.02f, 0.03f);
+    messages.push_back(message);
+    mavlink_msg_global_position_int_pack(systemId, kComponentId, &message, sequence * 20, latitude, longitude,
+                                         500000, 20000, 100, 50, -10, 9000);
+    messages.push_back(message);
+    mavlink_msg_vfr_hud_pack(systemId, kComponentId, &message, 12.0f, 11.5f, 90, 55, 20.0f, 0.5f);
+    messages.push_back(message);
+
+    if (sequence % 5 == 0) {
+        mavlink_msg_gps_raw_int_pack(systemId, kComponentId, &message, sequence * 20, GPS_FIX_TYPE_3D_FIX, latitude, longitude,
+                                     500000, 80, 120, 1150, 9000, 14, 0, 0, 0, 0, 0, 0);
+        messages.push_back(message);
+        mavlink_msg_sys_status_pack(systemId, kComponentId, &message, 0, 0, 0, 500, 15800, 1200, 80, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+        messages.push_back(message);
+    }
+}
+
+/// Sink for the vehicles' console output while the benchmark runs
+class NullBuffer : public std::streambuf
+{
+protected:
+    int overflow(int c) override { return c; }
+};
+
+struct Result {
+    size_t vehicles = 0;
+    uint64_t messages = 0;
+    double seconds = 0.0;
+    uint64_t dropped = 0;
+};
+
+Result run(size_t vehicleCount, size_t shardCount, uint64_t messageCount)
+{
+    Result result;
+    result.vehicles = vehicleCount;
+
+    VehicleManager manager(nullptr, shardCount);
+
+    // Discovery, each new vehicle requests its parameters and streams which takes a while
+    for (size_t i = 0; i < vehicleCount; i++) {
+        manager.handleMessage(heartbeat(static_cast<uint8_t>(i + 1)));
+    }
+    while (manager.stats().processed < vehicleCount) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // Interleave the vehicles like frames arriving on a shared link
+    std::vector<mavlink_message_t> messages;
+    messages.reserve(static_cast<size_t>(messageCount) + 16);
+    for (uint32_t sequence = 0; messages.size() < messageCount; sequence++) {
+        for (size_t i = 0; i < vehicleCount && messages.size() < messageCount; i++) {
+            telemetry(static_cast<uint8_t>(i + 1), sequence, messages);
+        }
+    }
+    messages.resize(static_cast<size_t>(messageCount));
+
+    // Keep every queue below capacity, even when all frames in flight belong to one shard, so the
+    // result is processing throughput and not drop rate
+    const uint64_t maxInFlight = VehicleManager::kDefaultQueueCapacity / 2;
+    const VehicleManager::Stats before = manager.stats();
+    const auto start = std::chrono::steady_clock::now();
+
+    for (const auto& message : messages) {
+        while (true) {
+            VehicleManager::Stats stats = manager.stats();
+            if (stats.routed - stats.processed < maxInFlight) {
+                break;
+            }
+            std::this_thread::yield();
+        }
+        manager.handleMessage(message);
+    }
+    while (true) {
+        VehicleManager::Stats stats = manager.stats();
+        if (stats.processed + stats.dropped - before.dropped >= before.processed + messageCount) {
+            break;
+        }
+        std::this_thread::yield();
+    }
+
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    VehicleManager::Stats after = manager.stats();
+    result.messages = after.processed - before.processed;
+    result.dropped = after.dropped - before.dropped;
+    result.seconds = std::chrono::duration<double>(elapsed).count();
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t shardCount = VehicleManager::kDefaultShardCount;
+    uint64_t messageCount = 1000000;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-shards" && i + 1 < argc) {
+            shardCount = static_cast<size_t>(std::max(1, atoi(argv[++i])));
+        } else if (arg == "-messages" && i + 1 < argc) {
+            messageCount = static_cast<uint64_t>(std::max(1LL, atoll(argv[++i])));
+        } else {
+            std::cout << "Usage: " << argv[0] << " [-shards <n>] [-messages <n>]\n";
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+
+    Logger::instance().setLevel(Logger::Error);
+    NullBuffer nullBuffer;
+    std::streambuf *coutBuffer = std::cout.rdbuf(&nullBuffer);
+
+    std::vector<Result> results;
+    for (size_t vehicleCount : {1, 10, 100}) {
+        results.push_back(run(vehicleCount, shardCount, messageCount));
+    }
+
+    std::cout.rdbuf(coutBuffer);
+    Logger::instance().shutdown();
+
+    printf("VehicleManager throughput, %zu shards, %llu messages per run\n", shardCount,
+           static_cast<unsigned long long>(messageCount));
+    printf("%10s %14s %12s %10s\n", "vehicles", "messages/s", "ns/message", "dropped");
+    for (const auto& result : results) {
+        double rate = result.seconds > 0.0 ? result.messages / result.seconds : 0.0;
+        double nsPerMessage = result.messages > 0 ? result.seconds * 1e9 / result.messages : 0.0;
+        printf("%10zu %14.0f %12.1f %10llu\n", result.vehicles, rate, nsPerMessage,
+               static_cast<unsigned long long>(result.dropped));
+    }
+    return 0;
+}
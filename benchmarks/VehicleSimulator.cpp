@@ -0,0 +1,796 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <csignal>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "FTPManager.h"
+
+/// Stand-in autopilots for load testing the collector end to end over loopback. Every simulated
+/// vehicle flies a circle and streams telemetry at per-message rates, in MAVLink 1, 2 or a mix per
+/// vehicle, with its own sequence numbers. The link drops, reorders and duplicates frames at the
+/// given rates.
+///
+/// The vehicles answer what the collector asks for at connection: PARAM_REQUEST_LIST, _READ and
+/// _SET from a generated parameter set, COMMAND_LONG including MAV_CMD_SET_MESSAGE_INTERVAL, which
+/// changes the stream rate, and MAV_CMD_REQUEST_MESSAGE, TIMESYNC and an empty mission. MAVLink FTP
+/// is refused so parameters always come through the PARAM_VALUE protocol.
+///
+///     VehicleSimulator [-target <address>] [-port <n>] [-vehicles <n>] [-sysid <first>]
+///                      [-autopilot px4|ardupilot] [-mavlink 1|2|mixed] [-rate <MESSAGE>=<Hz>]...
+///                      [-rate-scale <x>] [-params <n>] [-param-rate <per second>]
+///                      [-loss <percent>] [-reorder <percent>] [-duplicate <percent>]
+///                      [-duration <seconds>] [-stats <seconds>] [-seed <n>]
+
+namespace {
+
+constexpr uint8_t kComponentId = MAV_COMP_ID_AUTOPILOT1;
+constexpr mavlink_channel_t kChannel = MAVLINK_COMM_3;     // The collector parses on channel 0
+constexpr double kHomeLatitude = 47.397742;
+constexpr double kHomeLongitude = 8.545594;
+constexpr double kCircleRadiusMeters = 150.0;
+constexpr double kCruiseSpeed = 12.0;                       ///< m/s
+constexpr double kMetersPerDegree = 111319.5;
+
+std::atomic<bool> g_running(true);
+
+void signalHandler(int)
+{
+    g_running = false;
+}
+
+/// Telemetry streams and their rates when nothing asked for others
+struct StreamInfo {
+    const char *name;
+    uint32_t msgid;
+    double hz;
+};
+
+const StreamInfo kStreams[] = {
+    { "HEARTBEAT",           MAVLINK_MSG_ID_HEARTBEAT,           1.0 },
+    { "SYS_STATUS",          MAVLINK_MSG_ID_SYS_STATUS,          2.0 },
+    { "ATTITUDE",            MAVLINK_MSG_ID_ATTITUDE,            20.0 },
+    { "GLOBAL_POSITION_INT", MAVLINK_MSG_ID_GLOBAL_POSITION_INT, 10.0 },
+    { "VFR_HUD",             MAVLINK_MSG_ID_VFR_HUD,             4.0 },
+    { "GPS_RAW_INT",         MAVLINK_MSG_ID_GPS_RAW_INT,         5.0 },
+    { "BATTERY_STATUS",      MAVLINK_MSG_ID_BATTERY_STATUS,      1.0 },
+    { "RC_CHANNELS",         MAVLINK_MSG_ID_RC_CHANNELS,         4.0 },
+    { "VIBRATION",           MAVLINK_MSG_ID_VIBRATION,           2.0 },
+    { "WIND_COV",            MAVLINK_MSG_ID_WIND_COV,            1.0 },
+    { "ESTIMATOR_STATUS",    MAVLINK_MSG_ID_ESTIMATOR_STATUS,    1.0 },
+    { "MISSION_CURRENT",     MAVLINK_MSG_ID_MISSION_CURRENT,     1.0 },
+};
+
+struct Options {
+    std::string target = "127.0.0.1";
+    uint16_t port = 44003;
+    int vehicles = 1;
+    int firstSystemId = 1;
+    uint8_t autopilot = MAV_AUTOPILOT_PX4;
+    std::string mavlink = "2";
+    std::map<std::string, double> rates;        ///< Overrides by stream name
+    double rateScale = 1.0;
+    int params = 400;
+    double paramRate = 2000.0;
+    double lossPercent = 0.0;
+    double reorderPercent = 0.0;
+    double duplicatePercent = 0.0;
+    double durationSeconds = 0.0;               ///< 0: until interrupted
+    double statsSeconds = 5.0;
+    unsigned seed = 1;
+};
+
+struct Stats {
+    uint64_t frames = 0;        ///< Handed to the link, before impairments
+    uint64_t bytes = 0;
+    uint64_t dropped = 0;
+    uint64_t reordered = 0;
+    uint64_t duplicated = 0;
+    uint64_t requests = 0;      ///< Frames received from the collector
+    uint64_t paramValues = 0;
+    uint64_t commands = 0;
+};
+
+/// UDP socket towards the collector with the impairments applied per frame
+class Link
+{
+public:
+    Link(const Options &options, Stats &stats)
+        : _options(options)
+        , _stats(stats)
+        , _random(options.seed)
+    {
+        _socket = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in local{};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        bind(_socket, reinterpret_cast<sockaddr*>(&local), sizeof(local));
+
+        timeval timeout{0, 1000};
+        setsockopt(_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        _collector.sin_family = AF_INET;
+        _collector.sin_port = htons(options.port);
+        inet_pton(AF_INET, options.target.c_str(), &_collector.sin_addr);
+    }
+
+    ~Link()
+    {
+        close(_socket);
+    }
+
+    Link(const Link&) = delete;
+    Link& operator=(const Link&) = delete;
+
+    void send(const mavlink_message_t &message)
+    {
+        std::vector<uint8_t> frame(MAVLINK_MAX_PACKET_LEN);
+        frame.resize(mavlink_msg_to_send_buffer(frame.data(), &message));
+        _stats.frames++;
+        _stats.bytes += frame.size();
+
+        if (_chance(_options.lossPercent)) {
+            _stats.dropped++;
+            return;
+        }
+        // A held frame goes out after the one that follows it
+        if (_held.empty() && _chance(_options.reorderPercent)) {
+            _stats.reordered++;
+            _held = std::move(frame);
+            return;
+        }
+        _sendFrame(frame);
+        if (_chance(_options.duplicatePercent)) {
+            _stats.duplicated++;
+            _sendFrame(frame);
+        }
+        if (!_held.empty()) {
+            _sendFrame(_held);
+            _held.clear();
+        }
+    }
+
+    /// Waits up to a millisecond for the first datagram
+    void receive(const std::function<void(const mavlink_message_t&)> &handler)
+    {
+        uint8_t buffer[2048];
+        int flags = 0;
+        ssize_t received;
+        while ((received = recv(_socket, buffer, sizeof(buffer), flags)) > 0) {
+            mavlink_message_t message;
+            for (ssize_t i = 0; i < received; i++) {
+                if (mavlink_parse_char(kChannel, buffer[i], &message, &_parseStatus) == MAVLINK_FRAMING_OK) {
+                    _stats.requests++;
+                    handler(message);
+                }
+            }
+            flags = MSG_DONTWAIT;
+        }
+    }
+
+private:
+    bool _chance(double percent)
+    {
+        return percent > 0.0 && _percent(_random) < percent;
+    }
+
+    void _sendFrame(const std::vector<uint8_t> &frame)
+    {
+        sendto(_socket, frame.data(), frame.size(), 0, reinterpret_cast<const sockaddr*>(&_collector), sizeof(_collector));
+    }
+
+    const Options &_options;
+    Stats &_stats;
+    std::mt19937 _random;
+    std::uniform_real_distribution<double> _percent{0.0, 100.0};
+    int _socket = -1;
+    sockaddr_in _collector{};
+    std::vector<uint8_t> _held;
+    mavlink_status_t _parseStatus{};
+};
+
+struct Param {
+    std::string name;
+    uint8_t type;                       ///< MAV_PARAM_TYPE
+    mavlink_param_union_t value{};      ///< Encoded bytewise
+};
+
+std::vector<Param> makeParams(int count, uint8_t systemId)
+{
+    static const char *prefixes[] = { "ATC_RAT_PIT_", "ATC_RAT_RLL_", "BAT_", "CAL_MAG0_", "EKF2_", "GPS_",
+                                      "IMU_ACC_", "IMU_GYRO_", "MPC_", "NAV_", "RC1_", "SYS_" };
+    std::vector<Param> params;
+    for (int i = 0; i < count; i++) {
+        Param param;
+        param.name = std::string(prefixes[i % 12]) + "P" + std::to_string(i / 12);
+        switch (i % 4) {
+            case 0: param.type = MAV_PARAM_TYPE_INT8;   param.value.param_int8 = static_cast<int8_t>(i % 100); break;
+            case 1: param.type = MAV_PARAM_TYPE_INT16;  param.value.param_int16 = static_cast<int16_t>(i * 7); break;
+            case 2: param.type = MAV_PARAM_TYPE_INT32;  param.value.param_int32 = static_cast<int32_t>(i * 100003 + systemId); break;
+            default: param.type = MAV_PARAM_TYPE_REAL32; param.value.param_float = static_cast<float>(i) * 0.25f + systemId; break;
+        }
+        param.value.type = param.type;
+        params.push_back(param);
+    }
+    std::sort(params.begin(), params.end(), [](const Param &a, const Param &b) { return a.name < b.name; });
+    return params;
+}
+
+class SimulatedVehicle
+{
+public:
+    SimulatedVehicle(uint8_t systemId, bool mavlink1, const Options &options, Link &link, Stats &stats)
+        : _systemId(systemId)
+        , _options(options)
+        , _link(link)
+        , _stats(stats)
+        , _params(makeParams(options.params, systemId))
+        , _boot(std::chrono::steady_clock::now())
+    {
+        if (mavlink1) {
+            _status.flags |= MAVLINK_STATUS_FLAG_OUT_MAVLINK1;
+        }
+        // Vehicles spread out so their positions differ, and their streams don't fire in lockstep
+        _phase = systemId * 0.7;
+        const auto now = std::chrono::steady_clock::now();
+        for (const StreamInfo &info : kStreams) {
+            Stream stream;
+            stream.info = &info;
+            stream.defaultIntervalSecs = _defaultInterval(info);
+            stream.intervalSecs = stream.defaultIntervalSecs;
+            stream.next = now + std::chrono::microseconds((systemId * 7919 + info.msgid * 104729) % 100000);
+            _streams.push_back(stream);
+        }
+    }
+
+    uint8_t systemId() const { return _systemId; }
+
+    void update(std::chrono::steady_clock::time_point now)
+    {
+        for (Stream &stream : _streams) {
+            if (stream.intervalSecs <= 0.0) {
+                continue;
+            }
+            // Far behind, e.g. after the process was stopped, skip instead of bursting
+            if (now - stream.next > std::chrono::seconds(1)) {
+                stream.next = now;
+            }
+            while (stream.next <= now) {
+                _sendTelemetry(stream.info->msgid, now);
+                stream.next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(stream.intervalSecs));
+            }
+        }
+
+        // Parameter list, paced
+        if (!_pendingParams.empty()) {
+            const double elapsed = std::chrono::duration<double>(now - _lastParamTime).count();
+            _paramBudget = std::min(_paramBudget + elapsed * _options.paramRate, std::max(1.0, _options.paramRate * 0.01));
+            while (!_pendingParams.empty() && _paramBudget >= 1.0) {
+                _sendParam(_pendingParams.front());
+                _pendingParams.pop_front();
+                _paramBudget -= 1.0;
+            }
+        }
+        _lastParamTime = now;
+    }
+
+    void handleMessage(const mavlink_message_t &message)
+    {
+        switch (message.msgid) {
+            case MAVLINK_MSG_ID_PARAM_REQUEST_LIST: {
+                mavlink_param_request_list_t request;
+                mavlink_msg_param_request_list_decode(&message, &request);
+                if (_addressed(request.target_system)) {
+                    _pendingParams.clear();
+                    for (size_t i = 0; i < _params.size(); i++) {
+                        _pendingParams.push_back(static_cast<uint16_t>(i));
+                    }
+                    _paramBudget = 0.0;
+                }
+                break;
+            }
+            case MAVLINK_MSG_ID_PARAM_REQUEST_READ: {
+                mavlink_param_request_read_t request;
+                mavlink_msg_param_request_read_decode(&message, &request);
+                if (_addressed(request.target_system)) {
+                    int index = request.param_index;
+                    if (index < 0) {
+                        index = _paramIndex(std::string(request.param_id, strnlen(request.param_id, sizeof(request.param_id))));
+                    }
+                    if (index >= 0 && static_cast<size_t>(index) < _params.size()) {
+                        _sendParam(static_cast<uint16_t>(index));
+                    }
+                }
+                break;
+            }
+            case MAVLINK_MSG_ID_PARAM_SET: {
+                mavlink_param_set_t set;
+                mavlink_msg_param_set_decode(&message, &set);
+                if (_addressed(set.target_system)) {
+                    const int index = _paramIndex(std::string(set.param_id, strnlen(set.param_id, sizeof(set.param_id))));
+                    if (index >= 0) {
+                        Param &param = _params[static_cast<size_t>(index)];
+                        memcpy(&param.value.param_float, &set.param_value, sizeof(float));
+                        _sendParam(static_cast<uint16_t>(index));
+                    }
+                }
+                break;
+            }
+            case MAVLINK_MSG_ID_COMMAND_LONG: {
+                mavlink_command_long_t command;
+                mavlink_msg_command_long_decode(&message, &command);
+                if (_addressed(command.target_system)) {
+                    _stats.commands++;
+                    _handleCommand(message, command);
+                }
+                break;
+            }
+            case MAVLINK_MSG_ID_TIMESYNC: {
+                mavlink_timesync_t timesync;
+                mavlink_msg_timesync_decode(&message, &timesync);
+                if (timesync.tc1 == 0 && (timesync.target_system == 0 || timesync.target_system == _systemId)) {
+                    mavlink_message_t reply;
+                    mavlink_msg_timesync_pack_status(_systemId, kComponentId, &_status, &reply, _bootNs(), timesync.ts1,
+                                                     message.sysid, message.compid);
+                    _link.send(reply);
+                }
+                break;
+            }
+            case MAVLINK_MSG_ID_MISSION_REQUEST_LIST: {
+                mavlink_mission_request_list_t request;
+                mavlink_msg_mission_request_list_decode(&message, &request);
+                if (_addressed(request.target_system)) {
+                    mavlink_message_t reply;
+                    mavlink_msg_mission_count_pack_status(_systemId, kComponentId, &_status, &reply, message.sysid, message.compid,
+                                                          0, request.mission_type, 0);
+                    _link.send(reply);
+                }
+                break;
+            }
+            case MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL: {
+                mavlink_file_transfer_protocol_t transfer;
+                mavlink_msg_file_transfer_protocol_decode(&message, &transfer);
+                if (_addressed(transfer.target_system)) {
+                    FTPManager::Request request;
+                    memcpy(&request, transfer.payload, sizeof(request));
+                    FTPManager::Request response{};
+                    response.seqNumber = static_cast<uint16_t>(request.seqNumber + 1);
+                    response.session = request.session;
+                    response.reqOpcode = request.opcode;
+                    response.opcode = FTPManager::kRspNak;
+                    response.size = 1;
+                    response.data[0] = FTPManager::kErrUnknownCommand;
+                    mavlink_message_t reply;
+                    mavlink_msg_file_transfer_protocol_pack_status(_systemId, kComponentId, &_status, &reply, 0, message.sysid,
+                                                                   message.compid, reinterpret_cast<const uint8_t*>(&response));
+                    _link.send(reply);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+private:
+    struct Stream {
+        const StreamInfo *info = nullptr;
+        double defaultIntervalSecs = 0.0;
+        double intervalSecs = 0.0;          ///< 0: disabled
+        std::chrono::steady_clock::time_point next;
+    };
+
+    double _defaultInterval(const StreamInfo &info) const
+    {
+        // The heartbeat isn't scaled, the collector times vehicles out on it
+        auto it = _options.rates.find(info.name);
+        const double hz = it != _options.rates.end() ? it->second
+                        : info.msgid == MAVLINK_MSG_ID_HEARTBEAT ? info.hz : info.hz * _options.rateScale;
+        return hz > 0.0 ? 1.0 / hz : 0.0;
+    }
+
+    bool _addressed(uint8_t targetSystem) const
+    {
+        return targetSystem == 0 || targetSystem == _systemId;
+    }
+
+    int _paramIndex(const std::string &name) const
+    {
+        for (size_t i = 0; i < _params.size(); i++) {
+            if (_params[i].name == name) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    Stream *_stream(uint32_t msgid)
+    {
+        for (Stream &stream : _streams) {
+            if (stream.info->msgid == msgid) {
+                return &stream;
+            }
+        }
+        return nullptr;
+    }
+
+    void _handleCommand(const mavlink_message_t &message, const mavlink_command_long_t &command)
+    {
+        uint8_t result = MAV_RESULT_ACCEPTED;
+        switch (command.command) {
+            case MAV_CMD_SET_MESSAGE_INTERVAL: {
+                Stream *stream = _stream(static_cast<uint32_t>(command.param1));
+                if (!stream) {
+                    result = MAV_RESULT_DENIED;
+                } else if (command.param2 < 0.0f) {
+                    stream->intervalSecs = 0.0;
+                } else if (command.param2 == 0.0f) {
+                    stream->intervalSecs = stream->defaultIntervalSecs;
+                } else {
+                    stream->intervalSecs = command.param2 * 1e-6;
+                    stream->next = std::chrono::steady_clock::now();
+                }
+                break;
+            }
+            case MAV_CMD_REQUEST_MESSAGE:
+                if (!_sendRequested(static_cast<uint32_t>(command.param1))) {
+                    result = MAV_RESULT_UNSUPPORTED;
+                }
+                break;
+            case MAV_CMD_REQUEST_AUTOPILOT_CAPABILITIES:
+                _sendRequested(MAVLINK_MSG_ID_AUTOPILOT_VERSION);
+                break;
+            default:
+                break;
+        }
+
+        mavlink_message_t ack;
+        mavlink_msg_command_ack_pack_status(_systemId, kComponentId, &_status, &ack, command.command, result, 0, 0,
+                                            message.sysid, message.compid);
+        _link.send(ack);
+    }
+
+    bool _sendRequested(uint32_t msgid)
+    {
+        mavlink_message_t message;
+        if (msgid == MAVLINK_MSG_ID_AUTOPILOT_VERSION) {
+            const uint8_t custom[8] = {};
+            const uint8_t uid2[18] = {};
+            uint64_t capabilities = MAV_PROTOCOL_CAPABILITY_MISSION_INT | MAV_PROTOCOL_CAPABILITY_COMMAND_INT |
+                                    MAV_PROTOCOL_CAPABILITY_PARAM_ENCODE_BYTEWISE;
+            if (!(_status.flags & MAVLINK_STATUS_FLAG_OUT_MAVLINK1)) {
+                capabilities |= MAV_PROTOCOL_CAPABILITY_MAVLINK2;
+            }
+            mavlink_msg_autopilot_version_pack_status(_systemId, kComponentId, &_status, &message, capabilities,
+                                                      0x010E0000, 0, 0, 1, custom, custom, custom, 0x26ac, 0x0011,
+                                                      0x1000 + _systemId, uid2);
+            _link.send(message);
+            return true;
+        }
+        if (msgid == MAVLINK_MSG_ID_HOME_POSITION) {
+            const float q[4] = {1.0f, 0.0f, 0.0f, 0.0f};
+            mavlink_msg_home_position_pack_status(_systemId, kComponentId, &_status, &message,
+                                                  static_cast<int32_t>(_homeLatitude() * 1e7),
+                                                  static_cast<int32_t>(kHomeLongitude * 1e7), 488000,
+                                                  0.0f, 0.0f, 0.0f, q, 0.0f, 0.0f, 0.0f, _bootUs());
+            _link.send(message);
+            return true;
+        }
+        if (_stream(msgid)) {
+            _sendTelemetry(msgid, std::chrono::steady_clock::now());
+            return true;
+        }
+        return false;
+    }
+
+    void _sendParam(uint16_t index)
+    {
+        const Param &param = _params[index];
+        char name[MAVLINK_MSG_PARAM_VALUE_FIELD_PARAM_ID_LEN] = {};
+        memcpy(name, param.name.data(), std::min(param.name.size(), sizeof(name)));
+        mavlink_message_t message;
+        mavlink_msg_param_value_pack_status(_systemId, kComponentId, &_status, &message, name, param.value.param_float,
+                                            param.type, static_cast<uint16_t>(_params.size()), index);
+        _link.send(message);
+        _stats.paramValues++;
+    }
+
+    double _homeLatitude() const
+    {
+        return kHomeLatitude + (_systemId - 1) * 0.005;
+    }
+
+    void _sendTelemetry(uint32_t msgid, std::chrono::steady_clock::time_point now)
+    {
+        const double t = std::chrono::duration<double>(now - _boot).count();
+        const uint32_t bootMs = static_cast<uint32_t>(t * 1000.0);
+        const uint64_t bootUs = static_cast<uint64_t>(t * 1e6);
+
+        // Counter-clockwise circle around home at cruise speed, gently climbing and sinking
+        const double angle = _phase + t * kCruiseSpeed / kCircleRadiusMeters;
+        const double north = kCircleRadiusMeters * std::sin(angle);
+        const double east = kCircleRadiusMeters * std::cos(angle);
+        const double latitude = _homeLatitude() + north / kMetersPerDegree;
+        const double longitude = kHomeLongitude + east / (kMetersPerDegree * std::cos(kHomeLatitude * M_PI / 180.0));
+        const double relativeAlt = 50.0 + 5.0 * std::sin(t * 0.1);
+        const double climb = 0.5 * std::cos(t * 0.1);
+        const double yaw = std::remainder(angle + M_PI, 2.0 * M_PI);     // Direction of travel, north = 0
+        const double vn = kCruiseSpeed * std::cos(angle);
+        const double ve = -kCruiseSpeed * std::sin(angle);
+        const float roll = static_cast<float>(-std::atan(kCruiseSpeed * kCruiseSpeed / (kCircleRadiusMeters * 9.81)));
+        const uint16_t headingCdeg = static_cast<uint16_t>(std::fmod(yaw * 180.0 / M_PI + 360.0, 360.0) * 100.0);
+        const double batteryRemaining = std::max(0.0, 100.0 - t / 36.0);
+
+        mavlink_message_t message;
+        switch (msgid) {
+            case MAVLINK_MSG_ID_HEARTBEAT:
+                mavlink_msg_heartbeat_pack_status(_systemId, kComponentId, &_status, &message, MAV_TYPE_QUADROTOR, _options.autopilot,
+                                                  MAV_MODE_FLAG_CUSTOM_MODE_ENABLED | MAV_MODE_FLAG_SAFETY_ARMED, 0, MAV_STATE_ACTIVE);
+                break;
+            case MAVLINK_MSG_ID_SYS_STATUS:
+                mavlink_msg_sys_status_pack_status(_systemId, kComponentId, &_status, &message, 0x3fffff, 0x3fffff, 0x3fffff, 420,
+                                                   static_cast<uint16_t>(15200 + batteryRemaining * 12), 1450,
+                                                   static_cast<int8_t>(batteryRemaining), 0, 0, 0, 0, 0, 0, 0, 0, 0);
+                break;
+            case MAVLINK_MSG_ID_ATTITUDE:
+                mavlink_msg_attitude_pack_status(_systemId, kComponentId, &_status, &message, bootMs, roll,
+                                                 static_cast<float>(0.05 * std::sin(t)), static_cast<float>(yaw),
+                                                 0.0f, 0.0f, static_cast<float>(kCruiseSpeed / kCircleRadiusMeters));
+                break;
+            case MAVLINK_MSG_ID_GLOBAL_POSITION_INT:
+                mavlink_msg_global_position_int_pack_status(_systemId, kComponentId, &_status, &message, bootMs,
+                                                            static_cast<int32_t>(latitude * 1e7), static_cast<int32_t>(longitude * 1e7),
+                                                            static_cast<int32_t>((488.0 + relativeAlt) * 1000.0),
+                                                            static_cast<int32_t>(relativeAlt * 1000.0),
+                                                            static_cast<int16_t>(vn * 100.0), static_cast<int16_t>(ve * 100.0),
+                                                            static_cast<int16_t>(-climb * 100.0), headingCdeg);
+                break;
+            case MAVLINK_MSG_ID_VFR_HUD:
+                mavlink_msg_vfr_hud_pack_status(_systemId, kComponentId, &_status, &message, static_cast<float>(kCruiseSpeed),
+                                                static_cast<float>(kCruiseSpeed), static_cast<int16_t>(headingCdeg / 100), 55,
+                                                static_cast<float>(488.0 + relativeAlt), static_cast<float>(climb));
+                break;
+            case MAVLINK_MSG_ID_GPS_RAW_INT:
+                mavlink_msg_gps_raw_int_pack_status(_systemId, kComponentId, &_status, &message, bootUs, GPS_FIX_TYPE_3D_FIX,
+                                                    static_cast<int32_t>(latitude * 1e7), static_cast<int32_t>(longitude * 1e7),
+                                                    static_cast<int32_t>((488.0 + relativeAlt) * 1000.0), 80, 120,
+                                                    static_cast<uint16_t>(kCruiseSpeed * 100.0), headingCdeg, 14,
+                                                    0, 900, 1400, 250, 0, 0);
+                break;
+            case MAVLINK_MSG_ID_BATTERY_STATUS: {
+                uint16_t voltages[10];
+                std::fill(std::begin(voltages), std::end(voltages), UINT16_MAX);
+                for (int cell = 0; cell < 4; cell++) {
+                    voltages[cell] = static_cast<uint16_t>(3700 + batteryRemaining * 5);
+                }
+                const uint16_t voltagesExt[4] = {0, 0, 0, 0};
+                mavlink_msg_battery_status_pack_status(_systemId, kComponentId, &_status, &message, 0, MAV_BATTERY_FUNCTION_ALL,
+                                                       MAV_BATTERY_TYPE_LIPO, 3100, voltages, 1450,
+                                                       static_cast<int32_t>(t * 14.5 / 3.6), -1, static_cast<int8_t>(batteryRemaining),
+                                                       static_cast<int32_t>(batteryRemaining * 36.0), MAV_BATTERY_CHARGE_STATE_OK,
+                                                       voltagesExt, MAV_BATTERY_MODE_UNKNOWN, 0);
+                break;
+            }
+            case MAVLINK_MSG_ID_RC_CHANNELS:
+                mavlink_msg_rc_channels_pack_status(_systemId, kComponentId, &_status, &message, bootMs, 8,
+                                                    1500, 1500, 1550, 1500, 1900, 1000, 1500, 1500,
+                                                    UINT16_MAX, UINT16_MAX, UINT16_MAX, UINT16_MAX, UINT16_MAX, UINT16_MAX,
+                                                    UINT16_MAX, UINT16_MAX, UINT16_MAX, UINT16_MAX, 220);
+                break;
+            case MAVLINK_MSG_ID_VIBRATION:
+                mavlink_msg_vibration_pack_status(_systemId, kComponentId, &_status, &message, bootUs,
+                                                  static_cast<float>(4.0 + std::sin(t)), 4.5f, 11.0f, 0, 0, 0);
+                break;
+            case MAVLINK_MSG_ID_WIND_COV:
+                mavlink_msg_wind_cov_pack_status(_systemId, kComponentId, &_status, &message, bootUs, 3.0f, -1.5f, 0.0f,
+                                                 0.4f, 0.2f, static_cast<float>(488.0 + relativeAlt), 0.0f, 0.0f);
+                break;
+            case MAVLINK_MSG_ID_ESTIMATOR_STATUS:
+                mavlink_msg_estimator_status_pack_status(_systemId, kComponentId, &_status, &message, bootUs,
+                                                         ESTIMATOR_ATTITUDE | ESTIMATOR_VELOCITY_HORIZ | ESTIMATOR_VELOCITY_VERT |
+                                                         ESTIMATOR_POS_HORIZ_ABS | ESTIMATOR_POS_VERT_ABS,
+                                                         0.1f, 0.2f, 0.15f, 0.05f, 0.0f, 0.0f, 0.9f, 1.4f);
+                break;
+            case MAVLINK_MSG_ID_MISSION_CURRENT:
+                mavlink_msg_mission_current_pack_status(_systemId, kComponentId, &_status, &message, 0, 0,
+                                                        MISSION_STATE_NO_MISSION, 0, 0, 0, 0);
+                break;
+            default:
+                return;
+        }
+        _link.send(message);
+    }
+
+    int64_t _bootNs() const
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _boot).count();
+    }
+
+    uint64_t _bootUs() const
+    {
+        return static_cast<uint64_t>(_bootNs() / 1000);
+    }
+
+    const uint8_t _systemId;
+    const Options &_options;
+    Link &_link;
+    Stats &_stats;
+    mavlink_status_t _status{};             ///< Outgoing sequence numbers and MAVLink version of this vehicle
+    std::vector<Param> _params;
+    std::vector<Stream> _streams;
+    std::deque<uint16_t> _pendingParams;
+    double _paramBudget = 0.0;
+    std::chrono::steady_clock::time_point _lastParamTime;
+    const std::chrono::steady_clock::time_point _boot;
+    double _phase = 0.0;
+};
+
+void printStats(const Stats &stats, const Stats &previous, double seconds)
+{
+    printf("%10.0f frames/s %12.0f bytes/s  dropped %llu reordered %llu duplicated %llu  received %llu commands %llu params sent %llu\n",
+           (stats.frames - previous.frames) / seconds, (stats.bytes - previous.bytes) / seconds,
+           static_cast<unsigned long long>(stats.dropped), static_cast<unsigned long long>(stats.reordered),
+           static_cast<unsigned long long>(stats.duplicated), static_cast<unsigned long long>(stats.requests),
+           static_cast<unsigned long long>(stats.commands), static_cast<unsigned long long>(stats.paramValues));
+    fflush(stdout);
+}
+
+void usage(const char *program)
+{
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  -target <address>        Collector address (127.0.0.1)\n"
+              << "  -port <n>                Collector port (44003)\n"
+              << "  -vehicles <n>            Simulated vehicles (1)\n"
+              << "  -sysid <n>               System id of the first vehicle (1)\n"
+              << "  -autopilot px4|ardupilot Autopilot in the heartbeat (px4)\n"
+              << "  -mavlink 1|2|mixed       Protocol version, mixed gives odd system ids MAVLink 1 (2)\n"
+              << "  -rate <MESSAGE>=<Hz>     Stream rate of one message, 0 disables it, repeatable\n"
+              << "  -rate-scale <x>          Multiplies the default rates except the heartbeat's (1)\n"
+              << "  -params <n>              Parameters per vehicle (400)\n"
+              << "  -param-rate <n>          PARAM_VALUE per second per vehicle while listing (2000)\n"
+              << "  -loss <percent>          Frames dropped (0)\n"
+              << "  -reorder <percent>       Frames sent after the next one (0)\n"
+              << "  -duplicate <percent>     Frames sent twice (0)\n"
+              << "  -duration <seconds>      Run time, 0 until interrupted (0)\n"
+              << "  -stats <seconds>         Statistics interval (5)\n"
+              << "  -seed <n>                Seed of the impairments (1)\n"
+              << "Streams:";
+    for (const StreamInfo &info : kStreams) {
+        std::cout << " " << info.name << "=" << info.hz;
+    }
+    std::cout << "\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "-target" && hasValue) {
+            options.target = argv[++i];
+        } else if (arg == "-port" && hasValue) {
+            options.port = static_cast<uint16_t>(atoi(argv[++i]));
+        } else if (arg == "-vehicles" && hasValue) {
+            options.vehicles = std::clamp(atoi(argv[++i]), 1, 254);
+        } else if (arg == "-sysid" && hasValue) {
+            options.firstSystemId = std::clamp(atoi(argv[++i]), 1, 254);
+        } else if (arg == "-autopilot" && hasValue) {
+            std::string autopilot = argv[++i];
+            options.autopilot = autopilot == "ardupilot" ? MAV_AUTOPILOT_ARDUPILOTMEGA : MAV_AUTOPILOT_PX4;
+        } else if (arg == "-mavlink" && hasValue) {
+            options.mavlink = argv[++i];
+        } else if (arg == "-rate" && hasValue) {
+            std::string rate = argv[++i];
+            size_t equals = rate.find('=');
+            if (equals == std::string::npos) {
+                usage(argv[0]);
+                return 1;
+            }
+            options.rates[rate.substr(0, equals)] = std::max(0.0, atof(rate.c_str() + equals + 1));
+        } else if (arg == "-rate-scale" && hasValue) {
+            options.rateScale = std::max(0.0, atof(argv[++i]));
+        } else if (arg == "-params" && hasValue) {
+            options.params = std::clamp(atoi(argv[++i]), 0, 65535);
+        } else if (arg == "-param-rate" && hasValue) {
+            options.paramRate = std::max(1.0, atof(argv[++i]));
+        } else if (arg == "-loss" && hasValue) {
+            options.lossPercent = atof(argv[++i]);
+        } else if (arg == "-reorder" && hasValue) {
+            options.reorderPercent = atof(argv[++i]);
+        } else if (arg == "-duplicate" && hasValue) {
+            options.duplicatePercent = atof(argv[++i]);
+        } else if (arg == "-duration" && hasValue) {
+            options.durationSeconds = atof(argv[++i]);
+        } else if (arg == "-stats" && hasValue) {
+            options.statsSeconds = std::max(0.1, atof(argv[++i]));
+        } else if (arg == "-seed" && hasValue) {
+            options.seed = static_cast<unsigned>(atoi(argv[++i]));
+        } else {
+            usage(argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+    for (const auto &rate : options.rates) {
+        if (std::none_of(std::begin(kStreams), std::end(kStreams), [&](const StreamInfo &info) { return rate.first == info.name; })) {
+            std::cerr << "Unknown stream " << rate.first << "\n";
+            return 1;
+        }
+    }
+    if (options.mavlink != "1" && options.mavlink != "2" && options.mavlink != "mixed") {
+        usage(argv[0]);
+        return 1;
+    }
+    if (options.firstSystemId + options.vehicles - 1 > 254) {
+        std::cerr << "System ids beyond 254\n";
+        return 1;
+    }
+
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+
+    Stats stats;
+    Link link(options, stats);
+    std::vector<std::unique_ptr<SimulatedVehicle>> vehicles;
+    for (int i = 0; i < options.vehicles; i++) {
+        const uint8_t systemId = static_cast<uint8_t>(options.firstSystemId + i);
+        const bool mavlink1 = options.mavlink == "1" || (options.mavlink == "mixed" && systemId % 2 == 1);
+        vehicles.push_back(std::make_unique<SimulatedVehicle>(systemId, mavlink1, options, link, stats));
+    }
+
+    printf("Simulating %d vehicle(s), sysid %d..%d, MAVLink %s, sending to %s:%u\n", options.vehicles, options.firstSystemId,
+           options.firstSystemId + options.vehicles - 1, options.mavlink.c_str(), options.target.c_str(), options.port);
+    fflush(stdout);
+
+    const auto start = std::chrono::steady_clock::now();
+    auto lastStats = start;
+    Stats previous;
+    while (g_running) {
+        const auto now = std::chrono::steady_clock::now();
+        if (options.durationSeconds > 0.0 && now - start >= std::chrono::duration<double>(options.durationSeconds)) {
+            break;
+        }
+        for (auto &vehicle : vehicles) {
+            vehicle->update(now);
+        }
+
+        link.receive([&vehicles](const mavlink_message_t &message) {
+            for (auto &vehicle : vehicles) {
+                vehicle->handleMessage(message);
+            }
+        });
+
+        const double sinceStats = std::chrono::duration<double>(std::chrono::steady_clock::now() - lastStats).count();
+        if (sinceStats >= options.statsSeconds) {
+            printStats(stats, previous, sinceStats);
+            previous = stats;
+            lastStats = std::chrono::steady_clock::now();
+        }
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("Total over %.1f s:\n", seconds);
+    printStats(stats, Stats{}, seconds);
+    return 0;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+/// Opt-in allocation counting. Configure with -DMAVCOLLECTOR_COUNT_ALLOCATIONS=ON to replace the
+/// global operator new and delete of the executable with counting versions, off by default.
+#ifndef MAVCOLLECTOR_COUNT_ALLOCATIONS
+#define MAVCOLLECTOR_COUNT_ALLOCATIONS 0
+#endif
+
+/// Heap allocations of the receive pipeline, counted per thread and per stage.
+///
+/// Every thread counts into a slot of its own, so the counting allocator takes no lock and shares no
+/// cache line with other threads. The stage an allocation belongs to is set for the thread by the
+/// innermost ALLOCATION_SCOPE, allocations outside of any scope are Untagged. A report sums the slots
+/// of all threads, including the ones which have exited, and divides by the number of messages the
+/// vehicles processed.
+///
+/// When the build mode is off the scopes compile to nothing and reports are empty.
+///
+///     ALLOCATION_SCOPE(Parameters);
+///     _parameterManager->mavlinkMessageReceived(message);
+class AllocationCounter
+{
+public:
+    enum Stage : uint8_t {
+        Untagged = 0,
+        Receive,            ///< Socket reads and datagram bookkeeping
+        Parse,              ///< MAVLink framing and loss tracking
+        Route,              ///< Vehicle lookup and queueing in the VehicleManager
+        Dispatch,           ///< Vehicle::handleMessage outside of the stages below
+        FactGroups,         ///< FactGroup::handleMessage decoding
+        Publish,            ///< Fact value change callbacks and published fact listeners
+        Parameters,
+        Managers,           ///< Log download, FTP, mission and time sync
+        Logging,            ///< Data log and console output, logger thread
+        StageCount,
+    };
+
+    struct Counts {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+        uint64_t frees = 0;
+    };
+
+    struct Report {
+        std::array<Counts, StageCount> stages{};
+        uint64_t messages = 0;
+
+        Counts total() const;
+        double allocationsPerMessage(Stage stage) const;
+        double bytesPerMessage(Stage stage) const;
+    };
+
+    static constexpr bool enabled() { return MAVCOLLECTOR_COUNT_ALLOCATIONS != 0; }
+
+    /// Sum of all threads since start up or the last reset()
+    static Report report();
+    static void reset();
+
+    /// Called once per message processed by a vehicle, the denominator of the per message figures
+    static void countMessage();
+
+    static const char* stageName(Stage stage);
+
+    /// "=== Allocation Statistics ===" block, one line per stage with allocations and bytes per message
+    static std::string formatReport(const Report &report);
+
+    /// Tags the calling thread's allocations with a stage for the lifetime of the scope
+    class Scope
+    {
+    public:
+        explicit Scope(Stage stage) : _previousStage(_currentStage) { _currentStage = stage; }
+        ~Scope() { _currentStage = _previousStage; }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Stage _previousStage;
+    };
+
+    /// Counting hooks of the replaced operator new and delete
+    static void recordAllocation(size_t bytes);
+    static void recordFree();
+
+private:
+    static inline thread_local Stage _currentStage = Untagged;
+};
+
+#define ALLOCATION_SCOPE_NAME2(line) _allocationScope##line
+#define ALLOCATION_SCOPE_NAME(line) ALLOCATION_SCOPE_NAME2(line)
+
+#if MAVCOLLECTOR_COUNT_ALLOCATIONS
+#define ALLOCATION_SCOPE(stage) AllocationCounter::Scope ALLOCATION_SCOPE_NAME(__LINE__)(AllocationCounter::stage)
+#else
+#define ALLOCATION_SCOPE(stage) do {} while (0)
+#endif
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <map>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+
+#include "Scheduler.h"
+
+// MAVLink headers
+#include "../thirdparty/c_library_v2/common/mavlink.h"
+
+class Vehicle;
+
+/// Sends COMMAND_LONG to one vehicle and matches the COMMAND_ACK replies to them.
+///
+/// Pending commands are keyed by target component and command id, which is all an ack carries. Any
+/// number of different commands can be in flight at once, a second command with the same key waits
+/// until the first one completed since their acks couldn't be told apart. Unacknowledged commands are
+/// resent with an incremented confirmation field from the shared Scheduler until they run out of
+/// attempts. The result is delivered through the returned future and, if given, the callback.
+class CommandManager
+{
+public:
+    struct Result {
+        enum Status : uint8_t {
+            Acked,          ///< result holds the MAV_RESULT
+            NoResponse,     ///< No ack after all attempts
+            Cancelled,      ///< Vehicle went away before the command completed
+        };
+
+        Status status = NoResponse;
+        uint8_t result = MAV_RESULT_FAILED;
+        uint8_t progress = 0;
+        int32_t resultParam2 = 0;
+        unsigned attempts = 0;
+
+        bool accepted() const { return status == Acked && result == MAV_RESULT_ACCEPTED; }
+    };
+
+    /// Called on the thread which completed the command: vehicle message handling for acks, the
+    /// scheduler for timeouts
+    typedef std::function<void(uint16_t command, const Result &result)> ResultCallback;
+
+    typedef std::array<float, 7> Params;
+
+    static constexpr int kAckTimeoutMsecs = 1000;
+    static constexpr int kInProgressTimeoutMsecs = 5000;    ///< After a MAV_RESULT_IN_PROGRESS ack
+    static constexpr unsigned kMaxAttempts = 4;
+
+    explicit CommandManager(Vehicle *vehicle);
+    ~CommandManager();
+
+    CommandManager(const CommandManager&) = delete;
+    CommandManager& operator=(const CommandManager&) = delete;
+
+    std::future<Result> sendCommand(uint8_t targetComponent, uint16_t command, const Params &params,
+                                    ResultCallback callback = ResultCallback());
+
+    void handleCommandAck(const mavlink_message_t &message);
+
+    /// @return Commands in flight or waiting for one with the same key
+    size_t pendingCommands() const;
+
+private:
+    typedef std::pair<uint8_t, uint16_t> Key;          ///< Target component, command
+
+    struct Command {
+        uint64_t timerSerial = 0;          ///< Identifies the current timeout, older ones are stale
+        Params params{};
+        unsigned attempts = 0;
+        Scheduler::TaskId timeoutTask = 0;
+        std::promise<Result> promise;
+        ResultCallback callback;
+    };
+
+    struct Completion {
+        bool completed = false;
+        uint16_t command = 0;
+        Result result;
+        std::promise<Result> promise;
+        ResultCallback callback;
+    };
+
+    void _send(const Key &key, Command &command);
+    void _scheduleTimeout(const Key &key, Command &command, int timeoutMsecs);
+    void _timeout(const Key &key, uint64_t serial);
+    Completion _complete(const Key &key, const Result &result);
+    static void _deliver(Completion &completion);
+
+    Vehicle *_vehicle = nullptr;
+
+    mutable std::mutex _mutex;
+    std::map<Key, std::deque<Command>> _commands;      ///< Front command of each key is in flight
+    uint64_t _nextSerial = 1;
+    bool _destroying = false;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+/// Recomputes facts which are derived from other values only when one of their inputs changed.
+///
+/// Inputs are bits chosen by the owner. Each output declares the inputs it reads together with the
+/// function computing it, message handlers mark the inputs they updated dirty, and update() runs
+/// every output reading a dirty input once. Outputs run in the order they were added, so an output
+/// may use the result of an earlier one.
+class DerivedFactEngine
+{
+public:
+    typedef uint32_t InputMask;
+    typedef std::function<void()> ComputeFunction;
+
+    void addOutput(InputMask inputs, ComputeFunction compute);
+
+    void markDirty(InputMask inputs) { _dirtyInputs |= inputs; }
+    bool isDirty() const { return _dirtyInputs != 0; }
+
+    /// Run the outputs depending on dirty inputs and clear the dirty state
+    void update();
+
+private:
+    struct Output {
+        InputMask inputs;
+        ComputeFunction compute;
+    };
+
+    std::vector<Output> _outputs;
+    InputMask _dirtyInputs = 0;
+};
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+
+#include "Scheduler.h"
+
+// MAVLink headers
+#include "../thirdparty/c_library_v2/common/mavlink.h"
+
+class Vehicle;
+
+/// Downloads files from a vehicle component with the MAVLink FTP protocol (FILE_TRANSFER_PROTOCOL).
+///
+/// A download opens a read session, then streams the file with BurstReadFile: the vehicle sends
+/// packets back to back until it ends the burst, and the next burst continues where the data
+/// stopped. Packets lost inside a burst are recorded as gaps and read afterwards with ReadFile, so
+/// a lossy link costs a few extra round trips rather than a restart. The session is terminated when
+/// the download ends, when the vehicle has no session left all of them are reset once.
+class FTPManager
+{
+public:
+    /// Called on the vehicle's message thread or the scheduler thread
+    ///     @param file Downloaded file, empty on failure
+    typedef std::function<void(const std::string &file, const std::string &errorMsg)> DownloadCompleteCallback;
+    typedef std::function<void(float progress)> ProgressCallback;
+
+    static constexpr int kAckTimeoutMsecs = 500;      ///< Silence before a request is sent again
+    static constexpr int kMaxRetries = 3;
+
+    explicit FTPManager(Vehicle *vehicle);
+    ~FTPManager();
+
+    FTPManager(const FTPManager&) = delete;
+    FTPManager& operator=(const FTPManager&) = delete;
+
+    /// Download a file into a directory, the file name is the last element of the uri without query
+    ///     @return false if a download is running
+    bool download(uint8_t componentId, const std::string &fromURI, const std::string &toDir,
+                  DownloadCompleteCallback completion, ProgressCallback progress = ProgressCallback());
+
+    void cancelDownload();
+    bool downloading() const;
+
+    void mavlinkMessageReceived(const mavlink_message_t &message);
+
+    enum Opcode : uint8_t {
+        kCmdNone = 0,
+        kCmdTerminateSession = 1,
+        kCmdResetSessions = 2,
+        kCmdListDirectory = 3,
+        kCmdOpenFileRO = 4,
+        kCmdReadFile = 5,
+        kCmdCreateFile = 6,
+        kCmdWriteFile = 7,
+        kCmdRemoveFile = 8,
+        kCmdCreateDirectory = 9,
+        kCmdRemoveDirectory = 10,
+        kCmdOpenFileWO = 11,
+        kCmdTruncateFile = 12,
+        kCmdRename = 13,
+        kCmdCalcFileCRC32 = 14,
+        kCmdBurstReadFile = 15,
+        kRspAck = 128,
+        kRspNak = 129,
+    };
+
+    enum ErrorCode : uint8_t {
+        kErrNone = 0,
+        kErrFail = 1,
+        kErrFailErrno = 2,
+        kErrInvalidDataSize = 3,
+        kErrInvalidSession = 4,
+        kErrNoSessionsAvailable = 5,
+        kErrEOF = 6,
+        kErrUnknownCommand = 7,
+        kErrFileExists = 8,
+        kErrFileProtected = 9,
+        kErrFileNotFound = 10,
+    };
+
+    /// FILE_TRANSFER_PROTOCOL payload
+    struct __attribute__((packed)) Request {
+        uint16_t seqNumber;
+        uint8_t session;
+        uint8_t opcode;
+        uint8_t size;               ///< Bytes of data used
+        uint8_t reqOpcode;          ///< Request an ack or nak answers
+        uint8_t burstComplete;      ///< Last packet of a burst
+        uint8_t padding;
+        uint32_t offset;
+        uint8_t data[MAVLINK_MSG_FILE_TRANSFER_PROTOCOL_FIELD_PAYLOAD_LEN - 12];
+    };
+    static_assert(sizeof(Request) == MAVLINK_MSG_FILE_TRANSFER_PROTOCOL_FIELD_PAYLOAD_LEN);
+
+    static constexpr uint8_t kDataSize = sizeof(Request::data);
+
+    static std::string errorString(const Request &nak);
+
+private:
+    enum class State {
+        Idle,
+        ResettingSessions,
+        Opening,
+        Bursting,
+        FillingGaps,
+    };
+
+    struct Gap {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    struct Download {
+        uint8_t componentId = 0;
+        std::string uri;
+        std::string path;
+        State state = State::Idle;
+        uint8_t session = 0;
+        bool sessionOpen = false;
+        bool sessionsReset = false;
+        std::vector<uint8_t> data;
+        uint32_t burstOffset = 0;           ///< Next offset expected from the burst
+        std::vector<Gap> gaps;              ///< Lost inside bursts, in file order
+        uint32_t bytesReceived = 0;
+        uint16_t lastSeqNumber = 0;         ///< Of the request in flight
+        int retries = 0;
+        std::string errorMsg;               ///< Set by the response handlers, ends the download
+        std::chrono::steady_clock::time_point lastActivity;
+        DownloadCompleteCallback completion;
+        ProgressCallback progress;
+    };
+
+    struct Completion {
+        DownloadCompleteCallback callback;
+        std::string file;
+        std::string errorMsg;
+    };
+
+    void _handleAck(const Request &response);
+    void _handleNak(const Request &response);
+    void _handleData(const Request &response);
+    void _timeout(uint64_t generation);
+
+    void _sendResetSessions();
+    void _sendOpen();
+    void _sendBurst();
+    void _sendRead();
+    void _sendTerminate();
+    void _send(Request &request);
+    void _scheduleTimeout();
+    void _fillGaps(uint32_t offset, uint32_t size);
+    Completion _finish(const std::string &errorMsg);
+
+    Vehicle *_vehicle = nullptr;
+
+    mutable std::mutex _mutex;
+    bool _destroying = false;
+    std::unique_ptr<Download> _download;
+    uint16_t _seqNumber = 0;
+    uint64_t _downloadGeneration = 0;
+    Scheduler::TaskId _timeoutTask = 0;
+};
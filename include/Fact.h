@@ -17,6 +17,9 @@ public:
 
     Fact();
     Fact(int componentId, const std::string &name, ValueType_t type);
+    /// Fact whose raw value is kept in valueSlot instead of the fact itself, see FactArena. The slot
+    /// must outlive the fact.
+    Fact(int componentId, const std::string &name, ValueType_t type, ValueVariant_t &valueSlot);
     Fact(const Fact &other);
     ~Fact() = default;
 
@@ -33,6 +36,11 @@ public:
     std::string rawValueString() const;
     std::string cookedValueString() const;
 
+    /// Value text written into [first, last) with the metadata's decimal places, see FactValueFormatter
+    /// @return One past the last character written, null if the text doesn't fit
+    char* rawValueString(char *first, char *last) const;
+    char* cookedValueString(char *first, char *last) const;
+
     // Value setters
     void setRawValue(const ValueVariant_t &value);
     void setCookedValue(const ValueVariant_t &value);
@@ -106,19 +114,21 @@ public:
 
 private:
     void _init();
-    void _sendValueChangedSignal(const ValueVariant_t &value);
-    std::string _variantToString(const ValueVariant_t &variant, int decimalPlaces) const;
+    void _sendValueChangedSignal();
     ValueVariant_t _stringToVariant(const std::string &str) const;
     ValueVariant_t clamp(const std::string &cookedValue);
 
-    int _componentId = 0;
-    std::string _name;
+    // Touched by every value update, kept together at the front
+    ValueVariant_t &_rawValue;          ///< _ownValue, or a slot of the FactArena the fact was placed in
     ValueType_t _type;
-    ValueVariant_t _rawValue;
-    std::shared_ptr<FactMetaData> _metaData;
     bool _sendValueChangedSignals = true;
     bool _deferredValueChangeSignal = false;
+    std::shared_ptr<FactMetaData> _metaData;
     ValueChangedCallback _valueChangedCallback;
 
+    int _componentId = 0;
+    std::string _name;
+    ValueVariant_t _ownValue;
+
     static constexpr int kDefaultDecimalPlaces = 6;
 };
\ No newline at end of file
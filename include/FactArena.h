@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "Fact.h"
+
+/// Storage for all facts of a vehicle in one allocation.
+///
+/// Facts made by the fact groups one by one with std::make_shared end up wherever the heap puts
+/// them, between the map nodes and strings allocated in the same constructors. A message updating a
+/// group's facts, or a snapshot reading all of them, then misses the cache on nearly every fact.
+///
+/// An arena allocates one block up front, split in two regions:
+///     - The raw values of all facts, a contiguous array of ValueVariant_t in creation order, so the
+///       facts of a group and the groups of a vehicle follow each other
+///     - The Fact objects, whose members are ordered so the ones used by a value update come first
+///       and the name, component id and unused own value last. Metadata stays in FactMetaData.
+///
+/// Facts handed out share ownership of the arena through the shared_ptr aliasing constructor, so
+/// a fact kept by a consumer keeps the arena and its value alive after the vehicle is gone. Facts
+/// are destroyed with the arena, all at once.
+///
+/// While a Scope is active the fact groups constructed on that thread place their facts in the
+/// arena, see FactGroup::_makeFact. When the arena is full further facts fall back to make_shared.
+/// Only one thread may make facts in an arena, updating them is no different from any other fact.
+class FactArena : public std::enable_shared_from_this<FactArena>
+{
+public:
+    using ValueType_t = FactMetaData::ValueType_t;
+    using ValueVariant_t = FactMetaData::ValueVariant_t;
+
+    /// Enough for the fact groups every Vehicle creates
+    static constexpr size_t kVehicleFactCapacity = 256;
+
+    /// Must be owned by a shared_ptr, facts share ownership of it
+    explicit FactArena(size_t factCapacity = kVehicleFactCapacity);
+    ~FactArena();
+
+    FactArena(const FactArena&) = delete;
+    FactArena& operator=(const FactArena&) = delete;
+
+    /// @return Fact placed in the arena, null if the arena is full
+    std::shared_ptr<Fact> makeFact(int componentId, const std::string &name, ValueType_t type);
+
+    size_t factCount() const { return _factCount; }
+    size_t factCapacity() const { return _factCapacity; }
+    size_t overflowCount() const { return _overflowCount; }     ///< Facts refused because the arena was full
+    size_t blockBytes() const { return _blockBytes; }
+
+    /// Raw values of the facts in creation order, factCount() of them
+    const ValueVariant_t* values() const { return _values; }
+
+    /// Arena the fact groups constructed on this thread place their facts in, null for none
+    static FactArena* current() { return _current; }
+
+    /// Makes an arena current on this thread for its lifetime
+    class Scope
+    {
+    public:
+        explicit Scope(FactArena *arena) : _previous(_current) { _current = arena; }
+        ~Scope() { _current = _previous; }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        FactArena *_previous;
+    };
+
+private:
+    static constexpr size_t kAlignment = 64;    ///< Cache line
+
+    void *_block = nullptr;
+    size_t _blockBytes = 0;
+    ValueVariant_t *_values = nullptr;
+    Fact *_facts = nullptr;
+    size_t _factCapacity = 0;
+    size_t _factCount = 0;
+    size_t _overflowCount = 0;
+
+    static inline thread_local FactArena *_current = nullptr;
+};
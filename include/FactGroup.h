@@ -9,6 +9,7 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
 
 #include "Fact.h"
 
@@ -46,6 +47,13 @@ public:
     bool telemetryAvailable() const { return _telemetryAvailable; }
     const std::map<std::string, std::shared_ptr<FactGroup>>& factGroups() const { return _nameToFactGroupMap; }
 
+    /// Appends "<linePrefix><name> <value>\n" for every fact of the group, in name order, in one pass
+    /// over the facts. Values are formatted straight into out, see FactValueFormatter. Reads the facts,
+    /// so only on the thread updating them, other threads read FactSharedMemoryPublisher::readGroup.
+    ///     @param cooked: Cooked values, false for raw
+    /// @return Number of facts written
+    size_t formatValues(std::string &out, bool cooked = true, const std::string &linePrefix = std::string()) const;
+
     /// Allows a FactGroup to parse incoming messages and fill in values
     virtual void handleMessage(Vehicle *vehicle, const mavlink_message_t &message);
 
@@ -56,9 +64,18 @@ public:
     typedef std::function<void(const FactGroup*, const std::string&, const Fact::ValueVariant_t&)> FactChangedCallback;
     void setFactChangedCallback(FactChangedCallback callback) { _factChangedCallback = callback; }
 
+    /// Listeners are invoked synchronously, on the publishing thread, every time a fact owned by this
+    /// group publishes a value. Unlike FactChangedCallback any number of listeners can be attached.
+    ///     @return Listener id to pass to removeFactPublishedListener
+    typedef std::function<void(const FactGroup*, const Fact*)> FactPublishedListener;
+    int addFactPublishedListener(FactPublishedListener listener);
+    void removeFactPublishedListener(int listenerId);
+
 protected:
     virtual void _updateAllValues();
 
+    /// New fact, placed in the current FactArena of this thread if there is one with room left
+    static std::shared_ptr<Fact> _makeFact(int componentId, const std::string &name, Fact::ValueType_t type);
     void _addFact(std::shared_ptr<Fact> fact, const std::string &name);
     void _addFact(std::shared_ptr<Fact> fact) { _addFact(fact, fact->name()); }
     void _addFactGroup(std::shared_ptr<FactGroup> factGroup, const std::string &name);
@@ -77,6 +94,7 @@ private:
     void _setupTimer();
     std::string _camelCase(const std::string &text);
     void _updateTimerCallback();
+    void _notifyFactPublished(const Fact *fact);
 
     std::chrono::steady_clock::time_point _lastUpdateTime;
     const bool _ignoreCamelCase = false;
@@ -85,13 +103,23 @@ private:
     TelemetryAvailableCallback _telemetryAvailableCallback;
     FactChangedCallback _factChangedCallback;
 
+    std::vector<std::pair<int, FactPublishedListener>> _factPublishedListeners;
+    std::mutex _listenerMutex;
+    int _nextListenerId = 0;
+
     // Timer simulation for Qt-free implementation
     std::thread _timerThread;
     std::atomic<bool> _timerRunning{false};
     std::mutex _timerMutex;
+    std::mutex _timerWaitMutex;
+    std::condition_variable _timerWakeup;       ///< Ends the timer wait early on destruction
 
     std::string _objectName;
+    const char *_traceName = "factgroup";
 public:
     std::string objectName() const { return _objectName; }
-    void setObjectName(const std::string &name) { _objectName = name; }
+    void setObjectName(const std::string &name);
+
+    /// Object name as a trace point name, valid for the lifetime of the process
+    const char* traceName() const { return _traceName; }
 };
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include <memory>
 #include <map>
 #include <limits>
+#include <cstdint>
 
 /// Holds the meta data associated with a Fact. This is kept in a separate object from the Fact itself
 /// since you may have multiple instances of the same Fact. But there is only ever one FactMetaData
@@ -35,6 +36,23 @@ public:
                         uint64_t, int64_t, float, double, std::string, bool> ValueVariant_t;
     
     typedef std::function<ValueVariant_t(const ValueVariant_t &from)> Translator;
+
+    /// How raw values are translated to cooked values and back. Every kind except TranslatorCustom is
+    /// a scale and offset, cooked = raw * scale + offset, applied inline by rawToCooked/cookedToRaw.
+    /// Numeric cooked values are double, or float for float facts. Only TranslatorCustom calls the
+    /// Translator pair given to setTranslators.
+    enum TranslatorKind : uint8_t {
+        TranslatorIdentity,             ///< Cooked value is the raw value
+        TranslatorRadiansToDegrees,
+        TranslatorDegreesToRadians,
+        TranslatorCentiToUnits,         ///< Centidegrees, centimeters, centidegrees Celsius, ...
+        TranslatorMetersToFeet,
+        TranslatorFeetToMeters,
+        TranslatorNormToPercent,        ///< Raw 0-1 shown as 0-100
+        TranslatorPercentToNorm,
+        TranslatorLinear,               ///< Any scale and offset, see setLinearTranslator
+        TranslatorCustom,
+    };
     
     // Custom function to validate a cooked value.
     //  @return Error string for failed validation explanation to user. Empty string indicates no error.
@@ -108,7 +126,7 @@ public:
 
     int decimalPlaces() const;
     ValueVariant_t rawDefaultValue() const;
-    ValueVariant_t cookedDefaultValue() const { return _rawTranslator(rawDefaultValue()); }
+    ValueVariant_t cookedDefaultValue() const { return rawToCooked(rawDefaultValue()); }
     bool defaultValueAvailable() const { return _defaultValueAvailable; }
     std::vector<std::string> bitmaskStrings() const { return _bitmaskStrings; }
     std::vector<ValueVariant_t> bitmaskValues() const { return _bitmaskValues; }
@@ -123,6 +141,9 @@ public:
     ValueVariant_t cookedMin() const;
     std::string cookedMaxString() const;
     std::string cookedMinString() const;
+    /// Limit text written into [first, last), null if it doesn't fit, see FactValueFormatter
+    char* cookedMaxString(char *first, char *last) const;
+    char* cookedMinString(char *first, char *last) const;
     bool maxIsDefaultForType() const;
     bool minIsDefaultForType() const;
     std::string name() const { return _name; }
@@ -142,8 +163,36 @@ public:
     double rawIncrement() const { return _rawIncrement; }
     double cookedIncrement() const;
 
-    Translator rawTranslator() const { return _rawTranslator; }
-    Translator cookedTranslator() const { return _cookedTranslator; }
+    /// Translators as functions, built-in kinds are wrapped. Prefer rawToCooked/cookedToRaw.
+    Translator rawTranslator() const;
+    Translator cookedTranslator() const;
+
+    TranslatorKind translatorKind() const { return _translatorKind; }
+
+    ValueVariant_t rawToCooked(const ValueVariant_t &rawValue) const
+    {
+        switch (_translatorKind) {
+        case TranslatorIdentity:
+            return rawValue;
+        case TranslatorCustom:
+            return _cookedTranslator(rawValue);
+        default:
+            return _scaleToCooked(rawValue, _translatorScale, _translatorOffset);
+        }
+    }
+
+    /// Cooked value translated to the raw type of the metadata, integers are rounded
+    ValueVariant_t cookedToRaw(const ValueVariant_t &cookedValue) const
+    {
+        switch (_translatorKind) {
+        case TranslatorIdentity:
+            return cookedValue;
+        case TranslatorCustom:
+            return _rawTranslator(cookedValue);
+        default:
+            return _scaleToRaw(cookedValue, _translatorScale, _translatorOffset, _type);
+        }
+    }
 
     /// Used to add new values to the bitmask lists after the meta data has been loaded
     void addBitmaskInfo(const std::string &name, const ValueVariant_t &value);
@@ -174,8 +223,15 @@ public:
     void setWriteOnly(bool bValue) { _writeOnly = bValue; }
     void setVolatileValue(bool bValue);
 
+    /// Custom translators, the built-in kinds cover the usual unit conversions without them
     void setTranslators(Translator rawTranslator, Translator cookedTranslator);
 
+    /// Built-in translator of the given kind, TranslatorLinear and TranslatorCustom need their own setters
+    void setTranslator(TranslatorKind kind);
+
+    /// cooked = raw * scale + offset, scale must not be 0
+    void setLinearTranslator(double scale, double offset);
+
     /// Set the translators to the standard built in versions
     void setBuiltInTranslator();
 
@@ -244,44 +300,8 @@ private:
     bool isInRawMinLimit(const ValueVariant_t &variantValue) const;
     bool isInRawMaxLimit(const ValueVariant_t &variantValue) const;
 
-    // Built in translators
-    static ValueVariant_t _defaultTranslator(const ValueVariant_t &from) { return from; }
-    static ValueVariant_t _degreesToRadians(const ValueVariant_t &degrees);
-    static ValueVariant_t _radiansToDegrees(const ValueVariant_t &radians);
-    static ValueVariant_t _centiDegreesToDegrees(const ValueVariant_t &centiDegrees);
-    static ValueVariant_t _degreesToCentiDegrees(const ValueVariant_t &degrees);
-    static ValueVariant_t _centiCelsiusToCelsius(const ValueVariant_t &centiCelsius);
-    static ValueVariant_t _celsiusToCentiCelsius(const ValueVariant_t &celsius);
-    static ValueVariant_t _metersToFeet(const ValueVariant_t &meters);
-    static ValueVariant_t _feetToMeters(const ValueVariant_t &feet);
-    static ValueVariant_t _squareMetersToSquareKilometers(const ValueVariant_t &squareMeters);
-    static ValueVariant_t _squareKilometersToSquareMeters(const ValueVariant_t &squareKilometers);
-    static ValueVariant_t _squareMetersToHectares(const ValueVariant_t &squareMeters);
-    static ValueVariant_t _hectaresToSquareMeters(const ValueVariant_t &hectares);
-    static ValueVariant_t _squareMetersToSquareFeet(const ValueVariant_t &squareMeters);
-    static ValueVariant_t _squareFeetToSquareMeters(const ValueVariant_t &squareFeet);
-    static ValueVariant_t _squareMetersToAcres(const ValueVariant_t &squareMeters);
-    static ValueVariant_t _acresToSquareMeters(const ValueVariant_t &acres);
-    static ValueVariant_t _squareMetersToSquareMiles(const ValueVariant_t &squareMeters);
-    static ValueVariant_t _squareMilesToSquareMeters(const ValueVariant_t &squareMiles);
-    static ValueVariant_t _metersPerSecondToMilesPerHour(const ValueVariant_t &metersPerSecond);
-    static ValueVariant_t _milesPerHourToMetersPerSecond(const ValueVariant_t &milesPerHour);
-    static ValueVariant_t _metersPerSecondToKilometersPerHour(const ValueVariant_t &metersPerSecond);
-    static ValueVariant_t _kilometersPerHourToMetersPerSecond(const ValueVariant_t &kilometersPerHour);
-    static ValueVariant_t _metersPerSecondToKnots(const ValueVariant_t &metersPerSecond);
-    static ValueVariant_t _knotsToMetersPerSecond(const ValueVariant_t &knots);
-    static ValueVariant_t _percentToNorm(const ValueVariant_t &percent);
-    static ValueVariant_t _normToPercent(const ValueVariant_t &normalized);
-    static ValueVariant_t _centimetersToInches(const ValueVariant_t &centimeters);
-    static ValueVariant_t _inchesToCentimeters(const ValueVariant_t &inches);
-    static ValueVariant_t _celsiusToFarenheit(const ValueVariant_t &celsius);
-    static ValueVariant_t _farenheitToCelsius(const ValueVariant_t &farenheit);
-    static ValueVariant_t _kilogramsToGrams(const ValueVariant_t &kg);
-    static ValueVariant_t _ouncesToGrams(const ValueVariant_t &oz);
-    static ValueVariant_t _poundsToGrams(const ValueVariant_t &lbs);
-    static ValueVariant_t _gramsToKilograms(const ValueVariant_t &g);
-    static ValueVariant_t _gramsToOunces(const ValueVariant_t &g);
-    static ValueVariant_t _gramsToPounds(const ValueVariant_t &g);
+    static ValueVariant_t _scaleToCooked(const ValueVariant_t &rawValue, double scale, double offset);
+    static ValueVariant_t _scaleToRaw(const ValueVariant_t &cookedValue, double scale, double offset, ValueType_t rawType);
 
     ValueType_t _type = valueTypeInt32; // must be first for correct constructor init
     int _decimalPlaces = kUnknownDecimalPlaces;
@@ -300,8 +320,11 @@ private:
     std::string _shortDescription;
     std::string _rawUnits;
     std::string _cookedUnits;
-    Translator _rawTranslator = _defaultTranslator;
-    Translator _cookedTranslator = _defaultTranslator;
+    TranslatorKind _translatorKind = TranslatorIdentity;
+    double _translatorScale = 1.0;
+    double _translatorOffset = 0.0;
+    Translator _rawTranslator;          ///< TranslatorCustom only
+    Translator _cookedTranslator;
     bool _vehicleRebootRequired = false;
     bool _qgcRebootRequired = false;
     double _rawIncrement = std::numeric_limits<double>::quiet_NaN();
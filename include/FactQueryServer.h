@@ -0,0 +1,147 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#include "Fact.h"
+
+class FactSharedMemoryPublisher;
+class FactSubscriptionManager;
+class FactRollups;
+class MessageRateTable;
+
+/// Local query service for the fact tree, served over a Unix domain stream socket.
+///
+/// The protocol is line based, one request per line, space separated:
+///     RESOLVE <path> [<path>...]          -> HANDLES <handle> [<handle>...]     (-1: unknown path)
+///     GET <handle> [<handle>...]          -> VALUE <handle> <value>             (one line per handle)
+///     GETPATH <path>                      -> VALUE <handle> <value>
+///     GROUP [<sysid>.]<group>             -> GROUP <group> <n>, then n lines, by fact name:
+///                                            FACT <name> <value>     (values of one update of the group)
+///     SUBSCRIBE <rateHz> <handle>...      -> SUBSCRIBED <id>, then UPDATE <id> <handle> <value> at rateHz
+///     UNSUBSCRIBE <id>                    -> OK
+///     WATCH <rateHz> <deadband> <path>... -> WATCHING <id>, then CHANGE <id> <path> <value> on every accepted change
+///     UNWATCH <id>                        -> OK
+///     WATCHSTATS <id>                     -> STATS <id> <enqueued> <delivered> <dropped> <coalesced> <filtered>
+///                                                      <rateLimited> <queueDepth> <lagMs> <maxLagMs>
+///     ROLLUP <handle> <1s|10s|1m> [<count>] -> ROLLUP <handle> <resolution> <n>, then n lines, oldest first:
+///                                            BUCKET <startMs> <min> <max> <mean> <last> <samples>
+///     RATES [<sysid>]                     -> RATES <n>, then n lines, by system id then message id:
+///                                            RATE <sysid> <msgid> <name> <count> <bytes> <rateHz> <bytesPerSec>
+/// Failures reply with ERROR <reason>.
+///
+/// Paths are "group.fact" (e.g. "battery.voltage", "gps.lat") or a bare fact name for facts of the root
+/// group, prefixed with the system id of the vehicle ("2.gps.lat"). Without a prefix they refer to the
+/// vehicle added first. A path is resolved to a handle once, later requests index the handle table
+/// directly. Handles are shared by all clients and stay valid for the lifetime of the server.
+///
+/// WATCH streams value changes through a FactSubscriptionManager, SUBSCRIBE samples at a fixed rate.
+///
+/// The facts are updated on the vehicle worker threads, so values are read from the seqlock snapshot of a
+/// FactSharedMemoryPublisher attached to each vehicle, never from the facts. Paths resolve against the
+/// snapshot's layout.
+///
+/// All clients are served by a single poll() loop thread, no thread is created per client.
+class FactQueryServer
+{
+public:
+    FactQueryServer() = default;
+    ~FactQueryServer();
+
+    FactQueryServer(const FactQueryServer&) = delete;
+    FactQueryServer& operator=(const FactQueryServer&) = delete;
+
+    /// Bind the socket and start the event loop
+    ///     @param socketPath: Filesystem path of the socket, an existing socket file is replaced
+    /// @return false: socket could not be created
+    bool start(const std::string &socketPath);
+
+    /// Serve the facts of a vehicle, from any thread, normally when the vehicle is discovered
+    ///     @param snapshot: Attached to the vehicle, values are read from it. Must stay attached until stop().
+    void addVehicle(int systemId, const FactSharedMemoryPublisher *snapshot);
+
+    /// Enables the WATCH commands. Must be set before start().
+    void setSubscriptionManager(FactSubscriptionManager *subscriptionManager) { _subscriptionManager = subscriptionManager; }
+
+    /// Enables the ROLLUP command. Must be set before start().
+    void setRollups(const FactRollups *rollups) { _rollups = rollups; }
+
+    /// Enables the RATES command. Must be set before start().
+    void setMessageRates(const MessageRateTable *messageRates) { _messageRates = messageRates; }
+
+    /// Stop the event loop, drop all clients and remove the socket file
+    void stop();
+
+    bool isRunning() const { return _running; }
+    size_t clientCount() const { return _clientCount; }
+
+private:
+    struct Subscription {
+        int id;
+        std::vector<int> handles;
+        std::chrono::milliseconds interval;
+        std::chrono::steady_clock::time_point nextUpdate;
+    };
+
+    struct Handle {
+        const FactSharedMemoryPublisher *snapshot;
+        int factIndex;
+    };
+
+    struct Client {
+        int fd;
+        std::string input;
+        std::string output;
+        std::vector<Subscription> subscriptions;
+        std::vector<int> watches;               ///< FactSubscriptionManager subscriber ids
+    };
+
+    void _eventLoop();
+    void _acceptClients();
+    bool _readClient(Client &client);
+    bool _writeClient(Client &client);
+    void _handleRequest(Client &client, const std::string &line);
+    void _publishSubscriptions(Client &client, std::chrono::steady_clock::time_point now);
+    void _publishWatches(Client &client);
+    void _closeClient(Client &client);
+    void _wakeup();
+    int _resolve(const std::string &path);
+    const FactSharedMemoryPublisher* _snapshotForPath(const std::string &path, std::string &factPath) const;
+    void _appendValue(std::string &output, const std::string &tag, int handle) const;
+    int _pollTimeoutMs(std::chrono::steady_clock::time_point now) const;
+
+    FactSubscriptionManager *_subscriptionManager = nullptr;
+    const FactRollups *_rollups = nullptr;
+    const MessageRateTable *_messageRates = nullptr;
+    std::string _socketPath;
+    int _listenFd = -1;
+    int _wakeupPipe[2] = {-1, -1};
+
+    std::thread _eventLoopThread;
+    std::atomic<bool> _running{false};
+    std::atomic<size_t> _clientCount{0};
+
+    mutable std::mutex _snapshotsMutex;
+    std::map<int, const FactSharedMemoryPublisher*> _snapshots;     ///< By system id
+    int _defaultSystemId = -1;                                      ///< Of the vehicle added first
+
+    // Only touched by the event loop thread
+    std::vector<Client> _clients;
+    std::vector<Handle> _handles;
+    std::unordered_map<std::string, int> _pathToHandle;
+    int _nextSubscriptionId = 1;
+
+    static constexpr size_t kMaxLineLength = 4096;
+    static constexpr size_t kMaxPendingOutput = 256 * 1024;     ///< Slow clients past this are dropped
+    static constexpr int kMaxSubscriptionRateHz = 100;
+    static constexpr int kIdlePollTimeoutMs = 100;
+    static constexpr size_t kWatchQueueCapacity = 1024;
+    static constexpr size_t kDefaultRollupBuckets = 60;
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+#include "Fact.h"
+
+class FactGroup;
+
+/// Incremental min/max/mean/last rollups of every numeric fact at 1 second, 10 second and 1 minute
+/// resolution. Each resolution is a fixed ring of buckets per fact, allocated on the first sample, so
+/// memory is bounded by the retention and a sample costs one bucket update per resolution.
+/// Buckets are aligned to wall clock time so rollups from several collectors line up.
+class FactRollups
+{
+public:
+    enum Resolution {
+        Resolution1s,
+        Resolution10s,
+        Resolution1min,
+        ResolutionCount
+    };
+
+    struct Bucket {
+        int64_t startMs = 0;        ///< Bucket start, milliseconds since epoch
+        double min = 0.0;
+        double max = 0.0;
+        double mean = 0.0;
+        double last = 0.0;
+        uint32_t count = 0;
+    };
+
+    FactRollups();
+    ~FactRollups();
+
+    FactRollups(const FactRollups&) = delete;
+    FactRollups& operator=(const FactRollups&) = delete;
+
+    /// Number of buckets kept per fact, only takes effect for facts which haven't been sampled yet
+    void setRetention(Resolution resolution, size_t buckets);
+    size_t retention(Resolution resolution) const { return _retention[resolution]; }
+
+    /// Start sampling the numeric facts of rootGroup and its sub groups as they are published. May be
+    /// called for several roots, e.g. one per vehicle, series are kept per fact.
+    void attach(FactGroup *rootGroup);
+
+    /// Stop sampling all roots, the rollups collected so far are kept
+    void detach();
+
+    /// Copy the most recent buckets of a fact, oldest first. The current, still open, bucket is included.
+    ///     @param maxBuckets: Upper limit of buckets returned
+    /// @return false: the fact has no samples
+    bool buckets(const Fact *fact, Resolution resolution, size_t maxBuckets, std::vector<Bucket> &buckets) const;
+
+    /// @return Number of facts with rollups
+    size_t seriesCount() const;
+
+    static int64_t resolutionMs(Resolution resolution);
+
+    /// Parses "1s", "10s" or "1m"
+    static bool parseResolution(const std::string &text, Resolution &resolution);
+
+    /// Add a sample, normally called through the fact published listeners
+    void addSample(const Fact *fact, double value, int64_t timestampMs);
+
+private:
+    struct Slot {
+        int64_t bucketIndex = -1;   ///< timestamp / resolution of the bucket held in this slot
+        double min = 0.0;
+        double max = 0.0;
+        double sum = 0.0;
+        double last = 0.0;
+        uint32_t count = 0;
+    };
+
+    struct Series {
+        std::vector<Slot> rings[ResolutionCount];
+        int64_t newestBucketIndex[ResolutionCount] = {-1, -1, -1};
+    };
+
+    void _onFactPublished(const Fact *fact);
+
+    size_t _retention[ResolutionCount];
+    std::vector<std::pair<FactGroup*, int>> _listeners;   ///< Group and listener id, for detach
+
+    mutable std::mutex _mutex;
+    std::unordered_map<const Fact*, std::unique_ptr<Series>> _series;
+
+    static constexpr size_t kDefaultRetention1s = 120;       ///< 2 minutes
+    static constexpr size_t kDefaultRetention10s = 90;       ///< 15 minutes
+    static constexpr size_t kDefaultRetention1min = 120;     ///< 2 hours
+};
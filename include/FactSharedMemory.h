@@ -0,0 +1,275 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Fact.h"
+
+class FactGroup;
+
+/// Binary layout of the shared-memory fact segment. The layout is generated once, when the publisher
+/// attaches, from the facts registered at that time and never changes while the segment is mapped.
+///
+///     [FactShmHeader][FactShmGroupEntry x groupCount][FactShmFactEntry x factCount][value slots]
+///
+/// Every FactGroup owns a seqlock (FactShmGroupEntry::sequence). The sequence is odd while the writer
+/// updates a value of that group. Readers copy the values they need, re-check the sequence and retry
+/// if it moved or was odd. All offsets are relative to the start of the segment.
+static constexpr uint32_t kFactShmMagic = 0x5446564D;           ///< "MVFT"
+static constexpr uint16_t kFactShmSchemaVersion = 1;
+static constexpr size_t kFactShmNameLength = 32;
+static constexpr size_t kFactShmPathLength = 48;
+static constexpr size_t kFactShmNumericSlotSize = 8;
+static constexpr size_t kFactShmStringSlotSize = 64;
+
+struct FactShmHeader {
+    uint32_t magic;
+    uint16_t schemaVersion;
+    uint16_t headerSize;
+    uint32_t totalSize;
+    uint32_t groupCount;
+    uint32_t factCount;
+    uint32_t groupTableOffset;
+    uint32_t factTableOffset;
+    uint32_t valueAreaOffset;
+    std::atomic<uint64_t> publishCount;     ///< Incremented after every published value
+    uint8_t reserved[24];
+};
+static_assert(sizeof(FactShmHeader) == 64, "FactShmHeader must stay 64 bytes");
+
+struct alignas(64) FactShmGroupEntry {
+    std::atomic<uint32_t> sequence;         ///< Seqlock, odd while a write is in progress
+    uint32_t firstFact;                     ///< Index of the first fact of this group in the fact table
+    uint32_t factCount;
+    uint32_t reserved;
+    char name[kFactShmNameLength];
+};
+static_assert(sizeof(FactShmGroupEntry) == 64, "FactShmGroupEntry must stay one cache line");
+
+struct FactShmFactEntry {
+    char path[kFactShmPathLength];          ///< "group.fact", NUL terminated
+    uint32_t valueOffset;                   ///< Offset of the value slot
+    uint32_t valueSize;                     ///< Size of the value slot in bytes
+    uint16_t groupIndex;
+    uint8_t type;                           ///< FactMetaData::ValueType_t stored in the slot
+    uint8_t reserved[5];
+};
+static_assert(sizeof(FactShmFactEntry) == 64, "FactShmFactEntry must stay 64 bytes");
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Seqlock requires lock free 32 bit atomics");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Header requires lock free 64 bit atomics");
+
+/// Publishes the fact tree of a FactGroup hierarchy (normally a Vehicle) into a POSIX shared-memory
+/// segment so local processes can read current values without syscalls or copies through the collector.
+/// Values are written on the thread that publishes them, through FactGroup fact published listeners.
+/// Facts registered after attach() are not part of the layout and are not published.
+///
+/// The segment is also the snapshot other threads of the collector read values from, see readValue(),
+/// since the facts themselves may only be read on the thread that updates them. Without a segment name
+/// the same layout is kept in private memory for these reads only.
+class FactSharedMemoryPublisher
+{
+public:
+    FactSharedMemoryPublisher() = default;
+    ~FactSharedMemoryPublisher();
+
+    FactSharedMemoryPublisher(const FactSharedMemoryPublisher&) = delete;
+    FactSharedMemoryPublisher& operator=(const FactSharedMemoryPublisher&) = delete;
+
+    /// Create the segment, generate the layout from the facts currently registered in rootGroup and
+    /// write the initial values. No fact of rootGroup may be updated on another thread meanwhile.
+    ///     @param segmentName: shm_open name, e.g. "/mavcollector_facts", empty for a snapshot only
+    ///                         readable from this process
+    /// @return false: segment could not be created
+    bool attach(FactGroup *rootGroup, const std::string &segmentName);
+
+    /// Stop publishing and unlink the segment
+    void detach();
+
+    bool isAttached() const { return _segment != nullptr; }
+    std::string segmentName() const { return _segmentName; }
+    size_t segmentSize() const { return _segmentSize; }
+    uint32_t factCount() const { return static_cast<uint32_t>(_slots.size()); }
+    uint32_t groupCount() const { return static_cast<uint32_t>(_groupNames.size()); }
+
+    // Reads of the published values from any thread of this process. They only use the segment and
+    // tables built by attach(), never the facts, and must not overlap attach() or detach().
+
+    /// @return Fact table index of a "group.fact" path or root fact name, -1 if not published
+    int factIndex(const std::string &path) const;
+
+    /// Fact at a fact table index, null if out of range. Only to identify the fact, e.g. for FactRollups,
+    /// its value must be read with readValue.
+    const Fact* fact(int index) const;
+
+    /// Decimal places of the fact at a fact table index, for formatting its value
+    int decimalPlaces(int index) const;
+
+    /// Name of the fact at a fact table index within its group, empty if out of range
+    const std::string& factName(int index) const;
+
+    /// Consistent copy of the last published value of a fact, strings are cut to kFactShmStringSlotSize - 1
+    /// bytes. The value holds the alternative of the fact's type.
+    ///     @return false: index out of range
+    bool readValue(int index, Fact::ValueVariant_t &value) const;
+
+    /// Consistent copy of the last published values of all facts of a group, in fact name order. The
+    /// values are copied in one pass under the group's seqlock, so they belong to the same update.
+    ///     @param values: Fact table index and value of each fact, appended
+    /// @return false: unknown group
+    bool readGroup(const std::string &groupName, std::vector<std::pair<int, Fact::ValueVariant_t>> &values) const;
+
+private:
+    struct Slot {
+        uint32_t index;                     ///< In the fact table
+        uint32_t groupIndex;
+        uint32_t valueOffset;
+        uint32_t valueSize;
+        FactMetaData::ValueType_t type;
+    };
+
+    void* _createSegment(const std::string &segmentName);
+    void* _createSnapshot();
+    void _collectGroup(FactGroup *group, const std::string &groupName, std::vector<std::pair<const Fact*, std::string>> &facts);
+    void _publish(const Fact *fact);
+    static void _storeValue(uint8_t *segment, const Slot &slot, const Fact::ValueVariant_t &value);
+    static Fact::ValueVariant_t _loadValue(const uint8_t *source, const FactShmFactEntry &entry);
+
+    template<class T>
+    static void _write(uint8_t *destination, T value) { std::memcpy(destination, &value, sizeof(T)); }
+
+    template<class T>
+    static T _read(const uint8_t *source) { T value; std::memcpy(&value, source, sizeof(T)); return value; }
+
+    std::string _segmentName;
+    int _fd = -1;
+    uint8_t *_segment = nullptr;
+    size_t _segmentSize = 0;
+
+    std::unordered_map<const Fact*, Slot> _slots;
+    std::vector<std::string> _groupNames;
+    std::vector<const Fact*> _facts;                      ///< By fact table index
+    std::vector<int> _decimalPlaces;                      ///< By fact table index
+    std::vector<std::string> _factNames;                  ///< By fact table index, without the group
+    std::unordered_map<std::string, int> _pathToIndex;    ///< Every path a fact was found under
+    std::vector<std::pair<FactGroup*, int>> _listeners;   ///< Group and listener id, for detach
+};
+
+/// Minimal read side of the shared-memory fact segment. Header only so consumers only need this file.
+class FactSharedMemoryReader
+{
+public:
+    FactSharedMemoryReader() = default;
+    ~FactSharedMemoryReader() { close(); }
+
+    FactSharedMemoryReader(const FactSharedMemoryReader&) = delete;
+    FactSharedMemoryReader& operator=(const FactSharedMemoryReader&) = delete;
+
+    /// Map an existing segment read-only
+    bool open(const std::string &segmentName)
+    {
+        close();
+        int fd = ::shm_open(segmentName.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) < 0 || static_cast<size_t>(info.st_size) < sizeof(FactShmHeader)) {
+            ::close(fd);
+            return false;
+        }
+        void *mapped = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            return false;
+        }
+        _segment = static_cast<const uint8_t*>(mapped);
+        _segmentSize = static_cast<size_t>(info.st_size);
+        if (header()->magic != kFactShmMagic || header()->schemaVersion != kFactShmSchemaVersion) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (_segment) {
+            ::munmap(const_cast<uint8_t*>(_segment), _segmentSize);
+            _segment = nullptr;
+            _segmentSize = 0;
+        }
+    }
+
+    const FactShmHeader *header() const { return reinterpret_cast<const FactShmHeader*>(_segment); }
+
+    /// @return Index of the fact with the given "group.fact" path, -1 if not present. Resolve once, then
+    /// read by index.
+    int factIndex(const std::string &path) const
+    {
+        for (uint32_t i = 0; i < header()->factCount; i++) {
+            if (std::strncmp(_factTable()[i].path, path.c_str(), kFactShmPathLength) == 0) {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    /// Consistent read of a numeric fact, converted to double
+    ///     @return false: index out of range or the fact is a string
+    bool readNumeric(int index, double &value) const
+    {
+        if (index < 0 || static_cast<uint32_t>(index) >= header()->factCount) {
+            return false;
+        }
+        const FactShmFactEntry &entry = _factTable()[index];
+        if (entry.valueSize != kFactShmNumericSlotSize) {
+            return false;
+        }
+        const FactShmGroupEntry &group = _groupTable()[entry.groupIndex];
+        uint8_t raw[kFactShmNumericSlotSize];
+        uint32_t before;
+        do {
+            before = group.sequence.load(std::memory_order_acquire);
+            std::memcpy(raw, _segment + entry.valueOffset, sizeof(raw));
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((before & 1) || before != group.sequence.load(std::memory_order_relaxed));
+        value = slotToDouble(raw, static_cast<FactMetaData::ValueType_t>(entry.type));
+        return true;
+    }
+
+    static double slotToDouble(const uint8_t *raw, FactMetaData::ValueType_t type)
+    {
+        switch (type) {
+        case FactMetaData::valueTypeUint8:  return _load<uint8_t>(raw);
+        case FactMetaData::valueTypeInt8:   return _load<int8_t>(raw);
+        case FactMetaData::valueTypeUint16: return _load<uint16_t>(raw);
+        case FactMetaData::valueTypeInt16:  return _load<int16_t>(raw);
+        case FactMetaData::valueTypeUint32: return _load<uint32_t>(raw);
+        case FactMetaData::valueTypeInt32:  return _load<int32_t>(raw);
+        case FactMetaData::valueTypeUint64: return static_cast<double>(_load<uint64_t>(raw));
+        case FactMetaData::valueTypeInt64:  return static_cast<double>(_load<int64_t>(raw));
+        case FactMetaData::valueTypeFloat:  return _load<float>(raw);
+        case FactMetaData::valueTypeBool:   return _load<uint8_t>(raw) ? 1.0 : 0.0;
+        default:                            return _load<double>(raw);
+        }
+    }
+
+private:
+    template<class T>
+    static T _load(const uint8_t *raw) { T value; std::memcpy(&value, raw, sizeof(T)); return value; }
+
+    const FactShmGroupEntry *_groupTable() const { return reinterpret_cast<const FactShmGroupEntry*>(_segment + header()->groupTableOffset); }
+    const FactShmFactEntry *_factTable() const { return reinterpret_cast<const FactShmFactEntry*>(_segment + header()->factTableOffset); }
+
+    const uint8_t *_segment = nullptr;
+    size_t _segmentSize = 0;
+};
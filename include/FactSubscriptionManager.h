@@ -0,0 +1,151 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <functional>
+
+#include "Fact.h"
+
+class FactGroup;
+
+/// Fan out of fact value changes to any number of consumers.
+///
+/// Every subscriber registers a set of fact paths ("group.fact" or a root fact name), a maximum update
+/// rate per fact and a deadband. Several vehicles can be attached, a path is prefixed with the system id
+/// of its vehicle ("1.battery.voltage"), without one it refers to the vehicle attached first. Accepted changes are copied into a bounded queue owned by the subscriber
+/// and consumers drain it from their own thread with takeUpdates(). The publishing (receive) thread only
+/// ever takes the subscriber lock long enough to push into the queue, so a slow consumer can't stall ingest,
+/// it loses updates instead, which shows in its drop counters.
+class FactSubscriptionManager
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum OverflowPolicy {
+        DropOldest,     ///< Every accepted change is queued, a full queue discards its oldest entry
+        Coalesce,       ///< At most one entry per fact, a newer value replaces the queued one in place
+    };
+
+    struct SubscriberOptions {
+        std::vector<std::string> paths;
+        double maxRateHz = 0.0;                 ///< Per fact, 0: unlimited
+        double deadband = 0.0;                  ///< Minimum absolute change of numeric facts, 0: any change
+        size_t queueCapacity = 256;
+        OverflowPolicy overflowPolicy = DropOldest;
+
+        /// Called on the publishing thread when the queue goes from empty to non empty. Must not block and
+        /// must not call back into the manager, it is meant for waking the consumer's event loop.
+        std::function<void()> updatesAvailableCallback;
+    };
+
+    struct FactUpdate {
+        std::string path;
+        Fact::ValueVariant_t value;
+        Clock::time_point timestamp;            ///< Time the value was published
+    };
+
+    struct SubscriberStats {
+        uint64_t enqueued = 0;                  ///< Updates accepted into the queue
+        uint64_t delivered = 0;                 ///< Updates handed to the consumer
+        uint64_t dropped = 0;                   ///< Updates discarded because the queue was full
+        uint64_t coalesced = 0;                 ///< Updates merged into an already queued entry
+        uint64_t filtered = 0;                  ///< Changes suppressed by the deadband
+        uint64_t rateLimited = 0;               ///< Changes deferred because of maxRateHz
+        size_t queueDepth = 0;
+        uint64_t lagMs = 0;                     ///< Age of the oldest queued update
+        uint64_t maxLagMs = 0;                  ///< Largest age of an update at delivery
+    };
+
+    FactSubscriptionManager() = default;
+    ~FactSubscriptionManager();
+
+    FactSubscriptionManager(const FactSubscriptionManager&) = delete;
+    FactSubscriptionManager& operator=(const FactSubscriptionManager&) = delete;
+
+    /// Start observing the fact tree of rootGroup and its sub groups, in addition to those already attached
+    ///     @param systemId: Path prefix of the tree's facts
+    void attach(FactGroup *rootGroup, int systemId);
+
+    /// Stop observing all trees, existing subscribers keep their queued updates
+    void detach();
+
+    /// Splits "<systemId>.group.fact" into the system id and "group.fact". A path without a system id is
+    /// returned whole, with systemId -1.
+    static void splitPath(const std::string &path, int &systemId, std::string &factPath);
+
+    /// @return Subscriber id, -1 if none of the paths could be resolved
+    int subscribe(const SubscriberOptions &options);
+    void unsubscribe(int subscriberId);
+
+    /// Move up to maxUpdates queued updates, oldest first, into updates. Rate limited values whose
+    /// interval expired are queued first.
+    ///     @return Number of updates appended
+    size_t takeUpdates(int subscriberId, std::vector<FactUpdate> &updates, size_t maxUpdates = std::numeric_limits<size_t>::max());
+
+    /// Block until the subscriber has queued updates or the timeout expires
+    ///     @return true: updates are available
+    bool waitForUpdates(int subscriberId, std::chrono::milliseconds timeout);
+
+    /// @return false: unknown subscriber
+    bool subscriberStats(int subscriberId, SubscriberStats &stats) const;
+
+private:
+    /// Per subscriber state of one subscribed fact
+    struct FactState {
+        std::string path;
+        bool hasDelivered = false;
+        double lastValue = 0.0;                 ///< Last accepted numeric value, for the deadband
+        Clock::time_point lastAccepted;
+        bool queued = false;                    ///< Coalesce: an entry for this fact is in the queue
+        uint64_t queuedSequence = 0;
+        bool pending = false;                   ///< Rate limited value waiting for its interval
+        Fact::ValueVariant_t pendingValue;
+        Clock::time_point pendingTimestamp;
+    };
+
+    struct QueueEntry {
+        size_t factIndex;
+        Fact::ValueVariant_t value;
+        Clock::time_point timestamp;
+    };
+
+    struct Subscriber {
+        SubscriberOptions options;
+        Clock::duration minInterval{0};
+        std::vector<FactState> facts;
+        std::deque<QueueEntry> queue;
+        uint64_t headSequence = 0;              ///< Sequence number of queue.front()
+        SubscriberStats stats;
+        bool removed = false;
+
+        mutable std::mutex mutex;
+        std::condition_variable updatesAvailable;
+    };
+
+    void _onFactPublished(const Fact *fact);
+    void _offer(Subscriber &subscriber, size_t factIndex, const Fact::ValueVariant_t &value, Clock::time_point now);
+    void _enqueue(Subscriber &subscriber, size_t factIndex, const Fact::ValueVariant_t &value, Clock::time_point timestamp);
+    void _flushPending(Subscriber &subscriber, Clock::time_point now);
+    std::shared_ptr<Fact> _resolve(const std::string &path) const;
+    std::shared_ptr<Subscriber> _subscriber(int subscriberId) const;
+    static bool _numericValue(const Fact::ValueVariant_t &value, double &result);
+
+    std::vector<std::pair<FactGroup*, int>> _listeners;   ///< Group and listener id, for detach
+
+    mutable std::shared_mutex _subscribersMutex;
+    std::map<int, FactGroup*> _rootGroups;                ///< By system id
+    int _defaultSystemId = -1;                             ///< Of the tree attached first
+    std::map<int, std::shared_ptr<Subscriber>> _subscribers;
+    std::unordered_map<const Fact*, std::vector<std::pair<Subscriber*, size_t>>> _interest;
+    int _nextSubscriberId = 1;
+};
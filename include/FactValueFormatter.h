@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "FactMetaData.h"
+
+/// Text of fact values, written with std::to_chars straight into a caller's buffer.
+///
+/// Integers are written in decimal, float and double in fixed notation with the given number of
+/// decimal places, bools as true/false and strings as they are, the same text std::ostringstream
+/// with std::fixed and std::setprecision gave. No stream, locale or heap allocation is involved, a
+/// caller formatting many values reuses one buffer.
+class FactValueFormatter
+{
+public:
+    using ValueVariant_t = FactMetaData::ValueVariant_t;
+
+    /// Largest number of decimal places written, more are cut to this
+    static constexpr int kMaxDecimalPlaces = 32;
+
+    /// Fits any numeric value at up to kMaxDecimalPlaces, the longest being -DBL_MAX with its 309
+    /// integer digits. Strings may need more.
+    static constexpr size_t kBufferSize = 352;
+
+    /// Value as text into [first, last)
+    ///     @param decimalPlaces: For float and double, negative for the stream default of 6
+    /// @return One past the last character written, null if the text doesn't fit
+    static char* format(char *first, char *last, const ValueVariant_t &value, int decimalPlaces);
+
+    static std::string toString(const ValueVariant_t &value, int decimalPlaces);
+
+    /// Appends the text of value to out
+    static void append(std::string &out, const ValueVariant_t &value, int decimalPlaces);
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+/// Great circle distance and bearing on a spherical earth, accurate to about 0.5% which is well
+/// below GPS error at the distances a vehicle flies.
+///
+/// A GeoPoint caches the cosine of its latitude, so a distance or bearing between two points costs
+/// one sine/cosine pair for the longitude difference plus the haversine itself. Points which don't
+/// move, like home or the ground station, pay for their cosine once.
+namespace GeoMath {
+
+constexpr double kEarthRadiusMeters = 6371008.8;
+constexpr double kDegreesToRadians = M_PI / 180.0;
+constexpr double kRadiansToDegrees = 180.0 / M_PI;
+
+struct GeoPoint {
+    double latitude = 0.0;      ///< Radians
+    double longitude = 0.0;     ///< Radians
+    double cosLatitude = 1.0;
+    double sinLatitude = 0.0;
+
+    static GeoPoint fromDegrees(double latitudeDegrees, double longitudeDegrees)
+    {
+        GeoPoint point;
+        point.latitude = latitudeDegrees * kDegreesToRadians;
+        point.longitude = longitudeDegrees * kDegreesToRadians;
+        point.cosLatitude = std::cos(point.latitude);
+        point.sinLatitude = std::sin(point.latitude);
+        return point;
+    }
+
+    /// MAVLink encodes positions as degrees * 1E7
+    static GeoPoint fromE7(int32_t latitudeE7, int32_t longitudeE7)
+    {
+        return fromDegrees(latitudeE7 * 1e-7, longitudeE7 * 1e-7);
+    }
+};
+
+/// @return Haversine distance in meters
+inline double distance(const GeoPoint &from, const GeoPoint &to)
+{
+    const double sinHalfLatitude = std::sin((to.latitude - from.latitude) * 0.5);
+    const double sinHalfLongitude = std::sin((to.longitude - from.longitude) * 0.5);
+    const double a = sinHalfLatitude * sinHalfLatitude
+                   + from.cosLatitude * to.cosLatitude * sinHalfLongitude * sinHalfLongitude;
+    return 2.0 * kEarthRadiusMeters * std::asin(std::sqrt(std::fmin(a, 1.0)));
+}
+
+/// @return Initial bearing from one point towards the other, degrees 0-360 clockwise from north
+inline double bearing(const GeoPoint &from, const GeoPoint &to)
+{
+    const double deltaLongitude = to.longitude - from.longitude;
+    const double y = std::sin(deltaLongitude) * to.cosLatitude;
+    const double x = from.cosLatitude * to.sinLatitude - from.sinLatitude * to.cosLatitude * std::cos(deltaLongitude);
+    const double degrees = std::atan2(y, x) * kRadiansToDegrees;
+    return degrees < 0.0 ? degrees + 360.0 : degrees;
+}
+
+} // namespace GeoMath
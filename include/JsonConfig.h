@@ -2,6 +2,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include <variant>
 #include <fstream>
 #include <sstream>
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+
+#include "Scheduler.h"
+
+// MAVLink headers
+#include "../thirdparty/c_library_v2/common/mavlink.h"
+
+class Vehicle;
+
+/// Lists and downloads onboard logs of one vehicle with LOG_REQUEST_LIST and LOG_REQUEST_DATA.
+///
+/// The file is preallocated and mapped, each LOG_DATA chunk is copied straight to its offset in the
+/// order it arrives, and a bitmap records which chunks are there. Autopilots serve one data request
+/// at a time, so the download sweeps the file in windows of kWindowChunks: the next window is asked
+/// for as soon as the end of the current one arrives, chunks lost on the way are left as holes. Once
+/// the sweep reached the end, only the missing runs are requested again. When the last chunk of a
+/// request is lost nothing tells the end apart from a slow link, so the request is considered stalled
+/// after a timeout adapted to the measured round trip and chunk interval, and its missing part is
+/// asked for again.
+class LogDownloader
+{
+public:
+    struct LogEntry {
+        uint16_t id = 0;
+        uint32_t size = 0;          ///< Bytes
+        uint32_t timeUtc = 0;       ///< Seconds since 1970, 0 if unknown
+    };
+
+    struct Result {
+        bool success = false;
+        std::string error;
+        uint32_t bytes = 0;
+        double seconds = 0.0;
+        uint32_t requests = 0;      ///< LOG_REQUEST_DATA sent, including re-requests
+        double kilobytesPerSecond() const { return seconds > 0.0 ? bytes / 1024.0 / seconds : 0.0; }
+    };
+
+    static constexpr uint32_t kChunkSize = MAVLINK_MSG_LOG_DATA_FIELD_DATA_LEN;
+    static constexpr uint32_t kWindowChunks = 512;
+    static constexpr int kMinStallMsecs = 10;
+    static constexpr int kMaxStallMsecs = 300;             ///< Also used until the link was measured
+    static constexpr int kNoDataTimeoutMsecs = 6000;       ///< Then the download fails
+    static constexpr int kListTimeoutMsecs = 2000;
+    static constexpr uint32_t kMergeGapChunks = 8;        ///< Present chunks resent rather than splitting a re-request
+    static constexpr uint32_t kProgressChunks = 256;
+
+    /// Called on the vehicle's message thread or the scheduler thread
+    typedef std::function<void(bool success, const std::vector<LogEntry> &entries)> LogListCallback;
+    typedef std::function<void(uint32_t bytesReceived, uint32_t size)> ProgressCallback;
+    typedef std::function<void(const Result &result)> CompletionCallback;
+
+    explicit LogDownloader(Vehicle *vehicle);
+    ~LogDownloader();
+
+    LogDownloader(const LogDownloader&) = delete;
+    LogDownloader& operator=(const LogDownloader&) = delete;
+
+    void requestLogList(LogListCallback callback);
+
+    /// Start downloading a log into a new file of the entry's size. An empty log, which ArduPilot
+    /// lists with size 0, only creates the file and completes before this returns.
+    ///     @return false if a download is running or the file can't be created
+    bool downloadLog(const LogEntry &entry, const std::string &path, CompletionCallback completion,
+                     ProgressCallback progress = ProgressCallback());
+
+    void cancelDownload();
+    bool downloading() const;
+
+    void mavlinkMessageReceived(const mavlink_message_t &message);
+
+private:
+    struct Download {
+        LogEntry entry;
+        std::string path;
+        int fd = -1;
+        uint8_t *map = nullptr;
+        uint32_t chunkCount = 0;
+        std::vector<uint64_t> bitmap;
+        uint32_t chunksReceived = 0;
+        uint32_t sweepCursor = 0;           ///< First chunk not yet part of a sweep window
+        bool sweepDone = false;
+        uint32_t requestFirst = 0;          ///< Chunk range of the request in flight
+        uint32_t requestEnd = 0;
+        uint32_t requests = 0;
+        bool dataSinceCheck = false;
+        bool awaitingFirstData = false;     ///< Of the request in flight, for the round trip
+        std::chrono::steady_clock::time_point requestTime;
+        std::chrono::steady_clock::time_point lastDataTime;
+        double roundTripMsecs = 0.0;        ///< Smoothed, 0 until measured
+        double chunkIntervalMsecs = 0.0;    ///< Smoothed
+        uint32_t lastProgressChunks = 0;
+        std::chrono::steady_clock::time_point startTime;
+        CompletionCallback completion;
+        ProgressCallback progress;
+    };
+
+    struct Completion {
+        CompletionCallback callback;
+        Result result;
+    };
+
+    void _handleLogEntry(const mavlink_message_t &message);
+    void _handleLogData(const mavlink_message_t &message);
+    void _listTimeout(uint64_t generation);
+    void _scheduleStallCheck();
+    int _stallMsecs() const;
+    void _stallCheck(uint64_t generation);
+
+    bool _hasChunk(uint32_t chunk) const;
+    bool _nextRequest();
+    void _sendRequest(uint32_t firstChunk, uint32_t endChunk);
+    void _sendRequestEnd();
+    Completion _finish(bool success, const std::string &error);
+    void _closeFile(bool success);
+
+    Vehicle *_vehicle = nullptr;
+
+    mutable std::mutex _mutex;
+    bool _destroying = false;
+
+    // Log list
+    LogListCallback _listCallback;
+    std::map<uint16_t, LogEntry> _entries;
+    uint16_t _expectedEntries = 0;
+    bool _listRetried = false;
+    uint64_t _listGeneration = 0;
+    Scheduler::TaskId _listTask = 0;
+
+    std::unique_ptr<Download> _download;
+    uint64_t _downloadGeneration = 0;
+    Scheduler::TaskId _stallTask = 0;
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <type_traits>
+
+/// Compile time log level. Statements below this level are discarded by the compiler, their arguments
+/// are never evaluated. Set with -DMAVCOLLECTOR_LOG_LEVEL=<n> (see Logger::Level), defaults to Info.
+#ifndef MAVCOLLECTOR_LOG_LEVEL
+#define MAVCOLLECTOR_LOG_LEVEL 2
+#endif
+
+/// Asynchronous leveled logger.
+///
+/// Log statements capture their arguments in binary form into a fixed size record of a lock free
+/// multi producer ring and return. Formatting and output happen on a background thread. The format
+/// string and category must be string literals, only their pointers are stored. String arguments are
+/// copied into the record and truncated if they don't fit. When the ring is full the record is dropped
+/// and counted instead of blocking the caller.
+///
+/// Placeholders: "{}" for any argument, "{:.Nf}" for a fixed point double with N decimals.
+///
+///     LOG_DEBUG("GPS", "Satellites visible: {}", count);
+class Logger
+{
+public:
+    enum Level : uint8_t {
+        Trace = 0,
+        Debug = 1,
+        Info = 2,
+        Warning = 3,
+        Error = 4,
+    };
+
+    static constexpr size_t kMaxArguments = 8;
+    static constexpr size_t kStringBufferSize = 160;
+    static constexpr size_t kRingSize = 4096;              ///< Records, power of two
+
+    static Logger& instance();
+
+    /// Minimum level which is output, in addition to the compile time MAVCOLLECTOR_LOG_LEVEL
+    void setLevel(Level level) { _runtimeLevel = level; }
+    Level level() const { return _runtimeLevel; }
+    bool isEnabled(Level level) const { return level >= _runtimeLevel; }
+
+    /// Output file, stdout when null. The logger does not take ownership.
+    void setOutput(FILE *output);
+
+    /// Block until everything logged before the call has been written
+    void flush();
+
+    /// Flush and stop the background thread. Later statements are dropped. The instance itself is never
+    /// destroyed so statements from static destructors stay safe.
+    void shutdown();
+
+    uint64_t droppedRecords() const { return _droppedRecords; }
+    uint64_t writtenRecords() const { return _writtenRecords; }
+
+    static const char* levelName(Level level);
+
+    /// Parses "trace", "debug", "info", "warning" or "error"
+    static bool parseLevel(const std::string &text, Level &level);
+
+    template<typename... Args>
+    void log(Level level, const char *category, const char *format, const Args&... args)
+    {
+        static_assert(sizeof...(Args) <= kMaxArguments, "Too many log arguments");
+        if (!isEnabled(level)) {
+            return;
+        }
+
+        Record *record = _claim();
+        if (!record) {
+            return;
+        }
+        record->level = level;
+        record->category = category;
+        record->format = format;
+        record->argumentCount = 0;
+        record->stringsUsed = 0;
+        (_encode(*record, args), ...);
+        _commit(record);
+    }
+
+private:
+    enum ArgumentType : uint8_t {
+        ArgumentInt,
+        ArgumentUint,
+        ArgumentDouble,
+        ArgumentBool,
+        ArgumentChar,
+        ArgumentString,
+    };
+
+    struct Record {
+        std::atomic<uint64_t> sequence;
+        uint64_t timestampNs;
+        const char *category;
+        const char *format;
+        Level level;
+        uint8_t argumentCount;
+        uint16_t stringsUsed;
+        ArgumentType types[kMaxArguments];
+        uint64_t values[kMaxArguments];             ///< Strings: offset << 16 | length into strings
+        char strings[kStringBufferSize];
+    };
+
+    Logger();
+    ~Logger();
+
+    Record* _claim();
+    void _commit(Record *record);
+    void _writerThreadFunc();
+    void _format(const Record &record, std::string &line) const;
+
+    template<typename T>
+    static void _encode(Record &record, const T &value)
+    {
+        using Value = std::decay_t<T>;
+        uint8_t index = record.argumentCount++;
+        if constexpr (std::is_same_v<Value, bool>) {
+            record.types[index] = ArgumentBool;
+            record.values[index] = value ? 1 : 0;
+        } else if constexpr (std::is_same_v<Value, char>) {
+            record.types[index] = ArgumentChar;
+            record.values[index] = static_cast<uint8_t>(value);
+        } else if constexpr (std::is_enum_v<Value>) {
+            record.types[index] = ArgumentInt;
+            record.values[index] = static_cast<uint64_t>(static_cast<int64_t>(value));
+        } else if constexpr (std::is_integral_v<Value> && std::is_signed_v<Value>) {
+            record.types[index] = ArgumentInt;
+            record.values[index] = static_cast<uint64_t>(static_cast<int64_t>(value));
+        } else if constexpr (std::is_integral_v<Value>) {
+            record.types[index] = ArgumentUint;
+            record.values[index] = static_cast<uint64_t>(value);
+        } else if constexpr (std::is_floating_point_v<Value>) {
+            double converted = static_cast<double>(value);
+            record.types[index] = ArgumentDouble;
+            std::memcpy(&record.values[index], &converted, sizeof(converted));
+        } else {
+            _encodeString(record, index, std::string_view(value));
+        }
+    }
+
+    static void _encodeString(Record &record, uint8_t index, std::string_view text);
+
+    Level _runtimeLevel = static_cast<Level>(MAVCOLLECTOR_LOG_LEVEL);
+    std::atomic<FILE*> _output{nullptr};
+
+    std::unique_ptr<Record[]> _ring;
+    alignas(64) std::atomic<uint64_t> _writePosition{0};
+    alignas(64) uint64_t _readPosition = 0;
+
+    std::atomic<uint64_t> _droppedRecords{0};
+    std::atomic<uint64_t> _writtenRecords{0};
+
+    std::thread _writerThread;
+    std::atomic<bool> _running{false};
+    std::mutex _wakeupMutex;
+    std::condition_variable _wakeup;
+    std::condition_variable _flushed;
+    std::atomic<uint64_t> _flushedPosition{0};
+};
+
+#define MAVCOLLECTOR_LOG(level, category, ...)                                              \
+    do {                                                                                    \
+        if constexpr ((level) >= MAVCOLLECTOR_LOG_LEVEL) {                                  \
+            Logger::instance().log((level), (category), __VA_ARGS__);                      \
+        }                                                                                   \
+    } while (0)
+
+#define LOG_TRACE(category, ...)    MAVCOLLECTOR_LOG(Logger::Trace, category, __VA_ARGS__)
+#define LOG_DEBUG(category, ...)    MAVCOLLECTOR_LOG(Logger::Debug, category, __VA_ARGS__)
+#define LOG_INFO(category, ...)     MAVCOLLECTOR_LOG(Logger::Info, category, __VA_ARGS__)
+#define LOG_WARNING(category, ...)  MAVCOLLECTOR_LOG(Logger::Warning, category, __VA_ARGS__)
+#define LOG_ERROR(category, ...)    MAVCOLLECTOR_LOG(Logger::Error, category, __VA_ARGS__)
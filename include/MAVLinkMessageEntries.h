@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Only the types, so this header can come before mavlink.h, see below
+#include "../thirdparty/c_library_v2/mavlink_types.h"
+
+/// CRC extra, payload lengths and target offsets of every message of the compiled dialect, looked up
+/// in constant time.
+///
+/// The bundled library finds a message's entry with a binary search over MAVLINK_MESSAGE_CRCS on every
+/// frame. This table is built at compile time from the same list and indexed directly in two levels
+/// over the 24 bit message id space: the upper 12 bits pick a page, the lower 12 bits a slot in it.
+/// Blocks without any message share an empty page, so the table costs 4 KB plus 8 KB per populated
+/// page, three pages for common.xml.
+///
+/// A translation unit hands it to mavlink_parse_char() by including this header before anything
+/// which includes mavlink.h and defining MAVLINK_MESSAGE_ENTRIES_OVERRIDE, which replaces the
+/// library's mavlink_get_msg_entry() there.
+namespace MAVLinkMessageEntries {
+
+constexpr unsigned kSlotBits = 12;
+constexpr uint32_t kSlotsPerPage = 1u << kSlotBits;
+constexpr uint32_t kPageCount = (1u << 24) >> kSlotBits;
+
+using Page = std::array<uint16_t, kSlotsPerPage>;      ///< Entry index + 1, 0 for no message
+
+// Defined from the constexpr table in MAVLinkMessageEntries.cpp
+extern const uint8_t *const pageOfBlock;                ///< kPageCount page indexes, page 0 is empty
+extern const Page *const pages;
+extern const mavlink_msg_entry_t *const entries;        ///< MAVLINK_MESSAGE_CRCS
+extern const size_t entryCount;
+
+/// @return Entry of the message id, null if the dialect doesn't define it
+inline const mavlink_msg_entry_t* find(uint32_t messageId)
+{
+    if (messageId >= (1u << 24)) {
+        return nullptr;
+    }
+    const uint16_t slot = pages[pageOfBlock[messageId >> kSlotBits]][messageId & (kSlotsPerPage - 1)];
+    return slot ? &entries[slot - 1] : nullptr;
+}
+
+/// Entry found by the library's binary search over MAVLINK_MESSAGE_CRCS, for comparison
+const mavlink_msg_entry_t* findBySearch(uint32_t messageId);
+
+} // namespace MAVLinkMessageEntries
+
+#ifdef MAVLINK_MESSAGE_ENTRIES_OVERRIDE
+#ifdef MAVLINK_H
+#error "MAVLinkMessageEntries.h must be included before mavlink.h to replace its message entry lookup"
+#endif
+#define MAVLINK_GET_MSG_ENTRY
+static inline const mavlink_msg_entry_t *mavlink_get_msg_entry(uint32_t msgid)
+{
+    return MAVLinkMessageEntries::find(msgid);
+}
+#endif
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <span>
+
+#include "FactGroup.h"
+
+/// FactGroup holding every field of one MAVLink message, built from the MAVLINK_MESSAGE_INFO field
+/// tables of the compiled dialect instead of handwritten handlers.
+///
+/// The group is named after the message ("WIND_COV") and the facts after the fields ("wind_x"). Array
+/// fields get one fact per element ("voltages_0", "voltages_1", ...), char arrays a single string fact.
+/// The field table is turned into a flat list of wire offset and type descriptors once, decoding a
+/// message is a single pass over that list.
+class MAVLinkMessageFactGroup : public FactGroup
+{
+public:
+    explicit MAVLinkMessageFactGroup(const mavlink_message_info_t &messageInfo);
+    virtual ~MAVLinkMessageFactGroup() = default;
+
+    /// @return Field table of the named message, null if the dialect doesn't define it
+    static const mavlink_message_info_t* messageInfo(const std::string &messageName);
+
+    /// @return Field tables of every message of the dialect, sorted by message id
+    static std::span<const mavlink_message_info_t> allMessageInfo();
+
+    uint32_t messageId() const { return _messageId; }
+
+    void handleMessage(Vehicle *vehicle, const mavlink_message_t &message) override;
+
+private:
+    struct Field {
+        uint16_t wireOffset;
+        uint16_t length;                ///< Bytes, the whole array for strings
+        mavlink_message_type_t type;
+        Fact *fact;
+    };
+
+    uint32_t _messageId = 0;
+    uint16_t _wireLength = 0;           ///< Payload length without v2 zero truncation
+    std::vector<Field> _fields;
+};
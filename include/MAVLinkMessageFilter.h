@@ -0,0 +1,69 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <map>
+#include <memory>
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+/// Allow/deny filter on message id, system id and component id of received frames.
+///
+/// The connection evaluates it from the raw frame header before the frame is fed to the MAVLink
+/// parser, so a rejected frame costs a few byte reads instead of CRC calculation, copying into a
+/// mavlink_message_t and dispatch to every fact group. An id passes when the allow list is empty or
+/// contains it, and the deny list doesn't contain it. HEARTBEAT always passes the message id check,
+/// vehicle discovery and link health depend on it.
+///
+/// Configure the filter before the connection starts receiving, only the counters are thread safe.
+class MAVLinkMessageFilter
+{
+public:
+    MAVLinkMessageFilter();
+
+    void setMessageIds(const std::vector<uint32_t> &allow, const std::vector<uint32_t> &deny);
+    void setSystemIds(const std::vector<uint32_t> &allow, const std::vector<uint32_t> &deny);
+    void setComponentIds(const std::vector<uint32_t> &allow, const std::vector<uint32_t> &deny);
+
+    /// @return true if any list is set, a disabled filter is skipped by the connection
+    bool isEnabled() const { return _enabled; }
+
+    /// Check a frame header, rejected frames are counted per message id without a lock or allocation
+    ///     @return true if the frame should be parsed
+    bool accept(uint32_t messageId, uint8_t systemId, uint8_t componentId);
+
+    uint64_t droppedCount() const { return _droppedCount.load(std::memory_order_relaxed); }
+
+    /// droppedByMessageId key of the frames with message ids the compiled dialect doesn't define
+    static constexpr uint32_t kUnknownMessageId = UINT32_MAX;
+
+    /// @return Rejected frame count keyed by message id, built from the counters on every call
+    std::map<uint32_t, uint64_t> droppedByMessageId() const;
+
+    /// Parse a comma separated list of ids, message ids may also be given by name ("ATTITUDE")
+    ///     @return false if an entry is neither a number nor a message of the compiled dialect
+    static bool parseIdList(const std::string &list, std::vector<uint32_t> &ids, std::string &badEntry);
+
+private:
+    static void _fillTable(std::array<bool, 256> &table, const std::vector<uint32_t> &allow, const std::vector<uint32_t> &deny);
+    void _updateEnabled();
+
+    bool _enabled = false;
+
+    // Verdict per message id below _messageIdAccepted.size(), ids beyond use _messageIdDefault
+    std::vector<uint8_t> _messageIdAccepted;
+    bool _messageIdDefault = true;
+    bool _messageIdFiltered = false;
+
+    std::array<bool, 256> _systemIdAccepted;
+    std::array<bool, 256> _componentIdAccepted;
+    bool _systemIdFiltered = false;
+    bool _componentIdFiltered = false;
+
+    std::atomic<uint64_t> _droppedCount{0};
+
+    // Rejected frames per message of the dialect, by MAVLinkMessageEntries index, the last counter for
+    // message ids it doesn't define
+    std::unique_ptr<std::atomic<uint64_t>[]> _droppedByEntry;
+};
@@ -8,6 +8,7 @@
 #include <mutex>
 #include <set>
 #include <map>
+#include <array>
 #include <chrono>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -16,8 +17,12 @@
 // MAVLink headers
 #include "../thirdparty/c_library_v2/common/mavlink.h"
 
+#include "MAVLinkMessageFilter.h"
+#include "MessageRateTable.h"
+
 // Forward declarations
 class Vehicle;
+class VehicleManager;
 
 /// MAVLink UDP connection handler for both v1 and v2 protocols.
 /// This is a Qt-free implementation of QGroundControl's link system.
@@ -56,9 +61,24 @@ public:
     std::string remoteAddress() const { return _targetAddress; }
     uint16_t port() const { return _port; }
 
+    /// Run bytes through the receive path as if a datagram arrived on the socket, for replaying
+    /// captures and benchmarking the parser without a network
+    ///     @return true if at least one frame was parsed
+    bool processDatagram(const uint8_t *data, size_t length) { return _parseMavlinkData(data, length); }
+
     /// Set vehicle for message handling
     void setVehicle(Vehicle *vehicle) { _vehicle = vehicle; }
 
+    /// Set vehicle manager for message handling, takes precedence over a single vehicle
+    void setVehicleManager(VehicleManager *vehicleManager) { _vehicleManager = vehicleManager; }
+
+    /// Ingress filter applied to frame headers before parsing, configure it before connect()
+    MAVLinkMessageFilter& messageFilter() { return _messageFilter; }
+    const MAVLinkMessageFilter& messageFilter() const { return _messageFilter; }
+
+    /// Frames, bytes and rates per (system id, message id) of the parsed frames, filtered ones excluded
+    const MessageRateTable& messageRates() const { return _messageRates; }
+
     /// Set system ID for this connection
     void setSystemId(uint8_t systemId) { _systemId = systemId; }
     uint8_t getSystemId() const { return _systemId; }
@@ -81,6 +101,18 @@ public:
     uint64_t getPacketsSent() const { return _packetsSent; }
     uint64_t getPacketsLost() const { return _packetsLost; }
 
+    /// MAVLink frames received, including filtered ones, and frames missing from the sequence numbers
+    uint64_t getMessagesReceived() const { return _messagesReceived; }
+    uint64_t getMessagesLost() const { return _totalLossCounter; }
+
+    /// Frames, lost frames and frame bytes of one system id, counted like the totals above
+    struct SystemStats {
+        uint64_t messagesReceived = 0;
+        uint64_t messagesLost = 0;
+        uint64_t bytesReceived = 0;
+    };
+    SystemStats getSystemStats(uint8_t systemId) const;
+
     /// Reset statistics
     void resetStatistics();
 
@@ -114,7 +146,8 @@ private:
     void _processReceivedData(const uint8_t *data, size_t length, const std::string &senderAddress, uint16_t senderPort);
     bool _parseMavlinkData(const uint8_t *data, size_t length);
     void _detectMavlinkVersion(const mavlink_message_t &message);
-    void _updateMessageLossStats(const mavlink_message_t &message);
+    size_t _filteredFrameLength(const uint8_t *data, size_t length);
+    void _updateMessageLossStats(uint8_t systemId, uint8_t componentId, uint8_t sequence, size_t frameLength);
     void _sendHeartbeatFunc();
     
     // Connection health monitoring
@@ -133,6 +166,14 @@ private:
     socklen_t _lastSenderAddrLen;
     std::atomic<bool> _haveSenderAddr{false};
 
+    // Address each system id last sent a heartbeat from, so messages to a vehicle reach it when
+    // several vehicles share the link. Guarded by _socketMutex.
+    struct SystemAddress {
+        struct sockaddr_in addr;
+        socklen_t addrLen = 0;
+    };
+    std::map<uint8_t, SystemAddress> _systemAddresses;
+
     // Threading
     std::thread _receiveThread;
     std::thread _healthCheckThread;
@@ -143,9 +184,12 @@ private:
     mavlink_status_t _mavlinkStatus[MAVLINK_COMM_NUM_BUFFERS];
     std::atomic<int> _detectedMavlinkVersion{2}; // Default to v2
     bool _autoVersionDetection = true;
+    MAVLinkMessageFilter _messageFilter;
+    MessageRateTable _messageRates;
 
     // Vehicle reference
     Vehicle *_vehicle = nullptr;
+    std::atomic<VehicleManager*> _vehicleManager{nullptr};
 
     // Callbacks
     MessageReceivedCallback _messageReceivedCallback;
@@ -161,7 +205,14 @@ private:
     // Message loss tracking
     std::set<std::pair<uint8_t, uint8_t>> _firstMessageSeen;
     std::map<std::pair<uint8_t, uint8_t>, uint8_t> _lastSequence;
-    uint64_t _totalLossCounter = 0;
+    std::atomic<uint64_t> _messagesReceived{0};
+    std::atomic<uint64_t> _totalLossCounter{0};
+    struct SystemCounters {
+        std::atomic<uint64_t> messagesReceived{0};
+        std::atomic<uint64_t> messagesLost{0};
+        std::atomic<uint64_t> bytesReceived{0};
+    };
+    std::array<SystemCounters, 256> _systemCounters;
     double _runningLossPercent = 0.0f;
 
     // Heartbeat
@@ -169,6 +220,8 @@ private:
     std::atomic<bool> _sendHeartbeatFlag{false};
     static constexpr uint32_t HEARTBEAT_INTERVAL_MS = 1000; // 1 second
 
+    static constexpr int RECEIVE_BUFFER_BYTES = 1024 * 1024;
+
     // Connection health monitoring
     std::atomic<bool> _healthCheckEnabled{false};
     std::atomic<bool> _autoRestartEnabled{false};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+// MAVLink headers
+#include "../thirdparty/c_library_v2/common/mavlink.h"
+
+/// Received frame count, bytes and rates per (system id, message id), to see which streams take the
+/// link and CPU budget.
+///
+/// Every message id of the dialect gets a fixed slot through a direct indexed table, ids the dialect
+/// doesn't know share one slot. A system id's row of slots is allocated when its first frame arrives
+/// and kept. Rates are exponentially weighted: each frame decays the rate by the time since the
+/// previous one and adds 1 / kRateTimeConstantSecs, a reader decays it further to the time of the
+/// read, so a stream which stops goes to zero.
+///
+/// record() must always be called from the same thread, the connection's receive thread. It takes no
+/// lock and doesn't allocate after the row exists. Readers may run on any thread.
+class MessageRateTable
+{
+public:
+    static constexpr double kRateTimeConstantSecs = 5.0;
+    static constexpr uint32_t kUnknownMessageId = UINT32_MAX;   ///< Entry of the shared slot
+
+    struct Entry {
+        uint8_t systemId = 0;
+        uint32_t messageId = 0;
+        const char *messageName = "";   ///< "UNKNOWN" for the shared slot
+        uint64_t count = 0;
+        uint64_t bytes = 0;             ///< Whole frames as received, header, checksum and signature included
+        double rateHz = 0.0;
+        double bytesPerSecond = 0.0;
+    };
+
+    MessageRateTable();
+    ~MessageRateTable();
+
+    MessageRateTable(const MessageRateTable&) = delete;
+    MessageRateTable& operator=(const MessageRateTable&) = delete;
+
+    /// Count a received frame
+    ///     @param nowNs: Steady clock time of arrival
+    void record(const mavlink_message_t &message, int64_t nowNs);
+
+    /// Every (system id, message id) received so far, ordered by system id then message id
+    ///     @param systemId: Only this system, -1 for all
+    std::vector<Entry> snapshot(int systemId = -1) const;
+
+    /// Size of the frame on the wire
+    static uint32_t frameLength(const mavlink_message_t &message);
+
+    static int64_t nowNs();
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> bytes{0};
+        std::atomic<int64_t> lastNs{0};
+        std::atomic<double> rateHz{0.0};
+        std::atomic<double> bytesPerSecond{0.0};
+    };
+
+    struct Row {
+        explicit Row(size_t slotCount) : slots(new Slot[slotCount]) {}
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    Row& _row(uint8_t systemId);
+
+    std::array<std::atomic<Row*>, 256> _rows{};
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+
+#include "Scheduler.h"
+
+// MAVLink headers
+#include "../thirdparty/c_library_v2/common/mavlink.h"
+
+class Vehicle;
+
+/// Downloads and uploads the mission of one vehicle with the MAVLink mission protocol.
+///
+/// Downloads keep several MISSION_REQUEST_INT outstanding instead of waiting for each item: ArduPilot
+/// answers requests in any order, other autopilots expect them one at a time and get a pipeline of
+/// one. Every outstanding request has its own timeout and is resent alone. Uploads are driven by the
+/// vehicle's requests. The mission is kept as an array indexed by sequence number, so the current
+/// item from MISSION_CURRENT is a direct lookup.
+class MissionManager
+{
+public:
+    /// MISSION_ITEM_INT without the addressing and sequence, which is the index in the mission
+    struct Item {
+        float param1 = 0.0f;
+        float param2 = 0.0f;
+        float param3 = 0.0f;
+        float param4 = 0.0f;
+        int32_t x = 0;              ///< Latitude * 1e7 or local x
+        int32_t y = 0;              ///< Longitude * 1e7 or local y
+        float z = 0.0f;
+        uint16_t command = 0;
+        uint8_t frame = MAV_FRAME_GLOBAL_RELATIVE_ALT_INT;
+        uint8_t autocontinue = 1;
+    };
+
+    struct Result {
+        bool success = false;
+        std::string error;
+        uint16_t count = 0;
+        double seconds = 0.0;
+        uint32_t messagesSent = 0;  ///< Including retransmissions
+    };
+
+    /// Called on the vehicle's message thread or the scheduler thread
+    typedef std::function<void(const Result &result)> CompletionCallback;
+
+    static constexpr int kArduPilotMaxOutstandingRequests = 4;
+    static constexpr int kRequestTimeoutMsecs = 1000;
+    static constexpr int kMaxRetries = 5;                  ///< Per item, and for the count
+
+    explicit MissionManager(Vehicle *vehicle);
+    ~MissionManager();
+
+    MissionManager(const MissionManager&) = delete;
+    MissionManager& operator=(const MissionManager&) = delete;
+
+    /// @return false if a transfer is running
+    bool loadFromVehicle(CompletionCallback completion);
+    bool writeToVehicle(const std::vector<Item> &items, CompletionCallback completion);
+    bool inProgress() const;
+
+    /// Requests kept outstanding during downloads, 0 chooses by autopilot
+    void setMaxOutstandingRequests(int requests);
+
+    void mavlinkMessageReceived(const mavlink_message_t &message);
+
+    /// Mission of the last completed transfer
+    size_t count() const;
+    std::vector<Item> items() const;
+    bool item(uint16_t seq, Item &item) const;
+
+    /// @return Sequence number from MISSION_CURRENT, -1 if none yet
+    int currentIndex() const;
+    bool currentItem(Item &item) const;
+
+private:
+    enum class State {
+        Idle,
+        RequestingCount,
+        Downloading,
+        Uploading,
+    };
+
+    struct Request {
+        std::chrono::steady_clock::time_point sentTime;
+        int attempts = 0;
+    };
+
+    struct Completion {
+        CompletionCallback callback;
+        Result result;
+    };
+
+    void _handleMissionCount(const mavlink_message_t &message);
+    void _handleMissionItemInt(const mavlink_message_t &message);
+    void _handleMissionRequest(uint16_t seq);
+    void _handleMissionAck(const mavlink_message_t &message);
+    void _timeoutCheck(uint64_t generation);
+
+    void _start(State state, CompletionCallback completion);
+    void _fillPipeline();
+    void _sendRequestList();
+    void _sendRequest(uint16_t seq);
+    void _sendCount();
+    void _sendItem(uint16_t seq);
+    void _sendAck(uint8_t type);
+    void _scheduleTimeoutCheck();
+    Completion _finish(bool success, const std::string &error);
+
+    Vehicle *_vehicle = nullptr;
+
+    mutable std::mutex _mutex;
+    bool _destroying = false;
+    int _maxOutstandingRequests = 0;
+
+    std::vector<Item> _items;
+    int _currentIndex = -1;
+
+    // Transfer in progress
+    State _state = State::Idle;
+    bool _uploading = false;
+    std::string _errorMsg;                          ///< Set by the message handlers, ends the transfer
+    std::vector<Item> _transferItems;
+    std::vector<bool> _received;
+    uint16_t _receivedCount = 0;
+    uint16_t _nextRequestSeq = 0;
+    int _lastUploadSeq = -1;                        ///< Last item the vehicle requested
+    std::map<uint16_t, Request> _outstanding;       ///< Download requests by sequence number
+    Request _transferRequest;                       ///< Count request or upload, whatever is waited for
+    uint32_t _messagesSent = 0;
+    std::chrono::steady_clock::time_point _startTime;
+    CompletionCallback _completion;
+    uint64_t _transferGeneration = 0;
+    Scheduler::TaskId _timeoutTask = 0;
+};
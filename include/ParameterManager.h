@@ -45,6 +45,10 @@ public:
     /// Re-request the full set of parameters from the autopilot
     void refreshAllParameters(uint8_t componentID = 0);
 
+    /// Load ArduPilot parameters as @PARAM/param.pck over MAVLink FTP, which falls back to
+    /// PARAM_REQUEST_LIST when the vehicle can't provide the file
+    void setFtpEnabled(bool enabled) { _tryftp = enabled; }
+
     /// Request a refresh on the specific parameter
     void refreshParameter(int componentId, const std::string &paramName);
 
@@ -87,6 +91,9 @@ public:
     static constexpr int kParamRequestReadRetryCount = 2;           ///< Number of retries for PARAM_REQUEST_READ
     static constexpr int kWaitForParamValueAckMs = 1000;    ///< Time to wait for param value ack after set param
 
+    static constexpr uint16_t kParamPackMagic = 0x671b;                 ///< param.pck without defaults
+    static constexpr uint16_t kParamPackMagicWithDefaults = 0x671c;
+
     // Callback support for Qt-free implementation
     typedef std::function<void(bool)> ParametersReadyCallback;
     void setParametersReadyCallback(ParametersReadyCallback callback) { _parametersReadyCallback = callback; }
@@ -110,6 +117,7 @@ private:
     /// Translates ParameterManager::defaultComponentId to real component id if needed
     int _actualComponentId(int componentId) const;
     void _mavlinkParamRequestRead(int componentId, const std::string &paramName, int paramIndex, bool notifyFailure);
+    void _mavlinkParamRequestList(int componentId);
     void _loadMetaData();
     void _clearMetaData();
     
@@ -203,16 +211,26 @@ private:
     std::thread _waitingParamTimeoutThread;
     std::atomic<bool> _timersRunning{false};
     std::mutex _timerMutex;
+
+    /// Shared with the detached timer threads, which may wake up after the manager is destroyed
+    struct TimerLifetime {
+        std::mutex mutex;
+        bool alive = true;
+    };
+    std::shared_ptr<TimerLifetime> _timerLifetime = std::make_shared<TimerLifetime>();
     
     // Timer state tracking
     std::atomic<bool> _initialRequestTimerActive{false};
     std::atomic<bool> _waitingParamTimerActive{false};
+    std::atomic<uint64_t> _initialRequestTimerGeneration{0};    ///< Restarting a timer supersedes the sleeping thread
+    std::atomic<uint64_t> _waitingParamTimerGeneration{0};
     std::chrono::steady_clock::time_point _initialRequestStartTime;
     std::chrono::steady_clock::time_point _waitingParamStartTime;
 
     std::shared_ptr<Fact> _defaultFact;   ///< Used to return default fact, when parameter not found
 
     bool _tryftp = false;
+    bool _parsingParamFile = false;     ///< true: parameters come from param.pck, no timers per parameter
 
     // Callbacks
     ParametersReadyCallback _parametersReadyCallback;
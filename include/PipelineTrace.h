@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/// Scoped trace points of the receive pipeline, exported as Chrome trace event JSON (chrome://tracing,
+/// Perfetto) to see where a latency spike went without attaching a profiler.
+///
+/// A trace point records a complete event, name, category, start and duration, into a ring buffer
+/// owned by the recording thread, so recording takes no lock. Timestamps are raw TSC reads, converted
+/// to microseconds at export against the steady clock. Each thread keeps its last kEventsPerThread
+/// events, older ones are overwritten. Names and categories must be string literals or intern()ed.
+///
+/// Tracing is off until setEnabled(true), a disabled trace point costs a relaxed load.
+///
+///     TRACE_SCOPE("vehicle", "dispatch");
+///     TRACE_SCOPE_ARG("vehicle", "dispatch", "msgid", message.msgid);
+class PipelineTrace
+{
+public:
+    static constexpr size_t kEventsPerThread = 16384;      ///< Power of two
+
+    static void setEnabled(bool enabled);
+    static bool isEnabled() { return _enabled.load(std::memory_order_relaxed); }
+
+    /// Label of the calling thread in the exported trace, a string literal
+    static void setThreadName(const char *name);
+
+    /// Stable copy of a name built at runtime, kept for the lifetime of the process
+    static const char* intern(const std::string &name);
+
+    /// Events of all threads, oldest first per thread, as a Chrome trace event JSON object
+    static std::string chromeTraceJson();
+
+    /// Write chromeTraceJson() to a file
+    ///     @return false: file could not be written
+    static bool writeChromeTrace(const std::string &path);
+
+    /// Drop the recorded events of all threads
+    static void clear();
+
+    class Scope
+    {
+    public:
+        Scope(const char *category, const char *name, const char *argName = nullptr, int64_t arg = 0)
+            : _category(category)
+            , _name(name)
+            , _argName(argName)
+            , _arg(arg)
+            , _startTicks(isEnabled() ? _ticks() : 0)
+        {
+        }
+
+        ~Scope()
+        {
+            if (_startTicks) {
+                _record(_category, _name, _argName, _arg, _startTicks, _ticks());
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char *_category;
+        const char *_name;
+        const char *_argName;
+        int64_t _arg;
+        uint64_t _startTicks;
+    };
+
+private:
+    static uint64_t _ticks()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+    }
+
+    static void _record(const char *category, const char *name, const char *argName, int64_t arg,
+                        uint64_t startTicks, uint64_t endTicks);
+
+    static inline std::atomic<bool> _enabled{false};
+};
+
+#define TRACE_SCOPE_NAME2(line) _traceScope##line
+#define TRACE_SCOPE_NAME(line) TRACE_SCOPE_NAME2(line)
+
+#define TRACE_SCOPE(category, name) PipelineTrace::Scope TRACE_SCOPE_NAME(__LINE__)(category, name)
+#define TRACE_SCOPE_ARG(category, name, argName, arg) \
+    PipelineTrace::Scope TRACE_SCOPE_NAME(__LINE__)(category, name, argName, static_cast<int64_t>(arg))
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <map>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+/// Runs delayed tasks on one shared thread, used for protocol timeouts and retries instead of a
+/// sleeping thread per timer.
+///
+/// Tasks run in deadline order and must return quickly, they hold up every other timer while they
+/// run. A task may schedule or cancel tasks itself.
+class Scheduler
+{
+public:
+    typedef uint64_t TaskId;                    ///< 0 is never a valid id
+    typedef std::function<void()> Task;
+
+    static Scheduler& instance();
+
+    /// @return Id to pass to cancel, 0 after shutdown
+    TaskId schedule(std::chrono::milliseconds delay, Task task);
+
+    /// Remove a task which hasn't run yet. When the task is running on the scheduler thread, waits for
+    /// it to finish unless called from the task itself, so the caller may destroy what the task uses.
+    ///     @return true if the task was removed before running
+    bool cancel(TaskId taskId);
+
+    /// Stop the thread, pending tasks are dropped. The instance itself is never destroyed.
+    void shutdown();
+
+    size_t pendingTasks() const;
+
+private:
+    Scheduler();
+    ~Scheduler();
+
+    void _threadFunc();
+
+    typedef std::chrono::steady_clock Clock;
+    typedef std::pair<Clock::time_point, TaskId> Key;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _wakeup;
+    std::condition_variable _taskFinished;
+    std::map<Key, Task> _tasks;
+    std::map<TaskId, Clock::time_point> _deadlines;
+    TaskId _nextTaskId = 1;
+    TaskId _runningTaskId = 0;
+    bool _running = false;
+    std::thread _thread;
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+#include "Scheduler.h"
+
+class Vehicle;
+class MAVLinkUdpConnection;
+
+/// Chooses the MAV_CMD_SET_MESSAGE_INTERVAL rate of each telemetry stream of one vehicle from the
+/// demanded rates and what the link carries.
+///
+/// Every kUpdateIntervalMsecs the controller measures received bytes and sequence loss of the
+/// vehicle's own frames, other vehicles sharing the socket don't count, and adjusts a scale applied
+/// to all demanded rates: it backs off multiplicatively when loss rises or the link gets close to
+/// its configured capacity and creeps back up while the link is clean, never above the demanded
+/// rate. With a known capacity the scale is also capped so the vehicle's expected traffic fits.
+/// Rates are only resent when they changed noticeably, and all of them again after reapply(), which
+/// the vehicle calls when it comes back after a reboot.
+class StreamRateController
+{
+public:
+    static constexpr int kUpdateIntervalMsecs = 2000;
+    static constexpr double kMinScale = 0.05;
+    static constexpr double kDecreaseFactor = 0.7;
+    static constexpr double kIncreaseStep = 0.1;
+    static constexpr double kHighLossPercent = 2.0;
+    static constexpr double kLowLossPercent = 0.5;
+    static constexpr double kTargetUtilization = 0.8;     ///< Of the configured link capacity
+    static constexpr double kMinRateHz = 0.5;
+    static constexpr double kResendThreshold = 0.1;       ///< Relative rate change which is sent
+
+    StreamRateController(Vehicle *vehicle, MAVLinkUdpConnection *connection);
+    ~StreamRateController();
+
+    StreamRateController(const StreamRateController&) = delete;
+    StreamRateController& operator=(const StreamRateController&) = delete;
+
+    /// Rate consumers want for a message, 0 removes the demand and returns the stream to the
+    /// autopilot's default rate
+    void setDemand(uint32_t messageId, double rateHz);
+
+    /// Replace all demands
+    void setDemands(const std::map<uint32_t, double> &rates);
+
+    /// Capacity of the vehicle's link in bytes per second, 0 if unknown in which case only loss limits the rates
+    void setLinkCapacity(double bytesPerSecond);
+
+    /// Send the initial rates and start periodic adjustment
+    void start();
+
+    /// Send every rate again on the next update, e.g. after the vehicle rebooted
+    void reapply();
+
+    double scale() const;
+
+    /// @return Rate currently requested from the vehicle, 0 if none
+    double appliedRate(uint32_t messageId) const;
+
+private:
+    struct Stream {
+        double demandHz = 0.0;
+        double appliedHz = 0.0;
+        uint16_t frameBytes = 0;
+        bool rejected = false;        ///< Vehicle refused the interval, not asked again until reapply
+        bool removed = false;         ///< Demand withdrawn, reset to the default rate on the next update
+    };
+
+    void _scheduleUpdate();
+    void _update();
+    void _apply(bool force);
+    void _sendInterval(uint32_t messageId, double rateHz);
+    double _expectedBytesPerSecond(double scale) const;
+
+    // Command results may arrive after the controller is gone
+    struct CallbackLifetime {
+        std::mutex mutex;
+        bool alive = true;
+    };
+    std::shared_ptr<CallbackLifetime> _callbackLifetime = std::make_shared<CallbackLifetime>();
+
+    Vehicle *_vehicle = nullptr;
+    MAVLinkUdpConnection *_connection = nullptr;
+
+    mutable std::mutex _mutex;
+    std::map<uint32_t, Stream> _streams;
+    double _linkCapacity = 0.0;
+    double _scale = 1.0;
+    bool _started = false;
+    bool _reapply = false;
+    bool _destroying = false;
+    Scheduler::TaskId _updateTask = 0;
+
+    // Counters of the vehicle's frames at the last update
+    std::chrono::steady_clock::time_point _lastUpdateTime;
+    uint64_t _lastBytesReceived = 0;
+    uint64_t _lastMessagesReceived = 0;
+    uint64_t _lastMessagesLost = 0;
+};
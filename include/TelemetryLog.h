@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+#include <ostream>
+#include <cstdint>
+
+// MAVLink headers
+#include "../thirdparty/c_library_v2/common/mavlink.h"
+
+class Vehicle;
+
+/// Text formats of the collector's console and data log output. They live in the core library so
+/// the formatting cost can be benchmarked along with the rest of the receive path.
+namespace TelemetryLog {
+
+/// "=== Telemetry Data ===" block with the vehicle's main facts, one "Name: value" per line
+///     @param timestampMs: Wall clock time printed in the header
+std::string telemetrySnapshot(Vehicle *vehicle, int64_t timestampMs);
+
+/// One data log line per received message: "timestamp,MSG,msgid,sysid,compid,len,sampleTime", the
+/// sample time is empty unless the vehicle's clock is synchronized and the message is time stamped
+///     @param vehicle: Sender of the message, nullptr if not known
+void writeMessageLine(std::ostream &out, int64_t timestampMs, const mavlink_message_t &message, Vehicle *vehicle);
+
+} // namespace TelemetryLog
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <deque>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+#include "Scheduler.h"
+
+// MAVLink headers
+#include "../thirdparty/c_library_v2/common/mavlink.h"
+
+class Vehicle;
+
+/// Estimates the offset and drift between a vehicle's boot clock and the collector's monotonic clock
+/// from TIMESYNC exchanges, so time_boot_ms and time_usec stamps of the vehicle's messages can be
+/// placed on the collector's time line.
+///
+/// Every exchange gives the vehicle time at the midpoint of its round trip. The estimate is a
+/// least squares line through the last kWindowSamples midpoints, using only the exchanges whose round
+/// trip was close to the shortest one: a long round trip was queued somewhere, most likely in one
+/// direction only, which moves its midpoint. A jump of the vehicle clock, as after a reboot, starts
+/// over. With the mapping in place the latency of every timestamped message is measured as it
+/// arrives.
+class TimeSync
+{
+public:
+    static constexpr int kAcquireIntervalMsecs = 1000;     ///< Between requests until synchronized
+    static constexpr int kTrackIntervalMsecs = 5000;
+    static constexpr size_t kWindowSamples = 32;
+    static constexpr size_t kMinSamples = 4;               ///< Before the estimate is used
+    static constexpr int kMaxRttMsecs = 2000;              ///< Longer exchanges are dropped
+    static constexpr double kRttTolerance = 0.1;           ///< Share of the shortest round trip, at least 2 ms
+    static constexpr int kMinDriftSpanMsecs = 20000;       ///< Exchanges used for the drift must span this
+    static constexpr int kResetOffsetMsecs = 1000;         ///< Offset jump taken as a new vehicle clock
+    static constexpr int kResetSamples = 3;                ///< Consecutive jumps before starting over
+    static constexpr double kMaxDriftPpm = 500.0;
+    static constexpr double kLatencySmoothing = 0.1;
+
+    struct Estimate {
+        bool synchronized = false;
+        double offsetMsecs = 0.0;       ///< Vehicle boot clock minus collector monotonic clock, now
+        double driftPpm = 0.0;          ///< Vehicle clock rate error
+        double rttMsecs = 0.0;          ///< Shortest TIMESYNC round trip in the window
+        double latencyMsecs = 0.0;      ///< Smoothed age of timestamped messages on arrival
+        size_t samples = 0;
+    };
+
+    explicit TimeSync(Vehicle *vehicle);
+    ~TimeSync();
+
+    TimeSync(const TimeSync&) = delete;
+    TimeSync& operator=(const TimeSync&) = delete;
+
+    /// Start the periodic exchanges
+    void start();
+
+    /// Forget the estimate and synchronize again, e.g. after the vehicle rebooted
+    void restart();
+
+    void mavlinkMessageReceived(const mavlink_message_t &message);
+
+    bool synchronized() const;
+    Estimate estimate() const;
+
+    /// @return false until synchronized
+    bool vehicleToLocal(uint64_t vehicleUsec, std::chrono::steady_clock::time_point &local) const;
+
+    /// Boot time stamp of a message from its time_boot_ms or time_usec field. time_usec holding
+    /// Unix time, which some autopilots do once they have GPS time, doesn't count.
+    ///     @return false if the message has none
+    static bool messageTime(const mavlink_message_t &message, uint64_t &vehicleUsec);
+
+private:
+    struct Sample {
+        int64_t localNs;        ///< Midpoint of the exchange
+        int64_t offsetNs;       ///< Vehicle minus local at the midpoint
+        int64_t rttNs;
+    };
+
+    void _scheduleRequest();
+    void _sendRequest();
+    void _sendResponse(const mavlink_message_t &request, int64_t ts1);
+    void _handleResponse(int64_t tc1, int64_t ts1, int64_t nowNs);
+    void _updateEstimate();
+    void _updateLatency(const mavlink_message_t &message, int64_t nowNs);
+    int64_t _vehicleToLocalNs(int64_t vehicleNs) const;
+    static int64_t _nowNs();
+
+    Vehicle *_vehicle = nullptr;
+
+    mutable std::mutex _mutex;
+    bool _destroying = false;
+    bool _started = false;
+    Scheduler::TaskId _requestTask = 0;
+
+    std::array<int64_t, 4> _sentTimestamps{};       ///< ts1 of the latest requests
+    size_t _nextSentTimestamp = 0;
+    std::deque<Sample> _samples;
+    int _jumpCount = 0;
+
+    // Vehicle minus local is _offsetNs + _drift * (local - _referenceNs)
+    bool _synchronized = false;
+    int64_t _referenceNs = 0;
+    double _offsetNs = 0.0;
+    double _drift = 0.0;
+    int64_t _minRttNs = 0;
+    double _latencyMsecs = 0.0;
+    bool _latencyValid = false;
+};
@@ -3,6 +3,8 @@
 #include <string>
 #include <memory>
 #include <functional>
+#include <map>
+#include <vector>
 
 #include "FactGroup.h"
 #include "MAVLinkUdpConnection.h"
@@ -15,13 +17,29 @@ struct __mavlink_message_t;
 class Vehicle;
 class ParameterManager;
 class BoardIdentifier;
+class VehicleFactGroup;
+class CommandManager;
+class StreamRateController;
+class LogDownloader;
+class FTPManager;
+class FactArena;
+class MissionManager;
+class TimeSync;
 
 /// Main Vehicle class that manages all vehicle data collection.
 /// This is a Qt-free port of QGroundControl's Vehicle class.
 class Vehicle : public FactGroup
 {
 public:
+    /// Single vehicle which receives every message of the connection and follows the system id of
+    /// the last heartbeat
     explicit Vehicle(MAVLinkUdpConnection* connection);
+
+    /// Vehicle bound to one system id, messages are delivered by a VehicleManager
+    ///     @param messageFactGroups: MAVLink message names decoded generically into fact groups of the same name
+    ///     @param factArena: Place the facts of all fact groups in one FactArena
+    Vehicle(MAVLinkUdpConnection* connection, uint8_t systemId, uint8_t componentId,
+            const std::vector<std::string> &messageFactGroups = {}, bool factArena = false);
     virtual ~Vehicle();
 
     /// System ID of this vehicle
@@ -59,13 +77,37 @@ public:
     /// Get parameter manager
     std::shared_ptr<ParameterManager> parameterManager() { return _parameterManager; }
 
+    /// Ground station position for the distanceToGCS and headingFromGCS facts. Must be set before
+    /// messages are handled.
+    void setGCSPosition(double latitude, double longitude);
+
     /// Get UDP connection
     MAVLinkUdpConnection* connection() { return _connection; }
 
     /// Send MAVLink message to vehicle
     bool sendMessage(const mavlink_message_t &message);
 
-    /// Send MAVLink command to vehicle
+    /// Get command manager
+    std::shared_ptr<CommandManager> commandManager() { return _commandManager; }
+
+    /// Get telemetry stream rate controller
+    std::shared_ptr<StreamRateController> streamRateController() { return _streamRateController; }
+
+    /// Get MAVLink FTP client
+    std::shared_ptr<FTPManager> ftpManager() { return _ftpManager; }
+
+    /// Get mission protocol client
+    std::shared_ptr<MissionManager> missionManager() { return _missionManager; }
+
+    /// Get vehicle clock synchronization
+    std::shared_ptr<TimeSync> timeSync() { return _timeSync; }
+
+    /// Get onboard log downloader
+    std::shared_ptr<LogDownloader> logDownloader() { return _logDownloader; }
+
+    /// Send MAVLink command to vehicle without waiting for the result. The command is resent until it
+    /// is acknowledged, the confirmation field is set per attempt by the command manager.
+    ///     @return false if there is no connection
     bool sendCommand(uint16_t command, uint8_t confirmation, float param1 = 0.0f, float param2 = 0.0f, 
                      float param3 = 0.0f, float param4 = 0.0f, float param5 = 0.0f, float param6 = 0.0f, float param7 = 0.0f);
 
@@ -185,6 +227,8 @@ public:
 
 private:
     void _initializeFactGroups();
+    void _createManagers();
+    void _addMessageFactGroups(const std::vector<std::string> &messageNames);
     void _handleHeartbeat(const mavlink_message_t &message);
     void _handleStatustext(const mavlink_message_t &message);
     void _handleCommandAck(const mavlink_message_t &message);
@@ -219,11 +263,26 @@ private:
 
     // Managers
     std::shared_ptr<ParameterManager> _parameterManager;
+    std::shared_ptr<CommandManager> _commandManager;
+    std::shared_ptr<StreamRateController> _streamRateController;
+    std::shared_ptr<LogDownloader> _logDownloader;
+    std::shared_ptr<FTPManager> _ftpManager;
+    std::shared_ptr<MissionManager> _missionManager;
+    std::shared_ptr<TimeSync> _timeSync;
+    std::shared_ptr<VehicleFactGroup> _vehicleFactGroup;
+    std::shared_ptr<FactArena> _factArena;     ///< Null unless constructed with factArena
 
     // Callbacks
     VehicleChangedCallback _vehicleChangedCallback;
     VehicleTextMessageCallback _vehicleTextMessageCallback;
 
+    // Bound to _systemId by a VehicleManager instead of registered with the connection
+    bool _managed = false;
+    bool _firstHeartbeatReceived = false;
+
+    // Message statistics
+    uint32_t _totalMessages = 0;
+
     // Timing
     uint64_t _lastHeartbeatTime = 0;
     static constexpr uint64_t HEARTBEAT_TIMEOUT_MS = 5000; // 5 seconds
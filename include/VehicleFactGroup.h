@@ -1,6 +1,8 @@
 #pragma once
 
 #include "FactGroup.h"
+#include "DerivedFactEngine.h"
+#include "GeoMath.h"
 
 /// Main vehicle FactGroup containing core telemetry data.
 /// This is a Qt-free port of QGroundControl's VehicleFactGroup.
@@ -44,6 +46,13 @@ public:
 
     void handleMessage(Vehicle *vehicle, const mavlink_message_t &message) override;
 
+    /// Ground station position used for distanceToGCS and headingFromGCS
+    void setGCSPosition(double latitude, double longitude);
+
+    /// Armed state from the heartbeat, flightDistance and hobbs only count while armed. Must be called
+    /// on the thread handling the vehicle's messages.
+    void setArmed(bool armed);
+
 protected:
     void _handleAttitude(Vehicle *vehicle, const mavlink_message_t &message);
     void _handleAttitudeQuaternion(Vehicle *vehicle, const mavlink_message_t &message);
@@ -51,9 +60,38 @@ protected:
     void _handleVfrHud(const mavlink_message_t &message);
     void _handleRawImuTemp(const mavlink_message_t &message);
     void _handleNavControllerOutput(const mavlink_message_t &message);
+    void _handleMissionCurrent(const mavlink_message_t &message);
+    void _handleGlobalPositionInt(const mavlink_message_t &message);
+    void _handleHomePosition(const mavlink_message_t &message);
 
 private:
     void _handleAttitudeWorker(double rollRadians, double pitchRadians, double yawRadians);
+    void _setupDerivedFacts();
+
+    // Inputs of the derived facts
+    enum : DerivedFactEngine::InputMask {
+        InputPosition       = 1 << 0,
+        InputHomePosition   = 1 << 1,
+        InputGCSPosition    = 1 << 2,
+        InputGroundSpeed    = 1 << 3,
+        InputArmedTime      = 1 << 4,
+    };
+
+    DerivedFactEngine _derivedFacts;
+    GeoMath::GeoPoint _position;
+    GeoMath::GeoPoint _previousPosition;
+    GeoMath::GeoPoint _homePosition;
+    GeoMath::GeoPoint _gcsPosition;
+    bool _positionAvailable = false;
+    bool _previousPositionAvailable = false;
+    bool _homePositionAvailable = false;
+    bool _gcsPositionAvailable = false;
+    double _groundSpeed = 0.0;
+    double _flightDistance = 0.0;
+    double _distanceToHome = 0.0;
+    bool _armed = false;
+    std::chrono::steady_clock::time_point _armedSince;
+    std::chrono::steady_clock::duration _armedTime{0};    ///< Of earlier arming periods
 
     float _altitudeTuningOffset = std::numeric_limits<float>::quiet_NaN();
     bool _altitudeMessageAvailable = false;
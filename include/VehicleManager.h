@@ -0,0 +1,149 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+// MAVLink headers
+#include "../thirdparty/c_library_v2/common/mavlink.h"
+
+class Vehicle;
+class MAVLinkUdpConnection;
+
+/// Owns one Vehicle per MAVLink system id and routes received frames to it.
+///
+/// A Vehicle is created on the first heartbeat from an autopilot with a system id which hasn't been
+/// seen yet, frames from system ids without a Vehicle are counted and dropped. Vehicles are assigned
+/// round robin to a fixed number of shards. Each shard has a worker thread and a single producer queue,
+/// so the messages of one Vehicle are always handled in order on the same thread while vehicles on
+/// other shards are processed in parallel. The receive thread only copies the frame into the queue of
+/// the vehicle's shard, when the queue is full the frame is dropped and counted instead of stalling
+/// the link.
+class VehicleManager
+{
+public:
+    struct Stats {
+        uint64_t routed = 0;        ///< Frames queued to a shard
+        uint64_t processed = 0;     ///< Frames handled by a Vehicle
+        uint64_t dropped = 0;       ///< Frames dropped because the shard queue was full
+        uint64_t unrouted = 0;      ///< Frames from system ids without a Vehicle
+        uint64_t queueWaitNs = 0;   ///< Total time processed frames spent in the shard queues
+        uint64_t handleNs = 0;      ///< Total time spent in Vehicle::handleMessage
+        uint64_t maxQueueWaitNs = 0;
+        uint64_t maxHandleNs = 0;
+    };
+
+    static constexpr size_t kDefaultShardCount = 2;
+    static constexpr size_t kDefaultQueueCapacity = 1024;     ///< Frames per shard, rounded up to a power of two
+
+    /// Starts the shard workers, frames are only received from the connection after start()
+    ///     @param connection: Used by the vehicles to send, may be null
+    explicit VehicleManager(MAVLinkUdpConnection *connection,
+                            size_t shardCount = kDefaultShardCount,
+                            size_t queueCapacity = kDefaultQueueCapacity);
+    ~VehicleManager();
+
+    VehicleManager(const VehicleManager&) = delete;
+    VehicleManager& operator=(const VehicleManager&) = delete;
+
+    /// Registers with the connection, which then hands every received frame to handleMessage. Call it
+    /// once the manager is configured, the setters below are read on the receive thread and must not be
+    /// called afterwards.
+    void start();
+
+    /// Route a received frame to the vehicle with the frame's system id. Must only be called from one
+    /// thread at a time, normally the connection's receive thread.
+    void handleMessage(const mavlink_message_t &message);
+
+    /// @return Vehicle with the given system id, null if none has been seen
+    std::shared_ptr<Vehicle> vehicle(uint8_t systemId) const;
+
+    /// @return All vehicles in the order they were discovered
+    std::vector<std::shared_ptr<Vehicle>> vehicles() const;
+
+    /// @return First vehicle which was discovered, null until then
+    std::shared_ptr<Vehicle> activeVehicle() const;
+
+    size_t vehicleCount() const;
+    size_t shardCount() const { return _shards.size(); }
+
+    Stats stats() const;
+
+    /// MAVLink messages decoded into generic fact groups, see MAVLinkMessageFactGroup. Must be set
+    /// before start().
+    void setMessageFactGroups(const std::vector<std::string> &messageNames) { _messageFactGroups = messageNames; }
+
+    /// Place the facts of each vehicle in one FactArena. Must be set before start().
+    void setFactArenaEnabled(bool enabled) { _factArenaEnabled = enabled; }
+
+    /// Ground station position handed to the vehicles, see Vehicle::setGCSPosition. Must be set before
+    /// start().
+    void setGCSPosition(double latitude, double longitude);
+
+    /// Called on the receive thread when a vehicle is created, before its first frame is queued to its
+    /// worker. Must be set before start().
+    typedef std::function<void(const std::shared_ptr<Vehicle>&)> VehicleAddedCallback;
+    void setVehicleAddedCallback(VehicleAddedCallback callback) { _vehicleAddedCallback = callback; }
+
+private:
+    struct Entry {
+        Vehicle *vehicle;
+        int64_t queuedNs;       ///< steady_clock
+        mavlink_message_t message;
+    };
+
+    struct Shard {
+        std::unique_ptr<Entry[]> ring;
+        size_t mask = 0;
+        alignas(64) std::atomic<uint64_t> head{0};         ///< Next entry the worker handles
+        alignas(64) std::atomic<uint64_t> tail{0};         ///< Next entry the receive thread fills
+        std::atomic<bool> sleeping{false};
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        std::atomic<uint64_t> processed{0};
+        std::atomic<uint64_t> queueWaitNs{0};
+        std::atomic<uint64_t> handleNs{0};
+        std::atomic<uint64_t> maxQueueWaitNs{0};
+        std::atomic<uint64_t> maxHandleNs{0};
+        std::thread thread;
+    };
+
+    struct Route {
+        Vehicle *vehicle = nullptr;
+        Shard *shard = nullptr;
+    };
+
+    bool _isVehicleHeartbeat(const mavlink_message_t &message) const;
+    void _addVehicle(const mavlink_message_t &message);
+    void _workerThreadFunc(Shard &shard);
+    static int64_t _nowNs();
+
+    MAVLinkUdpConnection *_connection = nullptr;
+    std::vector<std::string> _messageFactGroups;
+    bool _factArenaEnabled = false;
+    bool _gcsPositionAvailable = false;
+    double _gcsLatitude = 0.0;
+    double _gcsLongitude = 0.0;
+
+    std::vector<std::unique_ptr<Shard>> _shards;
+    std::atomic<bool> _running{false};
+
+    // Only touched by the thread calling handleMessage
+    std::array<Route, 256> _routes;
+
+    mutable std::mutex _vehiclesMutex;
+    std::vector<std::shared_ptr<Vehicle>> _vehicles;
+
+    std::atomic<uint64_t> _routedMessages{0};
+    std::atomic<uint64_t> _droppedMessages{0};
+    std::atomic<uint64_t> _unroutedMessages{0};
+
+    VehicleAddedCallback _vehicleAddedCallback;
+};
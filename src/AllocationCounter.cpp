@@ -0,0 +1,260 @@
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+namespace {
+
+constexpr size_t kThreadSlots = 256;
+
+/// Counters of one thread. Only the owning thread adds to them, reset() and thread exit clear them
+/// from outside, which is why they are atomics.
+struct alignas(64) Slot {
+    std::atomic<bool> claimed{false};
+    std::atomic<uint64_t> messages{0};
+    std::atomic<uint64_t> allocations[AllocationCounter::StageCount]{};
+    std::atomic<uint64_t> bytes[AllocationCounter::StageCount]{};
+    std::atomic<uint64_t> frees[AllocationCounter::StageCount]{};
+};
+
+// Plain arrays of atomics, constant initialized so they can be used by allocations made before main()
+Slot g_slots[kThreadSlots];
+Slot g_retiredSlot;         // Counts of threads which have exited
+Slot g_sharedSlot;          // Threads which found no free slot, and threads on their way out
+
+thread_local Slot *t_slot = nullptr;
+
+void moveCounts(Slot &from, Slot &to)
+{
+    to.messages.fetch_add(from.messages.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+    for (size_t stage = 0; stage < AllocationCounter::StageCount; stage++) {
+        to.allocations[stage].fetch_add(from.allocations[stage].exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+        to.bytes[stage].fetch_add(from.bytes[stage].exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+        to.frees[stage].fetch_add(from.frees[stage].exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+}
+
+/// Hands the slot back when its thread exits, keeping the counts
+struct SlotOwner {
+    Slot *slot = nullptr;
+
+    ~SlotOwner()
+    {
+        // Destructors of other thread locals may still allocate, they go to the shared slot
+        t_slot = &g_sharedSlot;
+        if (slot) {
+            moveCounts(*slot, g_retiredSlot);
+            slot->claimed.store(false, std::memory_order_release);
+        }
+    }
+};
+
+Slot& claimSlot()
+{
+    // Registering the owner's destructor goes through the C allocator, not back into operator new
+    static thread_local SlotOwner owner;
+    t_slot = &g_sharedSlot;
+    for (Slot &slot : g_slots) {
+        bool expected = false;
+        if (!slot.claimed.load(std::memory_order_relaxed) &&
+            slot.claimed.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            owner.slot = &slot;
+            t_slot = &slot;
+            break;
+        }
+    }
+    return *t_slot;
+}
+
+inline Slot& threadSlot()
+{
+    return t_slot ? *t_slot : claimSlot();
+}
+
+void addCounts(const Slot &slot, AllocationCounter::Report &report)
+{
+    report.messages += slot.messages.load(std::memory_order_relaxed);
+    for (size_t stage = 0; stage < AllocationCounter::StageCount; stage++) {
+        report.stages[stage].allocations += slot.allocations[stage].load(std::memory_order_relaxed);
+        report.stages[stage].bytes += slot.bytes[stage].load(std::memory_order_relaxed);
+        report.stages[stage].frees += slot.frees[stage].load(std::memory_order_relaxed);
+    }
+}
+
+void clearCounts(Slot &slot)
+{
+    slot.messages.store(0, std::memory_order_relaxed);
+    for (size_t stage = 0; stage < AllocationCounter::StageCount; stage++) {
+        slot.allocations[stage].store(0, std::memory_order_relaxed);
+        slot.bytes[stage].store(0, std::memory_order_relaxed);
+        slot.frees[stage].store(0, std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+AllocationCounter::Counts AllocationCounter::Report::total() const
+{
+    Counts total;
+    for (const Counts &counts : stages) {
+        total.allocations += counts.allocations;
+        total.bytes += counts.bytes;
+        total.frees += counts.frees;
+    }
+    return total;
+}
+
+double AllocationCounter::Report::allocationsPerMessage(Stage stage) const
+{
+    return messages ? static_cast<double>(stages[stage].allocations) / messages : 0.0;
+}
+
+double AllocationCounter::Report::bytesPerMessage(Stage stage) const
+{
+    return messages ? static_cast<double>(stages[stage].bytes) / messages : 0.0;
+}
+
+AllocationCounter::Report AllocationCounter::report()
+{
+    Report report;
+    addCounts(g_retiredSlot, report);
+    addCounts(g_sharedSlot, report);
+    for (const Slot &slot : g_slots) {
+        addCounts(slot, report);
+    }
+    return report;
+}
+
+void AllocationCounter::reset()
+{
+    clearCounts(g_retiredSlot);
+    clearCounts(g_sharedSlot);
+    for (Slot &slot : g_slots) {
+        clearCounts(slot);
+    }
+}
+
+void AllocationCounter::countMessage()
+{
+    if constexpr (enabled()) {
+        threadSlot().messages.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void AllocationCounter::recordAllocation(size_t bytes)
+{
+    Slot &slot = threadSlot();
+    slot.allocations[_currentStage].fetch_add(1, std::memory_order_relaxed);
+    slot.bytes[_currentStage].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void AllocationCounter::recordFree()
+{
+    threadSlot().frees[_currentStage].fetch_add(1, std::memory_order_relaxed);
+}
+
+const char* AllocationCounter::stageName(Stage stage)
+{
+    switch (stage) {
+        case Untagged:      return "Untagged";
+        case Receive:       return "Receive";
+        case Parse:         return "Parse";
+        case Route:         return "Route";
+        case Dispatch:      return "Dispatch";
+        case FactGroups:    return "FactGroups";
+        case Publish:       return "Publish";
+        case Parameters:    return "Parameters";
+        case Managers:      return "Managers";
+        case Logging:       return "Logging";
+        case StageCount:    break;
+    }
+    return "Unknown";
+}
+
+std::string AllocationCounter::formatReport(const Report &report)
+{
+    std::ostringstream oss;
+    char line[160];
+    oss << "\n=== Allocation Statistics ===" << std::endl;
+    if (!enabled()) {
+        oss << "Allocation counting not compiled in, configure with -DMAVCOLLECTOR_COUNT_ALLOCATIONS=ON" << std::endl;
+        return oss.str();
+    }
+
+    oss << "MessagesProcessed: " << report.messages << std::endl;
+    snprintf(line, sizeof(line), "%-12s %12s %12s %14s %16s %14s", "Stage", "allocs/msg", "bytes/msg", "allocations", "bytes", "frees");
+    oss << line << std::endl;
+    for (size_t index = 0; index < StageCount; index++) {
+        const Stage stage = static_cast<Stage>(index);
+        const Counts &counts = report.stages[stage];
+        snprintf(line, sizeof(line), "%-12s %12.2f %12.1f %14llu %16llu %14llu", stageName(stage),
+                 report.allocationsPerMessage(stage), report.bytesPerMessage(stage),
+                 static_cast<unsigned long long>(counts.allocations), static_cast<unsigned long long>(counts.bytes),
+                 static_cast<unsigned long long>(counts.frees));
+        oss << line << std::endl;
+    }
+
+    const Counts total = report.total();
+    const double messages = report.messages ? static_cast<double>(report.messages) : 1.0;
+    snprintf(line, sizeof(line), "%-12s %12.2f %12.1f %14llu %16llu %14llu", "Total",
+             report.messages ? total.allocations / messages : 0.0, report.messages ? total.bytes / messages : 0.0,
+             static_cast<unsigned long long>(total.allocations), static_cast<unsigned long long>(total.bytes),
+             static_cast<unsigned long long>(total.frees));
+    oss << line << std::endl;
+    return oss.str();
+}
+
+#if MAVCOLLECTOR_COUNT_ALLOCATIONS
+
+// Replacements of the global allocation functions. The nothrow variants of libstdc++ forward to these.
+
+namespace {
+
+void *countedAllocate(size_t size)
+{
+    void *pointer = malloc(size ? size : 1);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    AllocationCounter::recordAllocation(size);
+    return pointer;
+}
+
+void *countedAllocateAligned(size_t size, std::align_val_t alignment)
+{
+    const size_t align = static_cast<size_t>(alignment);
+    // aligned_alloc wants a multiple of the alignment
+    void *pointer = aligned_alloc(align, ((size ? size : 1) + align - 1) & ~(align - 1));
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    AllocationCounter::recordAllocation(size);
+    return pointer;
+}
+
+void countedFree(void *pointer)
+{
+    if (pointer) {
+        AllocationCounter::recordFree();
+        free(pointer);
+    }
+}
+
+} // namespace
+
+void *operator new(size_t size) { return countedAllocate(size); }
+void *operator new[](size_t size) { return countedAllocate(size); }
+void *operator new(size_t size, std::align_val_t alignment) { return countedAllocateAligned(size, alignment); }
+void *operator new[](size_t size, std::align_val_t alignment) { return countedAllocateAligned(size, alignment); }
+void operator delete(void *pointer) noexcept { countedFree(pointer); }
+void operator delete[](void *pointer) noexcept { countedFree(pointer); }
+void operator delete(void *pointer, size_t) noexcept { countedFree(pointer); }
+void operator delete[](void *pointer, size_t) noexcept { countedFree(pointer); }
+void operator delete(void *pointer, std::align_val_t) noexcept { countedFree(pointer); }
+void operator delete[](void *pointer, std::align_val_t) noexcept { countedFree(pointer); }
+void operator delete(void *pointer, size_t, std::align_val_t) noexcept { countedFree(pointer); }
+void operator delete[](void *pointer, size_t, std::align_val_t) noexcept { countedFree(pointer); }
+
+#endif
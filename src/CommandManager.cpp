@@ -0,0 +1,181 @@
+#include "CommandManager.h"
+#include "Vehicle.h"
+#include "Logger.h"
+#include <vector>
+
+CommandManager::CommandManager(Vehicle *vehicle)
+    : _vehicle(vehicle)
+{
+}
+
+CommandManager::~CommandManager()
+{
+    std::map<Key, std::deque<Command>> commands;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _destroying = true;
+        commands.swap(_commands);
+    }
+
+    // Waits for a timeout which is running right now, it finds nothing left to do
+    for (auto& [key, queue] : commands) {
+        for (auto& command : queue) {
+            Scheduler::instance().cancel(command.timeoutTask);
+
+            Completion completion{true, key.second, Result(), std::move(command.promise), std::move(command.callback)};
+            completion.result.status = Result::Cancelled;
+            completion.result.attempts = command.attempts;
+            _deliver(completion);
+        }
+    }
+}
+
+std::future<CommandManager::Result> CommandManager::sendCommand(uint8_t targetComponent, uint16_t command,
+                                                                const Params &params, ResultCallback callback)
+{
+    Command pending;
+    pending.params = params;
+    pending.callback = std::move(callback);
+    std::future<Result> future = pending.promise.get_future();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_destroying) {
+        Result result;
+        result.status = Result::Cancelled;
+        pending.promise.set_value(result);
+        return future;
+    }
+
+    const Key key(targetComponent, command);
+    std::deque<Command> &queue = _commands[key];
+    queue.push_back(std::move(pending));
+    if (queue.size() == 1) {
+        _send(key, queue.front());
+    }
+    return future;
+}
+
+void CommandManager::handleCommandAck(const mavlink_message_t &message)
+{
+    mavlink_command_ack_t commandAck;
+    mavlink_msg_command_ack_decode(&message, &commandAck);
+
+    const Key key(message.compid, commandAck.command);
+    Completion completion;
+    Scheduler::TaskId timeoutTask = 0;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _commands.find(key);
+        if (it == _commands.end() || it->second.empty()) {
+            LOG_DEBUG("Command", "Unexpected COMMAND_ACK for command {} from compid={}", commandAck.command, message.compid);
+            return;
+        }
+
+        Command &command = it->second.front();
+        if (commandAck.result == MAV_RESULT_IN_PROGRESS) {
+            // Still working on it, stop resending but keep waiting for the final ack
+            timeoutTask = command.timeoutTask;
+            _scheduleTimeout(key, command, kInProgressTimeoutMsecs);
+        } else {
+            timeoutTask = command.timeoutTask;
+            Result result;
+            result.status = Result::Acked;
+            result.result = commandAck.result;
+            result.progress = commandAck.progress;
+            result.resultParam2 = commandAck.result_param2;
+            result.attempts = command.attempts;
+            completion = _complete(key, result);
+        }
+    }
+
+    // Outside the lock, cancel waits for a running timeout which needs it
+    Scheduler::instance().cancel(timeoutTask);
+    if (completion.completed) {
+        _deliver(completion);
+    }
+}
+
+size_t CommandManager::pendingCommands() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    size_t count = 0;
+    for (const auto& [key, queue] : _commands) {
+        count += queue.size();
+    }
+    return count;
+}
+
+void CommandManager::_send(const Key &key, Command &command)
+{
+    mavlink_message_t message;
+    mavlink_msg_command_long_pack(255, MAV_COMP_ID_MISSIONPLANNER, &message,
+                                  _vehicle->systemId(), key.first, key.second,
+                                  static_cast<uint8_t>(command.attempts),
+                                  command.params[0], command.params[1], command.params[2], command.params[3],
+                                  command.params[4], command.params[5], command.params[6]);
+    command.attempts++;
+
+    if (!_vehicle->sendMessage(message)) {
+        LOG_DEBUG("Command", "Sending command {} failed, attempt {}", key.second, command.attempts);
+    }
+    _scheduleTimeout(key, command, kAckTimeoutMsecs);
+}
+
+void CommandManager::_scheduleTimeout(const Key &key, Command &command, int timeoutMsecs)
+{
+    // A stale timer finds a different serial at the front of the queue and does nothing
+    const uint64_t serial = _nextSerial++;
+    command.timerSerial = serial;
+    command.timeoutTask = Scheduler::instance().schedule(std::chrono::milliseconds(timeoutMsecs),
+                                                         [this, key, serial]() { _timeout(key, serial); });
+}
+
+void CommandManager::_timeout(const Key &key, uint64_t serial)
+{
+    Completion completion;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _commands.find(key);
+        if (_destroying || it == _commands.end() || it->second.empty() || it->second.front().timerSerial != serial) {
+            return;
+        }
+
+        Command &command = it->second.front();
+        if (command.attempts < kMaxAttempts) {
+            LOG_DEBUG("Command", "No ack for command {}, retrying", key.second);
+            _send(key, command);
+            return;
+        }
+
+        LOG_WARNING("Command", "No ack for command {} to sysid={} compid={} after {} attempts",
+                    key.second, _vehicle->systemId(), key.first, command.attempts);
+        Result result;
+        result.status = Result::NoResponse;
+        result.attempts = command.attempts;
+        completion = _complete(key, result);
+    }
+    _deliver(completion);
+}
+
+CommandManager::Completion CommandManager::_complete(const Key &key, const Result &result)
+{
+    std::deque<Command> &queue = _commands[key];
+    Command &command = queue.front();
+    Completion completion{true, key.second, result, std::move(command.promise), std::move(command.callback)};
+    queue.pop_front();
+
+    if (queue.empty()) {
+        _commands.erase(key);
+    } else {
+        _send(key, queue.front());
+    }
+    return completion;
+}
+
+void CommandManager::_deliver(Completion &completion)
+{
+    completion.promise.set_value(completion.result);
+    if (completion.callback) {
+        completion.callback(completion.command, completion.result);
+    }
+}
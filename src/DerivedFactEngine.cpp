@@ -0,0 +1,22 @@
+#include "DerivedFactEngine.h"
+
+void DerivedFactEngine::addOutput(InputMask inputs, ComputeFunction compute)
+{
+    _outputs.push_back(Output{inputs, std::move(compute)});
+}
+
+void DerivedFactEngine::update()
+{
+    const InputMask dirtyInputs = _dirtyInputs;
+    if (dirtyInputs == 0) {
+        return;
+    }
+
+    // Cleared first so an output may mark inputs dirty for the next update
+    _dirtyInputs = 0;
+    for (const auto& output : _outputs) {
+        if (output.inputs & dirtyInputs) {
+            output.compute();
+        }
+    }
+}
@@ -0,0 +1,451 @@
+#include "FTPManager.h"
+#include "Vehicle.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+FTPManager::FTPManager(Vehicle *vehicle)
+    : _vehicle(vehicle)
+{
+}
+
+FTPManager::~FTPManager()
+{
+    Scheduler::TaskId timeoutTask;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _destroying = true;
+        timeoutTask = _timeoutTask;
+        if (_download && _download->sessionOpen) {
+            _sendTerminate();
+        }
+        _download.reset();
+    }
+    Scheduler::instance().cancel(timeoutTask);
+}
+
+bool FTPManager::download(uint8_t componentId, const std::string &fromURI, const std::string &toDir,
+                          DownloadCompleteCallback completion, ProgressCallback progress)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_destroying || _download) {
+        return false;
+    }
+
+    std::string fileName = fromURI.substr(0, fromURI.find('?'));
+    fileName = fileName.substr(fileName.find_last_of('/') + 1);
+    if (fileName.empty() || fromURI.size() > kDataSize) {
+        return false;
+    }
+
+    _download = std::make_unique<Download>();
+    _download->componentId = componentId;
+    _download->uri = fromURI;
+    _download->path = toDir + "/" + fileName;
+    _download->completion = std::move(completion);
+    _download->progress = std::move(progress);
+    _downloadGeneration++;
+
+    LOG_INFO("FTP", "Downloading {} from sysid={} compid={}", fromURI, _vehicle->systemId(), componentId);
+    _sendOpen();
+    _scheduleTimeout();
+    return true;
+}
+
+void FTPManager::cancelDownload()
+{
+    Completion done;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_download) {
+            return;
+        }
+        done = _finish("Cancelled");
+    }
+    done.callback(done.file, done.errorMsg);
+}
+
+bool FTPManager::downloading() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _download != nullptr;
+}
+
+void FTPManager::mavlinkMessageReceived(const mavlink_message_t &message)
+{
+    if (message.msgid != MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL) {
+        return;
+    }
+
+    mavlink_file_transfer_protocol_t transfer;
+    mavlink_msg_file_transfer_protocol_decode(&message, &transfer);
+    if (transfer.target_system != 255 && transfer.target_system != 0) {
+        return;
+    }
+    Request response;
+    memcpy(&response, transfer.payload, sizeof(response));
+
+    Completion done;
+    ProgressCallback progress;
+    float fraction = 0.0f;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_download || message.compid != _download->componentId) {
+            return;
+        }
+
+        const uint32_t bytesBefore = _download->bytesReceived;
+        if (response.opcode == kRspAck) {
+            _handleAck(response);
+        } else if (response.opcode == kRspNak) {
+            _handleNak(response);
+        }
+
+        if (!_download) {
+            return;
+        }
+        if (_download->state == State::Idle) {
+            done = _finish(std::string());
+        } else if (!_download->errorMsg.empty()) {
+            done = _finish(_download->errorMsg);
+        } else if (_download->progress && _download->bytesReceived != bytesBefore) {
+            progress = _download->progress;
+            fraction = static_cast<float>(_download->bytesReceived) / static_cast<float>(_download->data.size());
+        }
+    }
+
+    if (progress) {
+        progress(fraction);
+    }
+    if (done.callback) {
+        done.callback(done.file, done.errorMsg);
+    }
+}
+
+std::string FTPManager::errorString(const Request &nak)
+{
+    if (nak.size == 0) {
+        return "Nak without error code";
+    }
+    switch (nak.data[0]) {
+        case kErrFail:                  return "Failed";
+        case kErrFailErrno:             return "Failed, errno " + std::to_string(nak.size > 1 ? nak.data[1] : 0);
+        case kErrInvalidDataSize:       return "Invalid data size";
+        case kErrInvalidSession:        return "Invalid session";
+        case kErrNoSessionsAvailable:   return "No sessions available";
+        case kErrEOF:                   return "End of file";
+        case kErrUnknownCommand:        return "Unknown command";
+        case kErrFileExists:            return "File exists";
+        case kErrFileProtected:         return "File protected";
+        case kErrFileNotFound:          return "File not found";
+        default:                        return "Error " + std::to_string(nak.data[0]);
+    }
+}
+
+void FTPManager::_handleAck(const Request &response)
+{
+    Download *download = _download.get();
+    const bool current = response.seqNumber == static_cast<uint16_t>(download->lastSeqNumber + 1);
+
+    switch (response.reqOpcode) {
+        case kCmdResetSessions:
+            if (download->state == State::ResettingSessions && current) {
+                _sendOpen();
+            }
+            break;
+
+        case kCmdOpenFileRO:
+            if (download->state != State::Opening || !current) {
+                break;
+            }
+            if (response.size < sizeof(uint32_t)) {
+                download->errorMsg = "Open ack without file size";
+                break;
+            }
+            uint32_t fileSize;
+            memcpy(&fileSize, response.data, sizeof(fileSize));
+            download->session = response.session;
+            download->sessionOpen = true;
+            download->data.resize(fileSize);
+            download->retries = 0;
+            if (fileSize == 0) {
+                download->state = State::Idle;
+            } else {
+                download->state = State::Bursting;
+                _sendBurst();
+            }
+            break;
+
+        case kCmdBurstReadFile:
+        case kCmdReadFile:
+            if (response.session == download->session &&
+                (download->state == State::Bursting || download->state == State::FillingGaps)) {
+                _handleData(response);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void FTPManager::_handleNak(const Request &response)
+{
+    Download *download = _download.get();
+    const uint8_t error = response.size > 0 ? response.data[0] : static_cast<uint8_t>(kErrFail);
+
+    switch (response.reqOpcode) {
+        case kCmdOpenFileRO:
+            if (download->state != State::Opening) {
+                break;
+            }
+            if (error == kErrNoSessionsAvailable && !download->sessionsReset) {
+                // Sessions left behind by an earlier client, nothing else should be using them
+                LOG_WARNING("FTP", "No FTP session available on sysid={}, resetting sessions", _vehicle->systemId());
+                download->sessionsReset = true;
+                download->state = State::ResettingSessions;
+                _sendResetSessions();
+            } else {
+                download->errorMsg = "Open " + download->uri + ": " + errorString(response);
+            }
+            break;
+
+        case kCmdBurstReadFile:
+            if (download->state != State::Bursting || response.session != download->session) {
+                break;
+            }
+            if (error == kErrEOF) {
+                // Lost the tail of the last burst
+                if (download->burstOffset < download->data.size()) {
+                    download->gaps.push_back({download->burstOffset, static_cast<uint32_t>(download->data.size()) - download->burstOffset});
+                    download->burstOffset = static_cast<uint32_t>(download->data.size());
+                }
+                download->state = State::FillingGaps;
+                _sendRead();
+            } else {
+                download->errorMsg = "Burst read: " + errorString(response);
+            }
+            break;
+
+        case kCmdReadFile:
+            if (download->state == State::FillingGaps && response.session == download->session) {
+                download->errorMsg = "Read: " + errorString(response);
+            }
+            break;
+
+        case kCmdResetSessions:
+            if (download->state == State::ResettingSessions) {
+                download->errorMsg = "Reset sessions: " + errorString(response);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void FTPManager::_handleData(const Request &response)
+{
+    Download *download = _download.get();
+    const uint32_t fileSize = static_cast<uint32_t>(download->data.size());
+    const uint32_t offset = response.offset;
+    const uint32_t size = response.size;
+    if (size == 0 || size > kDataSize || offset >= fileSize || size > fileSize - offset) {
+        return;
+    }
+
+    memcpy(download->data.data() + offset, response.data, size);
+    download->lastActivity = std::chrono::steady_clock::now();
+    download->retries = 0;
+
+    if (download->state == State::Bursting && response.reqOpcode == kCmdBurstReadFile) {
+        if (offset >= download->burstOffset) {
+            if (offset > download->burstOffset) {
+                download->gaps.push_back({download->burstOffset, offset - download->burstOffset});
+            }
+            download->bytesReceived += size;
+            download->burstOffset = offset + size;
+        } else {
+            _fillGaps(offset, size);
+        }
+
+        if (download->burstOffset >= fileSize) {
+            download->state = State::FillingGaps;
+            _sendRead();
+        } else if (response.burstComplete) {
+            _sendBurst();
+        }
+    } else if (download->state == State::FillingGaps) {
+        _fillGaps(offset, size);
+        if (response.reqOpcode == kCmdReadFile && response.seqNumber == static_cast<uint16_t>(download->lastSeqNumber + 1)) {
+            _sendRead();
+        }
+    }
+}
+
+void FTPManager::_timeout(uint64_t generation)
+{
+    Completion done;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        Download *download = _download.get();
+        if (_destroying || !download || generation != _downloadGeneration) {
+            return;
+        }
+
+        const auto silence = std::chrono::steady_clock::now() - download->lastActivity;
+        if (silence < std::chrono::milliseconds(kAckTimeoutMsecs)) {
+            _scheduleTimeout();
+            return;
+        }
+
+        if (++download->retries > kMaxRetries) {
+            done = _finish("Timeout");
+        } else {
+            LOG_DEBUG("FTP", "No response from sysid={}, retry {}", _vehicle->systemId(), download->retries);
+            switch (download->state) {
+                case State::ResettingSessions:  _sendResetSessions(); break;
+                case State::Opening:            _sendOpen(); break;
+                case State::Bursting:           _sendBurst(); break;
+                case State::FillingGaps:        _sendRead(); break;
+                case State::Idle:               break;
+            }
+            _scheduleTimeout();
+        }
+    }
+    if (done.callback) {
+        done.callback(done.file, done.errorMsg);
+    }
+}
+
+void FTPManager::_sendResetSessions()
+{
+    Request request{};
+    request.opcode = kCmdResetSessions;
+    _send(request);
+}
+
+void FTPManager::_sendOpen()
+{
+    Download *download = _download.get();
+    download->state = State::Opening;
+
+    Request request{};
+    request.opcode = kCmdOpenFileRO;
+    request.size = static_cast<uint8_t>(download->uri.size());
+    memcpy(request.data, download->uri.data(), download->uri.size());
+    _send(request);
+}
+
+void FTPManager::_sendBurst()
+{
+    Download *download = _download.get();
+
+    Request request{};
+    request.opcode = kCmdBurstReadFile;
+    request.session = download->session;
+    request.offset = download->burstOffset;
+    request.size = kDataSize;
+    _send(request);
+}
+
+void FTPManager::_sendRead()
+{
+    Download *download = _download.get();
+    if (download->gaps.empty()) {
+        download->state = State::Idle;
+        return;
+    }
+
+    const Gap &gap = download->gaps.front();
+    Request request{};
+    request.opcode = kCmdReadFile;
+    request.session = download->session;
+    request.offset = gap.offset;
+    request.size = static_cast<uint8_t>(std::min<uint32_t>(gap.size, kDataSize));
+    _send(request);
+}
+
+void FTPManager::_sendTerminate()
+{
+    Request request{};
+    request.opcode = kCmdTerminateSession;
+    request.session = _download->session;
+    _download->sessionOpen = false;
+    _send(request);
+}
+
+void FTPManager::_send(Request &request)
+{
+    request.seqNumber = ++_seqNumber;
+    _download->lastSeqNumber = request.seqNumber;
+    _download->lastActivity = std::chrono::steady_clock::now();
+
+    mavlink_message_t message;
+    mavlink_msg_file_transfer_protocol_pack(255, MAV_COMP_ID_MISSIONPLANNER, &message, 0,
+                                            _vehicle->systemId(), _download->componentId,
+                                            reinterpret_cast<const uint8_t*>(&request));
+    _vehicle->sendMessage(message);
+}
+
+void FTPManager::_scheduleTimeout()
+{
+    const uint64_t generation = _downloadGeneration;
+    const auto silence = std::chrono::steady_clock::now() - _download->lastActivity;
+    const auto delay = std::max(std::chrono::milliseconds(1),
+                                std::chrono::milliseconds(kAckTimeoutMsecs) - std::chrono::duration_cast<std::chrono::milliseconds>(silence));
+    _timeoutTask = Scheduler::instance().schedule(delay, [this, generation]() { _timeout(generation); });
+}
+
+void FTPManager::_fillGaps(uint32_t offset, uint32_t size)
+{
+    Download *download = _download.get();
+    const uint32_t end = offset + size;
+
+    std::vector<Gap> gaps;
+    for (const Gap &gap : download->gaps) {
+        const uint32_t gapEnd = gap.offset + gap.size;
+        if (gapEnd <= offset || gap.offset >= end) {
+            gaps.push_back(gap);
+            continue;
+        }
+        download->bytesReceived += std::min(gapEnd, end) - std::max(gap.offset, offset);
+        if (gap.offset < offset) {
+            gaps.push_back({gap.offset, offset - gap.offset});
+        }
+        if (gapEnd > end) {
+            gaps.push_back({end, gapEnd - end});
+        }
+    }
+    download->gaps.swap(gaps);
+}
+
+FTPManager::Completion FTPManager::_finish(const std::string &errorMsg)
+{
+    Download *download = _download.get();
+    if (download->sessionOpen) {
+        _sendTerminate();
+    }
+
+    Completion done;
+    done.callback = download->completion;
+    done.errorMsg = errorMsg;
+    if (errorMsg.empty()) {
+        std::ofstream file(download->path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(download->data.data()), static_cast<std::streamsize>(download->data.size()));
+        if (file) {
+            done.file = download->path;
+            LOG_INFO("FTP", "Downloaded {} ({} bytes) from sysid={}", download->uri, download->data.size(), _vehicle->systemId());
+        } else {
+            done.errorMsg = "Can't write " + download->path;
+        }
+    }
+    if (!done.errorMsg.empty()) {
+        LOG_WARNING("FTP", "Download of {} from sysid={} failed: {}", download->uri, _vehicle->systemId(), done.errorMsg);
+    }
+
+    _download.reset();
+    _downloadGeneration++;
+    return done;
+}
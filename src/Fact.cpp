@@ -1,30 +1,36 @@
 #include "Fact.h"
 #include "FactMetaData.h"
+#include "FactValueFormatter.h"
 #include <sstream>
-#include <iomanip>
 #include <cmath>
 #include <algorithm>
 
 Fact::Fact()
-    : _type(ValueType_t::valueTypeInt32)
+    : _rawValue(_ownValue), _type(ValueType_t::valueTypeInt32)
 {
     _init();
 }
 
 Fact::Fact(int componentId, const std::string &name, ValueType_t type)
-    : _componentId(componentId), _name(name), _type(type)
+    : _rawValue(_ownValue), _type(type), _componentId(componentId), _name(name)
+{
+    _init();
+}
+
+Fact::Fact(int componentId, const std::string &name, ValueType_t type, ValueVariant_t &valueSlot)
+    : _rawValue(valueSlot), _type(type), _componentId(componentId), _name(name)
 {
     _init();
 }
 
 Fact::Fact(const Fact &other)
-    : _componentId(other._componentId)
-    , _rawValue(other._rawValue)
+    : _rawValue(_ownValue)
     , _type(other._type)
-    , _metaData(other._metaData)
     , _sendValueChangedSignals(other._sendValueChangedSignals)
     , _deferredValueChangeSignal(other._deferredValueChangeSignal)
+    , _metaData(other._metaData)
     , _valueChangedCallback(other._valueChangedCallback)
+    , _componentId(other._componentId)
 {
     _init();
 }
@@ -83,7 +89,7 @@ Fact::ValueVariant_t Fact::cookedValue() const
         return _rawValue;
     }
     
-    return _metaData->cookedTranslator()(_rawValue);
+    return _metaData->rawToCooked(_rawValue);
 }
 
 int Fact::decimalPlaces() const
@@ -281,7 +287,7 @@ Fact::ValueVariant_t Fact::cookedMax() const
 
 std::string Fact::cookedMaxString() const
 {
-    return _variantToString(cookedMax(), decimalPlaces());
+    return FactValueFormatter::toString(cookedMax(), decimalPlaces());
 }
 
 bool Fact::maxIsDefaultForType() const
@@ -313,7 +319,7 @@ Fact::ValueVariant_t Fact::cookedMin() const
 
 std::string Fact::cookedMinString() const
 {
-    return _variantToString(cookedMin(), decimalPlaces());
+    return FactValueFormatter::toString(cookedMin(), decimalPlaces());
 }
 
 bool Fact::minIsDefaultForType() const
@@ -354,12 +360,28 @@ std::string Fact::rawUnits() const
 
 std::string Fact::rawValueString() const
 {
-    return _variantToString(_rawValue, decimalPlaces());
+    return FactValueFormatter::toString(_rawValue, decimalPlaces());
+}
+
+char* Fact::rawValueString(char *first, char *last) const
+{
+    return FactValueFormatter::format(first, last, _rawValue, decimalPlaces());
 }
 
 std::string Fact::cookedValueString() const
 {
-    return _variantToString(cookedValue(), decimalPlaces());
+    if (!_metaData || _metaData->translatorKind() == FactMetaData::TranslatorIdentity) {
+        return FactValueFormatter::toString(_rawValue, decimalPlaces());
+    }
+    return FactValueFormatter::toString(cookedValue(), decimalPlaces());
+}
+
+char* Fact::cookedValueString(char *first, char *last) const
+{
+    if (!_metaData || _metaData->translatorKind() == FactMetaData::TranslatorIdentity) {
+        return FactValueFormatter::format(first, last, _rawValue, decimalPlaces());
+    }
+    return FactValueFormatter::format(first, last, cookedValue(), decimalPlaces());
 }
 
 bool Fact::valueEqualsDefault() const
@@ -455,13 +477,13 @@ bool Fact::volatileValue() const
 
 std::string Fact::rawValueStringFullPrecision() const
 {
-    return _variantToString(_rawValue, 18);
+    return FactValueFormatter::toString(_rawValue, 18);
 }
 
 void Fact::setRawValue(const ValueVariant_t &value)
 {
     _rawValue = value;
-    _sendValueChangedSignal(cookedValue());
+    _sendValueChangedSignal();
 }
 
 void Fact::setCookedValue(const ValueVariant_t &value)
@@ -471,7 +493,7 @@ void Fact::setCookedValue(const ValueVariant_t &value)
         return;
     }
     
-    setRawValue(_metaData->rawTranslator()(value));
+    setRawValue(_metaData->cookedToRaw(value));
 }
 
 void Fact::setEnumIndex(int index)
@@ -514,7 +536,7 @@ void Fact::setSendValueChangedSignals(bool sendValueChangedSignals)
 void Fact::sendDeferredValueChangedSignal()
 {
     if (_deferredValueChangeSignal) {
-        _sendValueChangedSignal(cookedValue());
+        _sendValueChangedSignal();
         _deferredValueChangeSignal = false;
     }
 }
@@ -545,53 +567,16 @@ void Fact::setEnumInfo(const std::vector<std::string> &strings, const std::vecto
     }
 }
 
-std::string Fact::_variantToString(const ValueVariant_t &variant, int decimalPlaces) const
-{
-    std::ostringstream oss;
-    
-    if (std::holds_alternative<std::string>(variant)) {
-        return std::get<std::string>(variant);
-    } else if (std::holds_alternative<bool>(variant)) {
-        return std::get<bool>(variant) ? "true" : "false";
-    } else if (std::holds_alternative<double>(variant)) {
-        oss << std::fixed << std::setprecision(decimalPlaces) << std::get<double>(variant);
-        return oss.str();
-    } else if (std::holds_alternative<float>(variant)) {
-        oss << std::fixed << std::setprecision(decimalPlaces) << std::get<float>(variant);
-        return oss.str();
-    } else if (std::holds_alternative<int64_t>(variant)) {
-        oss << std::get<int64_t>(variant);
-        return oss.str();
-    } else if (std::holds_alternative<uint64_t>(variant)) {
-        oss << std::get<uint64_t>(variant);
-        return oss.str();
-    } else if (std::holds_alternative<int32_t>(variant)) {
-        oss << std::get<int32_t>(variant);
-        return oss.str();
-    } else if (std::holds_alternative<uint32_t>(variant)) {
-        oss << std::get<uint32_t>(variant);
-        return oss.str();
-    } else if (std::holds_alternative<int16_t>(variant)) {
-        oss << std::get<int16_t>(variant);
-        return oss.str();
-    } else if (std::holds_alternative<uint16_t>(variant)) {
-        oss << std::get<uint16_t>(variant);
-        return oss.str();
-    } else if (std::holds_alternative<int8_t>(variant)) {
-        oss << static_cast<int>(std::get<int8_t>(variant));
-        return oss.str();
-    } else if (std::holds_alternative<uint8_t>(variant)) {
-        oss << static_cast<int>(std::get<uint8_t>(variant));
-        return oss.str();
-    }
-    
-    return "";
-}
-
-void Fact::_sendValueChangedSignal(const ValueVariant_t &value)
+void Fact::_sendValueChangedSignal()
 {
-    if (_sendValueChangedSignals && _valueChangedCallback) {
-        _valueChangedCallback(this, value);
+    if (!_sendValueChangedSignals || !_valueChangedCallback) {
+        return;
+    }
+    if (!_metaData || _metaData->translatorKind() == FactMetaData::TranslatorIdentity) {
+        // Cooked is raw, no copy
+        _valueChangedCallback(this, _rawValue);
+    } else {
+        _valueChangedCallback(this, _metaData->rawToCooked(_rawValue));
     }
 }
 
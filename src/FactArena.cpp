@@ -0,0 +1,44 @@
+#include "FactArena.h"
+#include <new>
+
+namespace {
+
+constexpr size_t alignUp(size_t bytes, size_t alignment)
+{
+    return (bytes + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+FactArena::FactArena(size_t factCapacity)
+    : _factCapacity(factCapacity)
+{
+    const size_t valueBytes = alignUp(factCapacity * sizeof(ValueVariant_t), kAlignment);
+    _blockBytes = valueBytes + alignUp(factCapacity * sizeof(Fact), kAlignment);
+    _block = ::operator new(_blockBytes, std::align_val_t(kAlignment));
+    _values = static_cast<ValueVariant_t*>(_block);
+    _facts = reinterpret_cast<Fact*>(static_cast<std::byte*>(_block) + valueBytes);
+}
+
+FactArena::~FactArena()
+{
+    // Facts first, they refer to their values
+    for (size_t i = _factCount; i > 0; i--) {
+        _facts[i - 1].~Fact();
+        _values[i - 1].~ValueVariant_t();
+    }
+    ::operator delete(_block, std::align_val_t(kAlignment));
+}
+
+std::shared_ptr<Fact> FactArena::makeFact(int componentId, const std::string &name, ValueType_t type)
+{
+    if (_factCount == _factCapacity) {
+        _overflowCount++;
+        return std::shared_ptr<Fact>();
+    }
+
+    ValueVariant_t *value = new (&_values[_factCount]) ValueVariant_t();
+    Fact *fact = new (&_facts[_factCount]) Fact(componentId, name, type, *value);
+    _factCount++;
+    return std::shared_ptr<Fact>(shared_from_this(), fact);
+}
@@ -1,4 +1,8 @@
 #include "FactGroup.h"
+#include "AllocationCounter.h"
+#include "FactArena.h"
+#include "FactValueFormatter.h"
+#include "PipelineTrace.h"
 #include <algorithm>
 #include <thread>
 #include <chrono>
@@ -44,6 +48,31 @@ std::shared_ptr<FactGroup> FactGroup::getFactGroup(const std::string &name) cons
     return it->second;
 }
 
+size_t FactGroup::formatValues(std::string &out, bool cooked, const std::string &linePrefix) const
+{
+    char buffer[FactValueFormatter::kBufferSize];
+    size_t count = 0;
+    for (const auto& [name, fact] : _nameToFactMap) {
+        if (!fact) {
+            continue;
+        }
+        out += linePrefix;
+        out += name;
+        out += ' ';
+        const char *end = cooked ? fact->cookedValueString(buffer, buffer + sizeof(buffer))
+                                 : fact->rawValueString(buffer, buffer + sizeof(buffer));
+        if (end) {
+            out.append(buffer, end - buffer);
+        } else {
+            // Text longer than the buffer
+            out += cooked ? fact->cookedValueString() : fact->rawValueString();
+        }
+        out += '\n';
+        count++;
+    }
+    return count;
+}
+
 void FactGroup::setLiveUpdates(bool liveUpdates)
 {
     _liveUpdates = liveUpdates;
@@ -83,6 +112,16 @@ void FactGroup::_updateAllValues()
     }
 }
 
+std::shared_ptr<Fact> FactGroup::_makeFact(int componentId, const std::string &name, Fact::ValueType_t type)
+{
+    if (FactArena *arena = FactArena::current()) {
+        if (auto fact = arena->makeFact(componentId, name, type)) {
+            return fact;
+        }
+    }
+    return std::make_shared<Fact>(componentId, name, type);
+}
+
 void FactGroup::_addFact(std::shared_ptr<Fact> fact, const std::string &name)
 {
     if (!fact) {
@@ -98,12 +137,46 @@ void FactGroup::_addFact(std::shared_ptr<Fact> fact, const std::string &name)
     
     // Set up fact change callback to propagate to our callback
     fact->setValueChangedCallback([this, name](const Fact* changedFact, const Fact::ValueVariant_t& value) {
+        ALLOCATION_SCOPE(Publish);
+        TRACE_SCOPE("fact", "publish");
         if (_factChangedCallback) {
             _factChangedCallback(this, name, value);
         }
+        _notifyFactPublished(changedFact);
     });
 }
 
+int FactGroup::addFactPublishedListener(FactPublishedListener listener)
+{
+    std::lock_guard<std::mutex> lock(_listenerMutex);
+    int listenerId = _nextListenerId++;
+    _factPublishedListeners.emplace_back(listenerId, std::move(listener));
+    return listenerId;
+}
+
+void FactGroup::removeFactPublishedListener(int listenerId)
+{
+    std::lock_guard<std::mutex> lock(_listenerMutex);
+    _factPublishedListeners.erase(
+        std::remove_if(_factPublishedListeners.begin(), _factPublishedListeners.end(),
+                       [listenerId](const auto& entry) { return entry.first == listenerId; }),
+        _factPublishedListeners.end());
+}
+
+void FactGroup::_notifyFactPublished(const Fact *fact)
+{
+    std::lock_guard<std::mutex> lock(_listenerMutex);
+    for (const auto& entry : _factPublishedListeners) {
+        entry.second(this, fact);
+    }
+}
+
+void FactGroup::setObjectName(const std::string &name)
+{
+    _objectName = name;
+    _traceName = PipelineTrace::intern(name);
+}
+
 void FactGroup::_addFactGroup(std::shared_ptr<FactGroup> factGroup, const std::string &name)
 {
     if (!factGroup) {
@@ -139,7 +212,10 @@ void FactGroup::_setupTimer()
     _timerRunning = true;
     _timerThread = std::thread([this]() {
         while (_timerRunning) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(_updateRateMSecs));
+            {
+                std::unique_lock<std::mutex> lock(_timerWaitMutex);
+                _timerWakeup.wait_for(lock, std::chrono::milliseconds(_updateRateMSecs), [this]() { return !_timerRunning; });
+            }
             if (_timerRunning) {
                 _updateTimerCallback();
             }
@@ -178,7 +254,11 @@ void FactGroup::_updateTimerCallback()
 // Destructor implementation
 FactGroup::~FactGroup()
 {
-    _timerRunning = false;
+    {
+        std::lock_guard<std::mutex> lock(_timerWaitMutex);
+        _timerRunning = false;
+    }
+    _timerWakeup.notify_one();
     if (_timerThread.joinable()) {
         _timerThread.join();
     }
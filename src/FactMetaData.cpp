@@ -1,8 +1,10 @@
 #include "FactMetaData.h"
+#include "FactValueFormatter.h"
 #include <sstream>
 #include <iomanip>
 #include <cmath>
 #include <algorithm>
+#include <type_traits>
 
 FactMetaData::FactMetaData()
     : _rawMax(_maxForType())
@@ -43,6 +45,9 @@ FactMetaData::FactMetaData(const FactMetaData &other)
     , _shortDescription(other._shortDescription)
     , _rawUnits(other._rawUnits)
     , _cookedUnits(other._cookedUnits)
+    , _translatorKind(other._translatorKind)
+    , _translatorScale(other._translatorScale)
+    , _translatorOffset(other._translatorOffset)
     , _rawTranslator(other._rawTranslator)
     , _cookedTranslator(other._cookedTranslator)
     , _vehicleRebootRequired(other._vehicleRebootRequired)
@@ -76,6 +81,9 @@ const FactMetaData &FactMetaData::operator=(const FactMetaData &other)
         _shortDescription = other._shortDescription;
         _rawUnits = other._rawUnits;
         _cookedUnits = other._cookedUnits;
+        _translatorKind = other._translatorKind;
+        _translatorScale = other._translatorScale;
+        _translatorOffset = other._translatorOffset;
         _rawTranslator = other._rawTranslator;
         _cookedTranslator = other._cookedTranslator;
         _vehicleRebootRequired = other._vehicleRebootRequired;
@@ -117,46 +125,32 @@ int FactMetaData::decimalPlaces() const
 
 FactMetaData::ValueVariant_t FactMetaData::cookedMax() const
 {
-    return _cookedTranslator(_rawMax);
+    return rawToCooked(_rawMax);
 }
 
 std::string FactMetaData::cookedMaxString() const
 {
-    std::ostringstream oss;
-    
-    if (std::holds_alternative<double>(cookedMax())) {
-        oss << std::fixed << std::setprecision(decimalPlaces()) << std::get<double>(cookedMax());
-    } else if (std::holds_alternative<float>(cookedMax())) {
-        oss << std::fixed << std::setprecision(decimalPlaces()) << std::get<float>(cookedMax());
-    } else if (std::holds_alternative<int32_t>(cookedMax())) {
-        oss << std::get<int32_t>(cookedMax());
-    } else if (std::holds_alternative<uint32_t>(cookedMax())) {
-        oss << std::get<uint32_t>(cookedMax());
-    }
-    
-    return oss.str();
+    return FactValueFormatter::toString(cookedMax(), decimalPlaces());
+}
+
+char* FactMetaData::cookedMaxString(char *first, char *last) const
+{
+    return FactValueFormatter::format(first, last, cookedMax(), decimalPlaces());
 }
 
 FactMetaData::ValueVariant_t FactMetaData::cookedMin() const
 {
-    return _cookedTranslator(_rawMin);
+    return rawToCooked(_rawMin);
 }
 
 std::string FactMetaData::cookedMinString() const
 {
-    std::ostringstream oss;
-    
-    if (std::holds_alternative<double>(cookedMin())) {
-        oss << std::fixed << std::setprecision(decimalPlaces()) << std::get<double>(cookedMin());
-    } else if (std::holds_alternative<float>(cookedMin())) {
-        oss << std::fixed << std::setprecision(decimalPlaces()) << std::get<float>(cookedMin());
-    } else if (std::holds_alternative<int32_t>(cookedMin())) {
-        oss << std::get<int32_t>(cookedMin());
-    } else if (std::holds_alternative<uint32_t>(cookedMin())) {
-        oss << std::get<uint32_t>(cookedMin());
-    }
-    
-    return oss.str();
+    return FactValueFormatter::toString(cookedMin(), decimalPlaces());
+}
+
+char* FactMetaData::cookedMinString(char *first, char *last) const
+{
+    return FactValueFormatter::format(first, last, cookedMin(), decimalPlaces());
 }
 
 bool FactMetaData::maxIsDefaultForType() const
@@ -174,6 +168,11 @@ double FactMetaData::cookedIncrement() const
     if (std::isnan(_rawIncrement)) {
         return _rawIncrement;
     }
+
+    // A step doesn't move with the offset
+    if (_translatorKind != TranslatorCustom) {
+        return _rawIncrement * std::fabs(_translatorScale);
+    }
     
     // Convert raw increment to cooked increment
     ValueVariant_t rawInc;
@@ -188,7 +187,7 @@ double FactMetaData::cookedIncrement() const
             return _rawIncrement;
     }
     
-    ValueVariant_t cookedInc = _cookedTranslator(rawInc);
+    ValueVariant_t cookedInc = rawToCooked(rawInc);
     
     if (std::holds_alternative<double>(cookedInc)) {
         return std::get<double>(cookedInc);
@@ -259,17 +258,96 @@ void FactMetaData::setVolatileValue(bool bValue)
 
 void FactMetaData::setTranslators(Translator rawTranslator, Translator cookedTranslator)
 {
+    _translatorKind = TranslatorCustom;
     _rawTranslator = rawTranslator;
     _cookedTranslator = cookedTranslator;
 }
 
+void FactMetaData::setTranslator(TranslatorKind kind)
+{
+    double scale = 1.0;
+    switch (kind) {
+    case TranslatorIdentity:
+        break;
+    case TranslatorRadiansToDegrees:
+        scale = 180.0 / M_PI;
+        break;
+    case TranslatorDegreesToRadians:
+        scale = M_PI / 180.0;
+        break;
+    case TranslatorCentiToUnits:
+        scale = 0.01;
+        break;
+    case TranslatorMetersToFeet:
+        scale = 3.2808399;
+        break;
+    case TranslatorFeetToMeters:
+        scale = 0.3048;
+        break;
+    case TranslatorNormToPercent:
+        scale = 100.0;
+        break;
+    case TranslatorPercentToNorm:
+        scale = 0.01;
+        break;
+    case TranslatorLinear:
+    case TranslatorCustom:
+        // Need their parameters
+        return;
+    }
+    _translatorKind = kind;
+    _translatorScale = scale;
+    _translatorOffset = 0.0;
+    _rawTranslator = nullptr;
+    _cookedTranslator = nullptr;
+}
+
+void FactMetaData::setLinearTranslator(double scale, double offset)
+{
+    if (scale == 0.0) {
+        return;
+    }
+    _translatorKind = TranslatorLinear;
+    _translatorScale = scale;
+    _translatorOffset = offset;
+    _rawTranslator = nullptr;
+    _cookedTranslator = nullptr;
+}
+
 void FactMetaData::setBuiltInTranslator()
 {
-    _rawTranslator = _defaultTranslator;
-    _cookedTranslator = _defaultTranslator;
+    setTranslator(TranslatorIdentity);
     _setAppSettingsTranslators();
 }
 
+FactMetaData::Translator FactMetaData::rawTranslator() const
+{
+    switch (_translatorKind) {
+    case TranslatorIdentity:
+        return [](const ValueVariant_t &cookedValue) { return cookedValue; };
+    case TranslatorCustom:
+        return _rawTranslator;
+    default:
+        return [scale = _translatorScale, offset = _translatorOffset, type = _type](const ValueVariant_t &cookedValue) {
+            return _scaleToRaw(cookedValue, scale, offset, type);
+        };
+    }
+}
+
+FactMetaData::Translator FactMetaData::cookedTranslator() const
+{
+    switch (_translatorKind) {
+    case TranslatorIdentity:
+        return [](const ValueVariant_t &rawValue) { return rawValue; };
+    case TranslatorCustom:
+        return _cookedTranslator;
+    default:
+        return [scale = _translatorScale, offset = _translatorOffset](const ValueVariant_t &rawValue) {
+            return _scaleToCooked(rawValue, scale, offset);
+        };
+    }
+}
+
 bool FactMetaData::convertAndValidateRaw(const ValueVariant_t &rawValue, bool convertOnly, ValueVariant_t &typedValue, std::string &errorString) const
 {
     // For now, just pass through - in a full implementation this would do type conversion and validation
@@ -281,7 +359,7 @@ bool FactMetaData::convertAndValidateRaw(const ValueVariant_t &rawValue, bool co
 bool FactMetaData::convertAndValidateCooked(const ValueVariant_t &cookedValue, bool convertOnly, ValueVariant_t &typedValue, std::string &errorString) const
 {
     // For now, just pass through - in a full implementation this would do type conversion and validation
-    typedValue = _rawTranslator(cookedValue);
+    typedValue = cookedToRaw(cookedValue);
     errorString = "";
     return true;
 }
@@ -461,8 +539,7 @@ FactMetaData::ValueVariant_t FactMetaData::maxForType(ValueType_t type)
 void FactMetaData::_setAppSettingsTranslators()
 {
     // Default implementation - no translation
-    _rawTranslator = _defaultTranslator;
-    _cookedTranslator = _defaultTranslator;
+    setTranslator(TranslatorIdentity);
 }
 
 bool FactMetaData::isInRawMinLimit(const ValueVariant_t &variantValue) const
@@ -475,79 +552,62 @@ bool FactMetaData::isInRawMaxLimit(const ValueVariant_t &variantValue) const
     return variantValue <= _rawMax;
 }
 
-// Built-in translator implementations
-FactMetaData::ValueVariant_t FactMetaData::_degreesToRadians(const ValueVariant_t &degrees)
-{
-    if (std::holds_alternative<double>(degrees)) {
-        return std::get<double>(degrees) * M_PI / 180.0;
-    } else if (std::holds_alternative<float>(degrees)) {
-        return static_cast<float>(std::get<float>(degrees) * M_PI / 180.0f);
-    }
-    return degrees;
-}
-
-FactMetaData::ValueVariant_t FactMetaData::_radiansToDegrees(const ValueVariant_t &radians)
-{
-    if (std::holds_alternative<double>(radians)) {
-        return std::get<double>(radians) * 180.0 / M_PI;
-    } else if (std::holds_alternative<float>(radians)) {
-        return static_cast<float>(std::get<float>(radians) * 180.0f / M_PI);
-    }
-    return radians;
-}
-
-FactMetaData::ValueVariant_t FactMetaData::_centiDegreesToDegrees(const ValueVariant_t &centiDegrees)
-{
-    if (std::holds_alternative<int32_t>(centiDegrees)) {
-        return static_cast<double>(std::get<int32_t>(centiDegrees)) / 100.0;
-    } else if (std::holds_alternative<double>(centiDegrees)) {
-        return std::get<double>(centiDegrees) / 100.0;
-    }
-    return centiDegrees;
-}
-
-FactMetaData::ValueVariant_t FactMetaData::_degreesToCentiDegrees(const ValueVariant_t &degrees)
+// Built-in translators
+FactMetaData::ValueVariant_t FactMetaData::_scaleToCooked(const ValueVariant_t &rawValue, double scale, double offset)
 {
-    if (std::holds_alternative<double>(degrees)) {
-        return static_cast<int32_t>(std::round(std::get<double>(degrees) * 100.0));
-    }
-    return degrees;
-}
-
-FactMetaData::ValueVariant_t FactMetaData::_metersToFeet(const ValueVariant_t &meters)
-{
-    if (std::holds_alternative<double>(meters)) {
-        return std::get<double>(meters) * 3.2808399;
-    } else if (std::holds_alternative<float>(meters)) {
-        return static_cast<float>(std::get<float>(meters) * 3.2808399f);
-    }
-    return meters;
-}
-
-FactMetaData::ValueVariant_t FactMetaData::_feetToMeters(const ValueVariant_t &feet)
-{
-    if (std::holds_alternative<double>(feet)) {
-        return std::get<double>(feet) * 0.3048;
-    } else if (std::holds_alternative<float>(feet)) {
-        return static_cast<float>(std::get<float>(feet) * 0.3048f);
-    }
-    return feet;
+    return std::visit([scale, offset](const auto &value) -> ValueVariant_t {
+        using T = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<T, float>) {
+            return static_cast<float>(value * scale + offset);
+        } else if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>) {
+            return static_cast<double>(value) * scale + offset;
+        } else {
+            return value;
+        }
+    }, rawValue);
 }
 
-FactMetaData::ValueVariant_t FactMetaData::_percentToNorm(const ValueVariant_t &percent)
+FactMetaData::ValueVariant_t FactMetaData::_scaleToRaw(const ValueVariant_t &cookedValue, double scale, double offset, ValueType_t rawType)
 {
-    if (std::holds_alternative<uint16_t>(percent)) {
-        return static_cast<double>(std::get<uint16_t>(percent)) / 100.0;
-    } else if (std::holds_alternative<double>(percent)) {
-        return std::get<double>(percent) / 100.0;
+    double cooked = 0.0;
+    if (!std::visit([&cooked](const auto &value) {
+            using T = std::decay_t<decltype(value)>;
+            if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>) {
+                cooked = static_cast<double>(value);
+                return true;
+            }
+            return false;
+        }, cookedValue)) {
+        return cookedValue;
     }
-    return percent;
-}
 
-FactMetaData::ValueVariant_t FactMetaData::_normToPercent(const ValueVariant_t &normalized)
-{
-    if (std::holds_alternative<double>(normalized)) {
-        return static_cast<uint16_t>(std::round(std::get<double>(normalized) * 100.0));
+    const double raw = (cooked - offset) / scale;
+    switch (rawType) {
+    case valueTypeUint8:
+        return static_cast<uint8_t>(std::llround(raw));
+    case valueTypeInt8:
+        return static_cast<int8_t>(std::llround(raw));
+    case valueTypeUint16:
+        return static_cast<uint16_t>(std::llround(raw));
+    case valueTypeInt16:
+        return static_cast<int16_t>(std::llround(raw));
+    case valueTypeUint32:
+        return static_cast<uint32_t>(std::llround(raw));
+    case valueTypeInt32:
+        return static_cast<int32_t>(std::llround(raw));
+    case valueTypeUint64:
+        return static_cast<uint64_t>(std::llround(raw));
+    case valueTypeInt64:
+        return static_cast<int64_t>(std::llround(raw));
+    case valueTypeFloat:
+        return static_cast<float>(raw);
+    case valueTypeDouble:
+    case valueTypeElapsedTimeInSeconds:
+        return raw;
+    case valueTypeString:
+    case valueTypeBool:
+    case valueTypeCustom:
+        break;
     }
-    return normalized;
+    return cookedValue;
 }
@@ -0,0 +1,546 @@
+#include "FactQueryServer.h"
+#include "FactSharedMemory.h"
+#include "FactSubscriptionManager.h"
+#include "FactRollups.h"
+#include "MessageRateTable.h"
+#include "FactValueFormatter.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+FactQueryServer::~FactQueryServer()
+{
+    stop();
+}
+
+bool FactQueryServer::start(const std::string &socketPath)
+{
+    if (_running) {
+        return false;
+    }
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Invalid query server socket path: " << socketPath << std::endl;
+        return false;
+    }
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    _listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (_listenFd < 0) {
+        std::cerr << "Failed to create query server socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    unlink(socketPath.c_str());
+    if (bind(_listenFd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(_listenFd, 16) < 0) {
+        std::cerr << "Failed to bind query server socket " << socketPath << ": " << strerror(errno) << std::endl;
+        close(_listenFd);
+        _listenFd = -1;
+        return false;
+    }
+
+    if (pipe2(_wakeupPipe, O_NONBLOCK | O_CLOEXEC) < 0) {
+        std::cerr << "Failed to create query server wakeup pipe: " << strerror(errno) << std::endl;
+        close(_listenFd);
+        _listenFd = -1;
+        unlink(socketPath.c_str());
+        return false;
+    }
+
+    _socketPath = socketPath;
+    _running = true;
+    _eventLoopThread = std::thread(&FactQueryServer::_eventLoop, this);
+
+    std::cout << "Fact query server listening on " << socketPath << std::endl;
+    return true;
+}
+
+void FactQueryServer::addVehicle(int systemId, const FactSharedMemoryPublisher *snapshot)
+{
+    if (!snapshot || !snapshot->isAttached()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(_snapshotsMutex);
+    _snapshots[systemId] = snapshot;
+    if (_defaultSystemId < 0) {
+        _defaultSystemId = systemId;
+    }
+}
+
+void FactQueryServer::stop()
+{
+    if (!_running) {
+        return;
+    }
+
+    _running = false;
+    _wakeup();
+    if (_eventLoopThread.joinable()) {
+        _eventLoopThread.join();
+    }
+
+    for (auto& client : _clients) {
+        _closeClient(client);
+    }
+    _clients.clear();
+    _clientCount = 0;
+
+    close(_listenFd);
+    close(_wakeupPipe[0]);
+    close(_wakeupPipe[1]);
+    _listenFd = -1;
+    _wakeupPipe[0] = _wakeupPipe[1] = -1;
+    unlink(_socketPath.c_str());
+
+    _handles.clear();
+    _pathToHandle.clear();
+
+    std::lock_guard<std::mutex> lock(_snapshotsMutex);
+    _snapshots.clear();
+    _defaultSystemId = -1;
+}
+
+void FactQueryServer::_eventLoop()
+{
+    std::vector<struct pollfd> pollFds;
+
+    while (_running) {
+        pollFds.clear();
+        pollFds.push_back({_wakeupPipe[0], POLLIN, 0});
+        pollFds.push_back({_listenFd, POLLIN, 0});
+        for (const auto& client : _clients) {
+            short events = POLLIN;
+            if (!client.output.empty()) {
+                events |= POLLOUT;
+            }
+            pollFds.push_back({client.fd, events, 0});
+        }
+
+        int ready = poll(pollFds.data(), pollFds.size(), _pollTimeoutMs(std::chrono::steady_clock::now()));
+        if (ready < 0 && errno != EINTR) {
+            std::cerr << "Query server poll failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        if (!_running) {
+            break;
+        }
+
+        // Clients are indexed in the same order as pollFds, starting at 2. New clients are appended after
+        // the scan so the indices stay aligned.
+        auto now = std::chrono::steady_clock::now();
+        std::vector<size_t> closedClients;
+        for (size_t i = 0; i < _clients.size(); i++) {
+            Client &client = _clients[i];
+            short revents = pollFds[i + 2].revents;
+
+            bool keep = true;
+            if (revents & (POLLERR | POLLNVAL)) {
+                keep = false;
+            }
+            if (keep && (revents & (POLLIN | POLLHUP))) {
+                keep = _readClient(client);
+            }
+            if (keep) {
+                _publishSubscriptions(client, now);
+                _publishWatches(client);
+            }
+            if (keep && !client.output.empty()) {
+                keep = _writeClient(client);
+            }
+            if (!keep) {
+                closedClients.push_back(i);
+            }
+        }
+
+        for (auto it = closedClients.rbegin(); it != closedClients.rend(); ++it) {
+            _closeClient(_clients[*it]);
+            _clients.erase(_clients.begin() + static_cast<long>(*it));
+        }
+
+        if (pollFds[0].revents & POLLIN) {
+            char drain[64];
+            while (read(_wakeupPipe[0], drain, sizeof(drain)) > 0) {
+            }
+        }
+        if (pollFds[1].revents & POLLIN) {
+            _acceptClients();
+        }
+        _clientCount = _clients.size();
+    }
+}
+
+void FactQueryServer::_acceptClients()
+{
+    while (true) {
+        int fd = accept4(_listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                std::cerr << "Query server accept failed: " << strerror(errno) << std::endl;
+            }
+            return;
+        }
+        _clients.push_back(Client{fd, std::string(), std::string(), {}, {}});
+    }
+}
+
+bool FactQueryServer::_readClient(Client &client)
+{
+    char buffer[4096];
+    while (true) {
+        ssize_t received = read(client.fd, buffer, sizeof(buffer));
+        if (received == 0) {
+            return false;
+        }
+        if (received < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return true;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        client.input.append(buffer, static_cast<size_t>(received));
+
+        // Requests are handled as they arrive, so a client that keeps writing holds at most one
+        // unterminated line and is dropped as soon as that gets too long
+        size_t start = 0;
+        size_t end;
+        while ((end = client.input.find('\n', start)) != std::string::npos) {
+            std::string line = client.input.substr(start, end - start);
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if (!line.empty()) {
+                _handleRequest(client, line);
+            }
+            start = end + 1;
+        }
+        client.input.erase(0, start);
+
+        if (client.input.size() > kMaxLineLength || client.output.size() > kMaxPendingOutput) {
+            return false;
+        }
+    }
+}
+
+bool FactQueryServer::_writeClient(Client &client)
+{
+    while (!client.output.empty()) {
+        ssize_t sent = send(client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        client.output.erase(0, static_cast<size_t>(sent));
+    }
+    return client.output.size() <= kMaxPendingOutput;
+}
+
+void FactQueryServer::_handleRequest(Client &client, const std::string &line)
+{
+    std::istringstream request(line);
+    std::string command;
+    request >> command;
+
+    if (command == "RESOLVE") {
+        std::string path;
+        client.output += "HANDLES";
+        while (request >> path) {
+            client.output += " " + std::to_string(_resolve(path));
+        }
+        client.output += "\n";
+    } else if (command == "GET") {
+        int handle;
+        while (request >> handle) {
+            _appendValue(client.output, "VALUE", handle);
+        }
+    } else if (command == "GETPATH") {
+        std::string path;
+        request >> path;
+        int handle = _resolve(path);
+        if (handle < 0) {
+            client.output += "ERROR unknown path " + path + "\n";
+        } else {
+            _appendValue(client.output, "VALUE", handle);
+        }
+    } else if (command == "GROUP") {
+        std::string name;
+        request >> name;
+        std::string groupName;
+        const FactSharedMemoryPublisher *snapshot = _snapshotForPath(name, groupName);
+        std::vector<std::pair<int, Fact::ValueVariant_t>> values;
+        if (!snapshot || !snapshot->readGroup(groupName, values)) {
+            client.output += "ERROR unknown group " + name + "\n";
+            return;
+        }
+        client.output += "GROUP " + name + " " + std::to_string(values.size()) + "\n";
+        for (const auto& [factIndex, value] : values) {
+            client.output += "FACT ";
+            client.output += snapshot->factName(factIndex);
+            client.output += ' ';
+            FactValueFormatter::append(client.output, value, snapshot->decimalPlaces(factIndex));
+            client.output += '\n';
+        }
+    } else if (command == "SUBSCRIBE") {
+        int rateHz = 0;
+        request >> rateHz;
+        if (rateHz <= 0 || rateHz > kMaxSubscriptionRateHz) {
+            client.output += "ERROR rate must be 1-" + std::to_string(kMaxSubscriptionRateHz) + " Hz\n";
+            return;
+        }
+
+        Subscription subscription;
+        subscription.id = _nextSubscriptionId++;
+        subscription.interval = std::chrono::milliseconds(1000 / rateHz);
+        subscription.nextUpdate = std::chrono::steady_clock::now();
+        int handle;
+        while (request >> handle) {
+            if (handle < 0 || static_cast<size_t>(handle) >= _handles.size()) {
+                client.output += "ERROR unknown handle " + std::to_string(handle) + "\n";
+                return;
+            }
+            subscription.handles.push_back(handle);
+        }
+        if (subscription.handles.empty()) {
+            client.output += "ERROR no handles\n";
+            return;
+        }
+        client.subscriptions.push_back(std::move(subscription));
+        client.output += "SUBSCRIBED " + std::to_string(client.subscriptions.back().id) + "\n";
+    } else if (command == "UNSUBSCRIBE") {
+        int id = 0;
+        request >> id;
+        auto it = std::find_if(client.subscriptions.begin(), client.subscriptions.end(),
+                               [id](const Subscription& subscription) { return subscription.id == id; });
+        if (it == client.subscriptions.end()) {
+            client.output += "ERROR unknown subscription " + std::to_string(id) + "\n";
+        } else {
+            client.subscriptions.erase(it);
+            client.output += "OK\n";
+        }
+    } else if (command == "WATCH") {
+        if (!_subscriptionManager) {
+            client.output += "ERROR watch not available\n";
+            return;
+        }
+
+        FactSubscriptionManager::SubscriberOptions options;
+        request >> options.maxRateHz >> options.deadband;
+        std::string path;
+        while (request >> path) {
+            options.paths.push_back(path);
+        }
+        options.queueCapacity = kWatchQueueCapacity;
+        options.overflowPolicy = FactSubscriptionManager::Coalesce;
+        options.updatesAvailableCallback = [this]() { _wakeup(); };
+
+        int id = _subscriptionManager->subscribe(options);
+        if (id < 0) {
+            client.output += "ERROR no known paths\n";
+            return;
+        }
+        client.watches.push_back(id);
+        client.output += "WATCHING " + std::to_string(id) + "\n";
+    } else if (command == "UNWATCH" || command == "WATCHSTATS") {
+        int id = 0;
+        request >> id;
+        auto it = std::find(client.watches.begin(), client.watches.end(), id);
+        if (!_subscriptionManager || it == client.watches.end()) {
+            client.output += "ERROR unknown watch " + std::to_string(id) + "\n";
+        } else if (command == "UNWATCH") {
+            _subscriptionManager->unsubscribe(id);
+            client.watches.erase(it);
+            client.output += "OK\n";
+        } else {
+            FactSubscriptionManager::SubscriberStats stats;
+            _subscriptionManager->subscriberStats(id, stats);
+            client.output += "STATS " + std::to_string(id) + " " + std::to_string(stats.enqueued) + " " +
+                             std::to_string(stats.delivered) + " " + std::to_string(stats.dropped) + " " +
+                             std::to_string(stats.coalesced) + " " + std::to_string(stats.filtered) + " " +
+                             std::to_string(stats.rateLimited) + " " + std::to_string(stats.queueDepth) + " " +
+                             std::to_string(stats.lagMs) + " " + std::to_string(stats.maxLagMs) + "\n";
+        }
+    } else if (command == "ROLLUP") {
+        int handle = -1;
+        std::string resolutionText;
+        size_t count = kDefaultRollupBuckets;
+        request >> handle >> resolutionText >> count;
+
+        FactRollups::Resolution resolution;
+        if (!_rollups || !FactRollups::parseResolution(resolutionText, resolution)) {
+            client.output += "ERROR rollups not available for " + resolutionText + "\n";
+            return;
+        }
+        if (handle < 0 || static_cast<size_t>(handle) >= _handles.size()) {
+            client.output += "ERROR unknown handle " + std::to_string(handle) + "\n";
+            return;
+        }
+
+        std::vector<FactRollups::Bucket> buckets;
+        const Handle &factHandle = _handles[handle];
+        _rollups->buckets(factHandle.snapshot->fact(factHandle.factIndex), resolution, count, buckets);
+        client.output += "ROLLUP " + std::to_string(handle) + " " + resolutionText + " " + std::to_string(buckets.size()) + "\n";
+        for (const auto& bucket : buckets) {
+            client.output += "BUCKET " + std::to_string(bucket.startMs) + " " + std::to_string(bucket.min) + " " +
+                             std::to_string(bucket.max) + " " + std::to_string(bucket.mean) + " " +
+                             std::to_string(bucket.last) + " " + std::to_string(bucket.count) + "\n";
+        }
+    } else if (command == "RATES") {
+        int systemId = -1;
+        if (!(request >> systemId)) {
+            systemId = -1;      // All systems, a failed read stores 0
+        }
+        if (!_messageRates) {
+            client.output += "ERROR rates not available\n";
+            return;
+        }
+
+        const std::vector<MessageRateTable::Entry> entries = _messageRates->snapshot(systemId);
+        client.output += "RATES " + std::to_string(entries.size()) + "\n";
+        for (const auto& entry : entries) {
+            client.output += "RATE " + std::to_string(entry.systemId) + " " + std::to_string(entry.messageId) + " " +
+                             entry.messageName + " " + std::to_string(entry.count) + " " + std::to_string(entry.bytes) + " " +
+                             std::to_string(entry.rateHz) + " " + std::to_string(entry.bytesPerSecond) + "\n";
+        }
+    } else {
+        client.output += "ERROR unknown command " + command + "\n";
+    }
+}
+
+void FactQueryServer::_publishSubscriptions(Client &client, std::chrono::steady_clock::time_point now)
+{
+    for (auto& subscription : client.subscriptions) {
+        if (now < subscription.nextUpdate) {
+            continue;
+        }
+        // Skip missed periods instead of bursting to catch up
+        while (subscription.nextUpdate <= now) {
+            subscription.nextUpdate += subscription.interval;
+        }
+        std::string tag = "UPDATE " + std::to_string(subscription.id);
+        for (int handle : subscription.handles) {
+            _appendValue(client.output, tag, handle);
+        }
+    }
+}
+
+void FactQueryServer::_publishWatches(Client &client)
+{
+    if (!_subscriptionManager) {
+        return;
+    }
+
+    std::vector<FactSubscriptionManager::FactUpdate> updates;
+    for (int id : client.watches) {
+        updates.clear();
+        _subscriptionManager->takeUpdates(id, updates);
+        for (const auto& update : updates) {
+            // Same text as the VALUE replies, with the fact's decimal places
+            std::string factPath;
+            const FactSharedMemoryPublisher *snapshot = _snapshotForPath(update.path, factPath);
+            const int decimalPlaces = snapshot ? snapshot->decimalPlaces(snapshot->factIndex(factPath)) : -1;
+            client.output += "CHANGE " + std::to_string(id) + " " + update.path + " ";
+            FactValueFormatter::append(client.output, update.value, decimalPlaces);
+            client.output += '\n';
+        }
+    }
+}
+
+void FactQueryServer::_closeClient(Client &client)
+{
+    if (_subscriptionManager) {
+        for (int id : client.watches) {
+            _subscriptionManager->unsubscribe(id);
+        }
+    }
+    client.watches.clear();
+    close(client.fd);
+}
+
+void FactQueryServer::_wakeup()
+{
+    char wakeup = 0;
+    (void)write(_wakeupPipe[1], &wakeup, 1);
+}
+
+int FactQueryServer::_resolve(const std::string &path)
+{
+    auto it = _pathToHandle.find(path);
+    if (it != _pathToHandle.end()) {
+        return it->second;
+    }
+
+    std::string factPath;
+    const FactSharedMemoryPublisher *snapshot = _snapshotForPath(path, factPath);
+    const int factIndex = snapshot ? snapshot->factIndex(factPath) : -1;
+    if (factIndex < 0) {
+        return -1;
+    }
+
+    // Facts re-registered under several paths share one handle
+    auto existing = std::find_if(_handles.begin(), _handles.end(), [snapshot, factIndex](const Handle &handle) {
+        return handle.snapshot == snapshot && handle.factIndex == factIndex;
+    });
+    int handle = static_cast<int>(existing - _handles.begin());
+    if (existing == _handles.end()) {
+        _handles.push_back(Handle{snapshot, factIndex});
+    }
+    _pathToHandle[path] = handle;
+    return handle;
+}
+
+void FactQueryServer::_appendValue(std::string &output, const std::string &tag, int handle) const
+{
+    Fact::ValueVariant_t value;
+    if (handle < 0 || static_cast<size_t>(handle) >= _handles.size() ||
+        !_handles[handle].snapshot->readValue(_handles[handle].factIndex, value)) {
+        output += "ERROR unknown handle " + std::to_string(handle) + "\n";
+        return;
+    }
+    output += tag;
+    output += ' ';
+    output += std::to_string(handle);
+    output += ' ';
+    FactValueFormatter::append(output, value, _handles[handle].snapshot->decimalPlaces(_handles[handle].factIndex));
+    output += '\n';
+}
+
+const FactSharedMemoryPublisher* FactQueryServer::_snapshotForPath(const std::string &path, std::string &factPath) const
+{
+    int systemId;
+    FactSubscriptionManager::splitPath(path, systemId, factPath);
+
+    std::lock_guard<std::mutex> lock(_snapshotsMutex);
+    auto it = _snapshots.find(systemId < 0 ? _defaultSystemId : systemId);
+    return it == _snapshots.end() ? nullptr : it->second;
+}
+
+int FactQueryServer::_pollTimeoutMs(std::chrono::steady_clock::time_point now) const
+{
+    auto next = now + std::chrono::milliseconds(kIdlePollTimeoutMs);
+    for (const auto& client : _clients) {
+        for (const auto& subscription : client.subscriptions) {
+            next = std::min(next, subscription.nextUpdate);
+        }
+    }
+    if (next <= now) {
+        return 0;
+    }
+    return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count()) + 1;
+}
@@ -0,0 +1,176 @@
+#include "FactRollups.h"
+#include "FactGroup.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <type_traits>
+
+FactRollups::FactRollups()
+{
+    _retention[Resolution1s] = kDefaultRetention1s;
+    _retention[Resolution10s] = kDefaultRetention10s;
+    _retention[Resolution1min] = kDefaultRetention1min;
+}
+
+FactRollups::~FactRollups()
+{
+    detach();
+}
+
+void FactRollups::setRetention(Resolution resolution, size_t buckets)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _retention[resolution] = std::max<size_t>(buckets, 1);
+}
+
+void FactRollups::attach(FactGroup *rootGroup)
+{
+    if (!rootGroup) {
+        return;
+    }
+
+    std::vector<FactGroup*> groups;
+    groups.push_back(rootGroup);
+    for (const auto& pair : rootGroup->factGroups()) {
+        groups.push_back(pair.second.get());
+    }
+    for (FactGroup *group : groups) {
+        int listenerId = group->addFactPublishedListener([this](const FactGroup*, const Fact *fact) {
+            _onFactPublished(fact);
+        });
+        _listeners.emplace_back(group, listenerId);
+    }
+}
+
+void FactRollups::detach()
+{
+    for (const auto& [group, listenerId] : _listeners) {
+        group->removeFactPublishedListener(listenerId);
+    }
+    _listeners.clear();
+}
+
+bool FactRollups::buckets(const Fact *fact, Resolution resolution, size_t maxBuckets, std::vector<Bucket> &buckets) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _series.find(fact);
+    if (it == _series.end()) {
+        return false;
+    }
+
+    const Series &series = *it->second;
+    const std::vector<Slot> &ring = series.rings[resolution];
+    const int64_t newest = series.newestBucketIndex[resolution];
+    const int64_t size = static_cast<int64_t>(ring.size());
+    const int64_t count = std::min<int64_t>(static_cast<int64_t>(maxBuckets), size);
+    const int64_t bucketMs = resolutionMs(resolution);
+
+    // Oldest to newest, skipping slots which hold an older wrap of the ring or were never filled
+    for (int64_t bucketIndex = newest - count + 1; bucketIndex <= newest; bucketIndex++) {
+        if (bucketIndex < 0) {
+            continue;
+        }
+        const Slot &slot = ring[static_cast<size_t>(bucketIndex % size)];
+        if (slot.bucketIndex != bucketIndex || slot.count == 0) {
+            continue;
+        }
+        Bucket bucket;
+        bucket.startMs = bucketIndex * bucketMs;
+        bucket.min = slot.min;
+        bucket.max = slot.max;
+        bucket.mean = slot.sum / slot.count;
+        bucket.last = slot.last;
+        bucket.count = slot.count;
+        buckets.push_back(bucket);
+    }
+    return true;
+}
+
+size_t FactRollups::seriesCount() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _series.size();
+}
+
+int64_t FactRollups::resolutionMs(Resolution resolution)
+{
+    switch (resolution) {
+    case Resolution1s:      return 1000;
+    case Resolution10s:     return 10000;
+    case Resolution1min:    return 60000;
+    default:                return 1000;
+    }
+}
+
+bool FactRollups::parseResolution(const std::string &text, Resolution &resolution)
+{
+    if (text == "1s") {
+        resolution = Resolution1s;
+    } else if (text == "10s") {
+        resolution = Resolution10s;
+    } else if (text == "1m") {
+        resolution = Resolution1min;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void FactRollups::addSample(const Fact *fact, double value, int64_t timestampMs)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto &series = _series[fact];
+    if (!series) {
+        series = std::make_unique<Series>();
+        for (int resolution = 0; resolution < ResolutionCount; resolution++) {
+            series->rings[resolution].resize(_retention[resolution]);
+        }
+    }
+
+    for (int resolution = 0; resolution < ResolutionCount; resolution++) {
+        std::vector<Slot> &ring = series->rings[resolution];
+        int64_t bucketIndex = timestampMs / resolutionMs(static_cast<Resolution>(resolution));
+        Slot &slot = ring[static_cast<size_t>(bucketIndex % static_cast<int64_t>(ring.size()))];
+
+        if (slot.bucketIndex != bucketIndex) {
+            slot.bucketIndex = bucketIndex;
+            slot.min = value;
+            slot.max = value;
+            slot.sum = 0.0;
+            slot.count = 0;
+        }
+        slot.min = std::min(slot.min, value);
+        slot.max = std::max(slot.max, value);
+        slot.sum += value;
+        slot.last = value;
+        slot.count++;
+
+        series->newestBucketIndex[resolution] = std::max(series->newestBucketIndex[resolution], bucketIndex);
+    }
+}
+
+void FactRollups::_onFactPublished(const Fact *fact)
+{
+    if (fact->type() == FactMetaData::valueTypeString || fact->type() == FactMetaData::valueTypeCustom) {
+        return;
+    }
+
+    double value = 0.0;
+    bool isNumeric = std::visit([&value](const auto &held) {
+        using Held = std::decay_t<decltype(held)>;
+        if constexpr (std::is_arithmetic_v<Held>) {
+            value = static_cast<double>(held);
+            return true;
+        } else {
+            return false;
+        }
+    }, fact->rawValue());
+    if (!isNumeric || std::isnan(value)) {
+        return;
+    }
+
+    int64_t nowMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    addSample(fact, value, nowMs);
+}
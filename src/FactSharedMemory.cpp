@@ -0,0 +1,378 @@
+#include "FactSharedMemory.h"
+#include "FactGroup.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <iostream>
+#include <set>
+#include <type_traits>
+#include <algorithm>
+
+FactSharedMemoryPublisher::~FactSharedMemoryPublisher()
+{
+    detach();
+}
+
+bool FactSharedMemoryPublisher::attach(FactGroup *rootGroup, const std::string &segmentName)
+{
+    if (!rootGroup) {
+        return false;
+    }
+
+    detach();
+
+    // Flatten the tree into groups of facts. Sub groups are collected first so facts which are also
+    // re-registered on the root (the Vehicle does this for the "vehicle" group) keep their group path.
+    std::vector<std::pair<std::string, std::vector<std::pair<const Fact*, std::string>>>> groups;
+    std::vector<std::pair<const Fact*, std::string>> aliases;
+    std::set<const Fact*> seenFacts;
+
+    std::vector<std::pair<FactGroup*, std::string>> pending;
+    for (const auto& pair : rootGroup->factGroups()) {
+        pending.emplace_back(pair.second.get(), pair.first);
+    }
+    pending.emplace_back(rootGroup, rootGroup->objectName());
+
+    for (const auto& [group, groupName] : pending) {
+        std::vector<std::pair<const Fact*, std::string>> facts;
+        _collectGroup(group, groupName, facts);
+
+        std::vector<std::pair<const Fact*, std::string>> uniqueFacts;
+        for (const auto& fact : facts) {
+            if (seenFacts.insert(fact.first).second) {
+                uniqueFacts.push_back(fact);
+            } else {
+                aliases.push_back(fact);
+            }
+        }
+        // Facts of a group in name order, GROUP queries list them that way
+        std::sort(uniqueFacts.begin(), uniqueFacts.end(),
+                  [](const auto& a, const auto& b) { return a.second < b.second; });
+        if (!uniqueFacts.empty()) {
+            groups.emplace_back(groupName, std::move(uniqueFacts));
+        }
+    }
+
+    // Compute the layout
+    size_t factCount = 0;
+    for (const auto& group : groups) {
+        factCount += group.second.size();
+    }
+
+    const uint32_t groupTableOffset = sizeof(FactShmHeader);
+    const uint32_t factTableOffset = groupTableOffset + static_cast<uint32_t>(groups.size() * sizeof(FactShmGroupEntry));
+    const uint32_t valueAreaOffset = factTableOffset + static_cast<uint32_t>(factCount * sizeof(FactShmFactEntry));
+
+    uint32_t valueOffset = valueAreaOffset;
+    std::vector<FactShmFactEntry> factEntries;
+    factEntries.reserve(factCount);
+    for (size_t groupIndex = 0; groupIndex < groups.size(); groupIndex++) {
+        _groupNames.push_back(groups[groupIndex].first);
+        for (const auto& [fact, path] : groups[groupIndex].second) {
+            bool isString = fact->type() == FactMetaData::valueTypeString || fact->type() == FactMetaData::valueTypeCustom;
+
+            Slot slot;
+            slot.index = static_cast<uint32_t>(_facts.size());
+            slot.groupIndex = static_cast<uint32_t>(groupIndex);
+            slot.valueOffset = valueOffset;
+            slot.valueSize = static_cast<uint32_t>(isString ? kFactShmStringSlotSize : kFactShmNumericSlotSize);
+            slot.type = fact->type();
+            _slots[fact] = slot;
+            _facts.push_back(fact);
+            _decimalPlaces.push_back(fact->decimalPlaces());
+            _factNames.push_back(groups[groupIndex].first.empty() ? path : path.substr(groups[groupIndex].first.size() + 1));
+            _pathToIndex[path] = static_cast<int>(slot.index);
+            valueOffset += slot.valueSize;
+
+            FactShmFactEntry entry{};
+            strncpy(entry.path, path.c_str(), sizeof(entry.path) - 1);
+            entry.valueOffset = slot.valueOffset;
+            entry.valueSize = slot.valueSize;
+            entry.groupIndex = static_cast<uint16_t>(groupIndex);
+            entry.type = static_cast<uint8_t>(slot.type);
+            factEntries.push_back(entry);
+        }
+    }
+    _segmentSize = valueOffset;
+    for (const auto& [fact, path] : aliases) {
+        _pathToIndex.emplace(path, static_cast<int>(_slots[fact].index));
+    }
+
+    void *mapped = segmentName.empty() ? _createSnapshot() : _createSegment(segmentName);
+    if (!mapped) {
+        detach();
+        return false;
+    }
+
+    // Write tables. The magic goes in last so readers never see a half initialized header.
+    uint8_t *segment = static_cast<uint8_t*>(mapped);
+    memset(segment, 0, _segmentSize);
+
+    auto *header = reinterpret_cast<FactShmHeader*>(segment);
+    header->schemaVersion = kFactShmSchemaVersion;
+    header->headerSize = sizeof(FactShmHeader);
+    header->totalSize = static_cast<uint32_t>(_segmentSize);
+    header->groupCount = static_cast<uint32_t>(groups.size());
+    header->factCount = static_cast<uint32_t>(factCount);
+    header->groupTableOffset = groupTableOffset;
+    header->factTableOffset = factTableOffset;
+    header->valueAreaOffset = valueAreaOffset;
+
+    auto *groupTable = reinterpret_cast<FactShmGroupEntry*>(segment + groupTableOffset);
+    uint32_t firstFact = 0;
+    for (size_t i = 0; i < groups.size(); i++) {
+        groupTable[i].firstFact = firstFact;
+        groupTable[i].factCount = static_cast<uint32_t>(groups[i].second.size());
+        strncpy(groupTable[i].name, groups[i].first.c_str(), sizeof(groupTable[i].name) - 1);
+        firstFact += groupTable[i].factCount;
+    }
+    memcpy(segment + factTableOffset, factEntries.data(), factEntries.size() * sizeof(FactShmFactEntry));
+
+    for (const auto& [fact, slot] : _slots) {
+        _storeValue(segment, slot, fact->rawValue());
+    }
+
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = kFactShmMagic;
+    _segment = segment;
+
+    // Listeners go in last: the listener lock orders the layout writes above before the first _publish
+    for (const auto& pair : pending) {
+        int listenerId = pair.first->addFactPublishedListener([this](const FactGroup*, const Fact *fact) {
+            _publish(fact);
+        });
+        _listeners.emplace_back(pair.first, listenerId);
+    }
+
+    if (!segmentName.empty()) {
+        std::cout << "Publishing " << factCount << " facts in " << groups.size() << " groups to shared memory "
+                  << segmentName << " (" << _segmentSize << " bytes)" << std::endl;
+    }
+    return true;
+}
+
+void FactSharedMemoryPublisher::detach()
+{
+    for (const auto& [group, listenerId] : _listeners) {
+        group->removeFactPublishedListener(listenerId);
+    }
+    _listeners.clear();
+
+    if (_segment) {
+        munmap(_segment, _segmentSize);
+        _segment = nullptr;
+    }
+    if (_fd >= 0) {
+        close(_fd);
+        _fd = -1;
+    }
+    if (!_segmentName.empty()) {
+        shm_unlink(_segmentName.c_str());
+        _segmentName.clear();
+    }
+
+    _slots.clear();
+    _groupNames.clear();
+    _facts.clear();
+    _decimalPlaces.clear();
+    _factNames.clear();
+    _pathToIndex.clear();
+    _segmentSize = 0;
+}
+
+int FactSharedMemoryPublisher::factIndex(const std::string &path) const
+{
+    auto it = _pathToIndex.find(path);
+    return it == _pathToIndex.end() ? -1 : it->second;
+}
+
+const Fact* FactSharedMemoryPublisher::fact(int index) const
+{
+    return index >= 0 && static_cast<size_t>(index) < _facts.size() ? _facts[index] : nullptr;
+}
+
+int FactSharedMemoryPublisher::decimalPlaces(int index) const
+{
+    return index >= 0 && static_cast<size_t>(index) < _decimalPlaces.size() ? _decimalPlaces[index] : -1;
+}
+
+const std::string& FactSharedMemoryPublisher::factName(int index) const
+{
+    static const std::string empty;
+    return index >= 0 && static_cast<size_t>(index) < _factNames.size() ? _factNames[index] : empty;
+}
+
+bool FactSharedMemoryPublisher::readValue(int index, Fact::ValueVariant_t &value) const
+{
+    if (!_segment || index < 0 || static_cast<size_t>(index) >= _facts.size()) {
+        return false;
+    }
+
+    const auto *header = reinterpret_cast<const FactShmHeader*>(_segment);
+    const FactShmFactEntry &entry = reinterpret_cast<const FactShmFactEntry*>(_segment + header->factTableOffset)[index];
+    const FactShmGroupEntry &group = reinterpret_cast<const FactShmGroupEntry*>(_segment + header->groupTableOffset)[entry.groupIndex];
+
+    uint8_t raw[kFactShmStringSlotSize];
+    uint32_t before;
+    do {
+        before = group.sequence.load(std::memory_order_acquire);
+        memcpy(raw, _segment + entry.valueOffset, entry.valueSize);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((before & 1) || before != group.sequence.load(std::memory_order_relaxed));
+
+    value = _loadValue(raw, entry);
+    return true;
+}
+
+void* FactSharedMemoryPublisher::_createSegment(const std::string &segmentName)
+{
+    _fd = shm_open(segmentName.c_str(), O_CREAT | O_RDWR, 0644);
+    if (_fd < 0) {
+        std::cerr << "Failed to create shared memory segment " << segmentName << ": " << strerror(errno) << std::endl;
+        return nullptr;
+    }
+    // From here on the segment exists, detach() unlinks it on failure
+    _segmentName = segmentName;
+    if (ftruncate(_fd, static_cast<off_t>(_segmentSize)) < 0) {
+        std::cerr << "Failed to size shared memory segment " << segmentName << ": " << strerror(errno) << std::endl;
+        return nullptr;
+    }
+    void *mapped = mmap(nullptr, _segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Failed to map shared memory segment " << segmentName << ": " << strerror(errno) << std::endl;
+        return nullptr;
+    }
+    return mapped;
+}
+
+void* FactSharedMemoryPublisher::_createSnapshot()
+{
+    void *mapped = mmap(nullptr, _segmentSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Failed to allocate fact snapshot: " << strerror(errno) << std::endl;
+        return nullptr;
+    }
+    return mapped;
+}
+
+void FactSharedMemoryPublisher::_collectGroup(FactGroup *group, const std::string &groupName, std::vector<std::pair<const Fact*, std::string>> &facts)
+{
+    for (const auto& factName : group->factNames()) {
+        auto fact = group->getFact(factName);
+        if (fact) {
+            facts.emplace_back(fact.get(), groupName.empty() ? factName : groupName + "." + factName);
+        }
+    }
+}
+
+void FactSharedMemoryPublisher::_publish(const Fact *fact)
+{
+    if (!_segment) {
+        return;
+    }
+
+    auto it = _slots.find(fact);
+    if (it == _slots.end()) {
+        return;
+    }
+    const Slot &slot = it->second;
+
+    auto *groupTable = reinterpret_cast<FactShmGroupEntry*>(_segment + sizeof(FactShmHeader));
+    auto &sequence = groupTable[slot.groupIndex].sequence;
+
+    uint32_t start = sequence.load(std::memory_order_relaxed);
+    sequence.store(start + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    _storeValue(_segment, slot, fact->rawValue());
+    sequence.store(start + 2, std::memory_order_release);
+
+    reinterpret_cast<FactShmHeader*>(_segment)->publishCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FactSharedMemoryPublisher::_storeValue(uint8_t *segment, const Slot &slot, const Fact::ValueVariant_t &value)
+{
+    uint8_t *destination = segment + slot.valueOffset;
+
+    if (slot.valueSize == kFactShmStringSlotSize) {
+        memset(destination, 0, kFactShmStringSlotSize);
+        if (std::holds_alternative<std::string>(value)) {
+            const std::string &text = std::get<std::string>(value);
+            memcpy(destination, text.data(), std::min(text.size(), kFactShmStringSlotSize - 1));
+        }
+        return;
+    }
+
+    // Store in the slot type declared by the layout, whatever numeric alternative the variant holds
+    std::visit([&](const auto &held) {
+        using Held = std::decay_t<decltype(held)>;
+        if constexpr (std::is_arithmetic_v<Held>) {
+            switch (slot.type) {
+            case FactMetaData::valueTypeUint8:  _write(destination, static_cast<uint8_t>(held)); break;
+            case FactMetaData::valueTypeInt8:   _write(destination, static_cast<int8_t>(held)); break;
+            case FactMetaData::valueTypeUint16: _write(destination, static_cast<uint16_t>(held)); break;
+            case FactMetaData::valueTypeInt16:  _write(destination, static_cast<int16_t>(held)); break;
+            case FactMetaData::valueTypeUint32: _write(destination, static_cast<uint32_t>(held)); break;
+            case FactMetaData::valueTypeInt32:  _write(destination, static_cast<int32_t>(held)); break;
+            case FactMetaData::valueTypeUint64: _write(destination, static_cast<uint64_t>(held)); break;
+            case FactMetaData::valueTypeInt64:  _write(destination, static_cast<int64_t>(held)); break;
+            case FactMetaData::valueTypeFloat:  _write(destination, static_cast<float>(held)); break;
+            case FactMetaData::valueTypeBool:   _write(destination, static_cast<uint8_t>(held ? 1 : 0)); break;
+            default:                            _write(destination, static_cast<double>(held)); break;
+            }
+        }
+    }, value);
+}
+
+bool FactSharedMemoryPublisher::readGroup(const std::string &groupName, std::vector<std::pair<int, Fact::ValueVariant_t>> &values) const
+{
+    auto name = std::find(_groupNames.begin(), _groupNames.end(), groupName);
+    if (!_segment || name == _groupNames.end()) {
+        return false;
+    }
+
+    const auto *header = reinterpret_cast<const FactShmHeader*>(_segment);
+    const FactShmFactEntry *factTable = reinterpret_cast<const FactShmFactEntry*>(_segment + header->factTableOffset);
+    const FactShmGroupEntry &group = reinterpret_cast<const FactShmGroupEntry*>(_segment + header->groupTableOffset)[name - _groupNames.begin()];
+
+    // The slots of a group are contiguous, copy them all at once
+    const FactShmFactEntry &firstEntry = factTable[group.firstFact];
+    const FactShmFactEntry &lastEntry = factTable[group.firstFact + group.factCount - 1];
+    const uint32_t first = firstEntry.valueOffset;
+    std::vector<uint8_t> raw(lastEntry.valueOffset + lastEntry.valueSize - first);
+    uint32_t before;
+    do {
+        before = group.sequence.load(std::memory_order_acquire);
+        memcpy(raw.data(), _segment + first, raw.size());
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((before & 1) || before != group.sequence.load(std::memory_order_relaxed));
+
+    for (uint32_t i = group.firstFact; i < group.firstFact + group.factCount; i++) {
+        values.emplace_back(static_cast<int>(i), _loadValue(raw.data() + factTable[i].valueOffset - first, factTable[i]));
+    }
+    return true;
+}
+
+Fact::ValueVariant_t FactSharedMemoryPublisher::_loadValue(const uint8_t *source, const FactShmFactEntry &entry)
+{
+    if (entry.valueSize == kFactShmStringSlotSize) {
+        const char *text = reinterpret_cast<const char*>(source);
+        return std::string(text, strnlen(text, kFactShmStringSlotSize));
+    }
+
+    switch (static_cast<FactMetaData::ValueType_t>(entry.type)) {
+    case FactMetaData::valueTypeUint8:  return _read<uint8_t>(source);
+    case FactMetaData::valueTypeInt8:   return _read<int8_t>(source);
+    case FactMetaData::valueTypeUint16: return _read<uint16_t>(source);
+    case FactMetaData::valueTypeInt16:  return _read<int16_t>(source);
+    case FactMetaData::valueTypeUint32: return _read<uint32_t>(source);
+    case FactMetaData::valueTypeInt32:  return _read<int32_t>(source);
+    case FactMetaData::valueTypeUint64: return _read<uint64_t>(source);
+    case FactMetaData::valueTypeInt64:  return _read<int64_t>(source);
+    case FactMetaData::valueTypeFloat:  return _read<float>(source);
+    case FactMetaData::valueTypeBool:   return _read<uint8_t>(source) != 0;
+    default:                            return _read<double>(source);
+    }
+}
@@ -0,0 +1,345 @@
+#include "FactSubscriptionManager.h"
+#include "FactGroup.h"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+FactSubscriptionManager::~FactSubscriptionManager()
+{
+    detach();
+}
+
+void FactSubscriptionManager::attach(FactGroup *rootGroup, int systemId)
+{
+    if (!rootGroup) {
+        return;
+    }
+
+    {
+        std::unique_lock<std::shared_mutex> lock(_subscribersMutex);
+        _rootGroups[systemId] = rootGroup;
+        if (_defaultSystemId < 0) {
+            _defaultSystemId = systemId;
+        }
+    }
+
+    std::vector<FactGroup*> groups;
+    groups.push_back(rootGroup);
+    for (const auto& pair : rootGroup->factGroups()) {
+        groups.push_back(pair.second.get());
+    }
+    for (FactGroup *group : groups) {
+        int listenerId = group->addFactPublishedListener([this](const FactGroup*, const Fact *fact) {
+            _onFactPublished(fact);
+        });
+        _listeners.emplace_back(group, listenerId);
+    }
+}
+
+void FactSubscriptionManager::detach()
+{
+    for (const auto& [group, listenerId] : _listeners) {
+        group->removeFactPublishedListener(listenerId);
+    }
+    _listeners.clear();
+
+    std::unique_lock<std::shared_mutex> lock(_subscribersMutex);
+    _rootGroups.clear();
+    _defaultSystemId = -1;
+}
+
+void FactSubscriptionManager::splitPath(const std::string &path, int &systemId, std::string &factPath)
+{
+    systemId = -1;
+    factPath = path;
+
+    const size_t dot = path.find('.');
+    if (dot == 0 || dot == std::string::npos || dot > 3 ||
+        !std::all_of(path.begin(), path.begin() + static_cast<long>(dot), [](char c) { return c >= '0' && c <= '9'; })) {
+        return;
+    }
+    const int prefix = std::stoi(path.substr(0, dot));
+    if (prefix <= 255) {
+        systemId = prefix;
+        factPath = path.substr(dot + 1);
+    }
+}
+
+int FactSubscriptionManager::subscribe(const SubscriberOptions &options)
+{
+    auto subscriber = std::make_shared<Subscriber>();
+    subscriber->options = options;
+    subscriber->options.queueCapacity = std::max<size_t>(options.queueCapacity, 1);
+    if (options.maxRateHz > 0.0) {
+        subscriber->minInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options.maxRateHz));
+    }
+
+    std::unique_lock<std::shared_mutex> lock(_subscribersMutex);
+
+    std::vector<std::pair<const Fact*, size_t>> resolved;
+    for (const auto& path : options.paths) {
+        auto fact = _resolve(path);
+        if (!fact) {
+            continue;
+        }
+        FactState state;
+        state.path = path;
+        subscriber->facts.push_back(std::move(state));
+        resolved.emplace_back(fact.get(), subscriber->facts.size() - 1);
+    }
+    if (resolved.empty()) {
+        return -1;
+    }
+
+    int subscriberId = _nextSubscriberId++;
+    for (const auto& [fact, factIndex] : resolved) {
+        _interest[fact].emplace_back(subscriber.get(), factIndex);
+    }
+    _subscribers[subscriberId] = std::move(subscriber);
+    return subscriberId;
+}
+
+void FactSubscriptionManager::unsubscribe(int subscriberId)
+{
+    std::unique_lock<std::shared_mutex> lock(_subscribersMutex);
+    auto it = _subscribers.find(subscriberId);
+    if (it == _subscribers.end()) {
+        return;
+    }
+
+    Subscriber *subscriber = it->second.get();
+    for (auto interestIt = _interest.begin(); interestIt != _interest.end(); ) {
+        auto &entries = interestIt->second;
+        entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                     [subscriber](const auto& entry) { return entry.first == subscriber; }),
+                      entries.end());
+        interestIt = entries.empty() ? _interest.erase(interestIt) : std::next(interestIt);
+    }
+
+    // Wake a consumer blocked in waitForUpdates, it holds its own reference
+    {
+        std::lock_guard<std::mutex> subscriberLock(subscriber->mutex);
+        subscriber->removed = true;
+    }
+    subscriber->updatesAvailable.notify_all();
+    _subscribers.erase(it);
+}
+
+size_t FactSubscriptionManager::takeUpdates(int subscriberId, std::vector<FactUpdate> &updates, size_t maxUpdates)
+{
+    auto subscriber = _subscriber(subscriberId);
+    if (!subscriber) {
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(subscriber->mutex);
+    auto now = Clock::now();
+    _flushPending(*subscriber, now);
+
+    size_t count = 0;
+    while (count < maxUpdates && !subscriber->queue.empty()) {
+        QueueEntry &entry = subscriber->queue.front();
+        FactState &state = subscriber->facts[entry.factIndex];
+        if (state.queued && state.queuedSequence == subscriber->headSequence) {
+            state.queued = false;
+        }
+
+        uint64_t lagMs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(now - entry.timestamp).count());
+        subscriber->stats.maxLagMs = std::max(subscriber->stats.maxLagMs, lagMs);
+
+        updates.push_back(FactUpdate{state.path, std::move(entry.value), entry.timestamp});
+        subscriber->queue.pop_front();
+        subscriber->headSequence++;
+        count++;
+    }
+    subscriber->stats.delivered += count;
+    return count;
+}
+
+bool FactSubscriptionManager::waitForUpdates(int subscriberId, std::chrono::milliseconds timeout)
+{
+    auto subscriber = _subscriber(subscriberId);
+    if (!subscriber) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(subscriber->mutex);
+    auto deadline = Clock::now() + timeout;
+    while (true) {
+        _flushPending(*subscriber, Clock::now());
+        if (!subscriber->queue.empty()) {
+            return true;
+        }
+        if (subscriber->removed) {
+            return false;
+        }
+
+        // Pending rate limited values become due without a new publish, don't sleep past them
+        auto wakeup = deadline;
+        for (const auto& state : subscriber->facts) {
+            if (state.pending) {
+                wakeup = std::min(wakeup, state.lastAccepted + subscriber->minInterval);
+            }
+        }
+        if (subscriber->updatesAvailable.wait_until(lock, wakeup) == std::cv_status::timeout && Clock::now() >= deadline) {
+            _flushPending(*subscriber, Clock::now());
+            return !subscriber->queue.empty();
+        }
+    }
+}
+
+bool FactSubscriptionManager::subscriberStats(int subscriberId, SubscriberStats &stats) const
+{
+    auto subscriber = _subscriber(subscriberId);
+    if (!subscriber) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(subscriber->mutex);
+    stats = subscriber->stats;
+    stats.queueDepth = subscriber->queue.size();
+    stats.lagMs = 0;
+    if (!subscriber->queue.empty()) {
+        stats.lagMs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            Clock::now() - subscriber->queue.front().timestamp).count());
+    }
+    return true;
+}
+
+void FactSubscriptionManager::_onFactPublished(const Fact *fact)
+{
+    std::shared_lock<std::shared_mutex> lock(_subscribersMutex);
+    auto it = _interest.find(fact);
+    if (it == _interest.end()) {
+        return;
+    }
+
+    const Fact::ValueVariant_t value = fact->rawValue();
+    const auto now = Clock::now();
+    for (const auto& [subscriber, factIndex] : it->second) {
+        _offer(*subscriber, factIndex, value, now);
+    }
+}
+
+void FactSubscriptionManager::_offer(Subscriber &subscriber, size_t factIndex, const Fact::ValueVariant_t &value, Clock::time_point now)
+{
+    std::lock_guard<std::mutex> lock(subscriber.mutex);
+    FactState &state = subscriber.facts[factIndex];
+
+    double numeric = 0.0;
+    bool isNumeric = _numericValue(value, numeric);
+    if (state.hasDelivered && isNumeric && subscriber.options.deadband > 0.0 &&
+        std::fabs(numeric - state.lastValue) < subscriber.options.deadband) {
+        // The fact is back within the deadband of the value last accepted, a rate limited value still
+        // waiting is older than this one and must not be delivered after it
+        subscriber.stats.filtered++;
+        state.pending = false;
+        return;
+    }
+
+    if (state.hasDelivered && now - state.lastAccepted < subscriber.minInterval) {
+        // Keep the newest value, it is queued once the interval expires
+        subscriber.stats.rateLimited++;
+        state.pending = true;
+        state.pendingValue = value;
+        state.pendingTimestamp = now;
+        return;
+    }
+
+    state.pending = false;
+    state.hasDelivered = true;
+    state.lastAccepted = now;
+    if (isNumeric) {
+        state.lastValue = numeric;
+    }
+    bool wasEmpty = subscriber.queue.empty();
+    _enqueue(subscriber, factIndex, value, now);
+    subscriber.updatesAvailable.notify_one();
+    if (wasEmpty && subscriber.options.updatesAvailableCallback) {
+        subscriber.options.updatesAvailableCallback();
+    }
+}
+
+void FactSubscriptionManager::_enqueue(Subscriber &subscriber, size_t factIndex, const Fact::ValueVariant_t &value, Clock::time_point timestamp)
+{
+    FactState &state = subscriber.facts[factIndex];
+
+    if (subscriber.options.overflowPolicy == Coalesce && state.queued) {
+        QueueEntry &entry = subscriber.queue[state.queuedSequence - subscriber.headSequence];
+        entry.value = value;
+        subscriber.stats.coalesced++;
+        return;
+    }
+
+    if (subscriber.queue.size() >= subscriber.options.queueCapacity) {
+        FactState &oldestState = subscriber.facts[subscriber.queue.front().factIndex];
+        if (oldestState.queued && oldestState.queuedSequence == subscriber.headSequence) {
+            oldestState.queued = false;
+        }
+        subscriber.queue.pop_front();
+        subscriber.headSequence++;
+        subscriber.stats.dropped++;
+    }
+
+    state.queued = true;
+    state.queuedSequence = subscriber.headSequence + subscriber.queue.size();
+    subscriber.queue.push_back(QueueEntry{factIndex, value, timestamp});
+    subscriber.stats.enqueued++;
+}
+
+void FactSubscriptionManager::_flushPending(Subscriber &subscriber, Clock::time_point now)
+{
+    for (size_t factIndex = 0; factIndex < subscriber.facts.size(); factIndex++) {
+        FactState &state = subscriber.facts[factIndex];
+        if (!state.pending || now - state.lastAccepted < subscriber.minInterval) {
+            continue;
+        }
+        state.pending = false;
+        state.lastAccepted = now;
+        double numeric = 0.0;
+        if (_numericValue(state.pendingValue, numeric)) {
+            state.lastValue = numeric;
+        }
+        _enqueue(subscriber, factIndex, state.pendingValue, state.pendingTimestamp);
+    }
+}
+
+std::shared_ptr<Fact> FactSubscriptionManager::_resolve(const std::string &path) const
+{
+    int systemId;
+    std::string factPath;
+    splitPath(path, systemId, factPath);
+    auto root = _rootGroups.find(systemId < 0 ? _defaultSystemId : systemId);
+
+    FactGroup *group = root == _rootGroups.end() ? nullptr : root->second;
+    size_t start = 0;
+    size_t dot;
+    while (group && (dot = factPath.find('.', start)) != std::string::npos) {
+        group = group->getFactGroup(factPath.substr(start, dot - start)).get();
+        start = dot + 1;
+    }
+    if (!group) {
+        return std::shared_ptr<Fact>();
+    }
+    return group->getFact(factPath.substr(start));
+}
+
+std::shared_ptr<FactSubscriptionManager::Subscriber> FactSubscriptionManager::_subscriber(int subscriberId) const
+{
+    std::shared_lock<std::shared_mutex> lock(_subscribersMutex);
+    auto it = _subscribers.find(subscriberId);
+    return it == _subscribers.end() ? std::shared_ptr<Subscriber>() : it->second;
+}
+
+bool FactSubscriptionManager::_numericValue(const Fact::ValueVariant_t &value, double &result)
+{
+    return std::visit([&result](const auto &held) {
+        using Held = std::decay_t<decltype(held)>;
+        if constexpr (std::is_arithmetic_v<Held>) {
+            result = static_cast<double>(held);
+            return true;
+        } else {
+            return false;
+        }
+    }, value);
+}
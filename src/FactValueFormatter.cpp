@@ -0,0 +1,65 @@
+#include "FactValueFormatter.h"
+#include <charconv>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+
+constexpr int kStreamDefaultPrecision = 6;
+
+char* copy(char *first, char *last, const char *text, size_t length)
+{
+    if (static_cast<size_t>(last - first) < length) {
+        return nullptr;
+    }
+    memcpy(first, text, length);
+    return first + length;
+}
+
+} // namespace
+
+char* FactValueFormatter::format(char *first, char *last, const ValueVariant_t &value, int decimalPlaces)
+{
+    if (decimalPlaces < 0) {
+        decimalPlaces = kStreamDefaultPrecision;
+    } else if (decimalPlaces > kMaxDecimalPlaces) {
+        decimalPlaces = kMaxDecimalPlaces;
+    }
+
+    return std::visit([first, last, decimalPlaces](const auto &alternative) -> char* {
+        using T = std::decay_t<decltype(alternative)>;
+        if constexpr (std::is_same_v<T, std::string>) {
+            return copy(first, last, alternative.data(), alternative.size());
+        } else if constexpr (std::is_same_v<T, bool>) {
+            return alternative ? copy(first, last, "true", 4) : copy(first, last, "false", 5);
+        } else if constexpr (std::is_floating_point_v<T>) {
+            const std::to_chars_result result = std::to_chars(first, last, alternative, std::chars_format::fixed, decimalPlaces);
+            return result.ec == std::errc() ? result.ptr : nullptr;
+        } else {
+            const std::to_chars_result result = std::to_chars(first, last, alternative);
+            return result.ec == std::errc() ? result.ptr : nullptr;
+        }
+    }, value);
+}
+
+std::string FactValueFormatter::toString(const ValueVariant_t &value, int decimalPlaces)
+{
+    if (const std::string *text = std::get_if<std::string>(&value)) {
+        return *text;
+    }
+    char buffer[kBufferSize];
+    const char *end = format(buffer, buffer + sizeof(buffer), value, decimalPlaces);
+    return std::string(buffer, end ? end - buffer : 0);
+}
+
+void FactValueFormatter::append(std::string &out, const ValueVariant_t &value, int decimalPlaces)
+{
+    if (const std::string *text = std::get_if<std::string>(&value)) {
+        out += *text;
+        return;
+    }
+    char buffer[kBufferSize];
+    if (const char *end = format(buffer, buffer + sizeof(buffer), value, decimalPlaces)) {
+        out.append(buffer, end - buffer);
+    }
+}
@@ -0,0 +1,444 @@
+#include "LogDownloader.h"
+#include "Vehicle.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+LogDownloader::LogDownloader(Vehicle *vehicle)
+    : _vehicle(vehicle)
+{
+}
+
+LogDownloader::~LogDownloader()
+{
+    Scheduler::TaskId listTask;
+    Scheduler::TaskId stallTask;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _destroying = true;
+        listTask = _listTask;
+        stallTask = _stallTask;
+    }
+    Scheduler::instance().cancel(listTask);
+    Scheduler::instance().cancel(stallTask);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_download) {
+        _closeFile(false);
+        _download.reset();
+    }
+}
+
+void LogDownloader::requestLogList(LogListCallback callback)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_destroying) {
+        return;
+    }
+
+    _listCallback = std::move(callback);
+    _entries.clear();
+    _expectedEntries = 0;
+    _listRetried = false;
+
+    mavlink_message_t message;
+    mavlink_msg_log_request_list_pack(255, MAV_COMP_ID_MISSIONPLANNER, &message,
+                                      _vehicle->systemId(), _vehicle->componentId(), 0, 0xFFFF);
+    _vehicle->sendMessage(message);
+
+    const uint64_t generation = ++_listGeneration;
+    _listTask = Scheduler::instance().schedule(std::chrono::milliseconds(kListTimeoutMsecs),
+                                               [this, generation]() { _listTimeout(generation); });
+}
+
+bool LogDownloader::downloadLog(const LogEntry &entry, const std::string &path, CompletionCallback completion,
+                                ProgressCallback progress)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_destroying || _download) {
+        return false;
+    }
+
+    auto download = std::make_unique<Download>();
+    download->entry = entry;
+    download->path = path;
+    download->completion = std::move(completion);
+    download->progress = std::move(progress);
+    download->chunkCount = (entry.size + kChunkSize - 1) / kChunkSize;
+    download->bitmap.assign((download->chunkCount + 63) / 64, 0);
+    download->startTime = std::chrono::steady_clock::now();
+    download->lastDataTime = download->startTime;
+
+    // Preallocated so chunks can be placed wherever they belong as they arrive
+    download->fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (download->fd < 0) {
+        LOG_ERROR("LogDownload", "Can't create {}: {}", path, strerror(errno));
+        return false;
+    }
+    if (entry.size > 0) {
+        void *map = MAP_FAILED;
+        if (ftruncate(download->fd, entry.size) == 0) {
+            map = mmap(nullptr, entry.size, PROT_READ | PROT_WRITE, MAP_SHARED, download->fd, 0);
+        }
+        if (map == MAP_FAILED) {
+            LOG_ERROR("LogDownload", "Can't allocate {} bytes for {}: {}", entry.size, path, strerror(errno));
+            close(download->fd);
+            unlink(path.c_str());
+            return false;
+        }
+        download->map = static_cast<uint8_t*>(map);
+    }
+
+    _download = std::move(download);
+    _downloadGeneration++;
+    LOG_INFO("LogDownload", "Downloading log {} ({} bytes) from sysid={} to {}", entry.id, entry.size, _vehicle->systemId(), path);
+
+    if (_download->chunkCount == 0) {
+        Completion done = _finish(true, std::string());
+        lock.unlock();
+        if (done.callback) {
+            done.callback(done.result);
+        }
+        return true;
+    }
+
+    _nextRequest();
+    _scheduleStallCheck();
+    return true;
+}
+
+void LogDownloader::cancelDownload()
+{
+    Completion done;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_download) {
+            return;
+        }
+        done = _finish(false, "Cancelled");
+    }
+    if (done.callback) {
+        done.callback(done.result);
+    }
+}
+
+bool LogDownloader::downloading() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _download != nullptr;
+}
+
+void LogDownloader::mavlinkMessageReceived(const mavlink_message_t &message)
+{
+    switch (message.msgid) {
+    case MAVLINK_MSG_ID_LOG_ENTRY:
+        _handleLogEntry(message);
+        break;
+    case MAVLINK_MSG_ID_LOG_DATA:
+        _handleLogData(message);
+        break;
+    default:
+        break;
+    }
+}
+
+void LogDownloader::_handleLogEntry(const mavlink_message_t &message)
+{
+    mavlink_log_entry_t logEntry;
+    mavlink_msg_log_entry_decode(&message, &logEntry);
+
+    LogListCallback callback;
+    std::vector<LogEntry> entries;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_listCallback) {
+            return;
+        }
+
+        _expectedEntries = logEntry.num_logs;
+        if (logEntry.num_logs > 0) {
+            LogEntry &entry = _entries[logEntry.id];
+            entry.id = logEntry.id;
+            entry.size = logEntry.size;
+            entry.timeUtc = logEntry.time_utc;
+        }
+        if (_entries.size() < _expectedEntries) {
+            return;
+        }
+
+        for (const auto& [id, entry] : _entries) {
+            entries.push_back(entry);
+        }
+        callback = std::move(_listCallback);
+        _listCallback = LogListCallback();
+        _listGeneration++;
+    }
+    callback(true, entries);
+}
+
+void LogDownloader::_handleLogData(const mavlink_message_t &message)
+{
+    mavlink_log_data_t logData;
+    mavlink_msg_log_data_decode(&message, &logData);
+
+    Completion done;
+    ProgressCallback progress;
+    uint32_t bytesReceived = 0;
+    uint32_t size = 0;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        Download *download = _download.get();
+        if (!download || logData.id != download->entry.id || logData.count == 0 || logData.ofs % kChunkSize != 0) {
+            return;
+        }
+        const uint32_t chunk = logData.ofs / kChunkSize;
+        if (chunk >= download->chunkCount) {
+            return;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (download->awaitingFirstData) {
+            const double sample = std::chrono::duration<double, std::milli>(now - download->requestTime).count();
+            download->roundTripMsecs = download->roundTripMsecs > 0.0 ? 0.8 * download->roundTripMsecs + 0.2 * sample : sample;
+            download->awaitingFirstData = false;
+        } else {
+            const double sample = std::chrono::duration<double, std::milli>(now - download->lastDataTime).count();
+            download->chunkIntervalMsecs = 0.9 * download->chunkIntervalMsecs + 0.1 * sample;
+        }
+        download->lastDataTime = now;
+        download->dataSinceCheck = true;
+
+        if (!_hasChunk(chunk)) {
+            const uint32_t count = std::min<uint32_t>(logData.count, download->entry.size - logData.ofs);
+            std::memcpy(download->map + logData.ofs, logData.data, count);
+            download->bitmap[chunk / 64] |= 1ull << (chunk % 64);
+            download->chunksReceived++;
+        }
+
+        if (download->chunksReceived == download->chunkCount) {
+            done = _finish(true, std::string());
+        } else {
+            if (chunk + 1 == download->requestEnd) {
+                // The vehicle is through with the request, keep it busy
+                _nextRequest();
+            }
+            if (download->progress && download->chunksReceived - download->lastProgressChunks >= kProgressChunks) {
+                download->lastProgressChunks = download->chunksReceived;
+                progress = download->progress;
+                bytesReceived = std::min(download->chunksReceived * kChunkSize, download->entry.size);
+                size = download->entry.size;
+            }
+        }
+    }
+
+    if (progress) {
+        progress(bytesReceived, size);
+    }
+    if (done.callback) {
+        done.callback(done.result);
+    }
+}
+
+void LogDownloader::_listTimeout(uint64_t generation)
+{
+    LogListCallback callback;
+    std::vector<LogEntry> entries;
+    bool success;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_destroying || generation != _listGeneration || !_listCallback) {
+            return;
+        }
+
+        if (_entries.empty() && !_listRetried) {
+            _listRetried = true;
+            mavlink_message_t message;
+            mavlink_msg_log_request_list_pack(255, MAV_COMP_ID_MISSIONPLANNER, &message,
+                                              _vehicle->systemId(), _vehicle->componentId(), 0, 0xFFFF);
+            _vehicle->sendMessage(message);
+            _listTask = Scheduler::instance().schedule(std::chrono::milliseconds(kListTimeoutMsecs),
+                                                       [this, generation]() { _listTimeout(generation); });
+            return;
+        }
+
+        LOG_WARNING("LogDownload", "Log list from sysid={} incomplete, {} of {} entries", _vehicle->systemId(), _entries.size(), _expectedEntries);
+        for (const auto& [id, entry] : _entries) {
+            entries.push_back(entry);
+        }
+        success = !_entries.empty() && _entries.size() >= _expectedEntries;
+        callback = std::move(_listCallback);
+        _listCallback = LogListCallback();
+    }
+    callback(success, entries);
+}
+
+void LogDownloader::_scheduleStallCheck()
+{
+    const uint64_t generation = _downloadGeneration;
+    _stallTask = Scheduler::instance().schedule(std::chrono::milliseconds(_stallMsecs()),
+                                                [this, generation]() { _stallCheck(generation); });
+}
+
+int LogDownloader::_stallMsecs() const
+{
+    const Download *download = _download.get();
+    if (download->roundTripMsecs <= 0.0) {
+        return kMaxStallMsecs;
+    }
+
+    // Long enough for a request to be answered and for a few chunks to be late
+    const double msecs = std::max(2.0 * download->roundTripMsecs, 8.0 * download->chunkIntervalMsecs);
+    return std::clamp(static_cast<int>(msecs), kMinStallMsecs, kMaxStallMsecs);
+}
+
+void LogDownloader::_stallCheck(uint64_t generation)
+{
+    Completion done;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        Download *download = _download.get();
+        if (_destroying || !download || generation != _downloadGeneration) {
+            return;
+        }
+
+        const auto sinceData = std::chrono::steady_clock::now() - download->lastDataTime;
+        if (download->dataSinceCheck) {
+            // Still arriving
+        } else if (sinceData > std::chrono::milliseconds(kNoDataTimeoutMsecs)) {
+            done = _finish(false, "No data from vehicle");
+        } else {
+            // Ask for what is still missing of the current request, or move on if nothing is
+            uint32_t first = download->requestFirst;
+            while (first < download->requestEnd && _hasChunk(first)) {
+                first++;
+            }
+            if (first < download->requestEnd) {
+                _sendRequest(first, download->requestEnd);
+            } else {
+                _nextRequest();
+            }
+        }
+
+        if (_download) {
+            download->dataSinceCheck = false;
+            _scheduleStallCheck();
+        }
+    }
+    if (done.callback) {
+        done.callback(done.result);
+    }
+}
+
+bool LogDownloader::_hasChunk(uint32_t chunk) const
+{
+    return (_download->bitmap[chunk / 64] >> (chunk % 64)) & 1;
+}
+
+bool LogDownloader::_nextRequest()
+{
+    Download *download = _download.get();
+
+    // Sweep through the file first, lost chunks stay behind as holes
+    if (!download->sweepDone) {
+        if (download->sweepCursor < download->chunkCount) {
+            const uint32_t first = download->sweepCursor;
+            download->sweepCursor = std::min(download->chunkCount, first + kWindowChunks);
+            _sendRequest(first, download->sweepCursor);
+            return true;
+        }
+        download->sweepDone = true;
+    }
+
+    // Then fill the holes, a few present chunks in between are cheaper than another round trip
+    uint32_t first = download->chunkCount;
+    for (size_t word = 0; word < download->bitmap.size(); word++) {
+        if (~download->bitmap[word] != 0) {
+            first = static_cast<uint32_t>(word * 64 + __builtin_ctzll(~download->bitmap[word]));
+            break;
+        }
+    }
+    if (first >= download->chunkCount) {
+        return false;
+    }
+
+    uint32_t lastMissing = first;
+    const uint32_t limit = std::min(download->chunkCount, first + kWindowChunks);
+    for (uint32_t chunk = first + 1; chunk < limit && chunk - lastMissing <= kMergeGapChunks; chunk++) {
+        if (!_hasChunk(chunk)) {
+            lastMissing = chunk;
+        }
+    }
+    _sendRequest(first, lastMissing + 1);
+    return true;
+}
+
+void LogDownloader::_sendRequest(uint32_t firstChunk, uint32_t endChunk)
+{
+    Download *download = _download.get();
+    download->requestFirst = firstChunk;
+    download->requestEnd = endChunk;
+    download->requests++;
+    download->requestTime = std::chrono::steady_clock::now();
+    download->awaitingFirstData = true;
+
+    const uint32_t offset = firstChunk * kChunkSize;
+    const uint32_t count = std::min(endChunk * kChunkSize, download->entry.size) - offset;
+
+    mavlink_message_t message;
+    mavlink_msg_log_request_data_pack(255, MAV_COMP_ID_MISSIONPLANNER, &message,
+                                      _vehicle->systemId(), _vehicle->componentId(), download->entry.id, offset, count);
+    _vehicle->sendMessage(message);
+}
+
+void LogDownloader::_sendRequestEnd()
+{
+    mavlink_message_t message;
+    mavlink_msg_log_request_end_pack(255, MAV_COMP_ID_MISSIONPLANNER, &message,
+                                     _vehicle->systemId(), _vehicle->componentId());
+    _vehicle->sendMessage(message);
+}
+
+LogDownloader::Completion LogDownloader::_finish(bool success, const std::string &error)
+{
+    Download *download = _download.get();
+
+    Completion done;
+    done.callback = download->completion;
+    done.result.success = success;
+    done.result.error = error;
+    done.result.bytes = std::min(download->chunksReceived * kChunkSize, download->entry.size);
+    done.result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - download->startTime).count();
+    done.result.requests = download->requests;
+
+    _sendRequestEnd();
+    _closeFile(success);
+
+    if (success) {
+        LOG_INFO("LogDownload", "Log {} complete, {} bytes in {:.2f}s ({:.1f} KB/s, {} requests)",
+                 download->entry.id, done.result.bytes, done.result.seconds, done.result.kilobytesPerSecond(), download->requests);
+    } else {
+        LOG_WARNING("LogDownload", "Log {} failed after {} bytes: {}", download->entry.id, done.result.bytes, error);
+    }
+
+    _download.reset();
+    return done;
+}
+
+void LogDownloader::_closeFile(bool success)
+{
+    Download *download = _download.get();
+    if (download->map) {
+        munmap(download->map, download->entry.size);
+        download->map = nullptr;
+    }
+    if (download->fd >= 0) {
+        close(download->fd);
+        download->fd = -1;
+    }
+    if (!success) {
+        unlink(download->path.c_str());
+    }
+}
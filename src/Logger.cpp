@@ -0,0 +1,256 @@
+#include "Logger.h"
+#include "AllocationCounter.h"
+#include "PipelineTrace.h"
+#include <chrono>
+#include <ctime>
+#include <cinttypes>
+#include <algorithm>
+
+Logger& Logger::instance()
+{
+    static Logger *logger = new Logger();
+    return *logger;
+}
+
+Logger::Logger()
+    : _ring(new Record[kRingSize])
+{
+    static_assert((kRingSize & (kRingSize - 1)) == 0, "Ring size must be a power of two");
+
+    for (size_t i = 0; i < kRingSize; i++) {
+        _ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    _running = true;
+    _writerThread = std::thread(&Logger::_writerThreadFunc, this);
+}
+
+Logger::~Logger()
+{
+    shutdown();
+}
+
+void Logger::setOutput(FILE *output)
+{
+    flush();
+    _output = output;
+}
+
+void Logger::flush()
+{
+    if (!_running) {
+        return;
+    }
+
+    uint64_t target = _writePosition.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(_wakeupMutex);
+    _wakeup.notify_one();
+    _flushed.wait_for(lock, std::chrono::seconds(2), [this, target]() {
+        return _flushedPosition.load(std::memory_order_acquire) >= target || !_running;
+    });
+}
+
+void Logger::shutdown()
+{
+    if (!_running) {
+        return;
+    }
+
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(_wakeupMutex);
+        _running = false;
+    }
+    _wakeup.notify_one();
+    if (_writerThread.joinable()) {
+        _writerThread.join();
+    }
+}
+
+const char* Logger::levelName(Level level)
+{
+    switch (level) {
+    case Trace:     return "TRACE";
+    case Debug:     return "DEBUG";
+    case Info:      return "INFO";
+    case Warning:   return "WARN";
+    case Error:     return "ERROR";
+    default:        return "?";
+    }
+}
+
+bool Logger::parseLevel(const std::string &text, Level &level)
+{
+    static const std::pair<const char*, Level> levels[] = {
+        {"trace", Trace}, {"debug", Debug}, {"info", Info}, {"warning", Warning}, {"error", Error},
+    };
+    for (const auto& [name, value] : levels) {
+        if (text == name) {
+            level = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+Logger::Record* Logger::_claim()
+{
+    if (!_running) {
+        _droppedRecords.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    uint64_t position = _writePosition.load(std::memory_order_relaxed);
+    while (true) {
+        Record *record = &_ring[position & (kRingSize - 1)];
+        uint64_t sequence = record->sequence.load(std::memory_order_acquire);
+        int64_t difference = static_cast<int64_t>(sequence) - static_cast<int64_t>(position);
+
+        if (difference == 0) {
+            if (_writePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                record->timestampNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count());
+                return record;
+            }
+        } else if (difference < 0) {
+            // Ring is full, the writer thread is behind
+            _droppedRecords.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            position = _writePosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void Logger::_commit(Record *record)
+{
+    // The slot's sequence equals its claimed position until committed
+    uint64_t position = record->sequence.load(std::memory_order_relaxed);
+    record->sequence.store(position + 1, std::memory_order_release);
+}
+
+void Logger::_writerThreadFunc()
+{
+    ALLOCATION_SCOPE(Logging);
+    PipelineTrace::setThreadName("logger");
+    std::string line;
+    line.reserve(256);
+
+    while (true) {
+        bool wrote = false;
+        FILE *output = _output ? _output.load() : stdout;
+        while (true) {
+            Record &record = _ring[_readPosition & (kRingSize - 1)];
+            if (record.sequence.load(std::memory_order_acquire) != _readPosition + 1) {
+                break;
+            }
+
+            TRACE_SCOPE("log", "logger_write");
+            line.clear();
+            _format(record, line);
+            fwrite(line.data(), 1, line.size(), output);
+            _writtenRecords.fetch_add(1, std::memory_order_relaxed);
+            wrote = true;
+
+            record.sequence.store(_readPosition + kRingSize, std::memory_order_release);
+            _readPosition++;
+        }
+        if (wrote) {
+            fflush(output);
+        }
+
+        std::unique_lock<std::mutex> lock(_wakeupMutex);
+        _flushedPosition.store(_readPosition, std::memory_order_release);
+        _flushed.notify_all();
+        if (!_running) {
+            break;
+        }
+        // Producers never signal, polling keeps the log statements free of syscalls
+        _wakeup.wait_for(lock, std::chrono::milliseconds(20));
+    }
+}
+
+void Logger::_format(const Record &record, std::string &line) const
+{
+    char buffer[64];
+
+    time_t seconds = static_cast<time_t>(record.timestampNs / 1000000000ULL);
+    unsigned milliseconds = static_cast<unsigned>((record.timestampNs / 1000000ULL) % 1000);
+    struct tm localTime;
+    localtime_r(&seconds, &localTime);
+    int length = snprintf(buffer, sizeof(buffer), "%02d:%02d:%02d.%03u %-5s [%s] ",
+                          localTime.tm_hour, localTime.tm_min, localTime.tm_sec, milliseconds,
+                          levelName(record.level), record.category);
+    line.append(buffer, static_cast<size_t>(std::max(length, 0)));
+
+    size_t argument = 0;
+    for (const char *cursor = record.format; *cursor; cursor++) {
+        if (*cursor != '{') {
+            line.push_back(*cursor);
+            continue;
+        }
+        if (cursor[1] == '{') {
+            line.push_back('{');
+            cursor++;
+            continue;
+        }
+        const char *close = strchr(cursor, '}');
+        if (!close) {
+            line.append(cursor);
+            break;
+        }
+
+        // Optional precision spec "{:.Nf}"
+        int precision = -1;
+        if (cursor[1] == ':' && cursor[2] == '.') {
+            precision = atoi(cursor + 3);
+        }
+        cursor = close;
+
+        if (argument >= record.argumentCount) {
+            line.append("{?}");
+            continue;
+        }
+
+        uint64_t value = record.values[argument];
+        switch (record.types[argument]) {
+        case ArgumentInt:
+            length = snprintf(buffer, sizeof(buffer), "%" PRId64, static_cast<int64_t>(value));
+            break;
+        case ArgumentUint:
+            length = snprintf(buffer, sizeof(buffer), "%" PRIu64, value);
+            break;
+        case ArgumentDouble: {
+            double converted;
+            std::memcpy(&converted, &value, sizeof(converted));
+            length = precision >= 0 ? snprintf(buffer, sizeof(buffer), "%.*f", precision, converted)
+                                    : snprintf(buffer, sizeof(buffer), "%g", converted);
+            break;
+        }
+        case ArgumentBool:
+            length = snprintf(buffer, sizeof(buffer), "%s", value ? "true" : "false");
+            break;
+        case ArgumentChar:
+            length = snprintf(buffer, sizeof(buffer), "%c", static_cast<char>(value));
+            break;
+        case ArgumentString:
+            line.append(record.strings + (value >> 16), value & 0xFFFF);
+            length = 0;
+            break;
+        }
+        line.append(buffer, static_cast<size_t>(std::clamp(length, 0, static_cast<int>(sizeof(buffer) - 1))));
+        argument++;
+    }
+    line.push_back('\n');
+}
+
+void Logger::_encodeString(Record &record, uint8_t index, std::string_view text)
+{
+    size_t available = kStringBufferSize - record.stringsUsed;
+    size_t length = std::min(text.size(), available);
+    std::memcpy(record.strings + record.stringsUsed, text.data(), length);
+
+    record.types[index] = ArgumentString;
+    record.values[index] = (static_cast<uint64_t>(record.stringsUsed) << 16) | length;
+    record.stringsUsed = static_cast<uint16_t>(record.stringsUsed + length);
+}
@@ -0,0 +1,83 @@
+#include "MAVLinkMessageEntries.h"
+#include "../thirdparty/c_library_v2/common/mavlink.h"
+#include <iterator>
+
+namespace {
+
+using MAVLinkMessageEntries::kPageCount;
+using MAVLinkMessageEntries::kSlotBits;
+using MAVLinkMessageEntries::kSlotsPerPage;
+using MAVLinkMessageEntries::Page;
+
+constexpr mavlink_msg_entry_t kEntries[] = MAVLINK_MESSAGE_CRCS;
+constexpr size_t kEntryCount = std::size(kEntries);
+
+constexpr size_t populatedPages()
+{
+    std::array<bool, kPageCount> populated{};
+    size_t count = 0;
+    for (const mavlink_msg_entry_t &entry : kEntries) {
+        if (!populated[entry.msgid >> kSlotBits]) {
+            populated[entry.msgid >> kSlotBits] = true;
+            count++;
+        }
+    }
+    return count;
+}
+
+constexpr size_t kPopulatedPages = populatedPages();
+
+struct Table {
+    std::array<uint8_t, kPageCount> pageOfBlock{};
+    std::array<Page, kPopulatedPages + 1> pages{};
+};
+
+constexpr Table buildTable()
+{
+    Table table{};
+    uint8_t nextPage = 1;
+    for (size_t index = 0; index < kEntryCount; index++) {
+        const uint32_t messageId = kEntries[index].msgid;
+        uint8_t &page = table.pageOfBlock[messageId >> kSlotBits];
+        if (page == 0) {
+            page = nextPage++;
+        }
+        table.pages[page][messageId & (kSlotsPerPage - 1)] = static_cast<uint16_t>(index + 1);
+    }
+    return table;
+}
+
+static_assert(kPopulatedPages < 256, "Page indexes are 8 bit");
+static_assert(kEntryCount < UINT16_MAX, "Entry indexes are 16 bit");
+
+constexpr Table kTable = buildTable();
+
+constexpr bool tableMatchesEntries()
+{
+    for (size_t index = 0; index < kEntryCount; index++) {
+        const uint32_t messageId = kEntries[index].msgid;
+        if (kTable.pages[kTable.pageOfBlock[messageId >> kSlotBits]][messageId & (kSlotsPerPage - 1)] != index + 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(tableMatchesEntries(), "Every message id must map to its own entry");
+
+} // namespace
+
+namespace MAVLinkMessageEntries {
+
+const uint8_t *const pageOfBlock = kTable.pageOfBlock.data();
+const Page *const pages = kTable.pages.data();
+const mavlink_msg_entry_t *const entries = kEntries;
+const size_t entryCount = kEntryCount;
+
+const mavlink_msg_entry_t* findBySearch(uint32_t messageId)
+{
+    // This translation unit doesn't define MAVLINK_MESSAGE_ENTRIES_OVERRIDE, the library's version is used
+    return mavlink_get_msg_entry(messageId);
+}
+
+} // namespace MAVLinkMessageEntries
@@ -0,0 +1,145 @@
+#include "MAVLinkMessageFactGroup.h"
+#include "Vehicle.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+/// Field tables of all messages of the compiled dialect, sorted by message id
+const mavlink_message_info_t kMessageInfo[] = MAVLINK_MESSAGE_INFO;
+
+uint16_t fieldSize(mavlink_message_type_t type)
+{
+    switch (type) {
+    case MAVLINK_TYPE_CHAR:
+    case MAVLINK_TYPE_UINT8_T:
+    case MAVLINK_TYPE_INT8_T:
+        return 1;
+    case MAVLINK_TYPE_UINT16_T:
+    case MAVLINK_TYPE_INT16_T:
+        return 2;
+    case MAVLINK_TYPE_UINT32_T:
+    case MAVLINK_TYPE_INT32_T:
+    case MAVLINK_TYPE_FLOAT:
+        return 4;
+    case MAVLINK_TYPE_UINT64_T:
+    case MAVLINK_TYPE_INT64_T:
+    case MAVLINK_TYPE_DOUBLE:
+        return 8;
+    }
+    return 0;
+}
+
+FactMetaData::ValueType_t factType(mavlink_message_type_t type)
+{
+    switch (type) {
+    case MAVLINK_TYPE_CHAR:         return FactMetaData::valueTypeString;
+    case MAVLINK_TYPE_UINT8_T:      return FactMetaData::valueTypeUint8;
+    case MAVLINK_TYPE_INT8_T:       return FactMetaData::valueTypeInt8;
+    case MAVLINK_TYPE_UINT16_T:     return FactMetaData::valueTypeUint16;
+    case MAVLINK_TYPE_INT16_T:      return FactMetaData::valueTypeInt16;
+    case MAVLINK_TYPE_UINT32_T:     return FactMetaData::valueTypeUint32;
+    case MAVLINK_TYPE_INT32_T:      return FactMetaData::valueTypeInt32;
+    case MAVLINK_TYPE_UINT64_T:     return FactMetaData::valueTypeUint64;
+    case MAVLINK_TYPE_INT64_T:      return FactMetaData::valueTypeInt64;
+    case MAVLINK_TYPE_FLOAT:        return FactMetaData::valueTypeFloat;
+    case MAVLINK_TYPE_DOUBLE:       return FactMetaData::valueTypeDouble;
+    }
+    return FactMetaData::valueTypeCustom;
+}
+
+template<typename T>
+T read(const uint8_t *data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+} // namespace
+
+MAVLinkMessageFactGroup::MAVLinkMessageFactGroup(const mavlink_message_info_t &messageInfo)
+    : FactGroup(0) // Values are published as they are decoded, no update timer
+    , _messageId(messageInfo.msgid)
+{
+    setObjectName(messageInfo.name);
+
+    for (unsigned i = 0; i < messageInfo.num_fields; i++) {
+        const mavlink_field_info_t &fieldInfo = messageInfo.fields[i];
+        const uint16_t size = fieldSize(fieldInfo.type);
+        const unsigned count = std::max(fieldInfo.array_length, 1u);
+
+        if (fieldInfo.type == MAVLINK_TYPE_CHAR && fieldInfo.array_length > 0) {
+            auto fact = _makeFact(0, fieldInfo.name, FactMetaData::valueTypeString);
+            _addFact(fact);
+            _fields.push_back(Field{static_cast<uint16_t>(fieldInfo.wire_offset), static_cast<uint16_t>(count), fieldInfo.type, fact.get()});
+        } else {
+            for (unsigned element = 0; element < count; element++) {
+                std::string name = fieldInfo.name;
+                if (fieldInfo.array_length > 0) {
+                    name += "_" + std::to_string(element);
+                }
+                // A single char is a number, not text
+                auto type = fieldInfo.type == MAVLINK_TYPE_CHAR ? FactMetaData::valueTypeUint8 : factType(fieldInfo.type);
+                auto fact = _makeFact(0, name, type);
+                _addFact(fact);
+                _fields.push_back(Field{static_cast<uint16_t>(fieldInfo.wire_offset + element * size), size, fieldInfo.type, fact.get()});
+            }
+        }
+        _wireLength = std::max<uint16_t>(_wireLength, static_cast<uint16_t>(fieldInfo.wire_offset + size * count));
+    }
+}
+
+const mavlink_message_info_t* MAVLinkMessageFactGroup::messageInfo(const std::string &messageName)
+{
+    for (const auto& info : kMessageInfo) {
+        if (messageName == info.name) {
+            return &info;
+        }
+    }
+    return nullptr;
+}
+
+std::span<const mavlink_message_info_t> MAVLinkMessageFactGroup::allMessageInfo()
+{
+    return kMessageInfo;
+}
+
+void MAVLinkMessageFactGroup::handleMessage(Vehicle* /*vehicle*/, const mavlink_message_t &message)
+{
+    if (message.msgid != _messageId) {
+        return;
+    }
+
+    // MAVLink 2 strips trailing zero bytes from the payload, put them back
+    uint8_t payload[MAVLINK_MAX_PAYLOAD_LEN];
+    const size_t length = std::min<size_t>(message.len, _wireLength);
+    std::memcpy(payload, _MAV_PAYLOAD(&message), length);
+    std::memset(payload + length, 0, _wireLength - length);
+
+    for (const Field &field : _fields) {
+        const uint8_t *data = payload + field.wireOffset;
+        switch (field.type) {
+        case MAVLINK_TYPE_CHAR:
+            if (field.fact->type() == FactMetaData::valueTypeString) {
+                const char *text = reinterpret_cast<const char*>(data);
+                field.fact->setRawValue(std::string(text, strnlen(text, field.length)));
+            } else {
+                field.fact->setRawValue(read<uint8_t>(data));
+            }
+            break;
+        case MAVLINK_TYPE_UINT8_T:  field.fact->setRawValue(read<uint8_t>(data));   break;
+        case MAVLINK_TYPE_INT8_T:   field.fact->setRawValue(read<int8_t>(data));    break;
+        case MAVLINK_TYPE_UINT16_T: field.fact->setRawValue(read<uint16_t>(data));  break;
+        case MAVLINK_TYPE_INT16_T:  field.fact->setRawValue(read<int16_t>(data));   break;
+        case MAVLINK_TYPE_UINT32_T: field.fact->setRawValue(read<uint32_t>(data));  break;
+        case MAVLINK_TYPE_INT32_T:  field.fact->setRawValue(read<int32_t>(data));   break;
+        case MAVLINK_TYPE_UINT64_T: field.fact->setRawValue(read<uint64_t>(data));  break;
+        case MAVLINK_TYPE_INT64_T:  field.fact->setRawValue(read<int64_t>(data));   break;
+        case MAVLINK_TYPE_FLOAT:    field.fact->setRawValue(read<float>(data));     break;
+        case MAVLINK_TYPE_DOUBLE:   field.fact->setRawValue(read<double>(data));    break;
+        }
+    }
+
+    _setTelemetryAvailable(true);
+}
@@ -0,0 +1,123 @@
+#include "MAVLinkMessageFilter.h"
+#include "MAVLinkMessageEntries.h"
+#include "MAVLinkMessageFactGroup.h"
+#include <algorithm>
+#include <sstream>
+#include <cstdlib>
+
+MAVLinkMessageFilter::MAVLinkMessageFilter()
+    : _droppedByEntry(new std::atomic<uint64_t>[MAVLinkMessageEntries::entryCount + 1]())
+{
+    _systemIdAccepted.fill(true);
+    _componentIdAccepted.fill(true);
+}
+
+void MAVLinkMessageFilter::setMessageIds(const std::vector<uint32_t> &allow, const std::vector<uint32_t> &deny)
+{
+    _messageIdFiltered = !allow.empty() || !deny.empty();
+    _messageIdDefault = allow.empty();
+
+    uint32_t tableSize = MAVLINK_MSG_ID_HEARTBEAT + 1;
+    for (uint32_t id : allow) {
+        tableSize = std::max(tableSize, id + 1);
+    }
+    for (uint32_t id : deny) {
+        tableSize = std::max(tableSize, id + 1);
+    }
+
+    _messageIdAccepted.assign(tableSize, _messageIdDefault);
+    for (uint32_t id : allow) {
+        _messageIdAccepted[id] = true;
+    }
+    for (uint32_t id : deny) {
+        _messageIdAccepted[id] = false;
+    }
+    _messageIdAccepted[MAVLINK_MSG_ID_HEARTBEAT] = true;
+
+    _updateEnabled();
+}
+
+void MAVLinkMessageFilter::setSystemIds(const std::vector<uint32_t> &allow, const std::vector<uint32_t> &deny)
+{
+    _systemIdFiltered = !allow.empty() || !deny.empty();
+    _fillTable(_systemIdAccepted, allow, deny);
+    _updateEnabled();
+}
+
+void MAVLinkMessageFilter::setComponentIds(const std::vector<uint32_t> &allow, const std::vector<uint32_t> &deny)
+{
+    _componentIdFiltered = !allow.empty() || !deny.empty();
+    _fillTable(_componentIdAccepted, allow, deny);
+    _updateEnabled();
+}
+
+bool MAVLinkMessageFilter::accept(uint32_t messageId, uint8_t systemId, uint8_t componentId)
+{
+    bool accepted = _systemIdAccepted[systemId] && _componentIdAccepted[componentId];
+    if (accepted && _messageIdFiltered) {
+        accepted = messageId < _messageIdAccepted.size() ? _messageIdAccepted[messageId] != 0 : _messageIdDefault;
+    }
+
+    if (!accepted) {
+        const mavlink_msg_entry_t *entry = MAVLinkMessageEntries::find(messageId);
+        const size_t index = entry ? static_cast<size_t>(entry - MAVLinkMessageEntries::entries) : MAVLinkMessageEntries::entryCount;
+        _droppedByEntry[index].fetch_add(1, std::memory_order_relaxed);
+        _droppedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    return accepted;
+}
+
+std::map<uint32_t, uint64_t> MAVLinkMessageFilter::droppedByMessageId() const
+{
+    std::map<uint32_t, uint64_t> dropped;
+    for (size_t index = 0; index <= MAVLinkMessageEntries::entryCount; index++) {
+        const uint64_t count = _droppedByEntry[index].load(std::memory_order_relaxed);
+        if (count > 0) {
+            dropped[index < MAVLinkMessageEntries::entryCount ? MAVLinkMessageEntries::entries[index].msgid : kUnknownMessageId] = count;
+        }
+    }
+    return dropped;
+}
+
+bool MAVLinkMessageFilter::parseIdList(const std::string &list, std::vector<uint32_t> &ids, std::string &badEntry)
+{
+    std::istringstream entries(list);
+    for (std::string entry; std::getline(entries, entry, ','); ) {
+        entry.erase(std::remove(entry.begin(), entry.end(), ' '), entry.end());
+        if (entry.empty()) {
+            continue;
+        }
+
+        char *end = nullptr;
+        unsigned long id = std::strtoul(entry.c_str(), &end, 10);
+        if (*end == '\0' && id <= 0xFFFFFF) {
+            ids.push_back(static_cast<uint32_t>(id));
+        } else if (const mavlink_message_info_t *info = MAVLinkMessageFactGroup::messageInfo(entry)) {
+            ids.push_back(info->msgid);
+        } else {
+            badEntry = entry;
+            return false;
+        }
+    }
+    return true;
+}
+
+void MAVLinkMessageFilter::_fillTable(std::array<bool, 256> &table, const std::vector<uint32_t> &allow, const std::vector<uint32_t> &deny)
+{
+    table.fill(allow.empty());
+    for (uint32_t id : allow) {
+        if (id < table.size()) {
+            table[id] = true;
+        }
+    }
+    for (uint32_t id : deny) {
+        if (id < table.size()) {
+            table[id] = false;
+        }
+    }
+}
+
+void MAVLinkMessageFilter::_updateEnabled()
+{
+    _enabled = _messageIdFiltered || _systemIdFiltered || _componentIdFiltered;
+}
@@ -1,5 +1,12 @@
+// The parser looks up CRC extra and lengths in the direct indexed table, must come before mavlink.h
+#define MAVLINK_MESSAGE_ENTRIES_OVERRIDE
+#include "MAVLinkMessageEntries.h"
+
 #include "MAVLinkUdpConnection.h"
 #include "Vehicle.h"
+#include "VehicleManager.h"
+#include "AllocationCounter.h"
+#include "PipelineTrace.h"
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -63,6 +70,13 @@ bool MAVLinkUdpConnection::connect(const std::string &targetAddress, uint16_t po
         return false;
     }
     
+    // Bursts like log downloads overflow the default buffer before the receive thread catches up,
+    // the kernel caps the size at net.core.rmem_max
+    int receiveBufferSize = RECEIVE_BUFFER_BYTES;
+    if (setsockopt(_socketFd, SOL_SOCKET, SO_RCVBUF, &receiveBufferSize, sizeof(receiveBufferSize)) < 0) {
+        std::cerr << "Failed to set socket receive buffer size: " << strerror(errno) << std::endl;
+    }
+
     // Bind to local port to listen for MAVLink data (like the C example)
     struct sockaddr_in localAddr;
     memset(&localAddr, 0, sizeof(localAddr));
@@ -167,9 +181,16 @@ bool MAVLinkUdpConnection::sendMessage(const mavlink_message_t &message, uint8_t
     }
     
     if (len > 0) {
-        // Use sendto() to send back to the last sender (like the C example)
+        // Use sendto() to send back to the target system, or the last sender (like the C example)
+        const struct sockaddr_in *addr = &_lastSenderAddr;
+        socklen_t addrLen = _lastSenderAddrLen;
+        auto systemIt = systemId != 0 ? _systemAddresses.find(systemId) : _systemAddresses.end();
+        if (systemIt != _systemAddresses.end()) {
+            addr = &systemIt->second.addr;
+            addrLen = systemIt->second.addrLen;
+        }
         ssize_t sent = sendto(_socketFd, buffer, len, 0, 
-                             (struct sockaddr*)&_lastSenderAddr, _lastSenderAddrLen);
+                             (const struct sockaddr*)addr, addrLen);
         if (sent > 0) {
             _bytesSent += sent;
             _packetsSent++;
@@ -192,11 +213,23 @@ void MAVLinkUdpConnection::resetStatistics()
     _packetsLost = 0;
 }
 
+MAVLinkUdpConnection::SystemStats MAVLinkUdpConnection::getSystemStats(uint8_t systemId) const
+{
+    const SystemCounters &counters = _systemCounters[systemId];
+    SystemStats stats;
+    stats.messagesReceived = counters.messagesReceived.load(std::memory_order_relaxed);
+    stats.messagesLost = counters.messagesLost.load(std::memory_order_relaxed);
+    stats.bytesReceived = counters.bytesReceived.load(std::memory_order_relaxed);
+    return stats;
+}
+
 void MAVLinkUdpConnection::_receiveThreadFunc()
 {
     uint8_t buffer[MAVLINK_MAX_PACKET_LEN];
     struct sockaddr_in senderAddr;
     socklen_t senderAddrLen = sizeof(senderAddr);
+    ALLOCATION_SCOPE(Receive);
+    PipelineTrace::setThreadName("receive");
     
     while (_running) {
         // Receive data with timeout (like the C example)
@@ -204,6 +237,7 @@ void MAVLinkUdpConnection::_receiveThreadFunc()
                                   (struct sockaddr*)&senderAddr, &senderAddrLen);
         
         if (received > 0) {
+            TRACE_SCOPE_ARG("link", "receive", "bytes", received);
             _bytesReceived += received;
             _packetsReceived++;
             
@@ -241,29 +275,54 @@ void MAVLinkUdpConnection::_processReceivedData(const uint8_t* data, size_t leng
 
 bool MAVLinkUdpConnection::_parseMavlinkData(const uint8_t *data, size_t length)
 {
+    ALLOCATION_SCOPE(Parse);
+    TRACE_SCOPE_ARG("link", "parse", "bytes", length);
     bool parsedMessage = false;
     mavlink_message_t message;
+    const int64_t receivedNs = MessageRateTable::nowNs();
+    
+    const bool filterEnabled = _messageFilter.isEnabled();
     
     // Parse all bytes in the packet - there can be multiple messages per packet
     for (size_t i = 0; i < length; i++) {
+        // Rejected frames are skipped as a whole while the parser waits for a start byte
+        if (filterEnabled && _mavlinkStatus[MAVLINK_COMM_0].parse_state <= MAVLINK_PARSE_STATE_IDLE) {
+            size_t frameLength = _filteredFrameLength(data + i, length - i);
+            if (frameLength > 0) {
+                i += frameLength - 1;
+                continue;
+            }
+        }
+        
         if (mavlink_parse_char(MAVLINK_COMM_0, data[i], &message, &_mavlinkStatus[MAVLINK_COMM_0]) == MAVLINK_FRAMING_OK) {
             parsedMessage = true;
+            _messageRates.record(message, receivedNs);
             
             // Update last message time for health monitoring
             _updateLastMessageTime();
             
             // Update message loss detection
-            _updateMessageLossStats(message);
+            _updateMessageLossStats(message.sysid, message.compid, message.seq, MessageRateTable::frameLength(message));
             
             if (_autoVersionDetection) {
                 _detectMavlinkVersion(message);
             }
             
+            if (message.msgid == MAVLINK_MSG_ID_HEARTBEAT) {
+                std::lock_guard<std::mutex> lock(_socketMutex);
+                SystemAddress &systemAddress = _systemAddresses[message.sysid];
+                systemAddress.addr = _lastSenderAddr;
+                systemAddress.addrLen = _lastSenderAddrLen;
+            }
+            
             if (_messageReceivedCallback) {
+                ALLOCATION_SCOPE(Logging);
                 _messageReceivedCallback(message);
             }
             
-            if (_vehicle) {
+            if (VehicleManager *vehicleManager = _vehicleManager.load()) {
+                vehicleManager->handleMessage(message);
+            } else if (_vehicle) {
                 _vehicle->handleMessage(message);
             }
         }
@@ -272,6 +331,43 @@ bool MAVLinkUdpConnection::_parseMavlinkData(const uint8_t *data, size_t length)
     return parsedMessage;
 }
 
+size_t MAVLinkUdpConnection::_filteredFrameLength(const uint8_t *data, size_t length)
+{
+    // Header fields are read in place, the CRC isn't checked for frames which are thrown away
+    uint32_t messageId;
+    uint8_t sequence, systemId, componentId;
+    size_t frameLength;
+    
+    if (data[0] == MAVLINK_STX && length >= MAVLINK_NUM_HEADER_BYTES) {
+        sequence = data[4];
+        systemId = data[5];
+        componentId = data[6];
+        messageId = data[7] | (data[8] << 8) | (static_cast<uint32_t>(data[9]) << 16);
+        frameLength = MAVLINK_NUM_NON_PAYLOAD_BYTES + data[1];
+        if (data[2] & MAVLINK_IFLAG_SIGNED) {
+            frameLength += MAVLINK_SIGNATURE_BLOCK_LEN;
+        }
+    } else if (data[0] == MAVLINK_STX_MAVLINK1 && length >= 6) {
+        sequence = data[2];
+        systemId = data[3];
+        componentId = data[4];
+        messageId = data[5];
+        frameLength = 6 + data[1] + MAVLINK_NUM_CHECKSUM_BYTES;
+    } else {
+        return 0;
+    }
+    
+    // Truncated frames are left to the parser, which rejects them
+    if (frameLength > length || _messageFilter.accept(messageId, systemId, componentId)) {
+        return 0;
+    }
+    
+    // The frame did arrive, keep health and loss tracking in step
+    _updateLastMessageTime();
+    _updateMessageLossStats(systemId, componentId, sequence, frameLength);
+    return frameLength;
+}
+
 void MAVLinkUdpConnection::_detectMavlinkVersion(const mavlink_message_t &message)
 {
     // Simple version detection based on message magic field
@@ -290,29 +386,35 @@ void MAVLinkUdpConnection::_detectMavlinkVersion(const mavlink_message_t &messag
     }
 }
 
-void MAVLinkUdpConnection::_updateMessageLossStats(const mavlink_message_t &message)
+void MAVLinkUdpConnection::_updateMessageLossStats(uint8_t systemId, uint8_t componentId, uint8_t sequence, size_t frameLength)
 {
     // Track sequence numbers to detect message loss
-    const auto key = std::make_pair(message.sysid, message.compid);
+    const auto key = std::make_pair(systemId, componentId);
     
     uint8_t expectedSeq;
     if (!_firstMessageSeen.contains(key)) {
         _firstMessageSeen.insert(key);
-        expectedSeq = message.seq;
+        expectedSeq = sequence;
     } else {
         expectedSeq = _lastSequence[key] + 1;
     }
     
     uint64_t lostMessages;
-    if (message.seq >= expectedSeq) {
-        lostMessages = message.seq - expectedSeq;
+    if (sequence >= expectedSeq) {
+        lostMessages = sequence - expectedSeq;
     } else {
         // Handle sequence number wrap-around
-        lostMessages = static_cast<uint64_t>(message.seq) + 256ULL - expectedSeq;
+        lostMessages = static_cast<uint64_t>(sequence) + 256ULL - expectedSeq;
     }
     
+    _messagesReceived++;
     _totalLossCounter += lostMessages;
-    _lastSequence[key] = message.seq;
+    _lastSequence[key] = sequence;
+    
+    SystemCounters &counters = _systemCounters[systemId];
+    counters.messagesReceived.fetch_add(1, std::memory_order_relaxed);
+    counters.messagesLost.fetch_add(lostMessages, std::memory_order_relaxed);
+    counters.bytesReceived.fetch_add(frameLength, std::memory_order_relaxed);
     
     // Update loss percentage
     uint64_t totalSent = _packetsReceived + _totalLossCounter;
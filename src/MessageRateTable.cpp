@@ -0,0 +1,145 @@
+#include "MessageRateTable.h"
+#include "MAVLinkMessageFactGroup.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+constexpr double kNsPerSec = 1e9;
+
+/// Slot of every message id of the dialect, slot 0 is shared by the ids it doesn't define
+struct MessageIndex {
+    std::vector<uint16_t> slotOfId;
+    std::vector<const mavlink_message_info_t*> infoOfSlot;
+};
+
+const MessageIndex& messageIndex()
+{
+    static const MessageIndex index = []() {
+        MessageIndex index;
+        index.infoOfSlot.push_back(nullptr);
+        for (const mavlink_message_info_t &info : MAVLinkMessageFactGroup::allMessageInfo()) {
+            if (info.msgid >= index.slotOfId.size()) {
+                index.slotOfId.resize(info.msgid + 1, 0);
+            }
+            index.slotOfId[info.msgid] = static_cast<uint16_t>(index.infoOfSlot.size());
+            index.infoOfSlot.push_back(&info);
+        }
+        return index;
+    }();
+    return index;
+}
+
+inline size_t slotOf(uint32_t messageId)
+{
+    const std::vector<uint16_t> &slotOfId = messageIndex().slotOfId;
+    return messageId < slotOfId.size() ? slotOfId[messageId] : 0;
+}
+
+} // namespace
+
+MessageRateTable::MessageRateTable()
+{
+    // Built here so the receive thread never pays for it
+    messageIndex();
+}
+
+MessageRateTable::~MessageRateTable()
+{
+    for (auto &row : _rows) {
+        delete row.load();
+    }
+}
+
+int64_t MessageRateTable::nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t MessageRateTable::frameLength(const mavlink_message_t &message)
+{
+    if (message.magic == MAVLINK_STX_MAVLINK1) {
+        return 6 + message.len + MAVLINK_NUM_CHECKSUM_BYTES;
+    }
+    uint32_t length = MAVLINK_NUM_NON_PAYLOAD_BYTES + message.len;
+    if (message.incompat_flags & MAVLINK_IFLAG_SIGNED) {
+        length += MAVLINK_SIGNATURE_BLOCK_LEN;
+    }
+    return length;
+}
+
+MessageRateTable::Row& MessageRateTable::_row(uint8_t systemId)
+{
+    Row *row = _rows[systemId].load(std::memory_order_acquire);
+    if (!row) {
+        // Only the recording thread creates rows, no race with another writer
+        row = new Row(messageIndex().infoOfSlot.size());
+        _rows[systemId].store(row, std::memory_order_release);
+    }
+    return *row;
+}
+
+void MessageRateTable::record(const mavlink_message_t &message, int64_t nowNs)
+{
+    Slot &slot = _row(message.sysid).slots[slotOf(message.msgid)];
+    const uint32_t bytes = frameLength(message);
+
+    // Single writer, plain loads and stores are enough
+    const int64_t lastNs = slot.lastNs.load(std::memory_order_relaxed);
+    const double decay = lastNs ? std::exp(-static_cast<double>(nowNs - lastNs) / (kRateTimeConstantSecs * kNsPerSec)) : 0.0;
+    slot.rateHz.store(slot.rateHz.load(std::memory_order_relaxed) * decay + 1.0 / kRateTimeConstantSecs,
+                      std::memory_order_relaxed);
+    slot.bytesPerSecond.store(slot.bytesPerSecond.load(std::memory_order_relaxed) * decay + bytes / kRateTimeConstantSecs,
+                              std::memory_order_relaxed);
+    slot.lastNs.store(nowNs, std::memory_order_relaxed);
+    slot.bytes.store(slot.bytes.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+    slot.count.store(slot.count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+std::vector<MessageRateTable::Entry> MessageRateTable::snapshot(int systemId) const
+{
+    const MessageIndex &index = messageIndex();
+    const int64_t now = nowNs();
+    std::vector<Entry> entries;
+
+    for (size_t system = 0; system < _rows.size(); system++) {
+        if (systemId >= 0 && static_cast<size_t>(systemId) != system) {
+            continue;
+        }
+        const Row *row = _rows[system].load(std::memory_order_acquire);
+        if (!row) {
+            continue;
+        }
+
+        // Slots are in message id order after the shared one, which goes last
+        for (size_t n = 1; n <= index.infoOfSlot.size(); n++) {
+            const size_t slotIndex = n % index.infoOfSlot.size();
+            const Slot &slot = row->slots[slotIndex];
+            const uint64_t count = slot.count.load(std::memory_order_acquire);
+            if (count == 0) {
+                continue;
+            }
+
+            Entry entry;
+            entry.systemId = static_cast<uint8_t>(system);
+            if (const mavlink_message_info_t *info = index.infoOfSlot[slotIndex]) {
+                entry.messageId = info->msgid;
+                entry.messageName = info->name;
+            } else {
+                entry.messageId = kUnknownMessageId;
+                entry.messageName = "UNKNOWN";
+            }
+            entry.count = count;
+            entry.bytes = slot.bytes.load(std::memory_order_relaxed);
+
+            const int64_t idleNs = std::max<int64_t>(0, now - slot.lastNs.load(std::memory_order_relaxed));
+            const double decay = std::exp(-static_cast<double>(idleNs) / (kRateTimeConstantSecs * kNsPerSec));
+            entry.rateHz = slot.rateHz.load(std::memory_order_relaxed) * decay;
+            entry.bytesPerSecond = slot.bytesPerSecond.load(std::memory_order_relaxed) * decay;
+            entries.push_back(entry);
+        }
+    }
+    return entries;
+}
@@ -0,0 +1,440 @@
+#include "MissionManager.h"
+#include "Vehicle.h"
+#include "Logger.h"
+#include <algorithm>
+
+MissionManager::MissionManager(Vehicle *vehicle)
+    : _vehicle(vehicle)
+{
+}
+
+MissionManager::~MissionManager()
+{
+    Scheduler::TaskId timeoutTask;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _destroying = true;
+        timeoutTask = _timeoutTask;
+        _state = State::Idle;
+    }
+    Scheduler::instance().cancel(timeoutTask);
+}
+
+bool MissionManager::loadFromVehicle(CompletionCallback completion)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_destroying || _state != State::Idle) {
+        return false;
+    }
+
+    _start(State::RequestingCount, std::move(completion));
+    _transferItems.clear();
+    LOG_INFO("Mission", "Loading mission from sysid={}", _vehicle->systemId());
+    _sendRequestList();
+    _scheduleTimeoutCheck();
+    return true;
+}
+
+bool MissionManager::writeToVehicle(const std::vector<Item> &items, CompletionCallback completion)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_destroying || _state != State::Idle || items.size() > UINT16_MAX) {
+        return false;
+    }
+
+    _start(State::Uploading, std::move(completion));
+    _transferItems = items;
+    LOG_INFO("Mission", "Writing {} mission items to sysid={}", items.size(), _vehicle->systemId());
+    _sendCount();
+    _scheduleTimeoutCheck();
+    return true;
+}
+
+bool MissionManager::inProgress() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _state != State::Idle;
+}
+
+void MissionManager::setMaxOutstandingRequests(int requests)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _maxOutstandingRequests = std::max(0, requests);
+}
+
+size_t MissionManager::count() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _items.size();
+}
+
+std::vector<MissionManager::Item> MissionManager::items() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _items;
+}
+
+bool MissionManager::item(uint16_t seq, Item &item) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (seq >= _items.size()) {
+        return false;
+    }
+    item = _items[seq];
+    return true;
+}
+
+int MissionManager::currentIndex() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _currentIndex;
+}
+
+bool MissionManager::currentItem(Item &item) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_currentIndex < 0 || static_cast<size_t>(_currentIndex) >= _items.size()) {
+        return false;
+    }
+    item = _items[_currentIndex];
+    return true;
+}
+
+void MissionManager::mavlinkMessageReceived(const mavlink_message_t &message)
+{
+    if (message.msgid == MAVLINK_MSG_ID_MISSION_CURRENT) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _currentIndex = mavlink_msg_mission_current_get_seq(&message);
+        return;
+    }
+
+    if (message.msgid != MAVLINK_MSG_ID_MISSION_COUNT && message.msgid != MAVLINK_MSG_ID_MISSION_ITEM_INT &&
+        message.msgid != MAVLINK_MSG_ID_MISSION_REQUEST_INT && message.msgid != MAVLINK_MSG_ID_MISSION_REQUEST &&
+        message.msgid != MAVLINK_MSG_ID_MISSION_ACK) {
+        return;
+    }
+
+    Completion done;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_state == State::Idle || message.compid != _vehicle->componentId()) {
+            return;
+        }
+
+        switch (message.msgid) {
+            case MAVLINK_MSG_ID_MISSION_COUNT:
+                _handleMissionCount(message);
+                break;
+
+            case MAVLINK_MSG_ID_MISSION_ITEM_INT:
+                _handleMissionItemInt(message);
+                break;
+
+            case MAVLINK_MSG_ID_MISSION_REQUEST_INT:
+            case MAVLINK_MSG_ID_MISSION_REQUEST: {
+                // Both are answered with MISSION_ITEM_INT, the layouts only differ in the position type
+                mavlink_mission_request_int_t request;
+                mavlink_msg_mission_request_int_decode(&message, &request);
+                if ((request.target_system == 255 || request.target_system == 0) &&
+                    request.mission_type == MAV_MISSION_TYPE_MISSION) {
+                    _handleMissionRequest(request.seq);
+                }
+                break;
+            }
+
+            case MAVLINK_MSG_ID_MISSION_ACK:
+                _handleMissionAck(message);
+                break;
+
+            default:
+                break;
+        }
+
+        if (!_errorMsg.empty()) {
+            done = _finish(false, _errorMsg);
+        } else if (_state == State::Idle) {
+            done = _finish(true, std::string());
+        }
+    }
+    if (done.callback) {
+        done.callback(done.result);
+    }
+}
+
+void MissionManager::_handleMissionCount(const mavlink_message_t &message)
+{
+    if (_state != State::RequestingCount) {
+        return;
+    }
+    mavlink_mission_count_t missionCount;
+    mavlink_msg_mission_count_decode(&message, &missionCount);
+    if ((missionCount.target_system != 255 && missionCount.target_system != 0) ||
+        missionCount.mission_type != MAV_MISSION_TYPE_MISSION) {
+        return;
+    }
+
+    LOG_DEBUG("Mission", "sysid={} has {} mission items", _vehicle->systemId(), missionCount.count);
+    _transferItems.assign(missionCount.count, Item());
+    _received.assign(missionCount.count, false);
+    _receivedCount = 0;
+    _nextRequestSeq = 0;
+
+    if (missionCount.count == 0) {
+        _sendAck(MAV_MISSION_ACCEPTED);
+        _state = State::Idle;
+        return;
+    }
+    _state = State::Downloading;
+    _fillPipeline();
+}
+
+void MissionManager::_handleMissionItemInt(const mavlink_message_t &message)
+{
+    if (_state != State::Downloading) {
+        return;
+    }
+    mavlink_mission_item_int_t missionItem;
+    mavlink_msg_mission_item_int_decode(&message, &missionItem);
+    if ((missionItem.target_system != 255 && missionItem.target_system != 0) ||
+        missionItem.mission_type != MAV_MISSION_TYPE_MISSION ||
+        missionItem.seq >= _transferItems.size() || _received[missionItem.seq]) {
+        return;
+    }
+
+    Item &item = _transferItems[missionItem.seq];
+    item.param1 = missionItem.param1;
+    item.param2 = missionItem.param2;
+    item.param3 = missionItem.param3;
+    item.param4 = missionItem.param4;
+    item.x = missionItem.x;
+    item.y = missionItem.y;
+    item.z = missionItem.z;
+    item.command = missionItem.command;
+    item.frame = missionItem.frame;
+    item.autocontinue = missionItem.autocontinue;
+    _received[missionItem.seq] = true;
+    _receivedCount++;
+    _outstanding.erase(missionItem.seq);
+
+    if (_receivedCount == _transferItems.size()) {
+        _sendAck(MAV_MISSION_ACCEPTED);
+        _state = State::Idle;
+    } else {
+        _fillPipeline();
+    }
+}
+
+void MissionManager::_handleMissionRequest(uint16_t seq)
+{
+    if (_state != State::Uploading) {
+        return;
+    }
+    if (seq >= _transferItems.size()) {
+        LOG_WARNING("Mission", "sysid={} requested mission item {} of {}", _vehicle->systemId(), seq, _transferItems.size());
+        return;
+    }
+    _lastUploadSeq = seq;
+    _transferRequest.attempts = 0;
+    _sendItem(seq);
+}
+
+void MissionManager::_handleMissionAck(const mavlink_message_t &message)
+{
+    mavlink_mission_ack_t ack;
+    mavlink_msg_mission_ack_decode(&message, &ack);
+    if ((ack.target_system != 255 && ack.target_system != 0) || ack.mission_type != MAV_MISSION_TYPE_MISSION) {
+        return;
+    }
+
+    if (_state == State::Uploading && ack.type == MAV_MISSION_ACCEPTED) {
+        // The vehicle may accept before asking for every item if the count was zero
+        if (_transferItems.empty() || _lastUploadSeq == static_cast<int>(_transferItems.size()) - 1) {
+            _state = State::Idle;
+        }
+    } else if (ack.type != MAV_MISSION_ACCEPTED) {
+        _errorMsg = "Vehicle returned mission result " + std::to_string(ack.type);
+    }
+}
+
+void MissionManager::_timeoutCheck(uint64_t generation)
+{
+    Completion done;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_destroying || _state == State::Idle || generation != _transferGeneration) {
+            return;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        const auto timeout = std::chrono::milliseconds(kRequestTimeoutMsecs);
+
+        if (_state == State::Downloading) {
+            for (auto &pair : _outstanding) {
+                Request &request = pair.second;
+                if (now - request.sentTime < timeout) {
+                    continue;
+                }
+                if (++request.attempts > kMaxRetries) {
+                    done = _finish(false, "Timeout waiting for mission item " + std::to_string(pair.first));
+                    break;
+                }
+                LOG_DEBUG("Mission", "Mission item {} from sysid={} timed out, retry {}", pair.first, _vehicle->systemId(), request.attempts);
+                _sendRequest(pair.first);
+                request.sentTime = now;
+            }
+        } else if (now - _transferRequest.sentTime >= timeout) {
+            if (++_transferRequest.attempts > kMaxRetries) {
+                done = _finish(false, _state == State::RequestingCount ? "Timeout waiting for mission count"
+                                                                      : "Timeout waiting for mission request");
+            } else if (_state == State::RequestingCount) {
+                _sendRequestList();
+            } else if (_lastUploadSeq < 0) {
+                _sendCount();
+            } else {
+                // Most likely the vehicle didn't get the last item and its own retry was lost too
+                _sendItem(static_cast<uint16_t>(_lastUploadSeq));
+            }
+        }
+
+        if (!done.callback && _state != State::Idle) {
+            _scheduleTimeoutCheck();
+        }
+    }
+    if (done.callback) {
+        done.callback(done.result);
+    }
+}
+
+void MissionManager::_start(State state, CompletionCallback completion)
+{
+    _state = state;
+    _uploading = state == State::Uploading;
+    _errorMsg.clear();
+    _completion = std::move(completion);
+    _received.clear();
+    _receivedCount = 0;
+    _nextRequestSeq = 0;
+    _lastUploadSeq = -1;
+    _outstanding.clear();
+    _transferRequest = Request();
+    _messagesSent = 0;
+    _startTime = std::chrono::steady_clock::now();
+    _transferGeneration++;
+}
+
+void MissionManager::_fillPipeline()
+{
+    int maxOutstanding = _maxOutstandingRequests;
+    if (maxOutstanding == 0) {
+        maxOutstanding = _vehicle->autopilotType() == MAV_AUTOPILOT_ARDUPILOTMEGA ? kArduPilotMaxOutstandingRequests : 1;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    while (static_cast<int>(_outstanding.size()) < maxOutstanding && _nextRequestSeq < _transferItems.size()) {
+        const uint16_t seq = _nextRequestSeq++;
+        if (_received[seq]) {
+            continue;
+        }
+        _sendRequest(seq);
+        _outstanding[seq].sentTime = now;
+    }
+}
+
+void MissionManager::_sendRequestList()
+{
+    mavlink_message_t message;
+    mavlink_msg_mission_request_list_pack(255, MAV_COMP_ID_MISSIONPLANNER, &message,
+                                          _vehicle->systemId(), _vehicle->componentId(), MAV_MISSION_TYPE_MISSION);
+    _transferRequest.sentTime = std::chrono::steady_clock::now();
+    _messagesSent++;
+    _vehicle->sendMessage(message);
+}
+
+void MissionManager::_sendRequest(uint16_t seq)
+{
+    mavlink_message_t message;
+    mavlink_msg_mission_request_int_pack(255, MAV_COMP_ID_MISSIONPLANNER, &message,
+                                         _vehicle->systemId(), _vehicle->componentId(), seq, MAV_MISSION_TYPE_MISSION);
+    _messagesSent++;
+    _vehicle->sendMessage(message);
+}
+
+void MissionManager::_sendCount()
+{
+    mavlink_message_t message;
+    mavlink_msg_mission_count_pack(255, MAV_COMP_ID_MISSIONPLANNER, &message,
+                                   _vehicle->systemId(), _vehicle->componentId(),
+                                   static_cast<uint16_t>(_transferItems.size()), MAV_MISSION_TYPE_MISSION, 0);
+    _transferRequest.sentTime = std::chrono::steady_clock::now();
+    _messagesSent++;
+    _vehicle->sendMessage(message);
+}
+
+void MissionManager::_sendItem(uint16_t seq)
+{
+    const Item &item = _transferItems[seq];
+    mavlink_message_t message;
+    mavlink_msg_mission_item_int_pack(255, MAV_COMP_ID_MISSIONPLANNER, &message,
+                                      _vehicle->systemId(), _vehicle->componentId(), seq,
+                                      item.frame, item.command, seq == 0 ? 1 : 0, item.autocontinue,
+                                      item.param1, item.param2, item.param3, item.param4,
+                                      item.x, item.y, item.z, MAV_MISSION_TYPE_MISSION);
+    _transferRequest.sentTime = std::chrono::steady_clock::now();
+    _messagesSent++;
+    _vehicle->sendMessage(message);
+}
+
+void MissionManager::_sendAck(uint8_t type)
+{
+    mavlink_message_t message;
+    mavlink_msg_mission_ack_pack(255, MAV_COMP_ID_MISSIONPLANNER, &message,
+                                 _vehicle->systemId(), _vehicle->componentId(), type, MAV_MISSION_TYPE_MISSION, 0);
+    _messagesSent++;
+    _vehicle->sendMessage(message);
+}
+
+void MissionManager::_scheduleTimeoutCheck()
+{
+    // Wake up for the oldest request, newer ones are checked on the way
+    auto oldest = _transferRequest.sentTime;
+    if (_state == State::Downloading) {
+        oldest = std::chrono::steady_clock::time_point::max();
+        for (const auto &pair : _outstanding) {
+            oldest = std::min(oldest, pair.second.sentTime);
+        }
+    }
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - oldest);
+    const auto delay = std::max(std::chrono::milliseconds(1), std::chrono::milliseconds(kRequestTimeoutMsecs) - elapsed);
+
+    const uint64_t generation = _transferGeneration;
+    _timeoutTask = Scheduler::instance().schedule(delay, [this, generation]() { _timeoutCheck(generation); });
+}
+
+MissionManager::Completion MissionManager::_finish(bool success, const std::string &error)
+{
+    Completion done;
+    done.callback = std::move(_completion);
+    done.result.success = success;
+    done.result.error = error;
+    done.result.count = static_cast<uint16_t>(_transferItems.size());
+    done.result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _startTime).count();
+    done.result.messagesSent = _messagesSent;
+
+    if (success) {
+        _items = std::move(_transferItems);
+        LOG_INFO("Mission", "{} {} mission items {} sysid={} in {:.2f}s, {} messages sent",
+                 _uploading ? "Wrote" : "Loaded", _items.size(), _uploading ? "to" : "from",
+                 _vehicle->systemId(), done.result.seconds, _messagesSent);
+    } else {
+        LOG_WARNING("Mission", "Mission transfer with sysid={} failed: {}", _vehicle->systemId(), error);
+    }
+
+    _state = State::Idle;
+    _errorMsg.clear();
+    _transferItems.clear();
+    _received.clear();
+    _outstanding.clear();
+    _completion = CompletionCallback();
+    _transferGeneration++;
+    return done;
+}
@@ -1,5 +1,6 @@
 #include "ParameterManager.h"
 #include "Vehicle.h"
+#include "FTPManager.h"
 #include <mavlink/v2.0/common/mavlink.h>
 #include <fstream>
 #include <sstream>
@@ -8,6 +9,8 @@
 #include <filesystem>
 #include <cstring>
 
+#include "Logger.h"
+
 ParameterManager::ParameterManager(Vehicle *vehicle)
     : _vehicle(vehicle)
     , _timersRunning(true)
@@ -23,6 +26,11 @@ ParameterManager::ParameterManager(Vehicle *vehicle)
 ParameterManager::~ParameterManager()
 {
     _timersRunning = false;
+    {
+        // Waits for a timeout handler which is running right now
+        std::lock_guard<std::mutex> lock(_timerLifetime->mutex);
+        _timerLifetime->alive = false;
+    }
     if (_initialRequestTimeoutThread.joinable()) {
         _initialRequestTimeoutThread.join();
     }
@@ -109,17 +117,37 @@ void ParameterManager::refreshAllParameters(uint8_t componentID)
     
     _setLoadProgress(0.0);
     
+    // ArduPilot packs all parameters into one file, a few FTP bursts instead of a message per parameter
+    std::shared_ptr<FTPManager> ftpManager = _vehicle->ftpManager();
+    if (_tryftp && ftpManager && _vehicle->autopilotType() == MAV_AUTOPILOT_ARDUPILOTMEGA &&
+        (componentID == 0 || componentID == _vehicle->componentId())) {
+        const std::string ftpDir = "ParamCache/ftp_" + std::to_string(_vehicle->systemId());
+        std::error_code error;
+        std::filesystem::create_directories(ftpDir, error);
+        if (ftpManager->download(_vehicle->componentId(), "@PARAM/param.pck?withdefaults=1", ftpDir,
+                                 [this](const std::string &file, const std::string &errorMsg) { _ftpDownloadComplete(file, errorMsg); },
+                                 [this](float progress) { _ftpDownloadProgress(progress); })) {
+            LOG_INFO("Params", "Requesting all parameters of sysid={} with MAVLink FTP", _vehicle->systemId());
+            return;
+        }
+    }
+    
     // Start initial request timer
     _startInitialRequestTimer();
     
     // Send PARAM_REQUEST_LIST to request all parameters
+    _mavlinkParamRequestList(actualComponentId);
+}
+
+void ParameterManager::_mavlinkParamRequestList(int componentId)
+{
     mavlink_message_t message;
     mavlink_msg_param_request_list_pack(255, MAV_COMP_ID_MISSIONPLANNER, &message,
-                                       actualComponentId, actualComponentId);
+                                       _vehicle->systemId(), componentId);
     
     _vehicle->sendMessage(message);
     
-    std::cout << "Requesting all parameters for component " << actualComponentId << std::endl;
+    std::cout << "Requesting all parameters for component " << componentId << std::endl;
 }
 
 void ParameterManager::refreshParameter(int componentId, const std::string &paramName)
@@ -203,11 +231,13 @@ void ParameterManager::_startInitialRequestTimer()
 {
     _stopInitialRequestTimer();
     _initialRequestTimerActive = true;
+    uint64_t generation = ++_initialRequestTimerGeneration;
     _initialRequestStartTime = std::chrono::steady_clock::now();
     
-    _initialRequestTimeoutThread = std::thread([this]() {
+    _initialRequestTimeoutThread = std::thread([this, lifetime = _timerLifetime, generation]() {
         std::this_thread::sleep_for(std::chrono::seconds(5));
-        if (_initialRequestTimerActive.load() && _timersRunning.load()) {
+        std::lock_guard<std::mutex> lock(lifetime->mutex);
+        if (lifetime->alive && _initialRequestTimerActive.load() && _initialRequestTimerGeneration.load() == generation && _timersRunning.load()) {
             _initialRequestTimeout();
         }
     });
@@ -218,11 +248,13 @@ void ParameterManager::_startWaitingParamTimer()
 {
     _stopWaitingParamTimer();
     _waitingParamTimerActive = true;
+    uint64_t generation = ++_waitingParamTimerGeneration;
     _waitingParamStartTime = std::chrono::steady_clock::now();
     
-    _waitingParamTimeoutThread = std::thread([this]() {
+    _waitingParamTimeoutThread = std::thread([this, lifetime = _timerLifetime, generation]() {
         std::this_thread::sleep_for(std::chrono::seconds(3));
-        if (_waitingParamTimerActive.load() && _timersRunning.load()) {
+        std::lock_guard<std::mutex> lock(lifetime->mutex);
+        if (lifetime->alive && _waitingParamTimerActive.load() && _waitingParamTimerGeneration.load() == generation && _timersRunning.load()) {
             _waitingParamTimeout();
         }
     });
@@ -251,8 +283,8 @@ void ParameterManager::_initialRequestTimeout()
     
     if (!_disableAllRetries && (++_initialRequestRetryCount <= _maxInitialRequestListRetry)) {
         std::cout << "Retrying initial parameter request list, attempt " << _initialRequestRetryCount << std::endl;
-        refreshAllParameters();
         _startInitialRequestTimer();
+        _mavlinkParamRequestList(0);
     } else {
         std::cout << "Initial parameter request failed after " << _initialRequestRetryCount << " retries" << std::endl;
         _missingParameters = true;
@@ -357,6 +389,124 @@ void ParameterManager::_sendHashAck(int componentId, uint32_t crcValue)
     std::cout << "Sent hash acknowledgment: " << crcValue << std::endl;
 }
 
+void ParameterManager::_ftpDownloadComplete(const std::string &fileName, const std::string &errorMsg)
+{
+    bool parsed = false;
+    if (errorMsg.empty()) {
+        parsed = _parseParamFile(fileName);
+        std::error_code error;
+        std::filesystem::remove(fileName, error);
+    }
+    if (parsed) {
+        return;
+    }
+
+    // Not asked again for this vehicle, a failed download only delays every later load
+    LOG_WARNING("Params", "FTP parameter download from sysid={} failed ({}), using PARAM_REQUEST_LIST",
+                _vehicle->systemId(), errorMsg.empty() ? "invalid param.pck" : errorMsg);
+    _tryftp = false;
+    _startInitialRequestTimer();
+    _mavlinkParamRequestList(0);
+}
+
+void ParameterManager::_ftpDownloadProgress(float progress)
+{
+    _setLoadProgress(static_cast<double>(progress));
+}
+
+bool ParameterManager::_parseParamFile(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // Header: magic, parameters in the file, parameters of the vehicle
+    uint16_t header[3];
+    if (data.size() < sizeof(header)) {
+        LOG_WARNING("Params", "{} too short for a param.pck header", filename);
+        return false;
+    }
+    memcpy(header, data.data(), sizeof(header));
+    const uint16_t magic = header[0];
+    const uint16_t paramCount = header[1];
+    const bool withDefaults = magic == kParamPackMagicWithDefaults;
+    if (magic != kParamPackMagic && !withDefaults) {
+        LOG_WARNING("Params", "{} has unknown magic 0x{:04x}", filename, magic);
+        return false;
+    }
+
+    // Each entry: type and flags nibbles, length of the prefix shared with the previous name and
+    // length of the rest minus one, the rest of the name, the value and the default if flagged
+    const int componentId = _vehicle->componentId();
+    std::string name;
+    size_t pos = sizeof(header);
+    int index = 0;
+    bool valid = true;
+
+    _parsingParamFile = true;
+    while (pos < data.size() && index < paramCount) {
+        if (data[pos] == 0) {
+            // Padding, entries don't span FTP packets
+            pos++;
+            continue;
+        }
+        if (pos + 2 > data.size()) {
+            valid = false;
+            break;
+        }
+
+        const uint8_t type = data[pos] & 0x0F;
+        const uint8_t flags = data[pos] >> 4;
+        const size_t commonLength = data[pos + 1] & 0x0F;
+        const size_t nameLength = (data[pos + 1] >> 4) + 1;
+        pos += 2;
+
+        size_t valueSize;
+        uint8_t mavType;
+        switch (type) {
+            case 1: valueSize = 1; mavType = MAV_PARAM_TYPE_INT8; break;
+            case 2: valueSize = 2; mavType = MAV_PARAM_TYPE_INT16; break;
+            case 3: valueSize = 4; mavType = MAV_PARAM_TYPE_INT32; break;
+            case 4: valueSize = 4; mavType = MAV_PARAM_TYPE_REAL32; break;
+            default: valueSize = 0; mavType = 0; break;
+        }
+        const size_t defaultSize = (withDefaults && (flags & 1)) ? valueSize : 0;
+        if (valueSize == 0 || commonLength > name.size() || pos + nameLength + valueSize + defaultSize > data.size()) {
+            valid = false;
+            break;
+        }
+
+        name.resize(commonLength);
+        name.append(reinterpret_cast<const char*>(&data[pos]), nameLength);
+        pos += nameLength;
+
+        Fact::ValueVariant_t value;
+        switch (type) {
+            case 1: { int8_t v; memcpy(&v, &data[pos], sizeof(v)); value = v; break; }
+            case 2: { int16_t v; memcpy(&v, &data[pos], sizeof(v)); value = v; break; }
+            case 3: { int32_t v; memcpy(&v, &data[pos], sizeof(v)); value = v; break; }
+            default: { float v; memcpy(&v, &data[pos], sizeof(v)); value = v; break; }
+        }
+        pos += valueSize + defaultSize;
+
+        _handleParamValue(componentId, name, paramCount, index++, mavType, value);
+    }
+    _parsingParamFile = false;
+
+    if (!valid) {
+        LOG_WARNING("Params", "{} is malformed after {} of {} parameters", filename, index, paramCount);
+    }
+    if (index == 0) {
+        return false;
+    }
+
+    LOG_INFO("Params", "Loaded {} parameters of sysid={} from param.pck", index, _vehicle->systemId());
+    if (!_initialLoadComplete) {
+        // The file was cut short, param.pck is in index order so the rest is read by index
+        _startWaitingParamTimer();
+    }
+    return true;
+}
+
 std::string ParameterManager::_parameterCacheFile(int vehicleId, int componentId)
 {
     return "ParamCache/" + std::to_string(vehicleId) + "_" + std::to_string(componentId) + ".cache";
@@ -650,7 +800,7 @@ void ParameterManager::_setLoadProgress(double loadProgress)
     }
     
     // Notify progress updates
-    std::cout << "Parameter load progress: " << (loadProgress * 100.0) << "%" << std::endl;
+    LOG_DEBUG("Params", "Parameter load progress: {:.1f}%", loadProgress * 100.0);
 }
 
 int ParameterManager::_actualComponentId(int componentId) const
@@ -841,7 +991,7 @@ void ParameterManager::_handleParamValue(int componentId, const std::string &par
     
     // Disregard unrequested params prior to initial list response (ArduPilot behavior)
     if ((parameterIndex == 65535) && _initialRequestTimerActive.load()) {
-        std::cout << "Disregarding unrequested param prior to initial list response: " << parameterName << std::endl;
+        LOG_DEBUG("Params", "Disregarding unrequested param prior to initial list response: {}", parameterName);
         return;
     }
     
@@ -861,7 +1011,7 @@ void ParameterManager::_handleParamValue(int componentId, const std::string &par
             _waitingReadParamIndexMap[componentId][i] = 0;
         }
         
-        std::cout << "Seeing component " << componentId << " for first time - paramcount: " << parameterCount << std::endl;
+        LOG_INFO("Params", "Seeing component {} for first time - paramcount: {}", componentId, parameterCount);
     }
     
     // Remove from waiting list if present
@@ -906,8 +1056,10 @@ void ParameterManager::_handleParamValue(int componentId, const std::string &par
     }
     
     if (totalWaiting > 0) {
-        _startWaitingParamTimer();
-        std::cout << "Restarting waiting param timer - still waiting for " << totalWaiting << " parameters" << std::endl;
+        if (!_parsingParamFile) {
+            _startWaitingParamTimer();
+        }
+        LOG_DEBUG("Params", "Restarting waiting param timer - still waiting for {} parameters", totalWaiting);
     } else {
         // Check if initial load is complete
         _checkInitialLoadComplete();
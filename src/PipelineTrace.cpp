@@ -0,0 +1,258 @@
+#include "PipelineTrace.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace {
+
+struct Event {
+    std::atomic<const char*> category{nullptr};
+    std::atomic<const char*> name{nullptr};
+    std::atomic<const char*> argName{nullptr};
+    std::atomic<int64_t> arg{0};
+    std::atomic<uint64_t> startTicks{0};
+    std::atomic<uint64_t> endTicks{0};
+};
+
+/// Ring of one thread. Only the owner writes events and the position, the exporter reads behind it and
+/// drops whatever the owner may have overwritten meanwhile.
+struct ThreadBuffer {
+    std::atomic<bool> inUse{false};
+    std::atomic<long> threadId{0};
+    std::atomic<const char*> threadName{nullptr};
+    std::atomic<uint64_t> position{0};          ///< Events ever recorded
+    std::atomic<uint64_t> firstPosition{0};     ///< Events before it were cleared or belong to a previous owner
+    Event events[PipelineTrace::kEventsPerThread];
+};
+
+/// Buffers of all threads and interned names. Never destroyed, threads still running while static
+/// destructors run at exit keep recording into it.
+struct Registry {
+    std::mutex buffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;    // Never shrinks, buffers of exited threads are reused
+    std::mutex namesMutex;
+    std::set<std::string> names;
+};
+
+Registry& registry()
+{
+    static Registry *registry = new Registry();
+    return *registry;
+}
+
+// Clock pair taken when tracing is first enabled, TSC ticks are converted against the steady clock from here
+std::atomic<uint64_t> g_baseTicks{0};
+std::atomic<int64_t> g_baseNs{0};
+
+thread_local ThreadBuffer *t_buffer = nullptr;
+thread_local const char *t_threadName = nullptr;
+
+int64_t steadyNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// Hands the buffer to the next new thread when its owner exits, its events stay until then
+struct BufferOwner {
+    ThreadBuffer *buffer = nullptr;
+
+    ~BufferOwner()
+    {
+        t_buffer = nullptr;
+        if (buffer) {
+            buffer->inUse.store(false, std::memory_order_release);
+        }
+    }
+};
+
+ThreadBuffer& claimBuffer()
+{
+    static thread_local BufferOwner owner;
+
+    Registry &buffers = registry();
+    std::lock_guard<std::mutex> lock(buffers.buffersMutex);
+    ThreadBuffer *buffer = nullptr;
+    for (const auto &candidate : buffers.buffers) {
+        if (!candidate->inUse.load(std::memory_order_relaxed)) {
+            buffer = candidate.get();
+            break;
+        }
+    }
+    if (!buffer) {
+        buffers.buffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = buffers.buffers.back().get();
+    }
+
+    buffer->inUse.store(true, std::memory_order_relaxed);
+    buffer->threadId.store(static_cast<long>(syscall(SYS_gettid)), std::memory_order_relaxed);
+    buffer->threadName.store(t_threadName, std::memory_order_relaxed);
+    buffer->firstPosition.store(buffer->position.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    owner.buffer = buffer;
+    t_buffer = buffer;
+    return *buffer;
+}
+
+void appendJsonString(std::string &json, const char *text)
+{
+    json += '"';
+    for (; *text; text++) {
+        if (*text == '"' || *text == '\\') {
+            json += '\\';
+        }
+        json += (static_cast<unsigned char>(*text) < 0x20) ? ' ' : *text;
+    }
+    json += '"';
+}
+
+} // namespace
+
+void PipelineTrace::setEnabled(bool enabled)
+{
+    if (enabled && g_baseTicks.load() == 0) {
+        g_baseNs = steadyNs();
+        g_baseTicks = _ticks();
+    }
+    _enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void PipelineTrace::setThreadName(const char *name)
+{
+    t_threadName = name;
+    if (t_buffer) {
+        t_buffer->threadName.store(name, std::memory_order_relaxed);
+    }
+}
+
+const char* PipelineTrace::intern(const std::string &name)
+{
+    Registry &names = registry();
+    std::lock_guard<std::mutex> lock(names.namesMutex);
+    return names.names.insert(name).first->c_str();
+}
+
+void PipelineTrace::_record(const char *category, const char *name, const char *argName, int64_t arg,
+                            uint64_t startTicks, uint64_t endTicks)
+{
+    ThreadBuffer &buffer = t_buffer ? *t_buffer : claimBuffer();
+    const uint64_t position = buffer.position.load(std::memory_order_relaxed);
+    Event &event = buffer.events[position & (kEventsPerThread - 1)];
+    event.category.store(category, std::memory_order_relaxed);
+    event.name.store(name, std::memory_order_relaxed);
+    event.argName.store(argName, std::memory_order_relaxed);
+    event.arg.store(arg, std::memory_order_relaxed);
+    event.startTicks.store(startTicks, std::memory_order_relaxed);
+    event.endTicks.store(endTicks, std::memory_order_relaxed);
+    buffer.position.store(position + 1, std::memory_order_release);
+}
+
+void PipelineTrace::clear()
+{
+    Registry &buffers = registry();
+    std::lock_guard<std::mutex> lock(buffers.buffersMutex);
+    for (const auto &buffer : buffers.buffers) {
+        buffer->firstPosition.store(buffer->position.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+}
+
+std::string PipelineTrace::chromeTraceJson()
+{
+    // Ticks per microsecond over everything since tracing was enabled
+    const uint64_t baseTicks = g_baseTicks.load();
+    const int64_t elapsedNs = steadyNs() - g_baseNs.load();
+    const uint64_t elapsedTicks = _ticks() - baseTicks;
+    const double ticksPerUs = (baseTicks && elapsedNs > 0 && elapsedTicks > 0) ?
+        static_cast<double>(elapsedTicks) * 1000.0 / elapsedNs : 1000.0;
+
+    const long processId = static_cast<long>(getpid());
+    std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    char number[96];
+
+    struct Copy {
+        const char *category;
+        const char *name;
+        const char *argName;
+        int64_t arg;
+        uint64_t startTicks;
+        uint64_t endTicks;
+    };
+    std::vector<Copy> events;
+
+    Registry &buffers = registry();
+    std::lock_guard<std::mutex> lock(buffers.buffersMutex);
+    for (const auto &buffer : buffers.buffers) {
+        const uint64_t end = buffer->position.load(std::memory_order_acquire);
+        const long threadId = buffer->threadId.load(std::memory_order_relaxed);
+        const char *threadName = buffer->threadName.load(std::memory_order_relaxed);
+        uint64_t begin = std::max(buffer->firstPosition.load(std::memory_order_relaxed),
+                                  end > kEventsPerThread ? end - kEventsPerThread : 0);
+
+        events.clear();
+        for (uint64_t position = begin; position < end; position++) {
+            const Event &event = buffer->events[position & (kEventsPerThread - 1)];
+            events.push_back(Copy{event.category.load(std::memory_order_relaxed), event.name.load(std::memory_order_relaxed),
+                                  event.argName.load(std::memory_order_relaxed), event.arg.load(std::memory_order_relaxed),
+                                  event.startTicks.load(std::memory_order_relaxed), event.endTicks.load(std::memory_order_relaxed)});
+        }
+
+        // The event the owner is writing now overwrites the slot of the one kEventsPerThread before it
+        const uint64_t after = buffer->position.load(std::memory_order_acquire);
+        const uint64_t firstIntact = after >= kEventsPerThread ? after - kEventsPerThread + 1 : 0;
+        const size_t skip = firstIntact > begin ? static_cast<size_t>(firstIntact - begin) : 0;
+
+        if (threadName) {
+            json += first ? "" : ",";
+            first = false;
+            snprintf(number, sizeof(number), "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%ld,\"tid\":%ld,\"args\":{\"name\":",
+                     processId, threadId);
+            json += number;
+            appendJsonString(json, threadName);
+            json += "}}";
+        }
+
+        for (size_t index = skip; index < events.size(); index++) {
+            const Copy &event = events[index];
+            if (!event.name || event.startTicks < baseTicks) {
+                continue;
+            }
+            json += first ? "{" : ",{";
+            first = false;
+            json += "\"name\":";
+            appendJsonString(json, event.name);
+            json += ",\"cat\":";
+            appendJsonString(json, event.category ? event.category : "");
+            snprintf(number, sizeof(number), ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":%ld",
+                     (event.startTicks - baseTicks) / ticksPerUs, (event.endTicks - event.startTicks) / ticksPerUs,
+                     processId, threadId);
+            json += number;
+            if (event.argName) {
+                json += ",\"args\":{";
+                appendJsonString(json, event.argName);
+                snprintf(number, sizeof(number), ":%" PRId64 "}", event.arg);
+                json += number;
+            }
+            json += "}";
+        }
+    }
+
+    json += "]}\n";
+    return json;
+}
+
+bool PipelineTrace::writeChromeTrace(const std::string &path)
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << chromeTraceJson();
+    return static_cast<bool>(file);
+}
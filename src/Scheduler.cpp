@@ -0,0 +1,106 @@
+#include "Scheduler.h"
+
+Scheduler& Scheduler::instance()
+{
+    static Scheduler *scheduler = new Scheduler();
+    return *scheduler;
+}
+
+Scheduler::Scheduler()
+{
+    _running = true;
+    _thread = std::thread(&Scheduler::_threadFunc, this);
+}
+
+Scheduler::~Scheduler()
+{
+    shutdown();
+}
+
+Scheduler::TaskId Scheduler::schedule(std::chrono::milliseconds delay, Task task)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_running) {
+        return 0;
+    }
+
+    TaskId taskId = _nextTaskId++;
+    Clock::time_point deadline = Clock::now() + delay;
+    bool earliest = _tasks.empty() || Key(deadline, taskId) < _tasks.begin()->first;
+    _tasks.emplace(Key(deadline, taskId), std::move(task));
+    _deadlines.emplace(taskId, deadline);
+
+    if (earliest) {
+        _wakeup.notify_one();
+    }
+    return taskId;
+}
+
+bool Scheduler::cancel(TaskId taskId)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    auto deadline = _deadlines.find(taskId);
+    if (deadline != _deadlines.end()) {
+        _tasks.erase(Key(deadline->second, taskId));
+        _deadlines.erase(deadline);
+        return true;
+    }
+
+    if (taskId != 0 && std::this_thread::get_id() != _thread.get_id()) {
+        _taskFinished.wait(lock, [this, taskId]() { return _runningTaskId != taskId; });
+    }
+    return false;
+}
+
+void Scheduler::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_running) {
+            return;
+        }
+        _running = false;
+        _tasks.clear();
+        _deadlines.clear();
+    }
+    _wakeup.notify_one();
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
+
+size_t Scheduler::pendingTasks() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _tasks.size();
+}
+
+void Scheduler::_threadFunc()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (_running) {
+        if (_tasks.empty()) {
+            _wakeup.wait(lock);
+            continue;
+        }
+
+        auto next = _tasks.begin();
+        if (next->first.first > Clock::now()) {
+            _wakeup.wait_until(lock, next->first.first);
+            continue;
+        }
+
+        Task task = std::move(next->second);
+        _runningTaskId = next->first.second;
+        _deadlines.erase(_runningTaskId);
+        _tasks.erase(next);
+
+        lock.unlock();
+        task();
+        lock.lock();
+
+        _runningTaskId = 0;
+        _taskFinished.notify_all();
+    }
+}
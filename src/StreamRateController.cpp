@@ -0,0 +1,245 @@
+#include "StreamRateController.h"
+#include "CommandManager.h"
+#include "Vehicle.h"
+#include "MAVLinkUdpConnection.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cmath>
+
+StreamRateController::StreamRateController(Vehicle *vehicle, MAVLinkUdpConnection *connection)
+    : _vehicle(vehicle)
+    , _connection(connection)
+{
+}
+
+StreamRateController::~StreamRateController()
+{
+    Scheduler::TaskId updateTask;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _destroying = true;
+        updateTask = _updateTask;
+    }
+    Scheduler::instance().cancel(updateTask);
+
+    std::lock_guard<std::mutex> lock(_callbackLifetime->mutex);
+    _callbackLifetime->alive = false;
+}
+
+void StreamRateController::setDemand(uint32_t messageId, double rateHz)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (rateHz > 0.0) {
+        Stream &stream = _streams[messageId];
+        stream.demandHz = rateHz;
+        stream.removed = false;
+        if (const mavlink_msg_entry_t *entry = mavlink_get_msg_entry(messageId)) {
+            stream.frameBytes = entry->max_msg_len + MAVLINK_NUM_NON_PAYLOAD_BYTES;
+        }
+    } else {
+        auto it = _streams.find(messageId);
+        if (it != _streams.end()) {
+            it->second.removed = true;
+        }
+    }
+}
+
+void StreamRateController::setDemands(const std::map<uint32_t, double> &rates)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto& [messageId, stream] : _streams) {
+            if (!rates.contains(messageId)) {
+                stream.removed = true;
+            }
+        }
+    }
+    for (const auto& [messageId, rateHz] : rates) {
+        setDemand(messageId, rateHz);
+    }
+}
+
+void StreamRateController::setLinkCapacity(double bytesPerSecond)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _linkCapacity = std::max(0.0, bytesPerSecond);
+}
+
+void StreamRateController::start()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_started || _destroying) {
+        return;
+    }
+    _started = true;
+
+    if (_connection) {
+        const MAVLinkUdpConnection::SystemStats stats = _connection->getSystemStats(_vehicle->systemId());
+        _lastBytesReceived = stats.bytesReceived;
+        _lastMessagesReceived = stats.messagesReceived;
+        _lastMessagesLost = stats.messagesLost;
+    }
+    _lastUpdateTime = std::chrono::steady_clock::now();
+
+    // A known capacity bounds the first request already, before anything was measured
+    if (_linkCapacity > 0.0) {
+        double expected = _expectedBytesPerSecond(1.0);
+        if (expected > 0.0) {
+            _scale = std::clamp(_linkCapacity * kTargetUtilization / expected, kMinScale, 1.0);
+        }
+    }
+
+    _apply(true);
+    _scheduleUpdate();
+}
+
+void StreamRateController::reapply()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _reapply = true;
+}
+
+double StreamRateController::scale() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _scale;
+}
+
+double StreamRateController::appliedRate(uint32_t messageId) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _streams.find(messageId);
+    return it == _streams.end() ? 0.0 : it->second.appliedHz;
+}
+
+void StreamRateController::_scheduleUpdate()
+{
+    _updateTask = Scheduler::instance().schedule(std::chrono::milliseconds(kUpdateIntervalMsecs), [this]() { _update(); });
+}
+
+void StreamRateController::_update()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_destroying) {
+        return;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - _lastUpdateTime).count();
+    _lastUpdateTime = now;
+
+    if (_connection && seconds > 0.0) {
+        // Only this vehicle's frames, other vehicles on the same socket have links of their own
+        const MAVLinkUdpConnection::SystemStats stats = _connection->getSystemStats(_vehicle->systemId());
+        uint64_t bytesReceived = stats.bytesReceived;
+        uint64_t messagesReceived = stats.messagesReceived;
+        uint64_t messagesLost = stats.messagesLost;
+
+        double bytesPerSecond = (bytesReceived - _lastBytesReceived) / seconds;
+        uint64_t received = messagesReceived - _lastMessagesReceived;
+        uint64_t lost = messagesLost - _lastMessagesLost;
+        double lossPercent = received + lost > 0 ? 100.0 * lost / (received + lost) : 0.0;
+
+        _lastBytesReceived = bytesReceived;
+        _lastMessagesReceived = messagesReceived;
+        _lastMessagesLost = messagesLost;
+
+        // Only adjust while data flows, a silent link says nothing about its capacity
+        if (received > 0) {
+            bool congested = lossPercent > kHighLossPercent ||
+                             (_linkCapacity > 0.0 && bytesPerSecond > _linkCapacity * kTargetUtilization);
+            double scale = _scale;
+            if (congested) {
+                scale = std::max(kMinScale, _scale * kDecreaseFactor);
+            } else if (lossPercent < kLowLossPercent) {
+                scale = std::min(1.0, _scale + kIncreaseStep);
+            }
+
+            // Our own streams alone must fit the capacity, the vehicle's other traffic is seen in bytesPerSecond
+            if (_linkCapacity > 0.0) {
+                double expected = _expectedBytesPerSecond(1.0);
+                if (expected > 0.0) {
+                    scale = std::max(kMinScale, std::min(scale, _linkCapacity * kTargetUtilization / expected));
+                }
+            }
+
+            if (scale != _scale) {
+                LOG_DEBUG("StreamRate", "sysid={} {:.0f} B/s, loss {:.1f}%, scale {:.2f} -> {:.2f}",
+                          _vehicle->systemId(), bytesPerSecond, lossPercent, _scale, scale);
+                _scale = scale;
+            }
+        }
+    }
+
+    bool force = _reapply;
+    _reapply = false;
+    _apply(force);
+    _scheduleUpdate();
+}
+
+void StreamRateController::_apply(bool force)
+{
+    for (auto it = _streams.begin(); it != _streams.end(); ) {
+        Stream &stream = it->second;
+        const uint32_t messageId = it->first;
+
+        if (stream.removed) {
+            // Interval 0 returns the stream to the autopilot default
+            if (stream.appliedHz > 0.0) {
+                _vehicle->commandManager()->sendCommand(_vehicle->componentId(), MAV_CMD_SET_MESSAGE_INTERVAL,
+                                                        {static_cast<float>(messageId), 0, 0, 0, 0, 0, 0});
+            }
+            it = _streams.erase(it);
+            continue;
+        }
+
+        if (force) {
+            stream.rejected = false;
+        }
+        if (!stream.rejected) {
+            double rateHz = std::max(kMinRateHz, stream.demandHz * _scale);
+            if (force || stream.appliedHz == 0.0 || std::fabs(rateHz - stream.appliedHz) > stream.appliedHz * kResendThreshold) {
+                stream.appliedHz = rateHz;
+                _sendInterval(messageId, rateHz);
+            }
+        }
+        ++it;
+    }
+}
+
+void StreamRateController::_sendInterval(uint32_t messageId, double rateHz)
+{
+    const float intervalUsecs = static_cast<float>(std::round(1e6 / rateHz));
+    _vehicle->commandManager()->sendCommand(_vehicle->componentId(), MAV_CMD_SET_MESSAGE_INTERVAL,
+                                            {static_cast<float>(messageId), intervalUsecs, 0, 0, 0, 0, 0},
+                                            [this, lifetime = _callbackLifetime, messageId, rateHz](uint16_t, const CommandManager::Result &result) {
+        if (result.status != CommandManager::Result::Acked || result.accepted()) {
+            if (result.accepted()) {
+                LOG_DEBUG("StreamRate", "msgid {} at {:.1f}Hz", messageId, rateHz);
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> lifetimeLock(lifetime->mutex);
+        if (!lifetime->alive) {
+            return;
+        }
+        LOG_WARNING("StreamRate", "Vehicle rejected interval for msgid {}, MAV_RESULT {}", messageId, result.result);
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _streams.find(messageId);
+        if (it != _streams.end()) {
+            it->second.rejected = true;
+        }
+    });
+}
+
+double StreamRateController::_expectedBytesPerSecond(double scale) const
+{
+    double bytesPerSecond = 0.0;
+    for (const auto& [messageId, stream] : _streams) {
+        if (!stream.removed && !stream.rejected) {
+            bytesPerSecond += std::max(kMinRateHz, stream.demandHz * scale) * stream.frameBytes;
+        }
+    }
+    return bytesPerSecond;
+}
@@ -0,0 +1,324 @@
+#include "TelemetryLog.h"
+#include "Vehicle.h"
+#include "TimeSync.h"
+#include "AllocationCounter.h"
+#include "PipelineTrace.h"
+#include "VehicleGPSFactGroup.h"
+#include "VehicleBatteryFactGroup.h"
+#include "VehicleSystemStatusFactGroup.h"
+#include "VehicleRCFactGroup.h"
+#include "VehicleVibrationFactGroup.h"
+#include "VehicleTemperatureFactGroup.h"
+#include "VehicleEstimatorStatusFactGroup.h"
+#include "VehicleWindFactGroup.h"
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <variant>
+
+namespace {
+
+// Helper function to safely extract variant values
+template<typename T>
+T safeGetVariant(const FactMetaData::ValueVariant_t& variant, T defaultValue = T{}) {
+    try {
+        if (std::holds_alternative<T>(variant)) {
+            return std::get<T>(variant);
+        }
+    } catch (const std::bad_variant_access&) {
+        // Fall through to default value
+    }
+    return defaultValue;
+}
+
+} // namespace
+
+namespace TelemetryLog {
+
+std::string telemetrySnapshot(Vehicle *vehicle, int64_t timestampMs)
+{
+    ALLOCATION_SCOPE(Logging);
+    TRACE_SCOPE("log", "telemetry_snapshot");
+    if (!vehicle) {
+        return std::string();
+    }
+
+    std::ostringstream oss;
+    oss << "\n=== Telemetry Data ===" << std::endl;
+    
+    oss << "Timestamp: " << timestampMs << std::endl;
+
+    // Vehicle clock against ours, from TIMESYNC
+    TimeSync::Estimate clock = vehicle->timeSync()->estimate();
+    if (clock.synchronized) {
+        oss << std::fixed << std::setprecision(3);
+        oss << "VehicleClockOffset: " << clock.offsetMsecs << " ms" << std::endl;
+        oss << "VehicleClockDrift: " << clock.driftPpm << " ppm" << std::endl;
+        oss << "LinkRoundTrip: " << clock.rttMsecs << " ms" << std::endl;
+        oss << "LinkLatency: " << clock.latencyMsecs << " ms" << std::endl;
+    }
+    
+    // Main vehicle facts
+    auto roll = vehicle->roll();
+    auto pitch = vehicle->pitch();
+    auto heading = vehicle->heading();
+    auto groundSpeed = vehicle->groundSpeed();
+    auto altitudeAMSL = vehicle->altitudeAMSL();
+    auto altitudeRelative = vehicle->altitudeRelative();
+    auto climbRate = vehicle->climbRate();
+    auto throttlePct = vehicle->throttlePct();
+
+    oss << std::fixed << std::setprecision(6);
+    if (roll) oss << "Roll: " << safeGetVariant<double>(roll->cookedValue()) << std::endl;
+    if (pitch) oss << "Pitch: " << safeGetVariant<double>(pitch->cookedValue()) << std::endl;
+    if (heading) oss << "Heading: " << safeGetVariant<double>(heading->cookedValue()) << std::endl;
+    if (groundSpeed) oss << "GroundSpeed: " << safeGetVariant<double>(groundSpeed->cookedValue()) << std::endl;
+    if (altitudeAMSL) oss << "AltitudeAMSL: " << safeGetVariant<double>(altitudeAMSL->cookedValue()) << std::endl;
+    if (altitudeRelative) oss << "AltitudeRelative: " << safeGetVariant<double>(altitudeRelative->cookedValue()) << std::endl;
+    if (climbRate) oss << "ClimbRate: " << safeGetVariant<double>(climbRate->cookedValue()) << std::endl;
+    if (throttlePct) oss << "Throttle: " << safeGetVariant<uint16_t>(throttlePct->cookedValue()) << std::endl;
+
+    // GPS data
+    auto gpsGroup = vehicle->gpsFactGroup();
+    if (gpsGroup) {
+        auto lat = gpsGroup->getFact("lat");
+        auto lon = gpsGroup->getFact("lon");
+        auto satellites = gpsGroup->getFact("satellitesVisible");
+        auto fixType = gpsGroup->getFact("fixType");
+        auto hdop = gpsGroup->getFact("hdop");
+        auto vdop = gpsGroup->getFact("vdop");
+        auto alt = gpsGroup->getFact("alt");
+        auto eph = gpsGroup->getFact("eph");
+        auto epv = gpsGroup->getFact("epv");
+        
+        if (lat && lon) {
+            oss << "GPSLat: " << safeGetVariant<int32_t>(lat->cookedValue()) / 1e7 << std::endl;
+            oss << "GPSLon: " << safeGetVariant<int32_t>(lon->cookedValue()) / 1e7 << std::endl;
+        }
+        if (alt) oss << "GPSAlt: " << safeGetVariant<double>(alt->cookedValue()) << std::endl;
+        if (satellites) oss << "GPSSatellites: " << static_cast<int>(safeGetVariant<uint8_t>(satellites->cookedValue())) << std::endl;
+        if (fixType) oss << "GPSFixType: " << static_cast<int>(safeGetVariant<uint8_t>(fixType->cookedValue())) << std::endl;
+        if (hdop) oss << "GPSHDOP: " << safeGetVariant<double>(hdop->cookedValue()) << std::endl;
+        if (vdop) oss << "GPSVDOP: " << safeGetVariant<double>(vdop->cookedValue()) << std::endl;
+        if (eph) oss << "GPSEPH: " << safeGetVariant<double>(eph->cookedValue()) << std::endl;
+        if (epv) oss << "GPSEPV: " << safeGetVariant<double>(epv->cookedValue()) << std::endl;
+    }
+
+    // Battery data
+    auto batteryGroup = vehicle->batteryFactGroup();
+    if (batteryGroup) {
+        // System-level battery information
+        auto mavlinkVersion = batteryGroup->getFact("mavlinkVersion");
+        auto batteryCount = batteryGroup->getFact("batteryCount");
+        auto batterySystemType = batteryGroup->getFact("batterySystemType");
+        
+        if (mavlinkVersion) {
+            auto versionVal = safeGetVariant<uint8_t>(mavlinkVersion->cookedValue());
+            std::string versionStr = (versionVal == 1) ? "v1.0" : 
+                                    (versionVal == 2) ? "v2.0" : "Unknown";
+            oss << "BatteryMAVLinkVersion: " << versionStr << std::endl;
+        }
+        if (batteryCount) {
+            auto countVal = safeGetVariant<uint8_t>(batteryCount->cookedValue());
+            std::string countStr = (countVal == 255) ? "None" : 
+                                  (countVal == 1) ? "1 Battery" : 
+                                  (countVal == 2) ? "2 Batteries" : 
+                                  std::to_string(countVal) + " Batteries";
+            oss << "BatteryCount: " << countStr << std::endl;
+        }
+        if (batterySystemType) {
+            auto typeVal = safeGetVariant<uint8_t>(batterySystemType->cookedValue());
+            std::string typeStr = (typeVal == 0) ? "No Battery" : 
+                                 (typeVal == 1) ? "Basic System" : 
+                                 (typeVal == 2) ? "Enhanced System" : 
+                                 (typeVal == 3) ? "Dual Battery System" : 
+                                 (typeVal == 4) ? "Multi-Battery System" : "Unknown";
+            oss << "BatterySystemType: " << typeStr << std::endl;
+        }
+        
+        // Individual battery metrics
+        auto voltage = batteryGroup->getFact("voltage");
+        auto current = batteryGroup->getFact("current");
+        auto percent = batteryGroup->getFact("percent");
+        auto consumed = batteryGroup->getFact("consumed");
+        auto remaining = batteryGroup->getFact("remaining");
+        auto temperature = batteryGroup->getFact("temperature");
+        auto id = batteryGroup->getFact("id");
+        auto function = batteryGroup->getFact("function");
+        auto type = batteryGroup->getFact("type");
+        auto timeRemaining = batteryGroup->getFact("timeRemaining");
+        auto chargeState = batteryGroup->getFact("chargeState");
+        auto mode = batteryGroup->getFact("mode");
+        auto faultBitmask = batteryGroup->getFact("faultBitmask");
+        auto cellCount = batteryGroup->getFact("cellCount");
+        
+        if (voltage) oss << "BatteryVoltage: " << safeGetVariant<float>(voltage->cookedValue()) << " V" << std::endl;
+        if (current) oss << "BatteryCurrent: " << safeGetVariant<float>(current->cookedValue()) << " A" << std::endl;
+        if (percent) {
+            auto percentVal = safeGetVariant<uint8_t>(percent->cookedValue());
+            if (percentVal != 255) {
+                oss << "BatteryPercent: " << static_cast<int>(percentVal) << "%" << std::endl;
+            } else {
+                oss << "BatteryPercent: N/A" << std::endl;
+            }
+        }
+        if (consumed) oss << "BatteryConsumed: " << safeGetVariant<float>(consumed->cookedValue()) << " Ah" << std::endl;
+        if (remaining) oss << "BatteryRemaining: " << safeGetVariant<float>(remaining->cookedValue()) << " Ah" << std::endl;
+        if (temperature) oss << "BatteryTemperature: " << safeGetVariant<float>(temperature->cookedValue()) << " °C" << std::endl;
+        if (id) {
+            auto idVal = safeGetVariant<uint8_t>(id->cookedValue());
+            if (idVal != 255) {
+                oss << "BatteryID: " << static_cast<int>(idVal) << std::endl;
+            }
+        }
+        if (function) oss << "BatteryFunction: " << static_cast<int>(safeGetVariant<uint8_t>(function->cookedValue())) << std::endl;
+        if (type) oss << "BatteryType: " << static_cast<int>(safeGetVariant<uint8_t>(type->cookedValue())) << std::endl;
+        if (timeRemaining) {
+            auto timeVal = safeGetVariant<uint32_t>(timeRemaining->cookedValue());
+            if (timeVal != UINT32_MAX) {
+                oss << "BatteryTimeRemaining: " << timeVal << " s" << std::endl;
+            }
+        }
+        if (chargeState) {
+            auto chargeVal = safeGetVariant<uint8_t>(chargeState->cookedValue());
+            if (chargeVal != UINT8_MAX) {
+                oss << "BatteryChargeState: " << static_cast<int>(chargeVal) << std::endl;
+            }
+        }
+        if (mode) {
+            auto modeVal = safeGetVariant<uint8_t>(mode->cookedValue());
+            if (modeVal != UINT8_MAX) {
+                oss << "BatteryMode: " << static_cast<int>(modeVal) << std::endl;
+            }
+        }
+        if (faultBitmask) {
+            auto faultVal = safeGetVariant<uint32_t>(faultBitmask->cookedValue());
+            if (faultVal != UINT32_MAX) {
+                oss << "BatteryFaultBitmask: 0x" << std::hex << faultVal << std::dec << std::endl;
+            }
+        }
+        if (cellCount) {
+            auto cellVal = safeGetVariant<uint16_t>(cellCount->cookedValue());
+            if (cellVal > 0) {
+                oss << "BatteryCellCount: " << cellVal << std::endl;
+            }
+        }
+    }
+
+    // System Status data
+    auto systemStatusGroup = vehicle->systemStatusFactGroup();
+    if (systemStatusGroup) {
+        auto sensorPresent = systemStatusGroup->getFact("sensorPresent");
+        auto sensorHealth = systemStatusGroup->getFact("sensorHealth");
+        auto sensorErrors = systemStatusGroup->getFact("sensorErrors");
+        auto onboardControlSensorsPresent = systemStatusGroup->getFact("onboardControlSensorsPresent");
+        auto onboardControlSensorsHealth = systemStatusGroup->getFact("onboardControlSensorsHealth");
+        auto onboardControlSensorsErrors = systemStatusGroup->getFact("onboardControlSensorsErrors");
+        
+        if (sensorPresent) oss << "SensorPresent: 0x" << std::hex << safeGetVariant<uint32_t>(sensorPresent->cookedValue()) << std::dec << std::endl;
+        if (sensorHealth) oss << "SensorHealth: 0x" << std::hex << safeGetVariant<uint32_t>(sensorHealth->cookedValue()) << std::dec << std::endl;
+        if (sensorErrors) oss << "SensorErrors: 0x" << std::hex << safeGetVariant<uint32_t>(sensorErrors->cookedValue()) << std::dec << std::endl;
+        if (onboardControlSensorsPresent) oss << "ControlSensorsPresent: 0x" << std::hex << safeGetVariant<uint32_t>(onboardControlSensorsPresent->cookedValue()) << std::dec << std::endl;
+        if (onboardControlSensorsHealth) oss << "ControlSensorsHealth: 0x" << std::hex << safeGetVariant<uint32_t>(onboardControlSensorsHealth->cookedValue()) << std::dec << std::endl;
+        if (onboardControlSensorsErrors) oss << "ControlSensorsErrors: 0x" << std::hex << safeGetVariant<uint32_t>(onboardControlSensorsErrors->cookedValue()) << std::dec << std::endl;
+    }
+
+    // RC data
+    auto rcGroup = vehicle->rcFactGroup();
+    if (rcGroup) {
+        auto rcRSSI = rcGroup->getFact("rssi");
+        auto rcChannelCount = rcGroup->getFact("channelCount");
+        auto rcRSSI_DBM = rcGroup->getFact("rssiDbm");
+        auto rcRSSIPercent = rcGroup->getFact("rssiPercent");
+        
+        if (rcRSSI) oss << "RCRSSI: " << static_cast<int>(safeGetVariant<uint8_t>(rcRSSI->cookedValue())) << std::endl;
+        if (rcRSSI_DBM) oss << "RCRSSIDBM: " << static_cast<int>(safeGetVariant<int8_t>(rcRSSI_DBM->cookedValue())) << std::endl;
+        if (rcRSSIPercent) oss << "RCRSSIPercent: " << static_cast<int>(safeGetVariant<uint8_t>(rcRSSIPercent->cookedValue())) << std::endl;
+        if (rcChannelCount) oss << "RCChannels: " << static_cast<int>(safeGetVariant<uint8_t>(rcChannelCount->cookedValue())) << std::endl;
+    }
+
+    // Vibration data
+    auto vibrationGroup = vehicle->vibrationFactGroup();
+    if (vibrationGroup) {
+        auto vibrationX = vibrationGroup->getFact("vibrationX");
+        auto vibrationY = vibrationGroup->getFact("vibrationY");
+        auto vibrationZ = vibrationGroup->getFact("vibrationZ");
+        auto clippingX = vibrationGroup->getFact("clippingX");
+        auto clippingY = vibrationGroup->getFact("clippingY");
+        auto clippingZ = vibrationGroup->getFact("clippingZ");
+        
+        if (vibrationX) oss << "VibrationX: " << safeGetVariant<float>(vibrationX->cookedValue()) << std::endl;
+        if (vibrationY) oss << "VibrationY: " << safeGetVariant<float>(vibrationY->cookedValue()) << std::endl;
+        if (vibrationZ) oss << "VibrationZ: " << safeGetVariant<float>(vibrationZ->cookedValue()) << std::endl;
+        if (clippingX) oss << "VibrationClippingX: " << static_cast<int>(safeGetVariant<uint8_t>(clippingX->cookedValue())) << std::endl;
+        if (clippingY) oss << "VibrationClippingY: " << static_cast<int>(safeGetVariant<uint8_t>(clippingY->cookedValue())) << std::endl;
+        if (clippingZ) oss << "VibrationClippingZ: " << static_cast<int>(safeGetVariant<uint8_t>(clippingZ->cookedValue())) << std::endl;
+    }
+
+    // Temperature data
+    auto temperatureGroup = vehicle->temperatureFactGroup();
+    if (temperatureGroup) {
+        auto temperature1 = temperatureGroup->getFact("temperature1");
+        auto temperature2 = temperatureGroup->getFact("temperature2");
+        auto temperature3 = temperatureGroup->getFact("temperature3");
+        
+        if (temperature1) oss << "Temperature1: " << safeGetVariant<float>(temperature1->cookedValue()) << std::endl;
+        if (temperature2) oss << "Temperature2: " << safeGetVariant<float>(temperature2->cookedValue()) << std::endl;
+        if (temperature3) oss << "Temperature3: " << safeGetVariant<float>(temperature3->cookedValue()) << std::endl;
+    }
+
+    // Estimator Status data
+    auto estimatorStatusGroup = vehicle->estimatorStatusFactGroup();
+    if (estimatorStatusGroup) {
+        auto estimatorFlags = estimatorStatusGroup->getFact("flags");
+        auto innovationPosHoriz = estimatorStatusGroup->getFact("innovationPosHoriz");
+        auto innovationPosVert = estimatorStatusGroup->getFact("innovationPosVert");
+        auto innovationVelHoriz = estimatorStatusGroup->getFact("innovationVelHoriz");
+        auto innovationVelVert = estimatorStatusGroup->getFact("innovationVelVert");
+        auto innovationMag = estimatorStatusGroup->getFact("innovationMag");
+        auto innovationYaw = estimatorStatusGroup->getFact("innovationYaw");
+        
+        if (estimatorFlags) oss << "EstimatorFlags: 0x" << std::hex << safeGetVariant<uint32_t>(estimatorFlags->cookedValue()) << std::dec << std::endl;
+        if (innovationPosHoriz) oss << "InnovationPosHoriz: " << safeGetVariant<float>(innovationPosHoriz->cookedValue()) << std::endl;
+        if (innovationPosVert) oss << "InnovationPosVert: " << safeGetVariant<float>(innovationPosVert->cookedValue()) << std::endl;
+        if (innovationVelHoriz) oss << "InnovationVelHoriz: " << safeGetVariant<float>(innovationVelHoriz->cookedValue()) << std::endl;
+        if (innovationVelVert) oss << "InnovationVelVert: " << safeGetVariant<float>(innovationVelVert->cookedValue()) << std::endl;
+        if (innovationMag) oss << "InnovationMag: " << safeGetVariant<float>(innovationMag->cookedValue()) << std::endl;
+        if (innovationYaw) oss << "InnovationYaw: " << safeGetVariant<float>(innovationYaw->cookedValue()) << std::endl;
+    }
+
+    // Wind data
+    auto windGroup = vehicle->windFactGroup();
+    if (windGroup) {
+        auto windDirection = windGroup->getFact("direction");
+        auto windSpeed = windGroup->getFact("speed");
+        auto windClimb = windGroup->getFact("climb");
+        
+        if (windDirection) oss << "WindDirection: " << safeGetVariant<float>(windDirection->cookedValue()) << std::endl;
+        if (windSpeed) oss << "WindSpeed: " << safeGetVariant<float>(windSpeed->cookedValue()) << std::endl;
+        if (windClimb) oss << "WindClimb: " << safeGetVariant<float>(windClimb->cookedValue()) << std::endl;
+    }
+
+    return oss.str();
+}
+
+void writeMessageLine(std::ostream &out, int64_t timestampMs, const mavlink_message_t &message, Vehicle *vehicle)
+{
+    ALLOCATION_SCOPE(Logging);
+    TRACE_SCOPE("log", "message_line");
+    out << timestampMs << ",MSG," << static_cast<int>(message.msgid)
+        << "," << static_cast<int>(message.sysid)
+        << "," << static_cast<int>(message.compid)
+        << "," << static_cast<int>(message.len) << ",";
+
+    // When the vehicle took the sample, on the same clock, once its clock is synchronized
+    uint64_t vehicleUsec;
+    std::chrono::steady_clock::time_point sampleTime;
+    if (vehicle && TimeSync::messageTime(message, vehicleUsec) && vehicle->timeSync()->vehicleToLocal(vehicleUsec, sampleTime)) {
+        out << timestampMs - std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - sampleTime).count();
+    }
+    out << std::endl;
+}
+
+} // namespace TelemetryLog
@@ -0,0 +1,310 @@
+#include "TimeSync.h"
+#include "Vehicle.h"
+#include "MAVLinkMessageFactGroup.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+constexpr int64_t kNsPerMsec = 1000000;
+constexpr uint64_t kUnixTimeUsec = 1000000000000000ull;    // ~2001, boot clocks never get there
+
+struct TimeField {
+    uint16_t wireOffset;
+    bool usec;              ///< time_usec, otherwise time_boot_ms
+};
+
+/// Time field of every message of the dialect which has one
+const std::unordered_map<uint32_t, TimeField>& timeFields()
+{
+    static const std::unordered_map<uint32_t, TimeField> fields = []() {
+        std::unordered_map<uint32_t, TimeField> fields;
+        for (const mavlink_message_info_t &info : MAVLinkMessageFactGroup::allMessageInfo()) {
+            for (unsigned i = 0; i < info.num_fields; i++) {
+                const mavlink_field_info_t &field = info.fields[i];
+                if (field.array_length != 0) {
+                    continue;
+                }
+                if (field.type == MAVLINK_TYPE_UINT32_T && strcmp(field.name, "time_boot_ms") == 0) {
+                    fields[info.msgid] = TimeField{static_cast<uint16_t>(field.wire_offset), false};
+                    break;
+                }
+                if (field.type == MAVLINK_TYPE_UINT64_T && strcmp(field.name, "time_usec") == 0) {
+                    fields[info.msgid] = TimeField{static_cast<uint16_t>(field.wire_offset), true};
+                    break;
+                }
+            }
+        }
+        return fields;
+    }();
+    return fields;
+}
+
+} // namespace
+
+TimeSync::TimeSync(Vehicle *vehicle)
+    : _vehicle(vehicle)
+{
+}
+
+TimeSync::~TimeSync()
+{
+    Scheduler::TaskId requestTask;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _destroying = true;
+        requestTask = _requestTask;
+    }
+    Scheduler::instance().cancel(requestTask);
+}
+
+void TimeSync::start()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_started || _destroying) {
+        return;
+    }
+    _started = true;
+    _sendRequest();
+    _scheduleRequest();
+}
+
+void TimeSync::restart()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _samples.clear();
+    _jumpCount = 0;
+    _synchronized = false;
+    _latencyValid = false;
+}
+
+void TimeSync::mavlinkMessageReceived(const mavlink_message_t &message)
+{
+    const int64_t nowNs = _nowNs();
+
+    if (message.msgid != MAVLINK_MSG_ID_TIMESYNC) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_synchronized) {
+            _updateLatency(message, nowNs);
+        }
+        return;
+    }
+
+    mavlink_timesync_t timesync;
+    mavlink_msg_timesync_decode(&message, &timesync);
+    if (timesync.target_system != 0 && timesync.target_system != 255) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_destroying) {
+        return;
+    }
+    if (timesync.tc1 == 0) {
+        // The vehicle syncing to us, PX4 does
+        _sendResponse(message, timesync.ts1);
+    } else if (message.compid == _vehicle->componentId()) {
+        _handleResponse(timesync.tc1, timesync.ts1, nowNs);
+    }
+}
+
+bool TimeSync::synchronized() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _synchronized;
+}
+
+TimeSync::Estimate TimeSync::estimate() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    Estimate estimate;
+    estimate.synchronized = _synchronized;
+    estimate.samples = _samples.size();
+    if (_synchronized) {
+        estimate.offsetMsecs = (_offsetNs + _drift * static_cast<double>(_nowNs() - _referenceNs)) / kNsPerMsec;
+        estimate.driftPpm = _drift * 1e6;
+        estimate.rttMsecs = static_cast<double>(_minRttNs) / kNsPerMsec;
+        estimate.latencyMsecs = _latencyValid ? _latencyMsecs : 0.0;
+    }
+    return estimate;
+}
+
+bool TimeSync::vehicleToLocal(uint64_t vehicleUsec, std::chrono::steady_clock::time_point &local) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (!_synchronized) {
+        return false;
+    }
+    const int64_t localNs = _vehicleToLocalNs(static_cast<int64_t>(vehicleUsec) * 1000);
+    local = std::chrono::steady_clock::time_point(
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(localNs)));
+    return true;
+}
+
+bool TimeSync::messageTime(const mavlink_message_t &message, uint64_t &vehicleUsec)
+{
+    const auto &fields = timeFields();
+    auto it = fields.find(message.msgid);
+    if (it == fields.end()) {
+        return false;
+    }
+
+    // MAVLink 2 strips trailing zero bytes, which may include the high bytes of the time
+    const TimeField &field = it->second;
+    const size_t size = field.usec ? sizeof(uint64_t) : sizeof(uint32_t);
+    uint64_t value = 0;
+    if (message.len > field.wireOffset) {
+        memcpy(&value, _MAV_PAYLOAD(&message) + field.wireOffset, std::min<size_t>(size, message.len - field.wireOffset));
+    }
+    vehicleUsec = field.usec ? value : value * 1000;
+    return vehicleUsec != 0 && vehicleUsec < kUnixTimeUsec;
+}
+
+void TimeSync::_scheduleRequest()
+{
+    const int interval = _synchronized ? kTrackIntervalMsecs : kAcquireIntervalMsecs;
+    _requestTask = Scheduler::instance().schedule(std::chrono::milliseconds(interval), [this]() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_destroying) {
+            return;
+        }
+        _sendRequest();
+        _scheduleRequest();
+    });
+}
+
+void TimeSync::_sendRequest()
+{
+    const int64_t ts1 = _nowNs();
+    _sentTimestamps[_nextSentTimestamp] = ts1;
+    _nextSentTimestamp = (_nextSentTimestamp + 1) % _sentTimestamps.size();
+
+    mavlink_message_t message;
+    mavlink_msg_timesync_pack(255, MAV_COMP_ID_MISSIONPLANNER, &message, 0, ts1,
+                              _vehicle->systemId(), _vehicle->componentId());
+    _vehicle->sendMessage(message);
+}
+
+void TimeSync::_sendResponse(const mavlink_message_t &request, int64_t ts1)
+{
+    mavlink_message_t message;
+    mavlink_msg_timesync_pack(255, MAV_COMP_ID_MISSIONPLANNER, &message, _nowNs(), ts1, request.sysid, request.compid);
+    _vehicle->sendMessage(message);
+}
+
+void TimeSync::_handleResponse(int64_t tc1, int64_t ts1, int64_t nowNs)
+{
+    // Only answers to our own requests, anything else was meant for another ground station
+    if (ts1 == 0 || std::find(_sentTimestamps.begin(), _sentTimestamps.end(), ts1) == _sentTimestamps.end()) {
+        return;
+    }
+    const int64_t rttNs = nowNs - ts1;
+    if (rttNs < 0 || rttNs > kMaxRttMsecs * kNsPerMsec) {
+        return;
+    }
+
+    Sample sample;
+    sample.localNs = ts1 + rttNs / 2;
+    sample.offsetNs = tc1 - sample.localNs;
+    sample.rttNs = rttNs;
+
+    if (_synchronized) {
+        const double predicted = _offsetNs + _drift * static_cast<double>(sample.localNs - _referenceNs);
+        if (std::fabs(static_cast<double>(sample.offsetNs) - predicted) > static_cast<double>(kResetOffsetMsecs * kNsPerMsec)) {
+            if (++_jumpCount < kResetSamples) {
+                return;
+            }
+            LOG_INFO("TimeSync", "Clock of sysid={} jumped by {}ms, starting over", _vehicle->systemId(),
+                     static_cast<int64_t>((static_cast<double>(sample.offsetNs) - predicted) / kNsPerMsec));
+            _samples.clear();
+            _synchronized = false;
+            _latencyValid = false;
+        }
+    }
+    _jumpCount = 0;
+
+    _samples.push_back(sample);
+    if (_samples.size() > kWindowSamples) {
+        _samples.pop_front();
+    }
+    _updateEstimate();
+}
+
+void TimeSync::_updateEstimate()
+{
+    int64_t minRttNs = _samples.front().rttNs;
+    for (const Sample &sample : _samples) {
+        minRttNs = std::min(minRttNs, sample.rttNs);
+    }
+    const int64_t maxRttNs = minRttNs + std::max<int64_t>(static_cast<int64_t>(minRttNs * kRttTolerance), 2 * kNsPerMsec);
+
+    // Least squares relative to the newest sample and the first offset, the raw values don't fit a double
+    const int64_t referenceNs = _samples.back().localNs;
+    const int64_t baseOffsetNs = _samples.front().offsetNs;
+    double n = 0.0, sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumXY = 0.0;
+    int64_t firstNs = referenceNs;
+    for (const Sample &sample : _samples) {
+        if (sample.rttNs > maxRttNs) {
+            continue;
+        }
+        firstNs = std::min(firstNs, sample.localNs);
+        const double x = static_cast<double>(sample.localNs - referenceNs);
+        const double y = static_cast<double>(sample.offsetNs - baseOffsetNs);
+        n += 1.0;
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+    }
+
+    // Over a short span the timing noise of the exchanges swamps the drift, keep the last one
+    double drift = _samples.size() > 1 ? _drift : 0.0;
+    const double denominator = n * sumXX - sumX * sumX;
+    if (n >= 3.0 && denominator > 0.0 && referenceNs - firstNs >= kMinDriftSpanMsecs * kNsPerMsec) {
+        drift = std::clamp((n * sumXY - sumX * sumY) / denominator, -kMaxDriftPpm * 1e-6, kMaxDriftPpm * 1e-6);
+    }
+
+    const bool wasSynchronized = _synchronized;
+    _referenceNs = referenceNs;
+    _drift = drift;
+    _offsetNs = static_cast<double>(baseOffsetNs) + (sumY - drift * sumX) / n;
+    _minRttNs = minRttNs;
+    _synchronized = _samples.size() >= kMinSamples;
+
+    if (_synchronized && !wasSynchronized) {
+        LOG_INFO("TimeSync", "Clock of sysid={} synchronized, offset {:.1f}ms, round trip {:.1f}ms", _vehicle->systemId(),
+                 _offsetNs / kNsPerMsec, static_cast<double>(_minRttNs) / kNsPerMsec);
+    }
+}
+
+void TimeSync::_updateLatency(const mavlink_message_t &message, int64_t nowNs)
+{
+    uint64_t vehicleUsec;
+    if (!messageTime(message, vehicleUsec)) {
+        return;
+    }
+
+    const int64_t sampleNs = _vehicleToLocalNs(static_cast<int64_t>(vehicleUsec) * 1000);
+    const double latencyMsecs = static_cast<double>(nowNs - sampleNs) / kNsPerMsec;
+    if (_latencyValid) {
+        _latencyMsecs += kLatencySmoothing * (latencyMsecs - _latencyMsecs);
+    } else {
+        _latencyMsecs = latencyMsecs;
+        _latencyValid = true;
+    }
+}
+
+int64_t TimeSync::_vehicleToLocalNs(int64_t vehicleNs) const
+{
+    // vehicle = local + offset + drift * (local - reference), solved for local
+    const double sinceReference = (static_cast<double>(vehicleNs - _referenceNs) - _offsetNs) / (1.0 + _drift);
+    return _referenceNs + std::llround(sinceReference);
+}
+
+int64_t TimeSync::_nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -9,12 +9,22 @@
 #include "VehicleTemperatureFactGroup.h"
 #include "VehicleEstimatorStatusFactGroup.h"
 #include "VehicleWindFactGroup.h"
+#include "MAVLinkMessageFactGroup.h"
+#include "FactArena.h"
 #include <iostream>
 #include <sstream>
 #include <iomanip>
 #include <thread>
 #include <chrono>
 #include "ParameterManager.h"
+#include "CommandManager.h"
+#include "StreamRateController.h"
+#include "LogDownloader.h"
+#include "FTPManager.h"
+#include "MissionManager.h"
+#include "TimeSync.h"
+#include "AllocationCounter.h"
+#include "PipelineTrace.h"
 
 // MAVLink headers for version information
 #include "../thirdparty/c_library_v2/standard/mavlink_msg_autopilot_version.h"
@@ -22,6 +32,7 @@
 
 // Board identification
 #include "BoardIdentifier.h"
+#include "Logger.h"
 
 // MAVLink constants
 #define MAVLINK_MSG_ID_AUTOPILOT_VERSION 148
@@ -37,12 +48,46 @@ Vehicle::Vehicle(MAVLinkUdpConnection* connection)
         _connection->setVehicle(this);
     }
     
-    _parameterManager = std::make_shared<ParameterManager>(this);
+    _createManagers();
+}
+
+Vehicle::Vehicle(MAVLinkUdpConnection* connection, uint8_t systemId, uint8_t componentId,
+                 const std::vector<std::string> &messageFactGroups, bool factArena)
+    : FactGroup(100) // Update every 100ms
+    , _systemId(systemId)
+    , _componentId(componentId)
+    , _connection(connection)
+    , _managed(true)
+{
+    if (factArena) {
+        // Message fact groups rarely have more fields, any beyond the capacity are allocated on their own
+        _factArena = std::make_shared<FactArena>(FactArena::kVehicleFactCapacity + 64 * messageFactGroups.size());
+    }
+    {
+        FactArena::Scope arenaScope(_factArena.get());
+        _initializeFactGroups();
+        _addMessageFactGroups(messageFactGroups);
+    }
+    if (_factArena) {
+        LOG_DEBUG("Vehicle", "sysid={} {} facts in a {} byte arena, {} did not fit", _systemId,
+                  _factArena->factCount(), _factArena->blockBytes(), _factArena->overflowCount());
+    }
+    
+    _createManagers();
 }
 
 Vehicle::~Vehicle()
 {
-    if (_connection) {
+    // All still reference the vehicle from scheduler tasks, the controller sends through the command manager
+    // and FTP downloads complete into the parameter manager
+    _ftpManager.reset();
+    _missionManager.reset();
+    _timeSync.reset();
+    _logDownloader.reset();
+    _streamRateController.reset();
+    _commandManager.reset();
+    
+    if (_connection && !_managed) {
         _connection->setVehicle(nullptr);
     }
 }
@@ -55,16 +100,20 @@ bool Vehicle::sendMessage(const mavlink_message_t &message)
     return false;
 }
 
-bool Vehicle::sendCommand(uint16_t command, uint8_t confirmation, 
+bool Vehicle::sendCommand(uint16_t command, uint8_t /*confirmation*/, 
                          float param1, float param2, float param3, 
                          float param4, float param5, float param6, float param7)
 {
-    mavlink_message_t message;
-    mavlink_msg_command_long_pack(255, MAV_COMP_ID_MISSIONPLANNER, &message,
-                                 _systemId, _componentId, command, confirmation,
-                                 param1, param2, param3, param4, param5, param6, param7);
-    
-    return sendMessage(message);
+    if (!_connection) {
+        return false;
+    }
+    _commandManager->sendCommand(_componentId, command, {param1, param2, param3, param4, param5, param6, param7});
+    return true;
+}
+
+void Vehicle::setGCSPosition(double latitude, double longitude)
+{
+    _vehicleFactGroup->setGCSPosition(latitude, longitude);
 }
 
 bool Vehicle::armed() const
@@ -171,26 +220,25 @@ std::string Vehicle::systemStatusString() const
 
 void Vehicle::handleMessage(const mavlink_message_t &message)
 {
-    static uint32_t totalMessages = 0;
-    static std::map<uint32_t, uint32_t> messageCounts;
-    
-    totalMessages++;
-    messageCounts[message.msgid]++;
+    ALLOCATION_SCOPE(Dispatch);
+    TRACE_SCOPE_ARG("vehicle", "dispatch", "msgid", message.msgid);
+    AllocationCounter::countMessage();
+    _totalMessages++;
     
     // Debug: Log every message type for first 100 messages
-    if (totalMessages <= 100 || totalMessages % 100 == 0) {
-        std::cout << "[DEBUG] Message #" << totalMessages << ": MSGID " << (int)message.msgid 
-                  << " from sysid=" << (int)message.sysid << " compid=" << (int)message.compid << std::endl;
+    if (_totalMessages <= 100 || _totalMessages % 100 == 0) {
+        LOG_DEBUG("Vehicle", "Message #{}: MSGID {} from sysid={} compid={}", _totalMessages, message.msgid, message.sysid, message.compid);
     }
     
     // Debug: Log message statistics every 500 messages
-    if (totalMessages % 500 == 0) {
-        std::cout << "[DEBUG] Vehicle: Processed " << totalMessages 
-                  << " total messages. Message counts:" << std::endl;
-        for (const auto& pair : messageCounts) {
-            std::cout << "  MSGID " << pair.first << ": " << pair.second << " messages" << std::endl;
+    if constexpr (Logger::Debug >= MAVCOLLECTOR_LOG_LEVEL) {
+        if (_totalMessages % 500 == 0 && _connection && Logger::instance().isEnabled(Logger::Debug)) {
+            LOG_DEBUG("Vehicle", "Processed {} total messages. Message rates:", _totalMessages);
+            for (const auto& entry : _connection->messageRates().snapshot(message.sysid)) {
+                LOG_DEBUG("Vehicle", "  MSGID {} {}: {} messages, {:.1f} Hz, {:.0f} B/s", entry.messageId, entry.messageName,
+                          entry.count, entry.rateHz, entry.bytesPerSecond);
+            }
         }
-        std::cout << "Current msgid: " << (int)message.msgid << std::endl;
     }
     
     switch (message.msgid) {
@@ -212,20 +260,46 @@ void Vehicle::handleMessage(const mavlink_message_t &message)
             
         default:
             // Let fact groups handle the message
-            _updateAllValues();
+            {
+                ALLOCATION_SCOPE(Publish);
+                _updateAllValues();
+            }
             
             // Forward to fact groups
-            for (const auto& pair : _nameToFactGroupMap) {
-                const auto& factGroup = pair.second;
-                if (factGroup) {
-                    factGroup->handleMessage(this, message);
+            {
+                ALLOCATION_SCOPE(FactGroups);
+                for (const auto& pair : _nameToFactGroupMap) {
+                    const auto& factGroup = pair.second;
+                    if (factGroup) {
+                        PipelineTrace::Scope traceScope("factgroup", factGroup->traceName());
+                        factGroup->handleMessage(this, message);
+                    }
                 }
             }
             
             // Forward to parameter manager
             if (_parameterManager) {
+                ALLOCATION_SCOPE(Parameters);
+                TRACE_SCOPE("vehicle", "parameters");
                 _parameterManager->mavlinkMessageReceived(message);
             }
+            
+            ALLOCATION_SCOPE(Managers);
+            if (_logDownloader) {
+                _logDownloader->mavlinkMessageReceived(message);
+            }
+            
+            if (_ftpManager) {
+                _ftpManager->mavlinkMessageReceived(message);
+            }
+            
+            if (_missionManager) {
+                _missionManager->mavlinkMessageReceived(message);
+            }
+            
+            if (_timeSync) {
+                _timeSync->mavlinkMessageReceived(message);
+            }
             break;
     }
 }
@@ -235,6 +309,7 @@ void Vehicle::_initializeFactGroups()
     // Create main vehicle fact group
     auto vehicleFactGroup = std::make_shared<VehicleFactGroup>();
     _addFactGroup(vehicleFactGroup, "vehicle");
+    _vehicleFactGroup = vehicleFactGroup;
     
     // Create GPS fact group
     auto gpsFactGroup = std::make_shared<VehicleGPSFactGroup>();
@@ -282,15 +357,30 @@ void Vehicle::_initializeFactGroups()
     }
 }
 
+void Vehicle::_addMessageFactGroups(const std::vector<std::string> &messageNames)
+{
+    for (const auto& messageName : messageNames) {
+        const mavlink_message_info_t *messageInfo = MAVLinkMessageFactGroup::messageInfo(messageName);
+        if (!messageInfo) {
+            LOG_WARNING("Vehicle", "Message {} is not part of the MAVLink dialect, no fact group added", messageName);
+            continue;
+        }
+        _addFactGroup(std::make_shared<MAVLinkMessageFactGroup>(*messageInfo));
+    }
+}
+
 void Vehicle::_handleHeartbeat(const mavlink_message_t &message)
 {
     mavlink_heartbeat_t heartbeat;
     mavlink_msg_heartbeat_decode(&message, &heartbeat);
     
-    std::cout << "Received heartbeat from sysid=" << static_cast<int>(message.sysid) 
-              << " compid=" << static_cast<int>(message.compid) 
-              << " type=" << static_cast<int>(heartbeat.type)
-              << " autopilot=" << static_cast<int>(heartbeat.autopilot) << std::endl;
+    LOG_DEBUG("Vehicle", "Received heartbeat from sysid={} compid={} type={} autopilot={}",
+              message.sysid, message.compid, heartbeat.type, heartbeat.autopilot);
+    
+    // Cameras, gimbals and companions share the system id, only the autopilot describes the vehicle
+    if (heartbeat.autopilot == MAV_AUTOPILOT_INVALID) {
+        return;
+    }
     
     uint8_t oldSystemId = _systemId;
     uint8_t oldComponentId = _componentId;
@@ -300,7 +390,9 @@ void Vehicle::_handleHeartbeat(const mavlink_message_t &message)
     uint32_t oldCustomMode = _customMode;
     uint8_t oldSystemStatus = _systemStatus;
     
-    _systemId = message.sysid;
+    if (!_managed) {
+        _systemId = message.sysid;
+    }
     _componentId = message.compid;
     _vehicleType = heartbeat.type;
     _autopilotType = heartbeat.autopilot;
@@ -309,21 +401,33 @@ void Vehicle::_handleHeartbeat(const mavlink_message_t &message)
     _systemStatus = heartbeat.system_status;
     _mavlinkVersion = heartbeat.mavlink_version;
     
+    _vehicleFactGroup->setArmed(armed());
+    
+    uint64_t now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+    if (_firstHeartbeatReceived && now - _lastHeartbeatTime > HEARTBEAT_TIMEOUT_MS) {
+        // Most likely rebooted, which resets the stream rates to the autopilot defaults
+        LOG_INFO("Vehicle", "Heartbeat from sysid={} back after {}ms, re-applying stream rates", _systemId, now - _lastHeartbeatTime);
+        _streamRateController->reapply();
+        _timeSync->restart();
+    }
+    
     // Request parameters on first heartbeat
-    static bool firstHeartbeat = true;
-    if (firstHeartbeat && _parameterManager) {
-        std::cout << "First heartbeat received, requesting parameters..." << std::endl;
+    if (!_firstHeartbeatReceived && _parameterManager) {
+        LOG_INFO("Vehicle", "First heartbeat received, requesting parameters...");
         _parameterManager->refreshAllParameters();
         
         // Request autopilot version information
-        std::cout << "Requesting autopilot version information..." << std::endl;
+        LOG_INFO("Vehicle", "Requesting autopilot version information...");
         _requestAutopilotVersion();
         
         // Request telemetry data streams
-        std::cout << "Requesting telemetry data streams..." << std::endl;
+        LOG_INFO("Vehicle", "Requesting telemetry data streams...");
         _requestTelemetryStreams();
         
-        firstHeartbeat = false;
+        _timeSync->start();
+        
+        _firstHeartbeatReceived = true;
     }
     
     // Check if anything changed
@@ -334,8 +438,7 @@ void Vehicle::_handleHeartbeat(const mavlink_message_t &message)
         _notifyVehicleChanged();
     }
     
-    _lastHeartbeatTime = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::steady_clock::now().time_since_epoch()).count());
+    _lastHeartbeatTime = now;
 }
 
 void Vehicle::_handleStatustext(const mavlink_message_t &message)
@@ -383,11 +486,7 @@ void Vehicle::_handleStatustext(const mavlink_message_t &message)
 
 void Vehicle::_handleCommandAck(const mavlink_message_t &message)
 {
-    mavlink_command_ack_t commandAck;
-    mavlink_msg_command_ack_decode(&message, &commandAck);
-    
-    // Handle command acknowledgment
-    // This could be expanded to track pending commands
+    _commandManager->handleCommandAck(message);
 }
 
 void Vehicle::_handleAutopilotVersion(const mavlink_message_t &message)
@@ -442,44 +541,36 @@ void Vehicle::_requestAutopilotVersion()
 
 void Vehicle::_requestTelemetryStreams()
 {
-    // Request key telemetry data streams at 10Hz (100ms interval)
-    // MAV_CMD_SET_MESSAGE_INTERVAL: param1 = message ID, param2 = interval (microseconds)
-    
-    struct StreamRequest {
-        uint32_t msgId;
-        const char* name;
-    };
-    
-    StreamRequest streams[] = {
-        {MAVLINK_MSG_ID_SYS_STATUS, "SYS_STATUS"},
-        {MAVLINK_MSG_ID_ATTITUDE, "ATTITUDE"},
-        {MAVLINK_MSG_ID_GLOBAL_POSITION_INT, "GLOBAL_POSITION_INT"},
-        {MAVLINK_MSG_ID_GPS_RAW_INT, "GPS_RAW_INT"},
-        {MAVLINK_MSG_ID_BATTERY_STATUS, "BATTERY_STATUS"},
-        {MAVLINK_MSG_ID_VFR_HUD, "VFR_HUD"},
-        {MAVLINK_MSG_ID_RAW_IMU, "RAW_IMU"},
-        {MAVLINK_MSG_ID_SCALED_IMU, "SCALED_IMU"},
-        {MAVLINK_MSG_ID_SCALED_PRESSURE, "SCALED_PRESSURE"},
-        {MAVLINK_MSG_ID_SERVO_OUTPUT_RAW, "SERVO_OUTPUT_RAW"}
-    };
-    
-    const int streamCount = sizeof(streams) / sizeof(streams[0]);
-    const uint32_t interval_us = 100000; // 10Hz = 100,000 microseconds
-    
-    for (int i = 0; i < streamCount; i++) {
-        bool success = sendCommand(MAV_CMD_SET_MESSAGE_INTERVAL, 0, 
-                                  static_cast<float>(streams[i].msgId), 
-                                  static_cast<float>(interval_us));
-        
-        if (success) {
-            std::cout << "Requested " << streams[i].name << " stream at 10Hz" << std::endl;
-        } else {
-            std::cout << "Failed to request " << streams[i].name << " stream" << std::endl;
-        }
-        
-        // Small delay to avoid overwhelming the vehicle
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
-    }
+    // Rates follow the link from here on, see StreamRateController
+    _streamRateController->start();
+    
+    // Home is only sent on change or request, the distance and heading to home facts need it
+    sendCommand(MAV_CMD_REQUEST_MESSAGE, 0, static_cast<float>(MAVLINK_MSG_ID_HOME_POSITION));
+}
+
+void Vehicle::_createManagers()
+{
+    _commandManager = std::make_shared<CommandManager>(this);
+    _ftpManager = std::make_shared<FTPManager>(this);
+    _parameterManager = std::make_shared<ParameterManager>(this);
+    _logDownloader = std::make_shared<LogDownloader>(this);
+    _missionManager = std::make_shared<MissionManager>(this);
+    _timeSync = std::make_shared<TimeSync>(this);
+    
+    // Key telemetry streams at 10Hz unless configured otherwise
+    _streamRateController = std::make_shared<StreamRateController>(this, _connection);
+    _streamRateController->setDemands({
+        {MAVLINK_MSG_ID_SYS_STATUS, 10.0},
+        {MAVLINK_MSG_ID_ATTITUDE, 10.0},
+        {MAVLINK_MSG_ID_GLOBAL_POSITION_INT, 10.0},
+        {MAVLINK_MSG_ID_GPS_RAW_INT, 10.0},
+        {MAVLINK_MSG_ID_BATTERY_STATUS, 10.0},
+        {MAVLINK_MSG_ID_VFR_HUD, 10.0},
+        {MAVLINK_MSG_ID_RAW_IMU, 10.0},
+        {MAVLINK_MSG_ID_SCALED_IMU, 10.0},
+        {MAVLINK_MSG_ID_SCALED_PRESSURE, 10.0},
+        {MAVLINK_MSG_ID_SERVO_OUTPUT_RAW, 10.0},
+    });
 }
 
 std::string Vehicle::flightCustomVersionString() const
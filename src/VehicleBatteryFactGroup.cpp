@@ -14,61 +14,62 @@
 #include <cstring>     // For memcpy in packed structure handling
 #include <cstdint>     // For standard integer types
 #include <memory>      // For std::shared_ptr used in fact creation and battery groups
-#include <iostream>    // For debug output logging (std::cout)
 #include <string>      // For string operations in battery info fields
 
+#include "Logger.h"
+
 VehicleBatteryFactGroup::VehicleBatteryFactGroup(bool ignoreCamelCase)
     : FactGroup(500, ignoreCamelCase) // Update every 500ms
 {
     // Add all basic battery facts for primary battery
-    _addFact(std::make_shared<Fact>(0, "voltage", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "current", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "consumed", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "remaining", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "percent", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "temperature", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "id", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "function", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "type", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "timeRemaining", FactMetaData::valueTypeUint32));
-    _addFact(std::make_shared<Fact>(0, "chargeState", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "mode", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "faultBitmask", FactMetaData::valueTypeUint32));
-    _addFact(std::make_shared<Fact>(0, "cellCount", FactMetaData::valueTypeUint16));
+    _addFact(_makeFact(0, "voltage", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "current", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "consumed", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "remaining", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "percent", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "temperature", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "id", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "function", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "type", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "timeRemaining", FactMetaData::valueTypeUint32));
+    _addFact(_makeFact(0, "chargeState", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "mode", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "faultBitmask", FactMetaData::valueTypeUint32));
+    _addFact(_makeFact(0, "cellCount", FactMetaData::valueTypeUint16));
     
     // Add enhanced battery info facts (from BATTERY_INFO)
-    _addFact(std::make_shared<Fact>(0, "dischargeMinVoltage", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "chargingMinVoltage", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "restingMinVoltage", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "chargingMaxVoltage", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "chargingMaxCurrent", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "nominalVoltage", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "dischargeMaxCurrent", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "dischargeMaxBurstCurrent", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "designCapacity", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "fullChargeCapacity", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "cycleCount", FactMetaData::valueTypeUint16));
-    _addFact(std::make_shared<Fact>(0, "weight", FactMetaData::valueTypeUint16));
-    _addFact(std::make_shared<Fact>(0, "stateOfHealth", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "cellsInSeries", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "manufactureDate", FactMetaData::valueTypeString));
-    _addFact(std::make_shared<Fact>(0, "serialNumber", FactMetaData::valueTypeString));
-    _addFact(std::make_shared<Fact>(0, "batteryName", FactMetaData::valueTypeString));
+    _addFact(_makeFact(0, "dischargeMinVoltage", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "chargingMinVoltage", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "restingMinVoltage", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "chargingMaxVoltage", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "chargingMaxCurrent", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "nominalVoltage", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "dischargeMaxCurrent", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "dischargeMaxBurstCurrent", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "designCapacity", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "fullChargeCapacity", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "cycleCount", FactMetaData::valueTypeUint16));
+    _addFact(_makeFact(0, "weight", FactMetaData::valueTypeUint16));
+    _addFact(_makeFact(0, "stateOfHealth", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "cellsInSeries", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "manufactureDate", FactMetaData::valueTypeString));
+    _addFact(_makeFact(0, "serialNumber", FactMetaData::valueTypeString));
+    _addFact(_makeFact(0, "batteryName", FactMetaData::valueTypeString));
     
     // Add smart battery info facts (from SMART_BATTERY_INFO)
-    _addFact(std::make_shared<Fact>(0, "capacityFullSpecification", FactMetaData::valueTypeInt32));
-    _addFact(std::make_shared<Fact>(0, "capacityFull", FactMetaData::valueTypeInt32));
-    _addFact(std::make_shared<Fact>(0, "smartSerialNumber", FactMetaData::valueTypeString));
-    _addFact(std::make_shared<Fact>(0, "deviceName", FactMetaData::valueTypeString));
-    _addFact(std::make_shared<Fact>(0, "smartManufactureDate", FactMetaData::valueTypeString));
+    _addFact(_makeFact(0, "capacityFullSpecification", FactMetaData::valueTypeInt32));
+    _addFact(_makeFact(0, "capacityFull", FactMetaData::valueTypeInt32));
+    _addFact(_makeFact(0, "smartSerialNumber", FactMetaData::valueTypeString));
+    _addFact(_makeFact(0, "deviceName", FactMetaData::valueTypeString));
+    _addFact(_makeFact(0, "smartManufactureDate", FactMetaData::valueTypeString));
     
     // Add cell voltage tracking facts
-    _addFact(std::make_shared<Fact>(0, "cellCountDetected", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "cellCountDetected", FactMetaData::valueTypeUint8));
     
     // Add system-level battery facts for dynamic detection
-    _addFact(std::make_shared<Fact>(0, "mavlinkVersion", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "batteryCount", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "batterySystemType", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "mavlinkVersion", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "batteryCount", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "batterySystemType", FactMetaData::valueTypeUint8));
     
     // Initialize system facts to unknown state
     mavlinkVersion()->setRawValue(static_cast<uint8_t>(0));
@@ -83,25 +84,25 @@ void VehicleBatteryFactGroup::handleMessage([[maybe_unused]] Vehicle *vehicle, c
     switch (message.msgid) {
         // Standard battery status messages
         case MAVLINK_MSG_ID_BATTERY_STATUS:
-            std::cout << "[BATTERY] Handling BATTERY_STATUS message (ID: " << static_cast<int>(message.msgid) << ")" << std::endl;
+            LOG_TRACE("BATTERY", "Handling BATTERY_STATUS message (ID: {})", message.msgid);
             _handleBatteryStatus(message);
             break;
             
         // Battery info messages
         case MAVLINK_MSG_ID_BATTERY_INFO:
-            std::cout << "[BATTERY] Handling BATTERY_INFO message (ID: " << static_cast<int>(message.msgid) << ")" << std::endl;
+            LOG_TRACE("BATTERY", "Handling BATTERY_INFO message (ID: {})", message.msgid);
             _handleBatteryInfo(message);
             break;
             
         // Smart battery info messages
         case MAVLINK_MSG_ID_SMART_BATTERY_INFO:
-            std::cout << "[BATTERY] Handling SMART_BATTERY_INFO message (ID: " << static_cast<int>(message.msgid) << ")" << std::endl;
+            LOG_TRACE("BATTERY", "Handling SMART_BATTERY_INFO message (ID: {})", message.msgid);
             _handleSmartBatteryInfo(message);
             break;
             
         // ArduPilot battery2 messages
         case MAVLINK_MSG_ID_BATTERY2:
-            std::cout << "[BATTERY] Handling BATTERY2 message (ID: " << static_cast<int>(message.msgid) << ")" << std::endl;
+            LOG_TRACE("BATTERY", "Handling BATTERY2 message (ID: {})", message.msgid);
             _handleBattery2(message);
             break;
             
@@ -123,10 +124,8 @@ void VehicleBatteryFactGroup::_handleBatteryStatus(const mavlink_message_t &mess
     mavlink_battery_status_t batteryStatus;
     mavlink_msg_battery_status_decode(&message, &batteryStatus);
     
-    std::cout << "[BATTERY] === BATTERY_STATUS Message Decoded ===" << std::endl;
-    std::cout << "[BATTERY] Battery ID: " << static_cast<int>(batteryStatus.id) << std::endl;
-    std::cout << "[BATTERY] Function: " << static_cast<int>(batteryStatus.battery_function) << std::endl;
-    std::cout << "[BATTERY] Type: " << static_cast<int>(batteryStatus.type) << std::endl;
+    LOG_DEBUG("BATTERY", "BATTERY_STATUS decoded, id: {} function: {} type: {}",
+              batteryStatus.id, batteryStatus.battery_function, batteryStatus.type);
     
     // Process cell voltages (up to 10 cells for v1, up to 14 for v2)
     uint8_t detectedCellCount = 0;
@@ -203,12 +202,8 @@ void VehicleBatteryFactGroup::_handleBatteryStatus(const mavlink_message_t &mess
     mode = 0;
     faultBitmask = 0;
     
-    std::cout << "[BATTERY] Voltage: " << (batteryVoltage != NAN ? std::to_string(batteryVoltage) : "N/A") << "V" << std::endl;
-    std::cout << "[BATTERY] Current: " << (batteryCurrent != NAN ? std::to_string(batteryCurrent) : "N/A") << "A" << std::endl;
-    std::cout << "[BATTERY] Percent: " << static_cast<int>(percent) << "%" << std::endl;
-    std::cout << "[BATTERY] Temperature: " << (temperature != NAN ? std::to_string(temperature) : "N/A") << "°C" << std::endl;
-    std::cout << "[BATTERY] Cell Count: " << static_cast<int>(detectedCellCount) << std::endl;
-    std::cout << "[BATTERY] =============================================" << std::endl;
+    LOG_DEBUG("BATTERY", "Voltage: {}V Current: {}A Percent: {}% Temperature: {}°C Cell Count: {}",
+              batteryVoltage, batteryCurrent, percent, temperature, detectedCellCount);
     
     // Update all battery facts
     _updateBatteryFacts(batteryStatus.id, batteryVoltage, batteryCurrent, consumed, remaining, percent,
@@ -232,15 +227,12 @@ void VehicleBatteryFactGroup::_handleBatteryInfo(const mavlink_message_t &messag
     mavlink_battery_info_t batteryInfo;
     mavlink_msg_battery_info_decode(&message, &batteryInfo);
     
-    std::cout << "[BATTERY] === BATTERY_INFO Message Decoded ===" << std::endl;
-    std::cout << "[BATTERY] Battery ID: " << static_cast<int>(batteryInfo.id) << std::endl;
-    std::cout << "[BATTERY] Design Capacity: " << batteryInfo.design_capacity << "Ah" << std::endl;
-    std::cout << "[BATTERY] Full Charge Capacity: " << batteryInfo.full_charge_capacity << "Ah" << std::endl;
-    std::cout << "[BATTERY] Cycle Count: " << batteryInfo.cycle_count << std::endl;
-    std::cout << "[BATTERY] State of Health: " << static_cast<int>(batteryInfo.state_of_health) << "%" << std::endl;
-    std::cout << "[BATTERY] Serial Number: " << std::string(batteryInfo.serial_number) << std::endl;
-    std::cout << "[BATTERY] Name: " << std::string(batteryInfo.name) << std::endl;
-    std::cout << "[BATTERY] ======================================" << std::endl;
+    LOG_DEBUG("BATTERY", "BATTERY_INFO decoded, id: {} design capacity: {}Ah full charge capacity: {}Ah cycles: {} health: {}%",
+              batteryInfo.id, batteryInfo.design_capacity, batteryInfo.full_charge_capacity,
+              batteryInfo.cycle_count, batteryInfo.state_of_health);
+    LOG_DEBUG("BATTERY", "Serial Number: {} Name: {}",
+              std::string(batteryInfo.serial_number, strnlen(batteryInfo.serial_number, sizeof(batteryInfo.serial_number))),
+              std::string(batteryInfo.name, strnlen(batteryInfo.name, sizeof(batteryInfo.name))));
     
     // Update battery info facts
     _updateBatteryInfoFacts(batteryInfo.id, batteryInfo);
@@ -252,14 +244,12 @@ void VehicleBatteryFactGroup::_handleSmartBatteryInfo(const mavlink_message_t &m
     mavlink_smart_battery_info_t smartBatteryInfo;
     mavlink_msg_smart_battery_info_decode(&message, &smartBatteryInfo);
     
-    std::cout << "[BATTERY] === SMART_BATTERY_INFO Message Decoded ===" << std::endl;
-    std::cout << "[BATTERY] Battery ID: " << static_cast<int>(smartBatteryInfo.id) << std::endl;
-    std::cout << "[BATTERY] Capacity Full Spec: " << smartBatteryInfo.capacity_full_specification << "mAh" << std::endl;
-    std::cout << "[BATTERY] Capacity Full: " << smartBatteryInfo.capacity_full << "mAh" << std::endl;
-    std::cout << "[BATTERY] Cycle Count: " << smartBatteryInfo.cycle_count << std::endl;
-    std::cout << "[BATTERY] Device Name: " << std::string(smartBatteryInfo.device_name) << std::endl;
-    std::cout << "[BATTERY] Serial Number: " << std::string(smartBatteryInfo.serial_number) << std::endl;
-    std::cout << "[BATTERY] ==========================================" << std::endl;
+    LOG_DEBUG("BATTERY", "SMART_BATTERY_INFO decoded, id: {} capacity full spec: {}mAh capacity full: {}mAh cycles: {}",
+              smartBatteryInfo.id, smartBatteryInfo.capacity_full_specification,
+              smartBatteryInfo.capacity_full, smartBatteryInfo.cycle_count);
+    LOG_DEBUG("BATTERY", "Device Name: {} Serial Number: {}",
+              std::string(smartBatteryInfo.device_name, strnlen(smartBatteryInfo.device_name, sizeof(smartBatteryInfo.device_name))),
+              std::string(smartBatteryInfo.serial_number, strnlen(smartBatteryInfo.serial_number, sizeof(smartBatteryInfo.serial_number))));
     
     // Update smart battery info facts
     _updateSmartBatteryInfoFacts(smartBatteryInfo.id, smartBatteryInfo);
@@ -271,11 +261,8 @@ void VehicleBatteryFactGroup::_handleBattery2(const mavlink_message_t &message)
     mavlink_battery2_t battery2;
     mavlink_msg_battery2_decode(&message, &battery2);
     
-    std::cout << "[BATTERY] === BATTERY2 Message Decoded ===" << std::endl;
-    std::cout << "[BATTERY] Voltage: " << static_cast<float>(battery2.voltage) / 1000.0f << "V" << std::endl;
-    std::cout << "[BATTERY] Current: " << (battery2.current_battery != -1 ? 
-             std::to_string(static_cast<float>(battery2.current_battery) / 100.0f) : "N/A") << "A" << std::endl;
-    std::cout << "[BATTERY] ==============================" << std::endl;
+    LOG_DEBUG("BATTERY", "BATTERY2 decoded, voltage: {}V current: {}A", battery2.voltage / 1000.0f,
+              battery2.current_battery != -1 ? battery2.current_battery / 100.0f : NAN);
     
     // Update battery2 facts (for battery ID 1 typically)
     _updateBattery2Facts(1, battery2);
@@ -339,7 +326,7 @@ void VehicleBatteryFactGroup::_addCellVoltageFacts(uint8_t cellCount)
         
         // Only add if it doesn't already exist
         if (!getFact(factName)) {
-            _addFact(std::make_shared<Fact>(0, factName, FactMetaData::valueTypeFloat));
+            _addFact(_makeFact(0, factName, FactMetaData::valueTypeFloat));
         }
     }
 }
@@ -430,9 +417,8 @@ void VehicleBatteryFactGroup::_handleSysStatus(const mavlink_message_t &message)
     mavlink_sys_status_t sysStatus;
     mavlink_msg_sys_status_decode(&message, &sysStatus);
     
-    std::cout << "[BATTERY] SYS_STATUS - Voltage: " << (sysStatus.voltage_battery/1000.0f) 
-              << "V, Current: " << (sysStatus.current_battery/100.0f) 
-              << "A, Percent: " << (int)sysStatus.battery_remaining << "%" << std::endl;
+    LOG_TRACE("BATTERY", "SYS_STATUS - Voltage: {}V, Current: {}A, Percent: {}%",
+              sysStatus.voltage_battery / 1000.0f, sysStatus.current_battery / 100.0f, sysStatus.battery_remaining);
     
     // Update basic battery facts from SYS_STATUS
     voltage()->setRawValue(static_cast<float>(sysStatus.voltage_battery / 1000.0f));
@@ -5,35 +5,35 @@
 VehicleEstimatorStatusFactGroup::VehicleEstimatorStatusFactGroup(bool ignoreCamelCase)
     : FactGroup(1000, ignoreCamelCase)
 {
-    _addFact(std::make_shared<Fact>(0, "flags", FactMetaData::valueTypeUint64));
-    _addFact(std::make_shared<Fact>(0, "velocityRatio", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "posHorizRatio", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "posVertRatio", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "magRatio", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "haglRatio", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "tasRatio", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "posHorizAccuracy", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "posVertAccuracy", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "flags", FactMetaData::valueTypeUint64));
+    _addFact(_makeFact(0, "velocityRatio", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "posHorizRatio", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "posVertRatio", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "magRatio", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "haglRatio", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "tasRatio", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "posHorizAccuracy", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "posVertAccuracy", FactMetaData::valueTypeFloat));
     
     // Individual flag facts
-    _addFact(std::make_shared<Fact>(0, "flagsAttitude", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "flagsVelocityHoriz", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "flagsVelocityVert", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "flagsPosHorizRel", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "flagsPosHorizAbs", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "flagsPosVertAbs", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "flagsPosVertAGL", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "flagsConstPosMode", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "flagsPredPosHorizRel", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "flagsPredPosHorizAbs", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "flagsExpMode", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "flagsVelHorizSource", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "flagsVelVertSource", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "flagsPosHorizSource", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "flagsPosVertSource", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "flagsMagFieldSource", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "flagsTerrainAltSource", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "flagsYawAlignSource", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "flagsAttitude", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "flagsVelocityHoriz", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "flagsVelocityVert", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "flagsPosHorizRel", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "flagsPosHorizAbs", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "flagsPosVertAbs", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "flagsPosVertAGL", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "flagsConstPosMode", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "flagsPredPosHorizRel", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "flagsPredPosHorizAbs", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "flagsExpMode", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "flagsVelHorizSource", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "flagsVelVertSource", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "flagsPosHorizSource", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "flagsPosVertSource", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "flagsMagFieldSource", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "flagsTerrainAltSource", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "flagsYawAlignSource", FactMetaData::valueTypeBool));
 }
 
 void VehicleEstimatorStatusFactGroup::handleMessage(Vehicle *vehicle, const mavlink_message_t &message)
@@ -2,41 +2,123 @@
 #include "Vehicle.h"
 #include <mavlink/v2.0/common/mavlink.h>
 #include <cmath>
+#include <cstdio>
 
 VehicleFactGroup::VehicleFactGroup(bool ignoreCamelCase)
     : FactGroup(100, ignoreCamelCase) // Update every 100ms
 {
     // Add all vehicle facts
-    _addFact(std::make_shared<Fact>(0, "roll", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "pitch", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "heading", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "rollRate", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "pitchRate", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "yawRate", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "groundSpeed", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "airSpeed", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "airSpeedSetpoint", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "climbRate", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "altitudeRelative", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "altitudeAMSL", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "altitudeAboveTerr", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "altitudeTuning", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "altitudeTuningSetpoint", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "xTrackError", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "rangeFinderDist", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "flightDistance", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "distanceToHome", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "timeToHome", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "missionItemIndex", FactMetaData::valueTypeUint16));
-    _addFact(std::make_shared<Fact>(0, "headingToNextWP", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "distanceToNextWP", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "headingToHome", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "headingFromHome", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "headingFromGCS", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "distanceToGCS", FactMetaData::valueTypeDouble));
-    _addFact(std::make_shared<Fact>(0, "hobbs", FactMetaData::valueTypeString));
-    _addFact(std::make_shared<Fact>(0, "throttlePct", FactMetaData::valueTypeUint16));
-    _addFact(std::make_shared<Fact>(0, "imuTemp", FactMetaData::valueTypeInt16));
+    _addFact(_makeFact(0, "roll", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "pitch", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "heading", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "rollRate", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "pitchRate", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "yawRate", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "groundSpeed", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "airSpeed", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "airSpeedSetpoint", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "climbRate", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "altitudeRelative", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "altitudeAMSL", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "altitudeAboveTerr", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "altitudeTuning", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "altitudeTuningSetpoint", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "xTrackError", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "rangeFinderDist", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "flightDistance", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "distanceToHome", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "timeToHome", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "missionItemIndex", FactMetaData::valueTypeUint16));
+    _addFact(_makeFact(0, "headingToNextWP", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "distanceToNextWP", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "headingToHome", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "headingFromHome", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "headingFromGCS", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "distanceToGCS", FactMetaData::valueTypeDouble));
+    _addFact(_makeFact(0, "hobbs", FactMetaData::valueTypeString));
+    _addFact(_makeFact(0, "throttlePct", FactMetaData::valueTypeUint16));
+    _addFact(_makeFact(0, "imuTemp", FactMetaData::valueTypeInt16));
+
+    _setupDerivedFacts();
+}
+
+void VehicleFactGroup::_setupDerivedFacts()
+{
+    // Distance flown is integrated one position update at a time
+    _derivedFacts.addOutput(InputPosition, [this]() {
+        if (_armed && _previousPositionAvailable) {
+            _flightDistance += GeoMath::distance(_previousPosition, _position);
+            flightDistance()->setRawValue(_flightDistance);
+        }
+        _previousPosition = _position;
+        _previousPositionAvailable = true;
+    });
+
+    _derivedFacts.addOutput(InputPosition | InputHomePosition, [this]() {
+        if (!_positionAvailable || !_homePositionAvailable) {
+            return;
+        }
+        _distanceToHome = GeoMath::distance(_position, _homePosition);
+        distanceToHome()->setRawValue(_distanceToHome);
+        headingToHome()->setRawValue(GeoMath::bearing(_position, _homePosition));
+        headingFromHome()->setRawValue(GeoMath::bearing(_homePosition, _position));
+    });
+
+    // Uses distanceToHome computed above
+    _derivedFacts.addOutput(InputPosition | InputHomePosition | InputGroundSpeed, [this]() {
+        if (!_positionAvailable || !_homePositionAvailable) {
+            return;
+        }
+        double seconds = _groundSpeed > 0.5 ? _distanceToHome / _groundSpeed : std::numeric_limits<double>::quiet_NaN();
+        timeToHome()->setRawValue(seconds);
+    });
+
+    _derivedFacts.addOutput(InputPosition | InputGCSPosition, [this]() {
+        if (!_positionAvailable || !_gcsPositionAvailable) {
+            return;
+        }
+        distanceToGCS()->setRawValue(GeoMath::distance(_gcsPosition, _position));
+        headingFromGCS()->setRawValue(GeoMath::bearing(_gcsPosition, _position));
+    });
+
+    // Armed time of this session, formatted like QGC's hobbs meter
+    _derivedFacts.addOutput(InputArmedTime, [this]() {
+        auto armedTime = _armedTime;
+        if (_armed) {
+            armedTime += std::chrono::steady_clock::now() - _armedSince;
+        }
+        long long seconds = std::chrono::duration_cast<std::chrono::seconds>(armedTime).count();
+        char text[32];
+        snprintf(text, sizeof(text), "%04lld:%02lld:%02lld", seconds / 3600, (seconds / 60) % 60, seconds % 60);
+        hobbs()->setRawValue(std::string(text));
+    });
+}
+
+void VehicleFactGroup::setGCSPosition(double latitude, double longitude)
+{
+    _gcsPosition = GeoMath::GeoPoint::fromDegrees(latitude, longitude);
+    _gcsPositionAvailable = true;
+    _derivedFacts.markDirty(InputGCSPosition);
+}
+
+void VehicleFactGroup::setArmed(bool armed)
+{
+    if (armed != _armed) {
+        auto now = std::chrono::steady_clock::now();
+        if (armed) {
+            _armedSince = now;
+            // Don't count the distance between the last fix before arming and the first one after
+            _previousPositionAvailable = false;
+        } else {
+            _armedTime += now - _armedSince;
+        }
+        _armed = armed;
+        _derivedFacts.markDirty(InputArmedTime);
+    } else if (armed) {
+        // Heartbeats arrive at 1Hz, which is the resolution of hobbs
+        _derivedFacts.markDirty(InputArmedTime);
+    }
+    _derivedFacts.update();
 }
 
 void VehicleFactGroup::handleMessage(Vehicle *vehicle, const mavlink_message_t &message)
@@ -68,9 +150,23 @@ void VehicleFactGroup::handleMessage(Vehicle *vehicle, const mavlink_message_t &
             _handleNavControllerOutput(message);
             break;
             
+        case MAVLINK_MSG_ID_MISSION_CURRENT:
+            _handleMissionCurrent(message);
+            break;
+            
+        case MAVLINK_MSG_ID_GLOBAL_POSITION_INT:
+            _handleGlobalPositionInt(message);
+            break;
+            
+        case MAVLINK_MSG_ID_HOME_POSITION:
+            _handleHomePosition(message);
+            break;
+            
         default:
             break;
     }
+    
+    _derivedFacts.update();
 }
 
 void VehicleFactGroup::_handleAttitude(Vehicle *vehicle, const mavlink_message_t &message)
@@ -137,6 +233,8 @@ void VehicleFactGroup::_handleVfrHud(const mavlink_message_t &message)
     climbRate()->setRawValue(static_cast<double>(vfrHud.climb));
     throttlePct()->setRawValue(static_cast<uint16_t>(vfrHud.throttle * 100.0));
     
+    _groundSpeed = vfrHud.groundspeed;
+    _derivedFacts.markDirty(InputGroundSpeed);
     _setTelemetryAvailable(true);
 }
 
@@ -160,6 +258,39 @@ void VehicleFactGroup::_handleNavControllerOutput(const mavlink_message_t &messa
     _setTelemetryAvailable(true);
 }
 
+void VehicleFactGroup::_handleMissionCurrent(const mavlink_message_t &message)
+{
+    mavlink_mission_current_t missionCurrent;
+    mavlink_msg_mission_current_decode(&message, &missionCurrent);
+    
+    missionItemIndex()->setRawValue(static_cast<uint16_t>(missionCurrent.seq));
+}
+
+void VehicleFactGroup::_handleGlobalPositionInt(const mavlink_message_t &message)
+{
+    mavlink_global_position_int_t globalPosition;
+    mavlink_msg_global_position_int_decode(&message, &globalPosition);
+    
+    // No position estimate yet
+    if (globalPosition.lat == 0 && globalPosition.lon == 0) {
+        return;
+    }
+    
+    _position = GeoMath::GeoPoint::fromE7(globalPosition.lat, globalPosition.lon);
+    _positionAvailable = true;
+    _derivedFacts.markDirty(InputPosition);
+}
+
+void VehicleFactGroup::_handleHomePosition(const mavlink_message_t &message)
+{
+    mavlink_home_position_t homePosition;
+    mavlink_msg_home_position_decode(&message, &homePosition);
+    
+    _homePosition = GeoMath::GeoPoint::fromE7(homePosition.latitude, homePosition.longitude);
+    _homePositionAvailable = true;
+    _derivedFacts.markDirty(InputHomePosition);
+}
+
 void VehicleFactGroup::_handleAttitudeWorker(double rollRadians, double pitchRadians, double yawRadians)
 {
     // Convert radians to degrees
@@ -5,29 +5,29 @@
 VehicleGPS2FactGroup::VehicleGPS2FactGroup(bool ignoreCamelCase)
     : FactGroup(1000, ignoreCamelCase)
 {
-    _addFact(std::make_shared<Fact>(0, "lat", FactMetaData::valueTypeInt32));
-    _addFact(std::make_shared<Fact>(0, "lon", FactMetaData::valueTypeInt32));
-    _addFact(std::make_shared<Fact>(0, "alt", FactMetaData::valueTypeInt32));
-    _addFact(std::make_shared<Fact>(0, "altEllipsoid", FactMetaData::valueTypeInt32));
-    _addFact(std::make_shared<Fact>(0, "hdop", FactMetaData::valueTypeUint16));
-    _addFact(std::make_shared<Fact>(0, "vdop", FactMetaData::valueTypeUint16));
-    _addFact(std::make_shared<Fact>(0, "course", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "groundSpeed", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "count", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "lock", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "satellitesVisible", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "utcDate", FactMetaData::valueTypeUint32));
-    _addFact(std::make_shared<Fact>(0, "utcTime", FactMetaData::valueTypeUint32));
-    _addFact(std::make_shared<Fact>(0, "timeUtc", FactMetaData::valueTypeUint64));
-    _addFact(std::make_shared<Fact>(0, "fixType", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "eph", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "epv", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "heading", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "speedAccuracy", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "horizAccuracy", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "vertAccuracy", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "yaw", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "yawAccuracy", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "lat", FactMetaData::valueTypeInt32));
+    _addFact(_makeFact(0, "lon", FactMetaData::valueTypeInt32));
+    _addFact(_makeFact(0, "alt", FactMetaData::valueTypeInt32));
+    _addFact(_makeFact(0, "altEllipsoid", FactMetaData::valueTypeInt32));
+    _addFact(_makeFact(0, "hdop", FactMetaData::valueTypeUint16));
+    _addFact(_makeFact(0, "vdop", FactMetaData::valueTypeUint16));
+    _addFact(_makeFact(0, "course", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "groundSpeed", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "count", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "lock", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "satellitesVisible", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "utcDate", FactMetaData::valueTypeUint32));
+    _addFact(_makeFact(0, "utcTime", FactMetaData::valueTypeUint32));
+    _addFact(_makeFact(0, "timeUtc", FactMetaData::valueTypeUint64));
+    _addFact(_makeFact(0, "fixType", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "eph", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "epv", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "heading", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "speedAccuracy", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "horizAccuracy", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "vertAccuracy", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "yaw", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "yawAccuracy", FactMetaData::valueTypeFloat));
 }
 
 void VehicleGPS2FactGroup::handleMessage(Vehicle *vehicle, const mavlink_message_t &message)
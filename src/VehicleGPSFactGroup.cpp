@@ -8,46 +8,46 @@
 #include "../thirdparty/c_library_v2/common/mavlink_msg_high_latency2.h"
 #include "../thirdparty/c_library_v2/common/mavlink_msg_gps_status.h"
 
-#include <iostream>     // For debug output logging (std::cout)
 #include <memory>      // For std::shared_ptr used in fact creation
 #include <string>      // For string operations in satellite fact names
-#include <iomanip>     // For output formatting (std::setw, std::setprecision)
 #include <algorithm>   // For potential future algorithms (std::max_element)
 #include <cstring>     // For memcpy in packed structure handling
 
+#include "Logger.h"
+
 VehicleGPSFactGroup::VehicleGPSFactGroup(bool ignoreCamelCase)
     : FactGroup(1000, ignoreCamelCase) // Update every 1 second
 {
     // Add all basic GPS facts
-    _addFact(std::make_shared<Fact>(0, "lat", FactMetaData::valueTypeInt32));
-    _addFact(std::make_shared<Fact>(0, "lon", FactMetaData::valueTypeInt32));
-    _addFact(std::make_shared<Fact>(0, "alt", FactMetaData::valueTypeInt32));
-    _addFact(std::make_shared<Fact>(0, "altEllipsoid", FactMetaData::valueTypeInt32));
-    _addFact(std::make_shared<Fact>(0, "hdop", FactMetaData::valueTypeUint16));
-    _addFact(std::make_shared<Fact>(0, "vdop", FactMetaData::valueTypeUint16));
-    _addFact(std::make_shared<Fact>(0, "course", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "groundSpeed", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "count", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "lock", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "satellitesVisible", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "utcDate", FactMetaData::valueTypeUint32));
-    _addFact(std::make_shared<Fact>(0, "utcTime", FactMetaData::valueTypeUint32));
-    _addFact(std::make_shared<Fact>(0, "timeUtc", FactMetaData::valueTypeUint64));
-    _addFact(std::make_shared<Fact>(0, "fixType", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "eph", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "epv", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "heading", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "speedAccuracy", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "horizAccuracy", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "vertAccuracy", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "yaw", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "yawAccuracy", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "lat", FactMetaData::valueTypeInt32));
+    _addFact(_makeFact(0, "lon", FactMetaData::valueTypeInt32));
+    _addFact(_makeFact(0, "alt", FactMetaData::valueTypeInt32));
+    _addFact(_makeFact(0, "altEllipsoid", FactMetaData::valueTypeInt32));
+    _addFact(_makeFact(0, "hdop", FactMetaData::valueTypeUint16));
+    _addFact(_makeFact(0, "vdop", FactMetaData::valueTypeUint16));
+    _addFact(_makeFact(0, "course", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "groundSpeed", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "count", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "lock", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "satellitesVisible", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "utcDate", FactMetaData::valueTypeUint32));
+    _addFact(_makeFact(0, "utcTime", FactMetaData::valueTypeUint32));
+    _addFact(_makeFact(0, "timeUtc", FactMetaData::valueTypeUint64));
+    _addFact(_makeFact(0, "fixType", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "eph", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "epv", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "heading", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "speedAccuracy", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "horizAccuracy", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "vertAccuracy", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "yaw", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "yawAccuracy", FactMetaData::valueTypeFloat));
     
     // Add GPS status facts for detailed satellite information
-    _addFact(std::make_shared<Fact>(0, "gpsStatusSatellitesVisible", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "gpsStatusSatellitesUsed", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "gpsStatusAvgSNR", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "gpsStatusMaxSNR", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "gpsStatusSatellitesVisible", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "gpsStatusSatellitesUsed", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "gpsStatusAvgSNR", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "gpsStatusMaxSNR", FactMetaData::valueTypeUint8));
     
     // Initialize GPS status facts to default values
     gpsStatusSatellitesVisible()->setRawValue(static_cast<uint8_t>(0));
@@ -60,27 +60,27 @@ void VehicleGPSFactGroup::handleMessage([[maybe_unused]] Vehicle *vehicle, const
 {
     switch (message.msgid) {
         case MAVLINK_MSG_ID_GPS_RAW_INT:
-            std::cout << "[GPS] Handling GPS_RAW_INT message" << std::endl;
+            LOG_TRACE("GPS", "Handling GPS_RAW_INT message");
             _handleGPSRawInt(message);
             break;
             
         case MAVLINK_MSG_ID_GPS2_RAW:
-            std::cout << "[GPS] Handling GPS2_RAW message" << std::endl;
+            LOG_TRACE("GPS", "Handling GPS2_RAW message");
             _handleGPS2Raw(message);
             break;
             
         case MAVLINK_MSG_ID_GLOBAL_POSITION_INT:
-            std::cout << "[GPS] Handling GLOBAL_POSITION_INT message" << std::endl;
+            LOG_TRACE("GPS", "Handling GLOBAL_POSITION_INT message");
             _handleGlobalPositionInt(message);
             break;
             
         case MAVLINK_MSG_ID_HIGH_LATENCY2:
-            std::cout << "[GPS] Handling HIGH_LATENCY2 message" << std::endl;
+            LOG_TRACE("GPS", "Handling HIGH_LATENCY2 message");
             _handleHighLatency2(message);
             break;
             
         case MAVLINK_MSG_ID_GPS_STATUS:
-            std::cout << "[GPS] Handling GPS_STATUS message - detailed satellite data" << std::endl;
+            LOG_TRACE("GPS", "Handling GPS_STATUS message - detailed satellite data");
             _handleGPSStatus(message);
             break;
     }
@@ -160,8 +160,7 @@ void VehicleGPSFactGroup::_handleGPSStatus(const mavlink_message_t &message)
     mavlink_gps_status_t gpsStatus;
     mavlink_msg_gps_status_decode(&message, &gpsStatus);
     
-    std::cout << "[GPS] === GPS_STATUS Message Decoded ===" << std::endl;
-    std::cout << "[GPS] Satellites Visible: " << static_cast<int>(gpsStatus.satellites_visible) << std::endl;
+    LOG_DEBUG("GPS", "GPS_STATUS decoded, satellites visible: {}", gpsStatus.satellites_visible);
     
     // Count used satellites and calculate SNR statistics
     uint8_t usedCount = 0;
@@ -179,13 +178,9 @@ void VehicleGPSFactGroup::_handleGPSStatus(const mavlink_message_t &message)
             }
         }
         
-        std::cout << "[GPS] Sat " << std::setw(2) << (i+1) 
-                  << " PRN: " << std::setw(3) << static_cast<int>(gpsStatus.satellite_prn[i])
-                  << " Used: " << (gpsStatus.satellite_used[i] ? "Yes" : "No ")
-                  << " Elev: " << std::setw(3) << static_cast<int>(gpsStatus.satellite_elevation[i]) << "°"
-                  << " Azim: " << std::setw(3) << static_cast<int>(gpsStatus.satellite_azimuth[i]) << "°"
-                  << " SNR: " << std::setw(3) << static_cast<int>(gpsStatus.satellite_snr[i]) << "dB"
-                  << std::endl;
+        LOG_TRACE("GPS", "Sat {} PRN: {} Used: {} Elev: {}° Azim: {}° SNR: {}dB", i + 1,
+                  gpsStatus.satellite_prn[i], gpsStatus.satellite_used[i] ? "Yes" : "No",
+                  gpsStatus.satellite_elevation[i], gpsStatus.satellite_azimuth[i], gpsStatus.satellite_snr[i]);
     }
     
     // Calculate average SNR
@@ -194,10 +189,7 @@ void VehicleGPSFactGroup::_handleGPSStatus(const mavlink_message_t &message)
         avgSNR = static_cast<float>(totalSNR) / static_cast<float>(gpsStatus.satellites_visible);
     }
     
-    std::cout << "[GPS] Used Satellites: " << static_cast<int>(usedCount) << std::endl;
-    std::cout << "[GPS] Average SNR: " << std::fixed << std::setprecision(1) << avgSNR << "dB" << std::endl;
-    std::cout << "[GPS] Max SNR: " << static_cast<int>(maxSNR) << "dB" << std::endl;
-    std::cout << "[GPS] =====================================" << std::endl;
+    LOG_DEBUG("GPS", "Used Satellites: {} Average SNR: {:.1f}dB Max SNR: {}dB", usedCount, avgSNR, maxSNR);
     
     // Update GPS status facts
     _updateGPSStatusFacts(gpsStatus);
@@ -264,19 +256,19 @@ void VehicleGPSFactGroup::_addSatelliteFacts(uint8_t satelliteCount)
         
         // Only add if they don't already exist
         if (!getFact(prnFactName)) {
-            _addFact(std::make_shared<Fact>(0, prnFactName, FactMetaData::valueTypeUint8));
+            _addFact(_makeFact(0, prnFactName, FactMetaData::valueTypeUint8));
         }
         if (!getFact(usedFactName)) {
-            _addFact(std::make_shared<Fact>(0, usedFactName, FactMetaData::valueTypeUint8));
+            _addFact(_makeFact(0, usedFactName, FactMetaData::valueTypeUint8));
         }
         if (!getFact(elevFactName)) {
-            _addFact(std::make_shared<Fact>(0, elevFactName, FactMetaData::valueTypeUint8));
+            _addFact(_makeFact(0, elevFactName, FactMetaData::valueTypeUint8));
         }
         if (!getFact(azimFactName)) {
-            _addFact(std::make_shared<Fact>(0, azimFactName, FactMetaData::valueTypeUint8));
+            _addFact(_makeFact(0, azimFactName, FactMetaData::valueTypeUint8));
         }
         if (!getFact(snrFactName)) {
-            _addFact(std::make_shared<Fact>(0, snrFactName, FactMetaData::valueTypeUint8));
+            _addFact(_makeFact(0, snrFactName, FactMetaData::valueTypeUint8));
         }
     }
     
@@ -0,0 +1,233 @@
+#include "VehicleManager.h"
+#include "Vehicle.h"
+#include "MAVLinkUdpConnection.h"
+#include "Logger.h"
+#include "AllocationCounter.h"
+#include "PipelineTrace.h"
+#include <algorithm>
+#include <chrono>
+
+VehicleManager::VehicleManager(MAVLinkUdpConnection *connection, size_t shardCount, size_t queueCapacity)
+    : _connection(connection)
+{
+    size_t capacity = 1;
+    while (capacity < std::max<size_t>(queueCapacity, 2)) {
+        capacity <<= 1;
+    }
+
+    _running = true;
+    for (size_t i = 0; i < std::max<size_t>(shardCount, 1); i++) {
+        auto shard = std::make_unique<Shard>();
+        shard->ring.reset(new Entry[capacity]);
+        shard->mask = capacity - 1;
+        _shards.push_back(std::move(shard));
+    }
+    for (auto& shard : _shards) {
+        Shard *rawShard = shard.get();
+        shard->thread = std::thread([this, rawShard]() { _workerThreadFunc(*rawShard); });
+    }
+}
+
+void VehicleManager::start()
+{
+    // Last, the receive thread may create a vehicle with the configuration right away
+    if (_connection) {
+        _connection->setVehicleManager(this);
+    }
+}
+
+VehicleManager::~VehicleManager()
+{
+    if (_connection) {
+        _connection->setVehicleManager(nullptr);
+    }
+
+    // Workers drain their queue before exiting, the vehicles outlive them
+    _running = false;
+    for (auto& shard : _shards) {
+        {
+            std::lock_guard<std::mutex> lock(shard->mutex);
+            shard->wakeup.notify_one();
+        }
+        if (shard->thread.joinable()) {
+            shard->thread.join();
+        }
+    }
+}
+
+void VehicleManager::handleMessage(const mavlink_message_t &message)
+{
+    ALLOCATION_SCOPE(Route);
+    TRACE_SCOPE_ARG("link", "route", "msgid", message.msgid);
+    Route &route = _routes[message.sysid];
+    if (!route.vehicle) {
+        if (!_isVehicleHeartbeat(message)) {
+            _unroutedMessages.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        _addVehicle(message);
+    }
+
+    Shard &shard = *route.shard;
+    uint64_t tail = shard.tail.load(std::memory_order_relaxed);
+    if (tail - shard.head.load(std::memory_order_acquire) > shard.mask) {
+        _droppedMessages.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Entry &entry = shard.ring[tail & shard.mask];
+    entry.vehicle = route.vehicle;
+    entry.queuedNs = _nowNs();
+    entry.message = message;
+    // Sequentially consistent with the worker's sleeping flag, otherwise the wakeup could be missed
+    shard.tail.store(tail + 1, std::memory_order_seq_cst);
+    _routedMessages.fetch_add(1, std::memory_order_relaxed);
+
+    if (shard.sleeping.load(std::memory_order_seq_cst)) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.wakeup.notify_one();
+    }
+}
+
+std::shared_ptr<Vehicle> VehicleManager::vehicle(uint8_t systemId) const
+{
+    std::lock_guard<std::mutex> lock(_vehiclesMutex);
+    for (const auto& vehicle : _vehicles) {
+        if (vehicle->systemId() == systemId) {
+            return vehicle;
+        }
+    }
+    return std::shared_ptr<Vehicle>();
+}
+
+std::vector<std::shared_ptr<Vehicle>> VehicleManager::vehicles() const
+{
+    std::lock_guard<std::mutex> lock(_vehiclesMutex);
+    return _vehicles;
+}
+
+std::shared_ptr<Vehicle> VehicleManager::activeVehicle() const
+{
+    std::lock_guard<std::mutex> lock(_vehiclesMutex);
+    return _vehicles.empty() ? std::shared_ptr<Vehicle>() : _vehicles.front();
+}
+
+size_t VehicleManager::vehicleCount() const
+{
+    std::lock_guard<std::mutex> lock(_vehiclesMutex);
+    return _vehicles.size();
+}
+
+VehicleManager::Stats VehicleManager::stats() const
+{
+    Stats stats;
+    stats.routed = _routedMessages.load(std::memory_order_relaxed);
+    stats.dropped = _droppedMessages.load(std::memory_order_relaxed);
+    stats.unrouted = _unroutedMessages.load(std::memory_order_relaxed);
+    for (const auto& shard : _shards) {
+        stats.processed += shard->processed.load(std::memory_order_relaxed);
+        stats.queueWaitNs += shard->queueWaitNs.load(std::memory_order_relaxed);
+        stats.handleNs += shard->handleNs.load(std::memory_order_relaxed);
+        stats.maxQueueWaitNs = std::max(stats.maxQueueWaitNs, shard->maxQueueWaitNs.load(std::memory_order_relaxed));
+        stats.maxHandleNs = std::max(stats.maxHandleNs, shard->maxHandleNs.load(std::memory_order_relaxed));
+    }
+    return stats;
+}
+
+void VehicleManager::setGCSPosition(double latitude, double longitude)
+{
+    _gcsLatitude = latitude;
+    _gcsLongitude = longitude;
+    _gcsPositionAvailable = true;
+}
+
+bool VehicleManager::_isVehicleHeartbeat(const mavlink_message_t &message) const
+{
+    if (message.msgid != MAVLINK_MSG_ID_HEARTBEAT) {
+        return false;
+    }
+    if (_connection && message.sysid == _connection->getSystemId()) {
+        return false;
+    }
+
+    // Ground stations and peripherals without an autopilot don't get a Vehicle
+    mavlink_heartbeat_t heartbeat;
+    mavlink_msg_heartbeat_decode(&message, &heartbeat);
+    return heartbeat.type != MAV_TYPE_GCS && heartbeat.autopilot != MAV_AUTOPILOT_INVALID;
+}
+
+void VehicleManager::_addVehicle(const mavlink_message_t &message)
+{
+    auto vehicle = std::make_shared<Vehicle>(_connection, message.sysid, message.compid, _messageFactGroups,
+                                             _factArenaEnabled);
+    if (_gcsPositionAvailable) {
+        vehicle->setGCSPosition(_gcsLatitude, _gcsLongitude);
+    }
+
+    size_t vehicleIndex;
+    {
+        std::lock_guard<std::mutex> lock(_vehiclesMutex);
+        vehicleIndex = _vehicles.size();
+        _vehicles.push_back(vehicle);
+    }
+
+    Route &route = _routes[message.sysid];
+    route.vehicle = vehicle.get();
+    route.shard = _shards[vehicleIndex % _shards.size()].get();
+
+    LOG_INFO("VehicleManager", "New vehicle sysid={} compid={} on shard {}",
+             message.sysid, message.compid, vehicleIndex % _shards.size());
+
+    if (_vehicleAddedCallback) {
+        _vehicleAddedCallback(vehicle);
+    }
+}
+
+void VehicleManager::_workerThreadFunc(Shard &shard)
+{
+    PipelineTrace::setThreadName("vehicle worker");
+    while (true) {
+        uint64_t head = shard.head.load(std::memory_order_relaxed);
+        uint64_t tail = shard.tail.load(std::memory_order_acquire);
+
+        if (head == tail) {
+            if (!_running) {
+                break;
+            }
+            std::unique_lock<std::mutex> lock(shard.mutex);
+            shard.sleeping.store(true, std::memory_order_seq_cst);
+            if (shard.tail.load(std::memory_order_seq_cst) == head && _running) {
+                shard.wakeup.wait_for(lock, std::chrono::milliseconds(100));
+            }
+            shard.sleeping.store(false, std::memory_order_relaxed);
+            continue;
+        }
+
+        for (; head != tail; head++) {
+            Entry &entry = shard.ring[head & shard.mask];
+            const int64_t startNs = _nowNs();
+            entry.vehicle->handleMessage(entry.message);
+            const int64_t endNs = _nowNs();
+            const uint64_t queueWaitNs = static_cast<uint64_t>(std::max<int64_t>(0, startNs - entry.queuedNs));
+            // Hand the slot back right away so a slow message doesn't hold up the whole batch
+            shard.head.store(head + 1, std::memory_order_release);
+
+            // Only this thread writes the shard's counters
+            const uint64_t handleNs = static_cast<uint64_t>(endNs - startNs);
+            shard.processed.fetch_add(1, std::memory_order_relaxed);
+            shard.queueWaitNs.fetch_add(queueWaitNs, std::memory_order_relaxed);
+            shard.handleNs.fetch_add(handleNs, std::memory_order_relaxed);
+            if (queueWaitNs > shard.maxQueueWaitNs.load(std::memory_order_relaxed)) {
+                shard.maxQueueWaitNs.store(queueWaitNs, std::memory_order_relaxed);
+            }
+            if (handleNs > shard.maxHandleNs.load(std::memory_order_relaxed)) {
+                shard.maxHandleNs.store(handleNs, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+int64_t VehicleManager::_nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -5,17 +5,17 @@
 VehicleRCFactGroup::VehicleRCFactGroup(bool ignoreCamelCase)
     : FactGroup(100, ignoreCamelCase) // Update every 100ms
 {
-    _addFact(std::make_shared<Fact>(0, "channelRaw", FactMetaData::valueTypeUint16));
-    _addFact(std::make_shared<Fact>(0, "channelCount", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "rssi", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "rcRSSI", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "rcReceivedPacketCount", FactMetaData::valueTypeUint16));
-    _addFact(std::make_shared<Fact>(0, "rcLostPacketCount", FactMetaData::valueTypeUint16));
-    _addFact(std::make_shared<Fact>(0, "rcPPMFrameCount", FactMetaData::valueTypeUint16));
-    _addFact(std::make_shared<Fact>(0, "rcOVERRUN", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "rcFCS", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "rcRSSIDB", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "rcRSSIRegen", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "channelRaw", FactMetaData::valueTypeUint16));
+    _addFact(_makeFact(0, "channelCount", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "rssi", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "rcRSSI", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "rcReceivedPacketCount", FactMetaData::valueTypeUint16));
+    _addFact(_makeFact(0, "rcLostPacketCount", FactMetaData::valueTypeUint16));
+    _addFact(_makeFact(0, "rcPPMFrameCount", FactMetaData::valueTypeUint16));
+    _addFact(_makeFact(0, "rcOVERRUN", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "rcFCS", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "rcRSSIDB", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "rcRSSIRegen", FactMetaData::valueTypeUint8));
 }
 
 void VehicleRCFactGroup::handleMessage(Vehicle *vehicle, const mavlink_message_t &message)
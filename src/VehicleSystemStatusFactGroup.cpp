@@ -6,41 +6,41 @@ VehicleSystemStatusFactGroup::VehicleSystemStatusFactGroup(bool ignoreCamelCase)
     : FactGroup(1000, ignoreCamelCase) // Update every 1 second
 {
     // Add all system status facts
-    _addFact(std::make_shared<Fact>(0, "onboardControlSensorsPresent", FactMetaData::valueTypeUint32));
-    _addFact(std::make_shared<Fact>(0, "onboardControlSensorsEnabled", FactMetaData::valueTypeUint32));
-    _addFact(std::make_shared<Fact>(0, "onboardControlSensorsHealth", FactMetaData::valueTypeUint32));
-    _addFact(std::make_shared<Fact>(0, "load", FactMetaData::valueTypeUint16));
-    _addFact(std::make_shared<Fact>(0, "voltageBattery", FactMetaData::valueTypeUint16));
-    _addFact(std::make_shared<Fact>(0, "currentBattery", FactMetaData::valueTypeInt16));
-    _addFact(std::make_shared<Fact>(0, "batteryRemaining", FactMetaData::valueTypeUint8));
-    _addFact(std::make_shared<Fact>(0, "dropRateComm", FactMetaData::valueTypeUint16));
-    _addFact(std::make_shared<Fact>(0, "errorsComm", FactMetaData::valueTypeUint16));
-    _addFact(std::make_shared<Fact>(0, "errorsCount1", FactMetaData::valueTypeUint32));
-    _addFact(std::make_shared<Fact>(0, "errorsCount2", FactMetaData::valueTypeUint32));
-    _addFact(std::make_shared<Fact>(0, "errorsCount3", FactMetaData::valueTypeUint32));
-    _addFact(std::make_shared<Fact>(0, "errorsCount4", FactMetaData::valueTypeUint32));
+    _addFact(_makeFact(0, "onboardControlSensorsPresent", FactMetaData::valueTypeUint32));
+    _addFact(_makeFact(0, "onboardControlSensorsEnabled", FactMetaData::valueTypeUint32));
+    _addFact(_makeFact(0, "onboardControlSensorsHealth", FactMetaData::valueTypeUint32));
+    _addFact(_makeFact(0, "load", FactMetaData::valueTypeUint16));
+    _addFact(_makeFact(0, "voltageBattery", FactMetaData::valueTypeUint16));
+    _addFact(_makeFact(0, "currentBattery", FactMetaData::valueTypeInt16));
+    _addFact(_makeFact(0, "batteryRemaining", FactMetaData::valueTypeUint8));
+    _addFact(_makeFact(0, "dropRateComm", FactMetaData::valueTypeUint16));
+    _addFact(_makeFact(0, "errorsComm", FactMetaData::valueTypeUint16));
+    _addFact(_makeFact(0, "errorsCount1", FactMetaData::valueTypeUint32));
+    _addFact(_makeFact(0, "errorsCount2", FactMetaData::valueTypeUint32));
+    _addFact(_makeFact(0, "errorsCount3", FactMetaData::valueTypeUint32));
+    _addFact(_makeFact(0, "errorsCount4", FactMetaData::valueTypeUint32));
     
     // Individual sensor facts
-    _addFact(std::make_shared<Fact>(0, "sensorsPresent3dGyro", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "sensorsPresent3dAccel", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "sensorsPresent3dMag", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "sensorsPresentAbsPressure", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "sensorsPresentDiffPressure", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "sensorsPresentGps", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "sensorsPresent3dGyro", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "sensorsPresent3dAccel", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "sensorsPresent3dMag", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "sensorsPresentAbsPressure", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "sensorsPresentDiffPressure", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "sensorsPresentGps", FactMetaData::valueTypeBool));
     
-    _addFact(std::make_shared<Fact>(0, "sensorsEnabled3dGyro", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "sensorsEnabled3dAccel", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "sensorsEnabled3dMag", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "sensorsEnabledAbsPressure", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "sensorsEnabledDiffPressure", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "sensorsEnabledGps", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "sensorsEnabled3dGyro", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "sensorsEnabled3dAccel", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "sensorsEnabled3dMag", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "sensorsEnabledAbsPressure", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "sensorsEnabledDiffPressure", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "sensorsEnabledGps", FactMetaData::valueTypeBool));
     
-    _addFact(std::make_shared<Fact>(0, "sensorsHealth3dGyro", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "sensorsHealth3dAccel", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "sensorsHealth3dMag", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "sensorsHealthAbsPressure", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "sensorsHealthDiffPressure", FactMetaData::valueTypeBool));
-    _addFact(std::make_shared<Fact>(0, "sensorsHealthGps", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "sensorsHealth3dGyro", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "sensorsHealth3dAccel", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "sensorsHealth3dMag", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "sensorsHealthAbsPressure", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "sensorsHealthDiffPressure", FactMetaData::valueTypeBool));
+    _addFact(_makeFact(0, "sensorsHealthGps", FactMetaData::valueTypeBool));
 }
 
 void VehicleSystemStatusFactGroup::handleMessage(Vehicle *vehicle, const mavlink_message_t &message)
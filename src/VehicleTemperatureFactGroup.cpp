@@ -5,10 +5,10 @@
 VehicleTemperatureFactGroup::VehicleTemperatureFactGroup(bool ignoreCamelCase)
     : FactGroup(1000, ignoreCamelCase)
 {
-    _addFact(std::make_shared<Fact>(0, "temperature1", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "temperature2", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "temperature3", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "temperatureCalibrated", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "temperature1", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "temperature2", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "temperature3", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "temperatureCalibrated", FactMetaData::valueTypeFloat));
 }
 
 void VehicleTemperatureFactGroup::handleMessage(Vehicle *vehicle, const mavlink_message_t &message)
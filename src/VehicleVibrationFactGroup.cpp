@@ -5,13 +5,13 @@
 VehicleVibrationFactGroup::VehicleVibrationFactGroup(bool ignoreCamelCase)
     : FactGroup(100, ignoreCamelCase)
 {
-    _addFact(std::make_shared<Fact>(0, "vibrationX", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "vibrationY", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "vibrationZ", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "clipping0", FactMetaData::valueTypeUint32));
-    _addFact(std::make_shared<Fact>(0, "clipping1", FactMetaData::valueTypeUint32));
-    _addFact(std::make_shared<Fact>(0, "clipping2", FactMetaData::valueTypeUint32));
-    _addFact(std::make_shared<Fact>(0, "clipping3", FactMetaData::valueTypeUint32));
+    _addFact(_makeFact(0, "vibrationX", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "vibrationY", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "vibrationZ", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "clipping0", FactMetaData::valueTypeUint32));
+    _addFact(_makeFact(0, "clipping1", FactMetaData::valueTypeUint32));
+    _addFact(_makeFact(0, "clipping2", FactMetaData::valueTypeUint32));
+    _addFact(_makeFact(0, "clipping3", FactMetaData::valueTypeUint32));
 }
 
 void VehicleVibrationFactGroup::handleMessage(Vehicle *vehicle, const mavlink_message_t &message)
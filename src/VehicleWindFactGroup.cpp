@@ -5,9 +5,9 @@
 VehicleWindFactGroup::VehicleWindFactGroup(bool ignoreCamelCase)
     : FactGroup(1000, ignoreCamelCase)
 {
-    _addFact(std::make_shared<Fact>(0, "direction", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "speed", FactMetaData::valueTypeFloat));
-    _addFact(std::make_shared<Fact>(0, "speedZ", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "direction", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "speed", FactMetaData::valueTypeFloat));
+    _addFact(_makeFact(0, "speedZ", FactMetaData::valueTypeFloat));
 }
 
 void VehicleWindFactGroup::handleMessage(Vehicle *vehicle, const mavlink_message_t &message)
@@ -8,34 +8,56 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <map>
 #include <variant>
 #include <cstdlib>  // For std::getenv
+#include <cstdio>
+#include <algorithm>
 
 #include "JsonConfig.h"
 #include "MAVLinkUdpConnection.h"
 #include "Vehicle.h"
+#include "VehicleManager.h"
 #include "ParameterManager.h"
 #include "FactMetaData.h"
+#include "FactSharedMemory.h"
+#include "FactQueryServer.h"
+#include "FactSubscriptionManager.h"
+#include "FactRollups.h"
+#include "Logger.h"
+#include "StreamRateController.h"
+#include "LogDownloader.h"
+#include "MissionManager.h"
+#include "TelemetryLog.h"
+#include "AllocationCounter.h"
+#include "PipelineTrace.h"
 
 // Global variables for signal handling
 std::shared_ptr<MAVLinkUdpConnection> g_connection;
-std::shared_ptr<Vehicle> g_vehicle;
+std::unique_ptr<VehicleManager> g_vehicleManager;
+std::atomic<bool> g_vehicleManagerReady(false);     ///< Set once g_vehicleManager can be used from the receive thread
+std::shared_ptr<Vehicle> g_vehicle;     ///< First vehicle discovered, its facts are printed
+std::vector<std::unique_ptr<FactSharedMemoryPublisher>> g_factPublishers;  ///< One per vehicle, added on the receive thread
+FactQueryServer g_queryServer;
+FactSubscriptionManager g_subscriptionManager;
+FactRollups g_rollups;
 std::atomic<bool> g_running(true);
+std::atomic<bool> g_traceExportRequested(false);
 std::ofstream g_dataLog;
 
-// Signal handler for graceful shutdown
-void signalHandler(int signal)
+// Signal handler for graceful shutdown. Only async signal safe work here, the main loop sees the flag
+// and runs the normal shutdown, which releases the shared memory segment and the query socket.
+void signalHandler(int)
 {
-    std::cout << "\nReceived signal " << signal << ", shutting down..." << std::endl;
-    exit(0);
-    if (g_dataLog.is_open()) {
-        g_dataLog << "\n=== Shutdown at " << std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now().time_since_epoch()).count() << " ===" << std::endl;
-        g_dataLog.close();
-    }
     g_running = false;
 }
 
+// SIGUSR1 asks the main loop to export the pipeline trace
+void traceSignalHandler(int)
+{
+    g_traceExportRequested = true;
+}
+
 // Data logging functions
 void logMessage(const std::string& message)
 {
@@ -46,273 +68,13 @@ void logMessage(const std::string& message)
     }
 }
 
-// Helper function to safely extract variant values
-template<typename T>
-T safeGetVariant(const FactMetaData::ValueVariant_t& variant, T defaultValue = T{}) {
-    try {
-        if (std::holds_alternative<T>(variant)) {
-            return std::get<T>(variant);
-        }
-    } catch (const std::bad_variant_access&) {
-        // Fall through to default value
-    }
-    return defaultValue;
-}
-
 void logTelemetryData(Vehicle* vehicle)
 {
     if (!vehicle) return;
 
-    std::ostringstream oss;
-    oss << "\n=== Telemetry Data ===" << std::endl;
-    
-    // Get timestamp
     auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::system_clock::now().time_since_epoch()).count();
-    oss << "Timestamp: " << timestamp << std::endl;
-    
-    // Main vehicle facts
-    auto roll = vehicle->roll();
-    auto pitch = vehicle->pitch();
-    auto heading = vehicle->heading();
-    auto groundSpeed = vehicle->groundSpeed();
-    auto altitudeAMSL = vehicle->altitudeAMSL();
-    auto altitudeRelative = vehicle->altitudeRelative();
-    auto climbRate = vehicle->climbRate();
-    auto throttlePct = vehicle->throttlePct();
-
-    oss << std::fixed << std::setprecision(6);
-    if (roll) oss << "Roll: " << safeGetVariant<double>(roll->cookedValue()) << std::endl;
-    if (pitch) oss << "Pitch: " << safeGetVariant<double>(pitch->cookedValue()) << std::endl;
-    if (heading) oss << "Heading: " << safeGetVariant<double>(heading->cookedValue()) << std::endl;
-    if (groundSpeed) oss << "GroundSpeed: " << safeGetVariant<double>(groundSpeed->cookedValue()) << std::endl;
-    if (altitudeAMSL) oss << "AltitudeAMSL: " << safeGetVariant<double>(altitudeAMSL->cookedValue()) << std::endl;
-    if (altitudeRelative) oss << "AltitudeRelative: " << safeGetVariant<double>(altitudeRelative->cookedValue()) << std::endl;
-    if (climbRate) oss << "ClimbRate: " << safeGetVariant<double>(climbRate->cookedValue()) << std::endl;
-    if (throttlePct) oss << "Throttle: " << safeGetVariant<uint16_t>(throttlePct->cookedValue()) << std::endl;
-
-    // GPS data
-    auto gpsGroup = vehicle->gpsFactGroup();
-    if (gpsGroup) {
-        auto lat = gpsGroup->getFact("lat");
-        auto lon = gpsGroup->getFact("lon");
-        auto satellites = gpsGroup->getFact("satellitesVisible");
-        auto fixType = gpsGroup->getFact("fixType");
-        auto hdop = gpsGroup->getFact("hdop");
-        auto vdop = gpsGroup->getFact("vdop");
-        auto alt = gpsGroup->getFact("alt");
-        auto eph = gpsGroup->getFact("eph");
-        auto epv = gpsGroup->getFact("epv");
-        
-        if (lat && lon) {
-            oss << "GPSLat: " << safeGetVariant<int32_t>(lat->cookedValue()) / 1e7 << std::endl;
-            oss << "GPSLon: " << safeGetVariant<int32_t>(lon->cookedValue()) / 1e7 << std::endl;
-        }
-        if (alt) oss << "GPSAlt: " << safeGetVariant<double>(alt->cookedValue()) << std::endl;
-        if (satellites) oss << "GPSSatellites: " << static_cast<int>(safeGetVariant<uint8_t>(satellites->cookedValue())) << std::endl;
-        if (fixType) oss << "GPSFixType: " << static_cast<int>(safeGetVariant<uint8_t>(fixType->cookedValue())) << std::endl;
-        if (hdop) oss << "GPSHDOP: " << safeGetVariant<double>(hdop->cookedValue()) << std::endl;
-        if (vdop) oss << "GPSVDOP: " << safeGetVariant<double>(vdop->cookedValue()) << std::endl;
-        if (eph) oss << "GPSEPH: " << safeGetVariant<double>(eph->cookedValue()) << std::endl;
-        if (epv) oss << "GPSEPV: " << safeGetVariant<double>(epv->cookedValue()) << std::endl;
-    }
-
-    // Battery data
-    auto batteryGroup = vehicle->batteryFactGroup();
-    if (batteryGroup) {
-        // System-level battery information
-        auto mavlinkVersion = batteryGroup->getFact("mavlinkVersion");
-        auto batteryCount = batteryGroup->getFact("batteryCount");
-        auto batterySystemType = batteryGroup->getFact("batterySystemType");
-        
-        if (mavlinkVersion) {
-            auto versionVal = safeGetVariant<uint8_t>(mavlinkVersion->cookedValue());
-            std::string versionStr = (versionVal == 1) ? "v1.0" : 
-                                    (versionVal == 2) ? "v2.0" : "Unknown";
-            oss << "BatteryMAVLinkVersion: " << versionStr << std::endl;
-        }
-        if (batteryCount) {
-            auto countVal = safeGetVariant<uint8_t>(batteryCount->cookedValue());
-            std::string countStr = (countVal == 255) ? "None" : 
-                                  (countVal == 1) ? "1 Battery" : 
-                                  (countVal == 2) ? "2 Batteries" : 
-                                  std::to_string(countVal) + " Batteries";
-            oss << "BatteryCount: " << countStr << std::endl;
-        }
-        if (batterySystemType) {
-            auto typeVal = safeGetVariant<uint8_t>(batterySystemType->cookedValue());
-            std::string typeStr = (typeVal == 0) ? "No Battery" : 
-                                 (typeVal == 1) ? "Basic System" : 
-                                 (typeVal == 2) ? "Enhanced System" : 
-                                 (typeVal == 3) ? "Dual Battery System" : 
-                                 (typeVal == 4) ? "Multi-Battery System" : "Unknown";
-            oss << "BatterySystemType: " << typeStr << std::endl;
-        }
-        
-        // Individual battery metrics
-        auto voltage = batteryGroup->getFact("voltage");
-        auto current = batteryGroup->getFact("current");
-        auto percent = batteryGroup->getFact("percent");
-        auto consumed = batteryGroup->getFact("consumed");
-        auto remaining = batteryGroup->getFact("remaining");
-        auto temperature = batteryGroup->getFact("temperature");
-        auto id = batteryGroup->getFact("id");
-        auto function = batteryGroup->getFact("function");
-        auto type = batteryGroup->getFact("type");
-        auto timeRemaining = batteryGroup->getFact("timeRemaining");
-        auto chargeState = batteryGroup->getFact("chargeState");
-        auto mode = batteryGroup->getFact("mode");
-        auto faultBitmask = batteryGroup->getFact("faultBitmask");
-        auto cellCount = batteryGroup->getFact("cellCount");
-        
-        if (voltage) oss << "BatteryVoltage: " << safeGetVariant<float>(voltage->cookedValue()) << " V" << std::endl;
-        if (current) oss << "BatteryCurrent: " << safeGetVariant<float>(current->cookedValue()) << " A" << std::endl;
-        if (percent) {
-            auto percentVal = safeGetVariant<uint8_t>(percent->cookedValue());
-            if (percentVal != 255) {
-                oss << "BatteryPercent: " << static_cast<int>(percentVal) << "%" << std::endl;
-            } else {
-                oss << "BatteryPercent: N/A" << std::endl;
-            }
-        }
-        if (consumed) oss << "BatteryConsumed: " << safeGetVariant<float>(consumed->cookedValue()) << " Ah" << std::endl;
-        if (remaining) oss << "BatteryRemaining: " << safeGetVariant<float>(remaining->cookedValue()) << " Ah" << std::endl;
-        if (temperature) oss << "BatteryTemperature: " << safeGetVariant<float>(temperature->cookedValue()) << " °C" << std::endl;
-        if (id) {
-            auto idVal = safeGetVariant<uint8_t>(id->cookedValue());
-            if (idVal != 255) {
-                oss << "BatteryID: " << static_cast<int>(idVal) << std::endl;
-            }
-        }
-        if (function) oss << "BatteryFunction: " << static_cast<int>(safeGetVariant<uint8_t>(function->cookedValue())) << std::endl;
-        if (type) oss << "BatteryType: " << static_cast<int>(safeGetVariant<uint8_t>(type->cookedValue())) << std::endl;
-        if (timeRemaining) {
-            auto timeVal = safeGetVariant<uint32_t>(timeRemaining->cookedValue());
-            if (timeVal != UINT32_MAX) {
-                oss << "BatteryTimeRemaining: " << timeVal << " s" << std::endl;
-            }
-        }
-        if (chargeState) {
-            auto chargeVal = safeGetVariant<uint8_t>(chargeState->cookedValue());
-            if (chargeVal != UINT8_MAX) {
-                oss << "BatteryChargeState: " << static_cast<int>(chargeVal) << std::endl;
-            }
-        }
-        if (mode) {
-            auto modeVal = safeGetVariant<uint8_t>(mode->cookedValue());
-            if (modeVal != UINT8_MAX) {
-                oss << "BatteryMode: " << static_cast<int>(modeVal) << std::endl;
-            }
-        }
-        if (faultBitmask) {
-            auto faultVal = safeGetVariant<uint32_t>(faultBitmask->cookedValue());
-            if (faultVal != UINT32_MAX) {
-                oss << "BatteryFaultBitmask: 0x" << std::hex << faultVal << std::dec << std::endl;
-            }
-        }
-        if (cellCount) {
-            auto cellVal = safeGetVariant<uint16_t>(cellCount->cookedValue());
-            if (cellVal > 0) {
-                oss << "BatteryCellCount: " << cellVal << std::endl;
-            }
-        }
-    }
-
-    // System Status data
-    auto systemStatusGroup = vehicle->systemStatusFactGroup();
-    if (systemStatusGroup) {
-        auto sensorPresent = systemStatusGroup->getFact("sensorPresent");
-        auto sensorHealth = systemStatusGroup->getFact("sensorHealth");
-        auto sensorErrors = systemStatusGroup->getFact("sensorErrors");
-        auto onboardControlSensorsPresent = systemStatusGroup->getFact("onboardControlSensorsPresent");
-        auto onboardControlSensorsHealth = systemStatusGroup->getFact("onboardControlSensorsHealth");
-        auto onboardControlSensorsErrors = systemStatusGroup->getFact("onboardControlSensorsErrors");
-        
-        if (sensorPresent) oss << "SensorPresent: 0x" << std::hex << safeGetVariant<uint32_t>(sensorPresent->cookedValue()) << std::dec << std::endl;
-        if (sensorHealth) oss << "SensorHealth: 0x" << std::hex << safeGetVariant<uint32_t>(sensorHealth->cookedValue()) << std::dec << std::endl;
-        if (sensorErrors) oss << "SensorErrors: 0x" << std::hex << safeGetVariant<uint32_t>(sensorErrors->cookedValue()) << std::dec << std::endl;
-        if (onboardControlSensorsPresent) oss << "ControlSensorsPresent: 0x" << std::hex << safeGetVariant<uint32_t>(onboardControlSensorsPresent->cookedValue()) << std::dec << std::endl;
-        if (onboardControlSensorsHealth) oss << "ControlSensorsHealth: 0x" << std::hex << safeGetVariant<uint32_t>(onboardControlSensorsHealth->cookedValue()) << std::dec << std::endl;
-        if (onboardControlSensorsErrors) oss << "ControlSensorsErrors: 0x" << std::hex << safeGetVariant<uint32_t>(onboardControlSensorsErrors->cookedValue()) << std::dec << std::endl;
-    }
-
-    // RC data
-    auto rcGroup = vehicle->rcFactGroup();
-    if (rcGroup) {
-        auto rcRSSI = rcGroup->getFact("rssi");
-        auto rcChannelCount = rcGroup->getFact("channelCount");
-        auto rcRSSI_DBM = rcGroup->getFact("rssiDbm");
-        auto rcRSSIPercent = rcGroup->getFact("rssiPercent");
-        
-        if (rcRSSI) oss << "RCRSSI: " << static_cast<int>(safeGetVariant<uint8_t>(rcRSSI->cookedValue())) << std::endl;
-        if (rcRSSI_DBM) oss << "RCRSSIDBM: " << static_cast<int>(safeGetVariant<int8_t>(rcRSSI_DBM->cookedValue())) << std::endl;
-        if (rcRSSIPercent) oss << "RCRSSIPercent: " << static_cast<int>(safeGetVariant<uint8_t>(rcRSSIPercent->cookedValue())) << std::endl;
-        if (rcChannelCount) oss << "RCChannels: " << static_cast<int>(safeGetVariant<uint8_t>(rcChannelCount->cookedValue())) << std::endl;
-    }
-
-    // Vibration data
-    auto vibrationGroup = vehicle->vibrationFactGroup();
-    if (vibrationGroup) {
-        auto vibrationX = vibrationGroup->getFact("vibrationX");
-        auto vibrationY = vibrationGroup->getFact("vibrationY");
-        auto vibrationZ = vibrationGroup->getFact("vibrationZ");
-        auto clippingX = vibrationGroup->getFact("clippingX");
-        auto clippingY = vibrationGroup->getFact("clippingY");
-        auto clippingZ = vibrationGroup->getFact("clippingZ");
-        
-        if (vibrationX) oss << "VibrationX: " << safeGetVariant<float>(vibrationX->cookedValue()) << std::endl;
-        if (vibrationY) oss << "VibrationY: " << safeGetVariant<float>(vibrationY->cookedValue()) << std::endl;
-        if (vibrationZ) oss << "VibrationZ: " << safeGetVariant<float>(vibrationZ->cookedValue()) << std::endl;
-        if (clippingX) oss << "VibrationClippingX: " << static_cast<int>(safeGetVariant<uint8_t>(clippingX->cookedValue())) << std::endl;
-        if (clippingY) oss << "VibrationClippingY: " << static_cast<int>(safeGetVariant<uint8_t>(clippingY->cookedValue())) << std::endl;
-        if (clippingZ) oss << "VibrationClippingZ: " << static_cast<int>(safeGetVariant<uint8_t>(clippingZ->cookedValue())) << std::endl;
-    }
-
-    // Temperature data
-    auto temperatureGroup = vehicle->temperatureFactGroup();
-    if (temperatureGroup) {
-        auto temperature1 = temperatureGroup->getFact("temperature1");
-        auto temperature2 = temperatureGroup->getFact("temperature2");
-        auto temperature3 = temperatureGroup->getFact("temperature3");
-        
-        if (temperature1) oss << "Temperature1: " << safeGetVariant<float>(temperature1->cookedValue()) << std::endl;
-        if (temperature2) oss << "Temperature2: " << safeGetVariant<float>(temperature2->cookedValue()) << std::endl;
-        if (temperature3) oss << "Temperature3: " << safeGetVariant<float>(temperature3->cookedValue()) << std::endl;
-    }
-
-    // Estimator Status data
-    auto estimatorStatusGroup = vehicle->estimatorStatusFactGroup();
-    if (estimatorStatusGroup) {
-        auto estimatorFlags = estimatorStatusGroup->getFact("flags");
-        auto innovationPosHoriz = estimatorStatusGroup->getFact("innovationPosHoriz");
-        auto innovationPosVert = estimatorStatusGroup->getFact("innovationPosVert");
-        auto innovationVelHoriz = estimatorStatusGroup->getFact("innovationVelHoriz");
-        auto innovationVelVert = estimatorStatusGroup->getFact("innovationVelVert");
-        auto innovationMag = estimatorStatusGroup->getFact("innovationMag");
-        auto innovationYaw = estimatorStatusGroup->getFact("innovationYaw");
-        
-        if (estimatorFlags) oss << "EstimatorFlags: 0x" << std::hex << safeGetVariant<uint32_t>(estimatorFlags->cookedValue()) << std::dec << std::endl;
-        if (innovationPosHoriz) oss << "InnovationPosHoriz: " << safeGetVariant<float>(innovationPosHoriz->cookedValue()) << std::endl;
-        if (innovationPosVert) oss << "InnovationPosVert: " << safeGetVariant<float>(innovationPosVert->cookedValue()) << std::endl;
-        if (innovationVelHoriz) oss << "InnovationVelHoriz: " << safeGetVariant<float>(innovationVelHoriz->cookedValue()) << std::endl;
-        if (innovationVelVert) oss << "InnovationVelVert: " << safeGetVariant<float>(innovationVelVert->cookedValue()) << std::endl;
-        if (innovationMag) oss << "InnovationMag: " << safeGetVariant<float>(innovationMag->cookedValue()) << std::endl;
-        if (innovationYaw) oss << "InnovationYaw: " << safeGetVariant<float>(innovationYaw->cookedValue()) << std::endl;
-    }
-
-    // Wind data
-    auto windGroup = vehicle->windFactGroup();
-    if (windGroup) {
-        auto windDirection = windGroup->getFact("direction");
-        auto windSpeed = windGroup->getFact("speed");
-        auto windClimb = windGroup->getFact("climb");
-        
-        if (windDirection) oss << "WindDirection: " << safeGetVariant<float>(windDirection->cookedValue()) << std::endl;
-        if (windSpeed) oss << "WindSpeed: " << safeGetVariant<float>(windSpeed->cookedValue()) << std::endl;
-        if (windClimb) oss << "WindClimb: " << safeGetVariant<float>(windClimb->cookedValue()) << std::endl;
-    }
-
-    logMessage(oss.str());
+    logMessage(TelemetryLog::telemetrySnapshot(vehicle, timestamp));
 }
 
 void logParameters(Vehicle* vehicle)
@@ -409,6 +171,29 @@ void printConnectionStats(const MAVLinkUdpConnection* connection)
     oss << "PacketsLost: " << connection->getPacketsLost() << std::endl;
     oss << "MAVLinkVersion: " << connection->getDetectedMavlinkVersion() << std::endl;
     
+    const MAVLinkMessageFilter& filter = connection->messageFilter();
+    if (filter.isEnabled()) {
+        oss << "FilteredFrames: " << filter.droppedCount() << std::endl;
+        for (const auto& [messageId, count] : filter.droppedByMessageId()) {
+            if (messageId == MAVLinkMessageFilter::kUnknownMessageId) {
+                oss << "  unknown msgid: " << count << std::endl;
+            } else {
+                oss << "  msgid " << messageId << ": " << count << std::endl;
+            }
+        }
+    }
+    
+    // Streams by bandwidth, the ones which dominate the link first
+    std::vector<MessageRateTable::Entry> rates = connection->messageRates().snapshot();
+    std::sort(rates.begin(), rates.end(), [](const auto& a, const auto& b) { return a.bytesPerSecond > b.bytesPerSecond; });
+    oss << "\n=== Message Rates ===" << std::endl;
+    for (const auto& entry : rates) {
+        char line[160];
+        snprintf(line, sizeof(line), "sysid %u %s (%u): %.1f Hz, %.0f B/s, %llu messages", static_cast<unsigned>(entry.systemId), entry.messageName,
+                 entry.messageId, entry.rateHz, entry.bytesPerSecond, static_cast<unsigned long long>(entry.count));
+        oss << line << std::endl;
+    }
+    
     // Health monitoring statistics
     oss << "\n=== Health Monitoring ===" << std::endl;
     oss << "HealthCheckEnabled: " << (connection->isHealthCheckEnabled() ? "Yes" : "No") << std::endl;
@@ -452,7 +237,30 @@ int main(int argc, char* argv[])
             std::cout << "    \"enable_data_logging\": false,\n";
             std::cout << "    \"log_file_path\": \"mavlink_data.log\",\n";
             std::cout << "    \"version_check_enabled\": true,\n";
-            std::cout << "    \"auto_version_detection\": true\n";
+            std::cout << "    \"auto_version_detection\": true,\n";
+            std::cout << "    \"vehicle_worker_threads\": 2,\n";
+            std::cout << "    \"message_fact_groups\": \"\",\n";
+            std::cout << "    \"fact_arena_enabled\": false,\n";
+            std::cout << "    \"gcs_position\": \"\",\n";
+            std::cout << "    \"telemetry_streams\": \"\",\n";
+            std::cout << "    \"link_capacity_bytes_per_sec\": 0,\n";
+            std::cout << "    \"log_download_dir\": \"\",\n";
+            std::cout << "    \"param_ftp_enabled\": true,\n";
+            std::cout << "    \"mission_download_enabled\": true,\n";
+            std::cout << "    \"filter_msgid_allow\": \"\",\n";
+            std::cout << "    \"filter_msgid_deny\": \"\",\n";
+            std::cout << "    \"filter_sysid_allow\": \"\",\n";
+            std::cout << "    \"filter_sysid_deny\": \"\",\n";
+            std::cout << "    \"filter_compid_allow\": \"\",\n";
+            std::cout << "    \"filter_compid_deny\": \"\",\n";
+            std::cout << "    \"shm_publish_enabled\": false,\n";
+            std::cout << "    \"shm_segment_name\": \"/mavcollector_facts\",\n";
+            std::cout << "    \"query_server_enabled\": false,\n";
+            std::cout << "    \"query_socket_path\": \"/tmp/mavcollector.sock\",\n";
+            std::cout << "    \"rollups_enabled\": true,\n";
+            std::cout << "    \"log_level\": \"info\",\n";
+            std::cout << "    \"trace_enabled\": false,\n";
+            std::cout << "    \"trace_output_path\": \"mavcollector_trace.json\"\n";
             std::cout << "  }\n";
             return 0;
         }
@@ -482,6 +290,95 @@ int main(int argc, char* argv[])
     bool enableAutoRestart = config.getBool("auto_restart_enabled", true);
     uint32_t connectionTimeout = static_cast<uint32_t>(config.getInt("connection_timeout_ms", 5000));
     uint32_t restartDelay = static_cast<uint32_t>(config.getInt("restart_delay_ms", 1000));
+
+    // Vehicles are created per system id and spread over this many message handling threads
+    size_t vehicleWorkerThreads = static_cast<size_t>(std::max(1, config.getInt("vehicle_worker_threads", 2)));
+
+    // Comma separated MAVLink message names, each decoded into a fact group named after the message
+    std::vector<std::string> messageFactGroups;
+    std::istringstream messageNames(config.getString("message_fact_groups", ""));
+    for (std::string messageName; std::getline(messageNames, messageName, ','); ) {
+        messageName.erase(std::remove(messageName.begin(), messageName.end(), ' '), messageName.end());
+        if (!messageName.empty()) {
+            messageFactGroups.push_back(messageName);
+        }
+    }
+
+    // Lay out all facts of a vehicle in one allocation, see FactArena
+    bool factArenaEnabled = config.getBool("fact_arena_enabled", false);
+
+    // Ground station position as "latitude,longitude" in degrees, empty if unknown
+    double gcsLatitude = 0.0;
+    double gcsLongitude = 0.0;
+    std::string gcsPosition = config.getString("gcs_position", "");
+    bool haveGcsPosition = !gcsPosition.empty() &&
+        sscanf(gcsPosition.c_str(), "%lf , %lf", &gcsLatitude, &gcsLongitude) == 2;
+    if (!gcsPosition.empty() && !haveGcsPosition) {
+        std::cerr << "Ignoring invalid gcs_position " << gcsPosition << std::endl;
+    }
+
+    // Telemetry stream demand as "MESSAGE:Hz" pairs, empty for the built in set. The rates actually
+    // requested adapt to loss and the link capacity, 0 if unknown.
+    std::map<uint32_t, double> telemetryStreams;
+    std::istringstream streamEntries(config.getString("telemetry_streams", ""));
+    for (std::string entry; std::getline(streamEntries, entry, ','); ) {
+        entry.erase(std::remove(entry.begin(), entry.end(), ' '), entry.end());
+        size_t separator = entry.find(':');
+        std::vector<uint32_t> messageIds;
+        std::string badEntry;
+        if (entry.empty()) {
+            continue;
+        }
+        if (separator == std::string::npos ||
+            !MAVLinkMessageFilter::parseIdList(entry.substr(0, separator), messageIds, badEntry) || messageIds.size() != 1) {
+            std::cerr << "Ignoring invalid telemetry_streams entry " << entry << std::endl;
+            continue;
+        }
+        telemetryStreams[messageIds[0]] = atof(entry.c_str() + separator + 1);
+    }
+    double linkCapacity = config.getDouble("link_capacity_bytes_per_sec", 0.0);
+
+    // Newest onboard log of a vehicle is downloaded here after it disarms, empty to disable
+    std::string logDownloadDir = config.getString("log_download_dir", "");
+
+    // ArduPilot parameters as one file over MAVLink FTP instead of a message per parameter
+    bool paramFtpEnabled = config.getBool("param_ftp_enabled", true);
+
+    // Mission is loaded once the parameters are, to look up the current waypoint
+    bool missionDownloadEnabled = config.getBool("mission_download_enabled", true);
+
+    // Ingress filter, comma separated ids. Message ids may also be given by name.
+    std::vector<uint32_t> filterIds[6];
+    const char* filterKeys[6] = { "filter_msgid_allow", "filter_msgid_deny", "filter_sysid_allow",
+                                  "filter_sysid_deny", "filter_compid_allow", "filter_compid_deny" };
+    for (int i = 0; i < 6; i++) {
+        std::string badEntry;
+        if (!MAVLinkMessageFilter::parseIdList(config.getString(filterKeys[i], ""), filterIds[i], badEntry)) {
+            std::cerr << "Ignoring unknown id " << badEntry << " in " << filterKeys[i] << std::endl;
+        }
+    }
+
+    // Shared memory fact publication, one segment per vehicle named "<shm_segment_name>_<sysid>"
+    bool enableShmPublish = config.getBool("shm_publish_enabled", false);
+    std::string shmSegmentName = config.getString("shm_segment_name", "/mavcollector_facts");
+
+    // Local fact query server
+    bool enableQueryServer = config.getBool("query_server_enabled", false);
+    std::string querySocketPath = config.getString("query_socket_path", "/tmp/mavcollector.sock");
+    bool enableRollups = config.getBool("rollups_enabled", true);
+
+    // Pipeline trace points, written as Chrome trace JSON on SIGUSR1
+    bool enableTrace = config.getBool("trace_enabled", false);
+    std::string traceOutputPath = config.getString("trace_output_path", "mavcollector_trace.json");
+    PipelineTrace::setEnabled(enableTrace);
+
+    // Receive path logging, levels below the MAVCOLLECTOR_LOG_LEVEL build setting are compiled out
+    std::string logLevelName = config.getString("log_level", "info");
+    Logger::Level logLevel = Logger::Info;
+    if (!Logger::parseLevel(logLevelName, logLevel)) {
+        std::cerr << "Unknown log_level " << logLevelName << ", using info" << std::endl;
+    }
+    Logger::instance().setLevel(logLevel);
     
     // Print loaded configuration
     std::cout << "=== Configuration Loaded from: " << configFilePath << " ===" << std::endl;
@@ -523,6 +420,9 @@ int main(int argc, char* argv[])
     // Set up signal handlers
     std::signal(SIGINT, signalHandler);
     std::signal(SIGTERM, signalHandler);
+    if (enableTrace) {
+        std::signal(SIGUSR1, traceSignalHandler);
+    }
 
     logMessage("MAVLink Data Collector - Enhanced");
     logMessage("=======================");
@@ -548,6 +448,11 @@ int main(int argc, char* argv[])
     g_connection->setConnectionTimeout(connectionTimeout);
     g_connection->setAutoRestartDelay(restartDelay);
     
+    // Configure ingress filtering
+    g_connection->messageFilter().setMessageIds(filterIds[0], filterIds[1]);
+    g_connection->messageFilter().setSystemIds(filterIds[2], filterIds[3]);
+    g_connection->messageFilter().setComponentIds(filterIds[4], filterIds[5]);
+    
     if (enableHealthCheck) {
         logMessage("Connection health monitoring enabled:");
         std::ostringstream healthConfig;
@@ -580,10 +485,8 @@ int main(int argc, char* argv[])
             if (g_dataLog.is_open()) {
                 auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
                     std::chrono::system_clock::now().time_since_epoch()).count();
-                g_dataLog << timestamp << ",MSG," << static_cast<int>(message.msgid) 
-                         << "," << static_cast<int>(message.sysid) 
-                         << "," << static_cast<int>(message.compid) 
-                         << "," << static_cast<int>(message.len) << std::endl;
+                std::shared_ptr<Vehicle> vehicle = g_vehicleManagerReady ? g_vehicleManager->vehicle(message.sysid) : nullptr;
+                TelemetryLog::writeMessageLine(g_dataLog, timestamp, message, vehicle.get());
                 g_dataLog.flush();
             }
         }
@@ -599,34 +502,116 @@ int main(int argc, char* argv[])
         return 1;
     }
 
-    // Create vehicle with system ID from configuration
-    g_vehicle = std::make_shared<Vehicle>(g_connection.get());
-    
-    // Configure system ID and component ID from JSON configuration
-    g_vehicle->setSystemId(systemId);
-    g_vehicle->setComponentId(componentId);
-    
-    // Set up parameter manager callbacks
-    auto paramManager = g_vehicle->parameterManager();
-    if (paramManager) {
-        paramManager->setParametersReadyCallback([](bool ready) {
-            logMessage("Parameters " + std::string(ready ? "ready!" : "not ready"));
-        });
-        
-        paramManager->setLoadProgressCallback([](double progress) {
-            logMessage("Parameter loading progress: " + std::to_string(progress * 100.0) + "%");
-        });
-        
-        // Start parameter loading
-        logMessage("Starting parameter loading...");
-        paramManager->refreshAllParameters();
+    // Create a vehicle for every system id which sends an autopilot heartbeat
+    g_vehicleManager = std::make_unique<VehicleManager>(g_connection.get(), vehicleWorkerThreads);
+    g_vehicleManagerReady = true;
+    g_vehicleManager->setMessageFactGroups(messageFactGroups);
+    g_vehicleManager->setFactArenaEnabled(factArenaEnabled);
+    if (haveGcsPosition) {
+        g_vehicleManager->setGCSPosition(gcsLatitude, gcsLongitude);
+    }
+
+    // Serve fact queries to local clients, value change streams go through the subscription manager.
+    // Vehicles are added as they are discovered.
+    g_queryServer.setSubscriptionManager(&g_subscriptionManager);
+    g_queryServer.setMessageRates(&g_connection->messageRates());
+    if (enableRollups) {
+        g_queryServer.setRollups(&g_rollups);
+    }
+    if (enableQueryServer && !g_queryServer.start(querySocketPath)) {
+        logMessage("Fact query server disabled, socket could not be created");
     }
 
-    // Set up vehicle change callback
-    g_vehicle->setVehicleChangedCallback([](const Vehicle* vehicle) {
-        logMessage("Vehicle state changed");
+    g_vehicleManager->setVehicleAddedCallback([telemetryStreams, linkCapacity, logDownloadDir, paramFtpEnabled, missionDownloadEnabled,
+                                               enableShmPublish, shmSegmentName, enableRollups](const std::shared_ptr<Vehicle>& vehicle) {
+        int vehicleId = vehicle->systemId();
+        logMessage("Vehicle " + std::to_string(vehicleId) + " discovered");
+
+        // Fact consumers are attached before the vehicle's first frame is queued, while none of its facts
+        // change. Every vehicle publishes to its own segment, the query server reads values from the same
+        // snapshot, kept in private memory when nothing is published. Query and watch paths are prefixed
+        // with the system id.
+        auto publisher = std::make_unique<FactSharedMemoryPublisher>();
+        if (enableShmPublish || g_queryServer.isRunning()) {
+            const std::string segmentName = enableShmPublish ? shmSegmentName + "_" + std::to_string(vehicleId) : std::string();
+            if (publisher->attach(vehicle.get(), segmentName)) {
+                g_queryServer.addVehicle(vehicleId, publisher.get());
+            } else {
+                logMessage("Vehicle " + std::to_string(vehicleId) + " facts not published, segment could not be created");
+            }
+        }
+        g_subscriptionManager.attach(vehicle.get(), vehicleId);
+        if (enableRollups) {
+            g_rollups.attach(vehicle.get());
+        }
+        g_factPublishers.push_back(std::move(publisher));
+
+        // Streams are requested on the first heartbeat
+        if (!telemetryStreams.empty()) {
+            vehicle->streamRateController()->setDemands(telemetryStreams);
+        }
+        vehicle->streamRateController()->setLinkCapacity(linkCapacity);
+
+        // Set up parameter manager callbacks, parameters are requested on the first heartbeat
+        auto paramManager = vehicle->parameterManager();
+        if (paramManager) {
+            paramManager->setFtpEnabled(paramFtpEnabled);
+            std::weak_ptr<MissionManager> missionManager = vehicle->missionManager();
+            paramManager->setParametersReadyCallback([vehicleId, missionDownloadEnabled, missionManager](bool ready) {
+                logMessage("Vehicle " + std::to_string(vehicleId) + " parameters " + std::string(ready ? "ready!" : "not ready"));
+
+                auto manager = missionManager.lock();
+                if (!missionDownloadEnabled || !manager) {
+                    return;
+                }
+                manager->loadFromVehicle([vehicleId](const MissionManager::Result &result) {
+                    char seconds[32];
+                    snprintf(seconds, sizeof(seconds), "%.2f", result.seconds);
+                    logMessage("Vehicle " + std::to_string(vehicleId) + " mission " + (result.success ?
+                               "loaded, " + std::to_string(result.count) + " items in " + seconds + "s" : "load failed: " + result.error));
+                });
+            });
+            
+            paramManager->setLoadProgressCallback([vehicleId](double progress) {
+                logMessage("Vehicle " + std::to_string(vehicleId) + " parameter loading progress: " + std::to_string(progress * 100.0) + "%");
+            });
+        }
+
+        // Set up vehicle change callback, landing is when the flight's log is complete
+        std::weak_ptr<LogDownloader> logDownloader = vehicle->logDownloader();
+        auto wasArmed = std::make_shared<bool>(false);
+        vehicle->setVehicleChangedCallback([logDownloadDir, logDownloader, wasArmed](const Vehicle* vehicle) {
+            logMessage("Vehicle " + std::to_string(vehicle->systemId()) + " state changed");
+
+            const bool disarmed = *wasArmed && !vehicle->armed();
+            *wasArmed = vehicle->armed();
+            auto downloader = logDownloader.lock();
+            if (!disarmed || logDownloadDir.empty() || !downloader || downloader->downloading()) {
+                return;
+            }
+
+            const int vehicleId = vehicle->systemId();
+            downloader->requestLogList([logDownloadDir, logDownloader, vehicleId](bool, const std::vector<LogDownloader::LogEntry> &entries) {
+                auto downloader = logDownloader.lock();
+                if (entries.empty() || !downloader) {
+                    logMessage("Vehicle " + std::to_string(vehicleId) + " has no logs to download");
+                    return;
+                }
+                const LogDownloader::LogEntry &newest = entries.back();
+                const std::string path = logDownloadDir + "/vehicle" + std::to_string(vehicleId) + "_log" + std::to_string(newest.id) + ".bin";
+                downloader->downloadLog(newest, path, [vehicleId, path](const LogDownloader::Result &result) {
+                    char rate[32];
+                    snprintf(rate, sizeof(rate), "%.1f", result.kilobytesPerSecond());
+                    logMessage("Vehicle " + std::to_string(vehicleId) + " log " + (result.success ?
+                               "saved to " + path + " at " + rate + " KB/s" : "download failed: " + result.error));
+                });
+            });
+        });
     });
 
+    // Frames reach the vehicle manager from here on, it is fully configured
+    g_vehicleManager->start();
+
     logMessage("Connected! Waiting for vehicle data...");
     logMessage("Press Ctrl+C to stop.");
 
@@ -636,6 +621,16 @@ int main(int argc, char* argv[])
     
     while (g_running) {
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        // The first vehicle discovered is printed
+        if (!g_vehicle) {
+            g_vehicle = g_vehicleManager->activeVehicle();
+        }
+        
+        if (g_traceExportRequested.exchange(false)) {
+            logMessage(PipelineTrace::writeChromeTrace(traceOutputPath) ?
+                       "Pipeline trace written to " + traceOutputPath : "Could not write pipeline trace to " + traceOutputPath);
+        }
         
         // Print and log telemetry data periodically
         auto now = std::chrono::steady_clock::now();
@@ -645,6 +640,9 @@ int main(int argc, char* argv[])
             
             if (showStats) {
                 printConnectionStats(g_connection.get());
+                if (AllocationCounter::enabled()) {
+                    logMessage(AllocationCounter::formatReport(AllocationCounter::report()));
+                }
             }
             
             lastPrintTime = now;
@@ -654,12 +652,25 @@ int main(int argc, char* argv[])
     // Final statistics
     logMessage("\n=== Final Statistics ===");
     printConnectionStats(g_connection.get());
-    printVehicleInfo(g_vehicle.get());
+    if (AllocationCounter::enabled()) {
+        logMessage(AllocationCounter::formatReport(AllocationCounter::report()));
+    }
+    for (const auto& vehicle : g_vehicleManager->vehicles()) {
+        printVehicleInfo(vehicle.get());
+    }
 
     logMessage("\nShutting down...");
     
-    // Cleanup
+    // Cleanup, the receive thread stops first so no vehicle is added meanwhile
+    g_connection->disconnect();
+    g_queryServer.stop();
+    g_subscriptionManager.detach();
+    g_rollups.detach();
+    Logger::instance().shutdown();
+    g_factPublishers.clear();
     g_vehicle.reset();
+    g_vehicleManagerReady = false;
+    g_vehicleManager.reset();
     g_connection.reset();
     
     if (g_dataLog.is_open()) {